@@ -81,6 +81,25 @@ int main() {
         << "Test for addTo() failed: wrong size.\n\n";  
 
   /*
-   */   
+   *  test multiplyBy(): (A*B^T)*(B*A^T) has rank 2
+   */
+  MatrixLowRank P(A,B), Q(B,A);
+  P.multiplyBy(Q);
+  MatrixXd Pe = P*MatrixXd::Identity(P.cols(),P.cols());
+  if ( (Pe - A*B.transpose()*B*A.transpose()).norm() < tol*Pe.norm() && P.rank() == 2)
+    std::cout << "Test for multiplyBy() passed!\n\n";
+  else
+    std::cout << "Test for multiplyBy() failed.\n\n";
+
+  /*
+   *  addTo() for large matrices: only r x r matrices are decomposed
+   */
+  const int m = 100000, n = 50000, r = 10;
+  MatrixLowRank X(MatrixXd::Random(m,r), MatrixXd::Random(n,r));
+  MatrixLowRank Y(MatrixXd::Random(m,r), MatrixXd::Random(n,r));
+  X.addTo(Y);
+  std::cout << "Sum of two rank-" << r << " matrices of size " << m << " x "
+            << n << ": rank " << X.rank() << "\n";
+
   return 0;
 }
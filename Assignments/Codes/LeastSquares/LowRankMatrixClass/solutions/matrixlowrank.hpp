@@ -20,10 +20,15 @@ public:
 
   Eigen::MatrixXd operator*(const Eigen::MatrixXd &)const;
   MatrixLowRank &operator*=(const Eigen::MatrixXd &);
+  MatrixLowRank &multiplyBy(const MatrixLowRank &, double rtol = 1E-6,
+                            double atol = 1E-8);
   MatrixLowRank &addTo(const MatrixLowRank &, double rtol = 1E-6,
                        double atol = 1E-8);
 
 private:
+  // Truncated SVD of _A*_B.transpose() with cost O((m+n)r^2)
+  void recompress(double rtol, double atol);
+
   unsigned int _m;    // no. of rows
   unsigned int _n;    // no. of columns
   unsigned int _r;    // maximal rank, =1 for zero matrix
@@ -83,19 +88,32 @@ MatrixLowRank &MatrixLowRank::addTo(const MatrixLowRank &X, double rtol,
   // We have this = _A*_B.transpose() and
   // X = X._A*X._B.transpose()
   // START
-  unsigned int r = _r, s = X._r;
   // We will have X+this = Atilde*Btilde.transpose()
-  MatrixXd Atilde(_m, r + s), Btilde(_n, r + s);
+  MatrixXd Atilde(_m, _r + X._r), Btilde(_n, _r + X._r);
   Atilde << _A, X._A;
   Btilde << _B, X._B;
+  _A = Atilde;
+  _B = Btilde;
+  _r = _r + X._r;
+  recompress(rtol, atol);
+  // END
+  return *this;
+}
+/* SAM_LISTING_END_5 */
 
-  // Calculate the QR decomposition of Atilde and Btilde.
-  HouseholderQR<MatrixXd> qrA(Atilde);
-  HouseholderQR<MatrixXd> qrB(Btilde);
-  MatrixXd RA = qrA.matrixQR().triangularView<Upper>();
-  MatrixXd RB = qrB.matrixQR().triangularView<Upper>();
-
-  // We need the full SVD of RR = RA * RB.transpose()
+/* SAM_LISTING_BEGIN_6 */
+void MatrixLowRank::recompress(double rtol, double atol) {
+  assert(rtol > 0 && atol > 0 && "Tolerances must be positive!");
+  assert(_r <= std::min(_m, _n) && "Rank too large!");
+  // Thin QR decompositions A = QA*RA, B = QB*RB with r x r factors RA, RB:
+  // A*B.transpose() = QA*(RA*RB.transpose())*QB.transpose()
+  const unsigned int r = _r;
+  HouseholderQR<MatrixXd> qrA(_A);
+  HouseholderQR<MatrixXd> qrB(_B);
+  MatrixXd RA = qrA.matrixQR().topRows(r).triangularView<Upper>();
+  MatrixXd RB = qrB.matrixQR().topRows(r).triangularView<Upper>();
+
+  // SVD of the small r x r matrix RA*RB.transpose() only
   JacobiSVD<MatrixXd> svdRR(RA * RB.transpose(), ComputeFullU | ComputeFullV);
 
   // Rank of the sum X+this is the (numerical) rank of RA*RB.transpose().
@@ -107,7 +125,7 @@ MatrixLowRank &MatrixLowRank::addTo(const MatrixLowRank &X, double rtol,
     _r = 1;
     _A = MatrixXd::Zero(_m, 1);
     _B = MatrixXd::Zero(_n, 1);
-    return *this;
+    return;
   }
 
   unsigned int rtilde = 1;
@@ -118,11 +136,29 @@ MatrixLowRank &MatrixLowRank::addTo(const MatrixLowRank &X, double rtol,
     rtilde++;
   }
 
+  // Only the first r columns of the Householder factors are needed
+  MatrixXd UA = MatrixXd::Zero(_m, rtilde), VB = MatrixXd::Zero(_n, rtilde);
+  UA.topRows(r) = svdRR.matrixU().leftCols(rtilde) *
+                  Sigma.head(rtilde).asDiagonal();
+  VB.topRows(r) = svdRR.matrixV().leftCols(rtilde);
+  UA.applyOnTheLeft(qrA.householderQ());
+  VB.applyOnTheLeft(qrB.householderQ());
   _r = rtilde;
-  _A = qrA.householderQ() * svdRR.matrixU().leftCols(rtilde) *
-       Sigma.head(rtilde).asDiagonal();
-  _B = qrB.householderQ() * svdRR.matrixV().leftCols(rtilde);
-  // END
+  _A = UA;
+  _B = VB;
+}
+/* SAM_LISTING_END_6 */
+
+/* SAM_LISTING_BEGIN_7 */
+MatrixLowRank &MatrixLowRank::multiplyBy(const MatrixLowRank &X, double rtol,
+                                         double atol) {
+  assert(_n == X._m && "Inner dimensions must agree!");
+  // (A*B.transpose())*(X.A*X.B.transpose()) = (A*(B.transpose()*X.A))*X.B^T
+  _A = _A * (_B.transpose() * X._A);
+  _B = X._B;
+  _n = X._n;
+  _r = X._r;
+  recompress(rtol, atol);
   return *this;
 }
-/* SAM_LISTING_END_5 */
+/* SAM_LISTING_END_7 */
@@ -15,10 +15,15 @@ class MatrixLowRank {
 
   Eigen::MatrixXd operator*(const Eigen::MatrixXd &) const;
   MatrixLowRank &operator*=(const Eigen::MatrixXd &);
+  MatrixLowRank &multiplyBy(const MatrixLowRank &, double rtol = 1E-6,
+                            double atol = 1E-8);
   MatrixLowRank &addTo(const MatrixLowRank &, double rtol = 1E-6,
                        double atol = 1E-8);
 
  private:
+  // Truncated SVD of _A*_B.transpose() with cost O((m+n)r^2)
+  void recompress(double rtol, double atol);
+
   unsigned int _m;     // number of rows
   unsigned int _n;     // number of columns
   unsigned int _r;     // maximal rank, =1 for zero matrix
@@ -91,33 +96,48 @@ MatrixLowRank &MatrixLowRank::addTo(const MatrixLowRank &X, double rtol,
   // Note: This function should be efficient.
 
   // START
-  const unsigned int r = _r, s = X._r;
   // We will have X+this = Atilde*Btilde.transpose()
-  Eigen::MatrixXd Atilde(_m, r + s), Btilde(_n, r + s);
+  Eigen::MatrixXd Atilde(_m, _r + X._r), Btilde(_n, _r + X._r);
   Atilde << _A, X._A;
   Btilde << _B, X._B;
+  _A = Atilde;
+  _B = Btilde;
+  _r = _r + X._r;
+  recompress(rtol, atol);
+  // END
 
-  // Calculate the QR decomposition of Atilde and Btilde.
-  Eigen::HouseholderQR<Eigen::MatrixXd> qrA(Atilde);
-  Eigen::HouseholderQR<Eigen::MatrixXd> qrB(Btilde);
-  Eigen::MatrixXd RA = qrA.matrixQR().triangularView<Eigen::Upper>();
-  Eigen::MatrixXd RB = qrB.matrixQR().triangularView<Eigen::Upper>();
+  return *this;
+}
+/* SAM_LISTING_END_5 */
 
-  // We need the full SVD of RR = RA * RB.transpose()
+/* SAM_LISTING_BEGIN_6 */
+void MatrixLowRank::recompress(double rtol, double atol) {
+  assert(rtol > 0 && atol > 0 && "Tolerances must be positive!");
+  assert(_r <= std::min(_m, _n) && "Rank too large!");
+  // Thin QR decompositions A = QA*RA, B = QB*RB with r x r factors RA, RB:
+  // A*B.transpose() = QA*(RA*RB.transpose())*QB.transpose()
+  const unsigned int r = _r;
+  Eigen::HouseholderQR<Eigen::MatrixXd> qrA(_A);
+  Eigen::HouseholderQR<Eigen::MatrixXd> qrB(_B);
+  Eigen::MatrixXd RA =
+      qrA.matrixQR().topRows(r).triangularView<Eigen::Upper>();
+  Eigen::MatrixXd RB =
+      qrB.matrixQR().topRows(r).triangularView<Eigen::Upper>();
+
+  // SVD of the small r x r matrix RA*RB.transpose() only
   Eigen::JacobiSVD<Eigen::MatrixXd> svdRR(
       RA * RB.transpose(), Eigen::ComputeFullU | Eigen::ComputeFullV);
 
-  // Rank of the sum X+this is the (numerical) rank of RA*RB.transpose().
+  // Rank of the product is the (numerical) rank of RA*RB.transpose().
   Eigen::VectorXd Sigma = svdRR.singularValues();
   const double sigma1 = Sigma[0];
-  // Take care of the case sigma1=0, i.e. X+this = 0.
+  // Take care of the case sigma1=0, i.e. a zero matrix.
   // Follow the convention for storing the zero matrix
   if (sigma1 < atol) {
     _r = 1;
     _A = Eigen::MatrixXd::Zero(_m, 1);
     _B = Eigen::MatrixXd::Zero(_n, 1);
-
-    return *this;
+    return;
   }
 
   unsigned int rtilde = 1;
@@ -128,12 +148,36 @@ MatrixLowRank &MatrixLowRank::addTo(const MatrixLowRank &X, double rtol,
     rtilde++;
   }
 
+  // Only the first r columns of the Householder factors are needed
+  Eigen::MatrixXd UA = Eigen::MatrixXd::Zero(_m, rtilde);
+  Eigen::MatrixXd VB = Eigen::MatrixXd::Zero(_n, rtilde);
+  UA.topRows(r) =
+      svdRR.matrixU().leftCols(rtilde) * Sigma.head(rtilde).asDiagonal();
+  VB.topRows(r) = svdRR.matrixV().leftCols(rtilde);
+  UA.applyOnTheLeft(qrA.householderQ());
+  VB.applyOnTheLeft(qrB.householderQ());
   _r = rtilde;
-  _A = qrA.householderQ() * svdRR.matrixU().leftCols(rtilde) *
-       Sigma.head(rtilde).asDiagonal();
-  _B = qrB.householderQ() * svdRR.matrixV().leftCols(rtilde);
+  _A = UA;
+  _B = VB;
+}
+/* SAM_LISTING_END_6 */
+
+/* SAM_LISTING_BEGIN_7 */
+MatrixLowRank &MatrixLowRank::multiplyBy(const MatrixLowRank &X, double rtol,
+                                         double atol) {
+  assert(_n == X._m && "Inner dimensions must agree!");
+  // TODO: Replace the m x n-matrix stored in this class by
+  // trunc_tol(M * X), where X is of type MatrixLowRank.
+
+  // START
+  // (A*B.transpose())*(X.A*X.B.transpose()) = (A*(B.transpose()*X.A))*X.B^T
+  _A = _A * (_B.transpose() * X._A);
+  _B = X._B;
+  _n = X._n;
+  _r = X._r;
+  recompress(rtol, atol);
   // END
 
   return *this;
 }
-/* SAM_LISTING_END_5 */
+/* SAM_LISTING_END_7 */
@@ -80,6 +80,25 @@ TEST_SUITE("LowRankMatrix") {
     CHECK(err_stud == doctest::Approx(0.).epsilon(data.tol));
   }
 
+  // Test multiplyBy()
+  TEST_CASE("MatrixLowRank_TEST &multiplyBy" *
+            doctest::description("multiplyBy")) {
+    MatrixLowRank_TEST P = MatrixLowRank_TEST(data.A, data.B);
+    P.multiplyBy(MatrixLowRank_TEST(data.B, data.A));
+
+    // Multiply with identity so we actually get an eigen matrix to work with.
+    Eigen::MatrixXd Id = Eigen::MatrixXd::Identity(P.cols(), P.cols());
+    Eigen::MatrixXd Pe_stud = P * Id;  // Eigen version of P.
+    const Eigen::MatrixXd Pe =
+        data.A * data.B.transpose() * data.B * data.A.transpose();
+
+    REQUIRE(Pe_stud.cols() == Pe.cols());
+    REQUIRE(Pe_stud.rows() == Pe.rows());
+    const double err_stud = (Pe_stud - Pe).norm() / Pe.norm();
+    CHECK(err_stud == doctest::Approx(0.).epsilon(data.tol));
+    CHECK(P.rank() == 2);
+  }
+
   // Test addTo()
   TEST_CASE("MatrixLowRank_TEST &addTo" * doctest::description("addTo")) {
     MatrixLowRank_TEST N = MatrixLowRank_TEST(data.E, data.F);
@@ -78,6 +78,28 @@ int main() {
     std::cout << "Test for addTo() failed: wrong size.\n\n";
 
   /*
+   *  test multiplyBy(): (A*B^T)*(B*A^T) has rank 2
    */
+  MatrixLowRank P(A, B), Q(B, A);
+  P.multiplyBy(Q);
+  Eigen::MatrixXd Pe =
+      P * Eigen::MatrixXd::Identity(P.cols(), P.cols());  // Eigen version of P
+  const Eigen::MatrixXd AB = A * B.transpose() * B * A.transpose();
+  if (Pe.cols() == AB.cols() && Pe.rows() == AB.rows() &&
+      (Pe - AB).norm() < tol * AB.norm() && P.rank() == 2)
+    std::cout << "Test for multiplyBy() passed!\n\n";
+  else
+    std::cout << "Test for multiplyBy() failed.\n\n";
+
+  /*
+   *  addTo() for large matrices: only r x r matrices are decomposed
+   */
+  const int m = 100000, n = 50000, r = 10;
+  MatrixLowRank X(Eigen::MatrixXd::Random(m, r), Eigen::MatrixXd::Random(n, r));
+  MatrixLowRank Y(Eigen::MatrixXd::Random(m, r), Eigen::MatrixXd::Random(n, r));
+  X.addTo(Y);
+  std::cout << "Sum of two rank-" << r << " matrices of size " << m << " x "
+            << n << ": rank " << X.rank() << "\n";
+
   return 0;
 }
@@ -15,6 +15,8 @@ class MatrixLowRank {
 
   Eigen::MatrixXd operator*(const Eigen::MatrixXd &) const;
   MatrixLowRank &operator*=(const Eigen::MatrixXd &);
+  MatrixLowRank &multiplyBy(const MatrixLowRank &, double rtol = 1E-6,
+                            double atol = 1E-8);
   MatrixLowRank &addTo(const MatrixLowRank &, double rtol = 1E-6,
                        double atol = 1E-8);
 
@@ -96,3 +98,18 @@ MatrixLowRank &MatrixLowRank::addTo(const MatrixLowRank &X, double rtol,
   return *this;
 }
 /* SAM_LISTING_END_5 */
+
+/* SAM_LISTING_BEGIN_7 */
+MatrixLowRank &MatrixLowRank::multiplyBy(const MatrixLowRank &X, double rtol,
+                                         double atol) {
+  assert(_n == X._m && "Inner dimensions must agree!");
+  // TODO: Replace the m x n-matrix stored in this class by
+  // trunc_tol(M * X), where X is of type MatrixLowRank.
+
+  // START
+
+  // END
+
+  return *this;
+}
+/* SAM_LISTING_END_7 */
@@ -2,6 +2,7 @@
 #define CROSS_HPP
 
 #include <Eigen/Dense>
+#include <algorithm>
 #include <iomanip>
 #include <iostream>
 #include <vector>
@@ -129,6 +130,17 @@ void tab_crossprod() {
   }
   // END
   /* SAM_LISTING_END_4 */
+
+  // The implicit midpoint method once more, stage equation solved by the
+  // simplified Newton method
+  std::vector<Eigen::VectorXd> res_sn =
+      RK.solveSimplifiedNewton(f, Jf, T, y0, N);
+  double diff = 0.;
+  for (unsigned int i = 0; i < N + 1; ++i) {
+    diff = std::max(diff, (res_sn[i] - res_imp[i]).norm());
+  }
+  std::cout << "\n3. Implicit midpoint method, simplified Newton: "
+            << "max. difference to 1. " << diff << std::endl;
 }
 
 #endif
@@ -8,6 +8,7 @@
 #include <vector>
 
 #include "dampnewton.hpp"
+#include "irkstagesolver.hpp"
 
 /**
  * \brief Implements a Runge-Kutta implicit solver for a
@@ -80,6 +81,41 @@ class implicitRKIntegrator {
     return res;
   }
 
+  /**
+   * \brief Same as solve(), but the stage equations are solved by a
+   * simplified Newton method with frozen Jacobian, see IRKStageSolver: Df
+   * and the LU-decompositions are reused across steps, and for invertible,
+   * diagonalizable A only systems of size n are solved. The iteration is
+   * continued to a relative tolerance of 1e-10, whereas solve() stops the
+   * damped Newton method at the (loose) default tolerances of dampnewton().
+   * If the simplified Newton method fails, step() is used.
+   * \tparam Jacobian Jf may also return an Eigen::SparseMatrix<double>
+   */
+  template <class Function, class Jacobian>
+  std::vector<Eigen::VectorXd> solveSimplifiedNewton(Function &&f,
+                                                     Jacobian &&Jf, double T,
+                                                     const Eigen::VectorXd &y0,
+                                                     unsigned int N) const {
+    const double h = T / N;
+    std::vector<Eigen::VectorXd> res;
+    res.reserve(N + 1);
+    res.push_back(y0);
+    // Stage solver, keeps the frozen Jacobian from step to step
+    IRKStageSolver<std::decay_t<decltype(Jf(y0))>> stages(A, b, h);
+    // step() needs a dense Jacobian
+    auto Jdense = [&Jf](const Eigen::VectorXd &y) {
+      return Eigen::MatrixXd(Jf(y));
+    };
+    Eigen::VectorXd y1;
+    for (unsigned int k = 0; k < N; ++k) {
+      if (!stages.step(f, Jf, res.back(), y1)) {
+        step(f, Jdense, h, res.back(), y1);
+      }
+      res.push_back(y1);
+    }
+    return res;
+  }
+
  private:
   /**
    * \brief Perform a single step of the RK method for the
@@ -70,4 +70,19 @@ int main() {
     std::cout << std::endl;
   }
   /* SAM_LISTING_END_1 */
+
+  // Same study, stage equations solved by the simplified Newton method
+  std::cout << "\nSimplified Newton method" << std::endl;
+  std::cout << std::setw(15) << "N" << std::setw(15) << "error" << std::setw(15)
+            << "rate" << std::endl;
+  for (unsigned int i = 0; i < N.size(); ++i) {
+    auto res = RK.solveSimplifiedNewton(f, Jf, T, y0, N[i]);
+    double err = (res.back() - yex).norm();
+    std::cout << std::setw(15) << N[i] << std::setw(15) << err;
+    if (i > 0) {
+      std::cout << std::setw(15) << log2(errold / err);
+    }
+    errold = err;
+    std::cout << std::endl;
+  }
 }
@@ -41,5 +41,10 @@ macro (add_executable_numcse _name)
 
     # link with python3
     target_link_libraries(${target_name} ${Python3_LIBRARIES})
+
+    # link with the thread library (for std::thread)
+    if (TARGET Threads::Threads)
+      target_link_libraries(${target_name} Threads::Threads)
+    endif()
   endif()
 endmacro()
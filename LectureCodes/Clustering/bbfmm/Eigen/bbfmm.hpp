@@ -0,0 +1,423 @@
+#pragma once
+
+#include <Eigen/Dense>
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstdint>
+#include <numeric>
+#include <unordered_map>
+#include <vector>
+
+#include "parallel.hpp"
+
+/* Black-box fast multipole method [Fong, Darve, J. Comput. Phys. 228
+ * (2009)] for the kernel matrix-vector product
+ *   y_i = sum_j K(x_i, x_j) x_j,   i = 1, ..., N,
+ * with points x_i given by the columns of X in R^{d,N}, d = 1, 2, 3, and
+ * a kernel K(x, y) that is smooth for x != y, e.g. 1/|x - y|, log|x - y|
+ * or exp(-|x - y|^2). Only evaluations of K are needed, no expansions.
+ *
+ * The bounding cube of the points is subdivided uniformly into 2^d boxes
+ * per level down to about leaf_size points per box; only non-empty boxes
+ * are stored, the points are sorted by the Morton (Z-order) index of
+ * their leaf, so that every box holds a contiguous range at every level.
+ * Two boxes of the same level are well separated if they are not
+ * adjacent. In every box B, K(x, y) is interpolated by tensor products of
+ * Lagrange polynomials L_a^B in the q^d Chebyshev nodes xi_a^B, so that
+ * for well separated boxes B, C
+ *   sum_{j in C} K(x_i, x_j) x_j ~ sum_a L_a^B(x_i)
+ *      sum_b K(xi_a^B, xi_b^C) W_b^C,   W_b^C = sum_{j in C} L_b^C(x_j) x_j.
+ * Upward pass: the moments W of a leaf are computed from its points
+ * (P2M), those of a parent from its children by interpolation (M2M).
+ * Downward pass: every box collects K(xi^B, xi^C) W^C from its
+ * interaction list, the children of the neighbours of its parent that are
+ * not its neighbours (M2L), and the local values of its parent (L2L); at
+ * the leaves they are interpolated to the points (L2P) and the
+ * contributions of the neighbouring leaves are summed up directly (P2P).
+ * Every step is O(q^{2d}) per box, hence O(N) for N points; the accuracy
+ * is controlled by q, the error decreases exponentially in q.
+ * This assumes quasi-uniformly distributed points: the depth of the tree
+ * only depends on N, not on the points, so for strongly clustered points
+ * a leaf may hold many more than leaf_size points, and the direct P2P sums
+ * in it grow quadratically (up to O(N^2) if all points share a few
+ * leaves). Such point sets need an adaptive tree with leaves of bounded
+ * size instead.
+ * For translation invariant kernels, K(x + z, y + z) = K(x, y), the M2L
+ * matrices only depend on the level and the relative position of the
+ * boxes, at most 7^d - 3^d per level, and are precomputed. The boxes of a
+ * level are processed in parallel in all passes; every box writes only
+ * its own moments, local values or points. */
+
+struct FmmOptions {
+  unsigned int order = 5;            // q, Chebyshev nodes per direction
+  Eigen::Index leaf_size = 64;       // average points per leaf, roughly
+  bool translation_invariant = true;  // precompute M2L matrices
+  unsigned int num_threads = 0;
+};
+
+template <int d, class Kernel>
+class BlackBoxFmm {
+ public:
+  using Points = Eigen::Matrix<double, d, Eigen::Dynamic>;
+  using Point = Eigen::Matrix<double, d, 1>;
+
+  BlackBoxFmm(const Points &X, const Kernel &K, const FmmOptions &opt = {});
+
+  Eigen::Index rows() const { return Xp_.cols(); }
+  unsigned int levels() const { return boxes_.size() - 1; }
+  std::size_t numBoxes() const {
+    std::size_t n = 0;
+    for (const auto &l : boxes_) n += l.size();
+    return n;
+  }
+
+  Eigen::VectorXd operator*(const Eigen::VectorXd &x) const;
+
+ private:
+  struct Box {
+    std::array<int, d> ix;      // integer coordinates on its level
+    Eigen::Index begin, end;    // points in the order of Xp_
+    int parent = -1, octant = 0;
+    std::vector<int> children, inter, near;
+  };
+
+  static std::uint64_t morton(const std::array<int, d> &ix, unsigned int l) {
+    std::uint64_t key = 0;
+    for (unsigned int b = 0; b < l; ++b) {
+      for (int k = 0; k < d; ++k) {
+        key |= std::uint64_t((ix[k] >> b) & 1) << (b * d + k);
+      }
+    }
+    return key;
+  }
+  Point center(unsigned int l, const Box &B) const {
+    const double w = 2. * h_ / (1 << l);
+    Point c;
+    for (int k = 0; k < d; ++k) c(k) = lo_(k) + (B.ix[k] + 0.5) * w;
+    return c;
+  }
+  // values of the 1-D Lagrange polynomials at t in [-1,1]
+  void lagrange(double t, double *l) const {
+    for (int k = 0; k < q_; ++k) {
+      double v = cheb_w_(k);
+      for (int m = 0; m < q_; ++m) {
+        if (m != k) v *= t - cheb_(m);
+      }
+      l[k] = v;
+    }
+  }
+  // L(i, a) = L_a^B(x_i) for the points of the box B on level l
+  Eigen::MatrixXd basis(unsigned int l, const Box &B) const;
+  // Chebyshev nodes of a box with center c and half width hw
+  Points nodes(const Point &c, double hw) const {
+    Points P(d, nq_);
+    for (int a = 0; a < nq_; ++a) {
+      for (int k = 0; k < d; ++k) P(k, a) = c(k) + hw * cheb_(multi_(k, a));
+    }
+    return P;
+  }
+  Eigen::MatrixXd m2l(const Points &xi, const Points &et) const {
+    Eigen::MatrixXd M(nq_, nq_);
+    for (int b = 0; b < nq_; ++b) {
+      for (int a = 0; a < nq_; ++a) M(a, b) = K_(xi.col(a), et.col(b));
+    }
+    return M;
+  }
+  static int offsetIndex(const std::array<int, d> &a,
+                         const std::array<int, d> &b) {
+    int idx = 0;
+    for (int k = d - 1; k >= 0; --k) idx = 7 * idx + (b[k] - a[k] + 3);
+    return idx;
+  }
+
+  FmmOptions opt_;
+  Kernel K_;
+  int q_, nq_;
+  Eigen::VectorXd cheb_, cheb_w_;  // Chebyshev nodes on [-1,1], weights
+  Eigen::Matrix<int, d, Eigen::Dynamic> multi_;  // multi-indices of nodes
+  Point lo_;   // corner of the bounding cube
+  double h_;   // its half width
+  Points Xp_;  // points sorted by boxes
+  Eigen::VectorXi perm_;
+  std::vector<std::vector<Box>> boxes_;  // non-empty boxes of every level
+  std::vector<Eigen::MatrixXd> m2m_;     // for the 2^d octants
+  std::vector<std::vector<Eigen::MatrixXd>> m2l_;  // [level][offset]
+};
+
+template <int d, class Kernel>
+BlackBoxFmm<d, Kernel>::BlackBoxFmm(const Points &X, const Kernel &K,
+                                    const FmmOptions &opt)
+    : opt_(opt), K_(K), q_(opt.order) {
+  const Eigen::Index N = X.cols();
+  // Chebyshev nodes, barycentric weights and multi-indices
+  cheb_.resize(q_);
+  cheb_w_.resize(q_);
+  for (int k = 0; k < q_; ++k) {
+    cheb_(k) = std::cos(M_PI * (2 * k + 1) / (2 * q_));
+  }
+  for (int k = 0; k < q_; ++k) {
+    double w = 1.;
+    for (int m = 0; m < q_; ++m) {
+      if (m != k) w *= cheb_(k) - cheb_(m);
+    }
+    cheb_w_(k) = 1. / w;
+  }
+  nq_ = 1;
+  for (int k = 0; k < d; ++k) nq_ *= q_;
+  multi_.resize(d, nq_);
+  for (int a = 0; a < nq_; ++a) {
+    for (int k = 0, r = a; k < d; ++k, r /= q_) multi_(k, a) = r % q_;
+  }
+
+  // Bounding cube and number of levels
+  const Point xmin = X.rowwise().minCoeff(), xmax = X.rowwise().maxCoeff();
+  h_ = std::max(0.5 * (xmax - xmin).maxCoeff(), 1e-300) * (1. + 1e-12);
+  lo_ = 0.5 * (xmin + xmax) - Point::Constant(h_);
+  // average number of points per leaf within a factor 2^{d/2} of leaf_size
+  unsigned int L = 0;
+  while (L < 60 / d && N > opt.leaf_size * std::sqrt(double(1 << d)) *
+                               double(Eigen::Index(1) << (d * L))) {
+    ++L;
+  }
+  L = std::max(L, 2u);
+
+  // Sort the points by the Morton index of their leaf
+  const int n1 = 1 << L;
+  std::vector<std::array<int, d>> ix(N);
+  std::vector<std::uint64_t> key(N);
+  for (Eigen::Index i = 0; i < N; ++i) {
+    for (int k = 0; k < d; ++k) {
+      ix[i][k] = std::min(
+          n1 - 1, int((X(k, i) - lo_(k)) / (2. * h_) * n1));
+    }
+    key[i] = morton(ix[i], L);
+  }
+  std::vector<int> order(N);
+  std::iota(order.begin(), order.end(), 0);
+  std::stable_sort(order.begin(), order.end(),
+                   [&](int i, int j) { return key[i] < key[j]; });
+  perm_ = Eigen::Map<Eigen::VectorXi>(order.data(), N);
+  Xp_.resize(d, N);
+  for (Eigen::Index i = 0; i < N; ++i) Xp_.col(i) = X.col(perm_(i));
+
+  // Boxes: runs of equal keys on the leaf level, runs of equal parents
+  // above
+  boxes_.resize(L + 1);
+  for (Eigen::Index i = 0; i < N;) {
+    Eigen::Index j = i;
+    while (j < N && key[perm_(j)] == key[perm_(i)]) ++j;
+    boxes_[L].push_back(Box{ix[perm_(i)], i, j});
+    i = j;
+  }
+  for (unsigned int l = L; l > 0; --l) {
+    for (std::size_t b = 0; b < boxes_[l].size(); ++b) {
+      Box &B = boxes_[l][b];
+      std::array<int, d> p;
+      int o = 0;
+      for (int k = 0; k < d; ++k) {
+        p[k] = B.ix[k] >> 1;
+        o |= (B.ix[k] & 1) << k;
+      }
+      auto &up = boxes_[l - 1];
+      if (up.empty() || up.back().ix != p) {
+        up.push_back(Box{p, B.begin, B.end});
+      }
+      up.back().end = B.end;
+      up.back().children.push_back(b);
+      B.parent = up.size() - 1;
+      B.octant = o;
+    }
+  }
+
+  // Interaction lists and near field of the leaves
+  std::vector<std::unordered_map<std::uint64_t, int>> index(L + 1);
+  for (unsigned int l = 0; l <= L; ++l) {
+    for (std::size_t b = 0; b < boxes_[l].size(); ++b) {
+      index[l][morton(boxes_[l][b].ix, l)] = b;
+    }
+  }
+  const auto adjacent = [](const std::array<int, d> &a,
+                           const std::array<int, d> &b) {
+    for (int k = 0; k < d; ++k) {
+      if (std::abs(a[k] - b[k]) > 1) return false;
+    }
+    return true;
+  };
+  // neighbours of box b on level l, including b
+  const auto neighbours = [&](unsigned int l, const Box &B) {
+    std::vector<int> nb;
+    int nn = 1;
+    for (int k = 0; k < d; ++k) nn *= 3;
+    for (int r = 0; r < nn; ++r) {
+      std::array<int, d> c = B.ix;
+      bool inside = true;
+      for (int k = 0, s = r; k < d; ++k, s /= 3) {
+        c[k] += s % 3 - 1;
+        inside = inside && c[k] >= 0 && c[k] < (1 << l);
+      }
+      if (!inside) continue;
+      const auto it = index[l].find(morton(c, l));
+      if (it != index[l].end()) nb.push_back(it->second);
+    }
+    return nb;
+  };
+  for (unsigned int l = 2; l <= L; ++l) {
+    parallelFor(
+        boxes_[l].size(),
+        [&](std::size_t b0, std::size_t b1, unsigned int) {
+          for (std::size_t b = b0; b < b1; ++b) {
+            Box &B = boxes_[l][b];
+            for (int pn : neighbours(l - 1, boxes_[l - 1][B.parent])) {
+              for (int c : boxes_[l - 1][pn].children) {
+                if (!adjacent(B.ix, boxes_[l][c].ix)) B.inter.push_back(c);
+              }
+            }
+            if (l == L) B.near = neighbours(l, B);
+          }
+        },
+        opt_.num_threads);
+  }
+
+  // M2M: parent basis at the nodes of the children of every octant
+  std::vector<double> lg(q_);
+  for (int o = 0; o < (1 << d); ++o) {
+    Eigen::MatrixXd T(nq_, nq_);
+    for (int b = 0; b < nq_; ++b) {
+      Eigen::MatrixXd l1(q_, d);
+      for (int k = 0; k < d; ++k) {
+        lagrange(0.5 * (cheb_(multi_(k, b)) + 2. * ((o >> k) & 1) - 1.),
+                 lg.data());
+        for (int m = 0; m < q_; ++m) l1(m, k) = lg[m];
+      }
+      for (int a = 0; a < nq_; ++a) {
+        double v = 1.;
+        for (int k = 0; k < d; ++k) v *= l1(multi_(k, a), k);
+        T(a, b) = v;
+      }
+    }
+    m2m_.push_back(T);
+  }
+
+  // M2L matrices for all relative positions on every level
+  if (opt_.translation_invariant) {
+    int no = 1;
+    for (int k = 0; k < d; ++k) no *= 7;
+    m2l_.resize(L + 1);
+    for (unsigned int l = 2; l <= L; ++l) {
+      m2l_[l].resize(no);
+      const double w = 2. * h_ / (1 << l);
+      parallelFor(
+          no,
+          [&](std::size_t o0, std::size_t o1, unsigned int) {
+            for (std::size_t o = o0; o < o1; ++o) {
+              Point c;
+              bool far = false;
+              for (int k = 0, s = o; k < d; ++k, s /= 7) {
+                c(k) = (s % 7 - 3) * w;
+                far = far || std::abs(s % 7 - 3) > 1;
+              }
+              if (far) {
+                m2l_[l][o] =
+                    m2l(nodes(Point::Zero(), 0.5 * w), nodes(c, 0.5 * w));
+              }
+            }
+          },
+          opt_.num_threads);
+    }
+  }
+}
+
+template <int d, class Kernel>
+Eigen::MatrixXd BlackBoxFmm<d, Kernel>::basis(unsigned int l,
+                                              const Box &B) const {
+  const Point c = center(l, B);
+  const double hw = h_ / (1 << l);
+  Eigen::MatrixXd S(B.end - B.begin, nq_), l1(q_, d);
+  for (Eigen::Index i = B.begin; i < B.end; ++i) {
+    for (int k = 0; k < d; ++k) {
+      lagrange((Xp_(k, i) - c(k)) / hw, l1.col(k).data());
+    }
+    for (int a = 0; a < nq_; ++a) {
+      double v = 1.;
+      for (int k = 0; k < d; ++k) v *= l1(multi_(k, a), k);
+      S(i - B.begin, a) = v;
+    }
+  }
+  return S;
+}
+
+/* SAM_LISTING_BEGIN_0 */
+template <int d, class Kernel>
+Eigen::VectorXd BlackBoxFmm<d, Kernel>::operator*(
+    const Eigen::VectorXd &x) const {
+  const Eigen::Index N = rows();
+  const unsigned int L = levels();
+  Eigen::VectorXd xp(N), yp(N);
+  for (Eigen::Index i = 0; i < N; ++i) xp(i) = x(perm_(i));
+  // boxes of level l in parallel
+  const auto forBoxes = [&](unsigned int l, auto &&body) {
+    parallelFor(
+        boxes_[l].size(),
+        [&](std::size_t b0, std::size_t b1, unsigned int) {
+          for (std::size_t b = b0; b < b1; ++b) body(boxes_[l][b], b);
+        },
+        opt_.num_threads);
+  };
+  std::vector<Eigen::MatrixXd> W(L + 1), loc(L + 1);
+  for (unsigned int l = 2; l <= L; ++l) {
+    W[l] = Eigen::MatrixXd::Zero(nq_, boxes_[l].size());
+    loc[l] = Eigen::MatrixXd::Zero(nq_, boxes_[l].size());
+  }
+  // Upward pass: P2M on the leaves, M2M
+  forBoxes(L, [&](const Box &B, std::size_t b) {
+    W[L].col(b) = basis(L, B).transpose() * xp.segment(B.begin,
+                                                       B.end - B.begin);
+  });
+  for (unsigned int l = L - 1; l >= 2; --l) {
+    forBoxes(l, [&](const Box &B, std::size_t b) {
+      for (int c : B.children) {
+        W[l].col(b) += m2m_[boxes_[l + 1][c].octant] * W[l + 1].col(c);
+      }
+    });
+  }
+  // Downward pass: M2L and L2L
+  const double w0 = 2. * h_;
+  for (unsigned int l = 2; l <= L; ++l) {
+    const double hw = 0.5 * w0 / (1 << l);
+    forBoxes(l, [&](const Box &B, std::size_t b) {
+      for (int c : B.inter) {
+        const Box &C = boxes_[l][c];
+        if (opt_.translation_invariant) {
+          loc[l].col(b) += m2l_[l][offsetIndex(B.ix, C.ix)] * W[l].col(c);
+        } else {
+          loc[l].col(b) += m2l(nodes(center(l, B), hw),
+                               nodes(center(l, C), hw)) *
+                           W[l].col(c);
+        }
+      }
+      if (l > 2) {
+        loc[l].col(b) += m2m_[B.octant].transpose() * loc[l - 1].col(B.parent);
+      }
+    });
+  }
+  // L2P and P2P on the leaves
+  forBoxes(L, [&](const Box &B, std::size_t b) {
+    auto yb = yp.segment(B.begin, B.end - B.begin);
+    yb = basis(L, B) * loc[L].col(b);
+    for (int c : B.near) {
+      const Box &C = boxes_[L][c];
+      for (Eigen::Index i = B.begin; i < B.end; ++i) {
+        double v = 0.;
+        for (Eigen::Index j = C.begin; j < C.end; ++j) {
+          v += K_(Xp_.col(i), Xp_.col(j)) * xp(j);
+        }
+        yb(i - B.begin) += v;
+      }
+    }
+  });
+  Eigen::VectorXd y(N);
+  for (Eigen::Index i = 0; i < N; ++i) y(perm_(i)) = yp(i);
+  return y;
+}
+/* SAM_LISTING_END_0 */
@@ -0,0 +1,146 @@
+#include <Eigen/Dense>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <string>
+
+#include "bbfmm.hpp"
+#include "parallel.hpp"
+
+template <class Action>
+double timeit(Action &&a) {
+  const auto start = std::chrono::high_resolution_clock::now();
+  a();
+  const auto end = std::chrono::high_resolution_clock::now();
+  return std::chrono::duration<double>(end - start).count();
+}
+
+// Kernels, zero on the diagonal where they are singular
+struct MinKernel {  // A = [min(i, j)], cf. multAmin, smooth for x != y
+  template <class P1, class P2>
+  double operator()(const P1 &x, const P2 &y) const {
+    return std::min(x(0), y(0));
+  }
+};
+struct GaussKernel {
+  template <class P1, class P2>
+  double operator()(const P1 &x, const P2 &y) const {
+    return std::exp(-(x - y).squaredNorm() / 0.25);
+  }
+};
+struct LogKernel {
+  template <class P1, class P2>
+  double operator()(const P1 &x, const P2 &y) const {
+    const double r2 = (x - y).squaredNorm();
+    return r2 > 0. ? -0.5 * std::log(r2) : 0.;
+  }
+};
+struct CoulombKernel {
+  template <class P1, class P2>
+  double operator()(const P1 &x, const P2 &y) const {
+    const double r2 = (x - y).squaredNorm();
+    return r2 > 0. ? 1. / std::sqrt(r2) : 0.;
+  }
+};
+
+// Rows I of A x computed directly, O(N) per row
+template <int d, class Kernel>
+Eigen::VectorXd directRows(const Eigen::Matrix<double, d, Eigen::Dynamic> &X,
+                           const Kernel &K, const Eigen::VectorXd &x,
+                           const Eigen::VectorXi &I) {
+  Eigen::VectorXd y(I.size());
+  parallelFor(I.size(), [&](std::size_t b, std::size_t e, unsigned int) {
+    for (std::size_t k = b; k < e; ++k) {
+      double v = 0.;
+      for (Eigen::Index j = 0; j < X.cols(); ++j) {
+        v += K(X.col(I(k)), X.col(j)) * x(j);
+      }
+      y(k) = v;
+    }
+  });
+  return y;
+}
+
+// Error of the FMM against the direct O(N^2) summation for several q
+template <int d, class Kernel>
+void verify(const std::string &name, const Kernel &K,
+            const Eigen::Matrix<double, d, Eigen::Dynamic> &X,
+            bool translation_invariant = true) {
+  const Eigen::Index N = X.cols();
+  const Eigen::VectorXd x = Eigen::VectorXd::Random(N);
+  Eigen::VectorXd y;
+  const double t = timeit([&] {
+    y = directRows<d>(X, K, x, Eigen::VectorXi::LinSpaced(N, 0, N - 1));
+  });
+  std::cout << name << ", d = " << d << ", N = " << N << ": direct " << t
+            << " s\n";
+  for (unsigned int q : {2u, 3u, 4u, 5u, 6u, 7u, 8u}) {
+    if (d == 3 && q > 6) break;
+    FmmOptions opt;
+    opt.order = q;
+    opt.translation_invariant = translation_invariant;
+    Eigen::VectorXd yF;
+    double t_setup, t_apply;
+    t_setup = timeit([&] {
+      const BlackBoxFmm<d, Kernel> F(X, K, opt);
+      t_apply = timeit([&] { yF = F * x; });
+    });
+    std::cout << "  q = " << q << ": setup + apply " << t_setup
+              << " s, apply " << t_apply << " s, error "
+              << (yF - y).norm() / y.norm() << "\n";
+  }
+}
+
+int main(int argc, char **argv) {
+  std::cout << std::setprecision(3) << std::scientific;
+  std::srand(1);
+
+  // 1. Accuracy against the direct summation
+  {
+    const Eigen::Index N = 10000;
+    const Eigen::RowVectorXd t = Eigen::RowVectorXd::LinSpaced(N, 1, N);
+    // min(x + z, y + z) = min(x, y) + z: no precomputed M2L matrices
+    verify<1>("min(x, y), x_i = i", MinKernel(), t, false);
+    verify<1>("exp(-4|x - y|^2), x_i = i / N", GaussKernel(),
+              Eigen::RowVectorXd(t / N));
+    const Eigen::Matrix2Xd X2 = 0.5 * (Eigen::Matrix2Xd::Random(2, N) +
+                                       Eigen::Matrix2Xd::Ones(2, N));
+    verify<2>("-log|x - y|, random points", LogKernel(), X2);
+    verify<2>("exp(-4|x - y|^2), random points", GaussKernel(), X2);
+    const Eigen::Matrix3Xd X3 = 0.5 * (Eigen::Matrix3Xd::Random(3, N) +
+                                       Eigen::Matrix3Xd::Ones(3, N));
+    verify<3>("1/|x - y|, random points", CoulombKernel(), X3);
+  }
+
+  // 2. O(N) cost: 1/|x - y| in 3-D, q = 4
+  {
+    const Eigen::Index N_max = argc > 1 ? std::atol(argv[1]) : 1000000;
+    std::cout << "1/|x - y|, d = 3, q = 4, " << numThreadsFor(N_max, 0)
+              << " threads\n";
+    for (Eigen::Index N = N_max / 8; N <= N_max; N *= 2) {
+      const Eigen::Matrix3Xd X = 0.5 * (Eigen::Matrix3Xd::Random(3, N) +
+                                        Eigen::Matrix3Xd::Ones(3, N));
+      const Eigen::VectorXd x = Eigen::VectorXd::Random(N);
+      FmmOptions opt;
+      opt.order = 4;
+      const CoulombKernel K;
+      Eigen::VectorXd yF;
+      double t_apply;
+      const double t_setup = timeit([&] {
+        const BlackBoxFmm<3, CoulombKernel> F(X, K, opt);
+        t_apply = timeit([&] { yF = F * x; });
+      });
+      const Eigen::VectorXi I = Eigen::VectorXi::LinSpaced(100, 0, N - 1);
+      const Eigen::VectorXd y = directRows<3>(X, K, x, I);
+      Eigen::VectorXd yI(I.size());
+      for (Eigen::Index k = 0; k < I.size(); ++k) yI(k) = yF(I(k));
+      std::cout << "  N = " << std::setw(8) << N << ": setup + apply "
+                << t_setup << " s, apply " << t_apply << " s, "
+                << t_apply / N << " s / N, error "
+                << (yI - y).norm() / y.norm() << "\n";
+    }
+  }
+  return 0;
+}
@@ -0,0 +1,103 @@
+#pragma once
+
+#include <Eigen/Dense>
+#include <algorithm>
+#include <vector>
+
+/* Cluster tree for the points given by the columns of X in R^{d,N}, built
+ * by geometric bisection: the bounding box of a cluster is split at the
+ * midpoint of its longest edge. A node holds the points perm(begin), ...,
+ * perm(end-1) and a split only reorders this range of perm, the points
+ * are never copied. If all points of a cluster lie on one side of the
+ * midpoint, the cluster is split at the median of that coordinate
+ * instead, which also bounds the depth for strongly clustered points.
+ * Nodes are stored in a flat array in depth-first order, the tight
+ * bounding boxes in the columns of two matrices; clusters with at most
+ * leaf_size points are leaves. */
+
+struct ClusterTreeOptions {
+  Eigen::Index leaf_size = 64;  // no splitting of smaller clusters
+};
+
+template <int d>
+class ClusterTree {
+ public:
+  using Points = Eigen::Matrix<double, d, Eigen::Dynamic>;
+  struct Node {
+    Eigen::Index begin, end;    // points perm(begin), ..., perm(end-1)
+    int left = -1, right = -1;  // children, -1 for a leaf
+    unsigned int level = 0;
+  };
+
+  explicit ClusterTree(const Points &X, const ClusterTreeOptions &opt = {})
+      : opt_(opt), perm_(Eigen::VectorXi::LinSpaced(X.cols(), 0,
+                                                    X.cols() - 1)) {
+    nodes_.reserve(4 * X.cols() / std::max<Eigen::Index>(opt.leaf_size, 1) +
+                   1);
+    std::vector<Eigen::Matrix<double, d, 1>> lo, hi;
+    build(X, 0, X.cols(), 0, lo, hi);
+    lo_.resize(d, nodes_.size());
+    hi_.resize(d, nodes_.size());
+    for (std::size_t k = 0; k < nodes_.size(); ++k) {
+      lo_.col(k) = lo[k];
+      hi_.col(k) = hi[k];
+    }
+  }
+
+  const std::vector<Node> &nodes() const { return nodes_; }
+  const Node &node(int i) const { return nodes_[i]; }
+  bool isLeaf(int i) const { return nodes_[i].left < 0; }
+  const Eigen::VectorXi &permutation() const { return perm_; }
+  // corners of the bounding boxes
+  const Points &lo() const { return lo_; }
+  const Points &hi() const { return hi_; }
+
+  double diam(int i) const { return (hi_.col(i) - lo_.col(i)).norm(); }
+  // distance of the bounding boxes of nodes i and j
+  double dist(int i, int j) const {
+    return (lo_.col(j) - hi_.col(i))
+        .cwiseMax(lo_.col(i) - hi_.col(j))
+        .cwiseMax(0.)
+        .norm();
+  }
+
+ private:
+  int build(const Points &X, Eigen::Index begin, Eigen::Index end,
+            unsigned int level, std::vector<Eigen::Matrix<double, d, 1>> &lo,
+            std::vector<Eigen::Matrix<double, d, 1>> &hi) {
+    const int k = nodes_.size();
+    nodes_.push_back({begin, end, -1, -1, level});
+    Eigen::Matrix<double, d, 1> l = X.col(perm_(begin)), h = l;
+    for (Eigen::Index i = begin + 1; i < end; ++i) {
+      l = l.cwiseMin(X.col(perm_(i)));
+      h = h.cwiseMax(X.col(perm_(i)));
+    }
+    lo.push_back(l);
+    hi.push_back(h);
+    if (end - begin <= opt_.leaf_size) return k;
+    // Bisection of the longest edge
+    Eigen::Index dim;
+    (h - l).maxCoeff(&dim);
+    const double mid = 0.5 * (l(dim) + h(dim));
+    int *first = perm_.data() + begin, *last = perm_.data() + end;
+    int *split = std::partition(
+        first, last, [&](int i) { return X(dim, i) < mid; });
+    if (split == first || split == last) {
+      split = first + (end - begin) / 2;
+      std::nth_element(first, split, last, [&](int i, int j) {
+        return X(dim, i) < X(dim, j);
+      });
+    }
+    const Eigen::Index m = split - perm_.data();
+    const int left = build(X, begin, m, level + 1, lo, hi);
+    const int right = build(X, m, end, level + 1, lo, hi);
+    nodes_[k].left = left;
+    nodes_[k].right = right;
+    return k;
+  }
+
+  ClusterTreeOptions opt_;
+  std::vector<Node> nodes_;
+  Eigen::VectorXi perm_;
+  Points lo_, hi_;
+};
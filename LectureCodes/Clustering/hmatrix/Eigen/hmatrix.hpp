@@ -0,0 +1,432 @@
+#pragma once
+
+#include <Eigen/Dense>
+#include <algorithm>
+#include <cmath>
+#include <numeric>
+#include <utility>
+#include <vector>
+
+#include "clustertree.hpp"
+#include "parallel.hpp"
+
+/* Hierarchical matrix approximation of the kernel matrix
+ *   A = [K(x_i, x_j)]_{i,j=1..N}
+ * for points x_i given by the columns of X in R^{d,N}. The block cluster
+ * tree is built recursively from the pair (root, root) of the cluster tree
+ * of X: a pair (s, t) of clusters is admissible if
+ *   min(diam(s), diam(t)) <= eta dist(s, t)
+ * for their bounding boxes; then the block A|s x t is a far field block
+ * and approximated by a matrix of low rank, since K is smooth away from
+ * the diagonal. Otherwise the children of s and t are paired, unless one
+ * of them is a leaf, and A|s x t is a near field block, which is kept as
+ * it is. The far field blocks are approximated
+ *  - by adaptive cross approximation (ACA) with partial pivoting, which
+ *    needs O(k (|s| + |t|)) entries of the block for rank k, or
+ *  - by tensor product Chebyshev interpolation of K(x, y) in x and in y on
+ *    the bounding boxes with q^d nodes each,
+ *      A|s x t ~ L_s C_st L_t^T,  C_st = [K(xi_a, eta_b)]_{a,b},
+ *    with the Lagrange polynomials of the nodes at the points in L_s, L_t.
+ * With assemble = false nothing is stored but the cluster tree: near
+ * field blocks are summed up on the fly and the far field is applied by
+ * Chebyshev interpolation with the moments L_t^T x of all clusters, so
+ * that the memory is O(N) while the work stays O(N log N); thus kernel
+ * matrices of size 10^6 can be applied. The blocks are distributed among
+ * threads so that the estimated work is balanced, every thread sums into
+ * its own result vector. */
+
+enum class LowRank { ACA, Chebyshev };
+
+struct HMatrixOptions {
+  Eigen::Index leaf_size = 64;  // of the cluster tree
+  double eta = 1.;              // admissibility parameter
+  LowRank method = LowRank::ACA;
+  double aca_tol = 1e-6;        // relative tolerance of ACA
+  Eigen::Index max_rank = 64;   // of ACA
+  unsigned int cheb_nodes = 5;  // q, Chebyshev nodes per direction
+  bool assemble = true;         // false: matrix free, Chebyshev only
+  unsigned int num_threads = 0;
+};
+
+template <int d, class Kernel>
+class HMatrix {
+ public:
+  using Points = typename ClusterTree<d>::Points;
+
+  HMatrix(const Points &X, const Kernel &K, const HMatrixOptions &opt = {})
+      : opt_(opt), K_(K), tree_(X, ClusterTreeOptions{opt.leaf_size}) {
+    Xp_.resize(d, X.cols());
+    for (Eigen::Index i = 0; i < X.cols(); ++i) {
+      Xp_.col(i) = X.col(tree_.permutation()(i));
+    }
+    if (!opt_.assemble) opt_.method = LowRank::Chebyshev;
+    partition(0, 0);
+    if (opt_.method == LowRank::Chebyshev) chebyshevNodes();
+    if (opt_.assemble) assemble();
+  }
+
+  Eigen::Index rows() const { return Xp_.cols(); }
+  const ClusterTree<d> &tree() const { return tree_; }
+  std::size_t numNear() const { return near_.size(); }
+  std::size_t numFar() const { return far_.size(); }
+  // Stored doubles (assembled) and largest rank of a far field block
+  std::size_t storage() const;
+  Eigen::Index maxRank() const;
+
+  Eigen::VectorXd operator*(const Eigen::VectorXd &x) const;
+
+ private:
+  struct Block {
+    int row, col;  // nodes of the cluster tree
+  };
+  struct LowRankBlock {
+    Eigen::MatrixXd U, V;  // A|s x t ~ U V^T
+  };
+
+  // Block cluster tree, the leaves are collected in near_ and far_
+  void partition(int s, int t) {
+    if (std::min(tree_.diam(s), tree_.diam(t)) <=
+        opt_.eta * tree_.dist(s, t)) {
+      far_.push_back({s, t});
+    } else if (tree_.isLeaf(s) || tree_.isLeaf(t)) {
+      near_.push_back({s, t});
+    } else {
+      for (int cs : {tree_.node(s).left, tree_.node(s).right}) {
+        for (int ct : {tree_.node(t).left, tree_.node(t).right}) {
+          partition(cs, ct);
+        }
+      }
+    }
+  }
+  Eigen::Index size(int s) const {
+    return tree_.node(s).end - tree_.node(s).begin;
+  }
+  Eigen::MatrixXd dense(const Block &b) const {
+    const auto &s = tree_.node(b.row), &t = tree_.node(b.col);
+    Eigen::MatrixXd D(s.end - s.begin, t.end - t.begin);
+    for (Eigen::Index j = 0; j < D.cols(); ++j) {
+      for (Eigen::Index i = 0; i < D.rows(); ++i) {
+        D(i, j) = K_(Xp_.col(s.begin + i), Xp_.col(t.begin + j));
+      }
+    }
+    return D;
+  }
+  LowRankBlock aca(const Block &b) const;
+  void chebyshevNodes();
+  Eigen::MatrixXd chebyshevBasis(int s) const;
+  Eigen::MatrixXd coupling(int s, int t) const;
+  void assemble();
+  // Work items [0, n) with estimated costs split into p chunks of about
+  // equal cost, body(item, thread) is called for all items in parallel
+  template <class Body>
+  void balanced(const std::vector<double> &cost, unsigned int p,
+                Body &&body) const;
+
+  HMatrixOptions opt_;
+  Kernel K_;
+  ClusterTree<d> tree_;
+  Points Xp_;  // points in the order of the cluster tree
+  std::vector<Block> near_, far_;
+  std::vector<Eigen::MatrixXd> dense_;
+  std::vector<LowRankBlock> lowrank_;
+  Eigen::VectorXd cheb_, cheb_w_;  // Chebyshev nodes on [-1,1], weights
+  Eigen::Matrix<int, d, Eigen::Dynamic> multi_;  // multi-indices of nodes
+};
+
+/* SAM_LISTING_BEGIN_0 */
+// ACA with partial pivoting: rank-1 updates u v^T from the row and the
+// column of the residual block at the pivot, until
+// ||u|| ||v|| <= aca_tol ||U V^T||_F
+template <int d, class Kernel>
+typename HMatrix<d, Kernel>::LowRankBlock HMatrix<d, Kernel>::aca(
+    const Block &b) const {
+  const Eigen::Index m = size(b.row), n = size(b.col);
+  const Eigen::Index rs = tree_.node(b.row).begin;
+  const Eigen::Index cs = tree_.node(b.col).begin;
+  const Eigen::Index kmax = std::min({m, n, opt_.max_rank});
+  LowRankBlock lr{Eigen::MatrixXd(m, kmax), Eigen::MatrixXd(n, kmax)};
+  std::vector<bool> used(m, false);
+  Eigen::Index k = 0, i = 0;
+  double norm2 = 0.;  // ||U V^T||_F^2
+  while (k < kmax) {
+    used[i] = true;
+    Eigen::VectorXd v(n);
+    for (Eigen::Index j = 0; j < n; ++j) {
+      v(j) = K_(Xp_.col(rs + i), Xp_.col(cs + j));
+    }
+    v -= lr.V.leftCols(k) * lr.U.row(i).head(k).transpose();
+    Eigen::Index j;
+    const double piv = v.cwiseAbs().maxCoeff(&j);
+    if (piv == 0.) {
+      // zero row of the residual: try the next row not used yet
+      const auto it = std::find(used.begin(), used.end(), false);
+      if (it == used.end()) break;
+      i = it - used.begin();
+      continue;
+    }
+    v /= v(j);
+    Eigen::VectorXd u(m);
+    for (Eigen::Index l = 0; l < m; ++l) {
+      u(l) = K_(Xp_.col(rs + l), Xp_.col(cs + j));
+    }
+    u -= lr.U.leftCols(k) * lr.V.row(j).head(k).transpose();
+    const double uv2 = u.squaredNorm() * v.squaredNorm();
+    norm2 += uv2 + 2. * (lr.U.leftCols(k).transpose() * u)
+                            .dot(lr.V.leftCols(k).transpose() * v);
+    lr.U.col(k) = u;
+    lr.V.col(k) = v;
+    ++k;
+    if (uv2 <= opt_.aca_tol * opt_.aca_tol * norm2) break;
+    // next row: largest entry of u among the rows not used yet
+    double best = -1.;
+    for (Eigen::Index l = 0; l < m; ++l) {
+      if (!used[l] && std::abs(u(l)) > best) {
+        best = std::abs(u(l));
+        i = l;
+      }
+    }
+    if (best < 0.) break;
+  }
+  lr.U.conservativeResize(m, k);
+  lr.V.conservativeResize(n, k);
+  return lr;
+}
+/* SAM_LISTING_END_0 */
+
+template <int d, class Kernel>
+void HMatrix<d, Kernel>::chebyshevNodes() {
+  const int q = opt_.cheb_nodes;
+  cheb_.resize(q);
+  cheb_w_.resize(q);
+  for (int k = 0; k < q; ++k) {
+    cheb_(k) = std::cos(M_PI * (2 * k + 1) / (2 * q));
+  }
+  // 1 / prod_{m != k} (c_k - c_m), denominators of the Lagrange polynomials
+  for (int k = 0; k < q; ++k) {
+    double w = 1.;
+    for (int m = 0; m < q; ++m) {
+      if (m != k) w *= cheb_(k) - cheb_(m);
+    }
+    cheb_w_(k) = 1. / w;
+  }
+  int nq = 1;
+  for (int l = 0; l < d; ++l) nq *= q;
+  multi_.resize(d, nq);
+  for (int a = 0; a < nq; ++a) {
+    for (int l = 0, r = a; l < d; ++l, r /= q) multi_(l, a) = r % q;
+  }
+}
+
+// L_s: values of the q^d Lagrange polynomials of the Chebyshev nodes in the
+// bounding box of s at the points of s
+template <int d, class Kernel>
+Eigen::MatrixXd HMatrix<d, Kernel>::chebyshevBasis(int s) const {
+  const int q = opt_.cheb_nodes;
+  const auto &node = tree_.node(s);
+  const Eigen::Matrix<double, d, 1> c =
+      0.5 * (tree_.lo().col(s) + tree_.hi().col(s));
+  Eigen::Matrix<double, d, 1> h =
+      0.5 * (tree_.hi().col(s) - tree_.lo().col(s));
+  for (int l = 0; l < d; ++l) {
+    if (h(l) == 0.) h(l) = 1.;  // all points in a hyperplane
+  }
+  Eigen::MatrixXd L(node.end - node.begin, multi_.cols());
+  Eigen::MatrixXd l1(q, d);  // 1-D Lagrange polynomials at one point
+  for (Eigen::Index i = node.begin; i < node.end; ++i) {
+    for (int l = 0; l < d; ++l) {
+      const double t = (Xp_(l, i) - c(l)) / h(l);
+      for (int k = 0; k < q; ++k) {
+        double v = cheb_w_(k);
+        for (int m = 0; m < q; ++m) {
+          if (m != k) v *= t - cheb_(m);
+        }
+        l1(k, l) = v;
+      }
+    }
+    for (Eigen::Index a = 0; a < multi_.cols(); ++a) {
+      double v = 1.;
+      for (int l = 0; l < d; ++l) v *= l1(multi_(l, a), l);
+      L(i - node.begin, a) = v;
+    }
+  }
+  return L;
+}
+
+// C_st = [K(xi_a, eta_b)] for the Chebyshev nodes of the boxes of s and t
+template <int d, class Kernel>
+Eigen::MatrixXd HMatrix<d, Kernel>::coupling(int s, int t) const {
+  const auto nodes = [&](int r) {
+    const Eigen::Matrix<double, d, 1> c =
+        0.5 * (tree_.lo().col(r) + tree_.hi().col(r));
+    const Eigen::Matrix<double, d, 1> h =
+        0.5 * (tree_.hi().col(r) - tree_.lo().col(r));
+    Points P(d, multi_.cols());
+    for (Eigen::Index a = 0; a < multi_.cols(); ++a) {
+      for (int l = 0; l < d; ++l) {
+        P(l, a) = c(l) + h(l) * cheb_(multi_(l, a));
+      }
+    }
+    return P;
+  };
+  const Points xi = nodes(s), et = nodes(t);
+  Eigen::MatrixXd C(xi.cols(), et.cols());
+  for (Eigen::Index b = 0; b < C.cols(); ++b) {
+    for (Eigen::Index a = 0; a < C.rows(); ++a) {
+      C(a, b) = K_(xi.col(a), et.col(b));
+    }
+  }
+  return C;
+}
+
+template <int d, class Kernel>
+template <class Body>
+void HMatrix<d, Kernel>::balanced(const std::vector<double> &cost,
+                                  unsigned int p, Body &&body) const {
+  std::vector<double> acc(cost.size() + 1, 0.);
+  std::partial_sum(cost.begin(), cost.end(), acc.begin() + 1);
+  parallelFor(
+      p,
+      [&](std::size_t b, std::size_t e, unsigned int tid) {
+        for (std::size_t c = b; c < e; ++c) {
+          // items whose cumulated cost falls into the c-th p-quantile
+          const auto first = std::lower_bound(acc.begin(), acc.end() - 1,
+                                              acc.back() * c / p);
+          const auto last = std::lower_bound(acc.begin(), acc.end() - 1,
+                                             acc.back() * (c + 1) / p);
+          const std::size_t i1 =
+              c + 1 == p ? cost.size() : last - acc.begin();
+          for (std::size_t i = first - acc.begin(); i < i1; ++i) {
+            body(i, tid);
+          }
+        }
+      },
+      p);
+}
+
+template <int d, class Kernel>
+void HMatrix<d, Kernel>::assemble() {
+  const unsigned int p = numThreadsFor(near_.size() + far_.size(),
+                                       opt_.num_threads);
+  dense_.resize(near_.size());
+  lowrank_.resize(far_.size());
+  std::vector<double> cost;
+  for (const Block &b : near_) {
+    cost.push_back(double(size(b.row)) * size(b.col));
+  }
+  for (const Block &b : far_) {
+    cost.push_back(double(size(b.row)) + size(b.col));
+  }
+  balanced(cost, p, [&](std::size_t i, unsigned int) {
+    if (i < near_.size()) {
+      dense_[i] = dense(near_[i]);
+    } else {
+      const Block &b = far_[i - near_.size()];
+      LowRankBlock &lr = lowrank_[i - near_.size()];
+      if (opt_.method == LowRank::ACA) {
+        lr = aca(b);
+      } else {
+        lr.U = chebyshevBasis(b.row) * coupling(b.row, b.col);
+        lr.V = chebyshevBasis(b.col);
+      }
+    }
+  });
+}
+
+template <int d, class Kernel>
+std::size_t HMatrix<d, Kernel>::storage() const {
+  std::size_t n = 0;
+  for (const auto &D : dense_) n += D.size();
+  for (const auto &lr : lowrank_) n += lr.U.size() + lr.V.size();
+  return n;
+}
+
+template <int d, class Kernel>
+Eigen::Index HMatrix<d, Kernel>::maxRank() const {
+  if (!opt_.assemble) return multi_.cols();
+  Eigen::Index k = 0;
+  for (const auto &lr : lowrank_) k = std::max(k, lr.U.cols());
+  return k;
+}
+
+/* SAM_LISTING_BEGIN_1 */
+template <int d, class Kernel>
+Eigen::VectorXd HMatrix<d, Kernel>::operator*(
+    const Eigen::VectorXd &x) const {
+  const Eigen::Index N = rows();
+  const Eigen::VectorXi &perm = tree_.permutation();
+  Eigen::VectorXd xp(N);
+  for (Eigen::Index i = 0; i < N; ++i) xp(i) = x(perm(i));
+  const unsigned int p =
+      numThreadsFor(near_.size() + far_.size(), opt_.num_threads);
+  std::vector<Eigen::VectorXd> y(p, Eigen::VectorXd::Zero(N));
+  const auto rowsOf = [&](Eigen::VectorXd &v, int s) {
+    return v.segment(tree_.node(s).begin, size(s));
+  };
+  const auto colsOf = [&](int t) {
+    return xp.segment(tree_.node(t).begin, size(t));
+  };
+  std::vector<double> cost;
+  for (const Block &b : near_) {
+    cost.push_back(double(size(b.row)) * size(b.col));
+  }
+  if (opt_.assemble) {
+    for (const auto &lr : lowrank_) {
+      cost.push_back(lr.U.size() + lr.V.size());
+    }
+    balanced(cost, p, [&](std::size_t i, unsigned int tid) {
+      if (i < near_.size()) {
+        rowsOf(y[tid], near_[i].row) += dense_[i] * colsOf(near_[i].col);
+      } else {
+        const Block &b = far_[i - near_.size()];
+        const LowRankBlock &lr = lowrank_[i - near_.size()];
+        rowsOf(y[tid], b.row) += lr.U * (lr.V.transpose() * colsOf(b.col));
+      }
+    });
+  } else {
+    // Moments L_t^T x of all clusters: O(q^d N) per level of the tree
+    const int nn = tree_.nodes().size(), nq = multi_.cols();
+    Eigen::MatrixXd mom(nq, nn);
+    std::vector<double> cn(nn, 0.), cm(nn, 0.);
+    for (const Block &b : far_) {
+      cn[b.col] = size(b.col);
+      cm[b.row] = size(b.row);
+    }
+    balanced(cn, numThreadsFor(nn, opt_.num_threads),
+             [&](std::size_t t, unsigned int) {
+               if (cn[t] > 0.) {
+                 mom.col(t) = chebyshevBasis(t).transpose() * colsOf(t);
+               }
+             });
+    // Near field on the fly and far field C_st L_t^T x at the nodes of s
+    std::vector<Eigen::MatrixXd> loc(p, Eigen::MatrixXd::Zero(nq, nn));
+    for (std::size_t i = 0; i < far_.size(); ++i) cost.push_back(nq * nq);
+    balanced(cost, p, [&](std::size_t i, unsigned int tid) {
+      if (i < near_.size()) {
+        const auto &s = tree_.node(near_[i].row);
+        const auto &t = tree_.node(near_[i].col);
+        for (Eigen::Index k = s.begin; k < s.end; ++k) {
+          double v = 0.;
+          for (Eigen::Index l = t.begin; l < t.end; ++l) {
+            v += K_(Xp_.col(k), Xp_.col(l)) * xp(l);
+          }
+          y[tid](k) += v;
+        }
+      } else {
+        const Block &b = far_[i - near_.size()];
+        loc[tid].col(b.row) += coupling(b.row, b.col) * mom.col(b.col);
+      }
+    });
+    for (unsigned int t = 1; t < p; ++t) loc[0] += loc[t];
+    // Interpolation back to the points, L_s times the local values
+    balanced(cm, p, [&](std::size_t s, unsigned int tid) {
+      if (cm[s] > 0.) {
+        rowsOf(y[tid], s) += chebyshevBasis(s) * loc[0].col(s);
+      }
+    });
+  }
+  for (unsigned int t = 1; t < p; ++t) y[0] += y[t];
+  Eigen::VectorXd res(N);
+  for (Eigen::Index i = 0; i < N; ++i) res(perm(i)) = y[0](i);
+  return res;
+}
+/* SAM_LISTING_END_1 */
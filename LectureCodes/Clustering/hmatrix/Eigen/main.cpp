@@ -0,0 +1,115 @@
+#include <Eigen/Dense>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+
+#include "hmatrix.hpp"
+#include "parallel.hpp"
+
+template <class Action>
+double timeit(Action &&a) {
+  const auto start = std::chrono::high_resolution_clock::now();
+  a();
+  const auto end = std::chrono::high_resolution_clock::now();
+  return std::chrono::duration<double>(end - start).count();
+}
+
+// Logarithmic kernel of the 2-D Laplacian, zero on the diagonal
+struct LogKernel {
+  template <class P1, class P2>
+  double operator()(const P1 &x, const P2 &y) const {
+    const double r2 = (x - y).squaredNorm();
+    return r2 > 0. ? -0.5 * std::log(r2) : 0.;
+  }
+};
+
+// Rows I of A x computed directly, O(N) per row
+template <class Kernel>
+Eigen::VectorXd directRows(const Eigen::Matrix2Xd &X, const Kernel &K,
+                           const Eigen::VectorXd &x,
+                           const Eigen::VectorXi &I) {
+  Eigen::VectorXd y(I.size());
+  parallelFor(I.size(), [&](std::size_t b, std::size_t e, unsigned int) {
+    for (std::size_t k = b; k < e; ++k) {
+      double v = 0.;
+      for (Eigen::Index j = 0; j < X.cols(); ++j) {
+        v += K(X.col(I(k)), X.col(j)) * x(j);
+      }
+      y(k) = v;
+    }
+  });
+  return y;
+}
+
+int main(int argc, char **argv) {
+  std::cout << std::setprecision(3) << std::scientific;
+  const LogKernel K;
+
+  // 1. Assembled H-matrices against the dense matrix
+  {
+    const Eigen::Index N = 10000;
+    std::srand(1);
+    const Eigen::Matrix2Xd X = 0.5 * (Eigen::Matrix2Xd::Random(2, N) +
+                                      Eigen::Matrix2Xd::Ones(2, N));
+    const Eigen::VectorXd x = Eigen::VectorXd::Random(N);
+    Eigen::MatrixXd A(N, N);
+    double t = timeit([&] {
+      for (Eigen::Index j = 0; j < N; ++j) {
+        for (Eigen::Index i = 0; i < N; ++i) A(i, j) = K(X.col(i), X.col(j));
+      }
+    });
+    Eigen::VectorXd y;
+    const double t_mv = timeit([&] { y = A * x; });
+    std::cout << "log|x-y|, N = " << N << " random points in [0,1]^2\n"
+              << "  dense:          setup " << t << " s, matvec " << t_mv
+              << " s, storage " << double(N) * N << "\n";
+    for (LowRank method : {LowRank::ACA, LowRank::Chebyshev}) {
+      HMatrixOptions opt;
+      opt.method = method;
+      std::unique_ptr<HMatrix<2, LogKernel>> H;
+      t = timeit([&] { H.reset(new HMatrix<2, LogKernel>(X, K, opt)); });
+      Eigen::VectorXd yH;
+      const double t_h = timeit([&] { yH = *H * x; });
+      std::cout << (method == LowRank::ACA ? "  H-matrix, ACA:  "
+                                           : "  H-matrix, Cheb: ")
+                << "setup " << t << " s, matvec " << t_h << " s, storage "
+                << double(H->storage()) << ", " << H->numNear() << " near, "
+                << H->numFar() << " far blocks, max. rank " << H->maxRank()
+                << ", error " << (yH - y).norm() / y.norm() << "\n";
+    }
+  }
+
+  // 2. Matrix free H-matrix: the matrix is never stored, O(N log N)
+  {
+    const Eigen::Index N_max = argc > 1 ? std::atol(argv[1]) : 1000000;
+    std::cout << "matrix free, Chebyshev interpolation, q = 5, "
+              << numThreadsFor(N_max, 0) << " threads\n";
+    for (Eigen::Index N = N_max / 8; N <= N_max; N *= 2) {
+      std::srand(2);
+      const Eigen::Matrix2Xd X = 0.5 * (Eigen::Matrix2Xd::Random(2, N) +
+                                        Eigen::Matrix2Xd::Ones(2, N));
+      const Eigen::VectorXd x = Eigen::VectorXd::Random(N);
+      HMatrixOptions opt;
+      opt.assemble = false;
+      std::unique_ptr<HMatrix<2, LogKernel>> H;
+      const double t =
+          timeit([&] { H.reset(new HMatrix<2, LogKernel>(X, K, opt)); });
+      Eigen::VectorXd yH;
+      const double t_h = timeit([&] { yH = *H * x; });
+      // error on 100 rows
+      const Eigen::VectorXi I = Eigen::VectorXi::LinSpaced(100, 0, N - 1);
+      const Eigen::VectorXd y = directRows(X, K, x, I);
+      Eigen::VectorXd yI(I.size());
+      for (Eigen::Index k = 0; k < I.size(); ++k) yI(k) = yH(I(k));
+      std::cout << "  N = " << std::setw(8) << N << ": setup " << t
+                << " s, matvec " << t_h << " s, "
+                << t_h / (N * std::log2(double(N))) << " s / (N log N), "
+                << H->numFar() << " far blocks, error "
+                << (yI - y).norm() / y.norm() << "\n";
+    }
+  }
+  return 0;
+}
@@ -0,0 +1,143 @@
+#pragma once
+
+#include <Eigen/Dense>
+#include <algorithm>
+#include <cmath>
+#include <type_traits>
+#include <utility>
+
+/* Arnoldi process for the Krylov space K_m(A, v) = span{v, Av, ...,
+ * A^{m-1} v}: it computes an orthonormal basis V_{m+1} = [v_1, ...,
+ * v_{m+1}], v_1 = v / ||v||, and an upper Hessenberg matrix
+ * H~_m in R^{m+1,m} with
+ *   A V_m = V_{m+1} H~_m = V_m H_m + h_{m+1,m} v_{m+1} e_m^T .
+ * A new vector A v_j is orthogonalized against V_j by classical
+ * Gram-Schmidt applied twice ("twice is enough"), i.e. two matrix-vector
+ * products with V_j^T and V_j instead of j dot products.
+ * For symmetric A, H_m is tridiagonal and the Lanczos recurrence
+ *   beta_j v_{j+1} = A v_j - alpha_j v_j - beta_{j-1} v_{j-1}
+ * needs only the last two vectors; it is used with symmetric = true (the
+ * basis then slowly loses orthogonality, which is harmless for the
+ * approximation of f(A) v).
+ * The operator A may be a dense or sparse Eigen matrix or any functor
+ * Eigen::VectorXd(const Eigen::VectorXd &), so A is never needed as a
+ * matrix. */
+
+namespace arnoldi_detail {
+// y = A x for a matrix or a functor
+template <class Op>
+Eigen::VectorXd apply(const Op &A, const Eigen::VectorXd &x) {
+  if constexpr (std::is_base_of_v<Eigen::EigenBase<Op>, Op>) {
+    return A * x;
+  } else {
+    return A(x);
+  }
+}
+}  // namespace arnoldi_detail
+
+/* SAM_LISTING_BEGIN_0 */
+template <class Op>
+class Arnoldi {
+ public:
+  // Krylov spaces of A of dimension at most max_dim; the basis is stored
+  // in an n x (max_dim + 1) matrix that is reused by restart(). A is
+  // copied, so temporaries are fine; Arnoldi<const M &> keeps a reference
+  // to a matrix that outlives the object instead.
+  Arnoldi(const Op &A, Eigen::Index n, Eigen::Index max_dim,
+          bool symmetric = false)
+      : A_(A), V_(n, max_dim + 1), H_(max_dim + 1, max_dim),
+        symmetric_(symmetric) {}
+  Arnoldi(const Op &A, const Eigen::VectorXd &v, Eigen::Index max_dim,
+          bool symmetric = false)
+      : Arnoldi(A, v.size(), max_dim, symmetric) {
+    restart(v);
+  }
+
+  // Start again with K_1(A, v); returns false for v = 0
+  bool restart(const Eigen::VectorXd &v) {
+    m_ = 0;
+    beta_ = v.norm();
+    breakdown_ = !(beta_ > 0.);
+    if (breakdown_) {
+      V_.col(0).setZero();
+      return false;
+    }
+    V_.col(0) = v / beta_;
+    H_.setZero();
+    return true;
+  }
+
+  // Extend the basis by one vector, K_m -> K_{m+1}; returns false if the
+  // maximal dimension is reached or K_m is invariant under A ("happy
+  // breakdown", then H_m is exact: A V_m = V_m H_m)
+  bool step() {
+    if (breakdown_ || m_ >= maxDim()) return false;
+    const Eigen::Index j = m_;
+    Eigen::VectorXd w =
+        arnoldi_detail::apply(A_, Eigen::VectorXd(V_.col(j)));
+    const double norm_Av = w.norm();
+    if (symmetric_) {
+      if (j > 0) w -= H_(j - 1, j) * V_.col(j - 1);
+      H_(j, j) = V_.col(j).dot(w);
+      w -= H_(j, j) * V_.col(j);
+    } else {
+      for (int pass = 0; pass < 2; ++pass) {
+        const Eigen::VectorXd c = V_.leftCols(j + 1).transpose() * w;
+        w.noalias() -= V_.leftCols(j + 1) * c;
+        H_.col(j).head(j + 1) += c;
+      }
+    }
+    const double h = w.norm();
+    ++m_;
+    H_(j + 1, j) = h;
+    if (symmetric_ && j + 1 < maxDim()) H_(j, j + 1) = h;
+    // A v_j lies in K_j up to roundoff
+    if (h <= 1e-12 * norm_Av) {
+      H_(j + 1, j) = 0.;
+      V_.col(j + 1).setZero();
+      breakdown_ = true;
+      return false;
+    }
+    V_.col(j + 1) = w / h;
+    return true;
+  }
+
+  Eigen::Index dim() const { return m_; }
+  Eigen::Index maxDim() const { return H_.cols(); }
+  // ||v|| of the starting vector, v = beta V_m e_1
+  double beta() const { return beta_; }
+  bool breakdown() const { return breakdown_; }
+  // V_m and H_m = V_m^T A V_m
+  auto V() const { return V_.leftCols(m_); }
+  auto H() const { return H_.topLeftCorner(m_, m_); }
+  // h_{m+1,m} and v_{m+1} of the Arnoldi relation
+  double hNext() const { return m_ > 0 ? H_(m_, m_ - 1) : 0.; }
+  auto vNext() const { return V_.col(m_); }
+
+ private:
+  Op A_;
+  Eigen::MatrixXd V_, H_;
+  Eigen::Index m_ = 0;
+  double beta_ = 0.;
+  bool symmetric_, breakdown_ = true;
+};
+/* SAM_LISTING_END_0 */
+
+// V in R^{n,k+1} and H~ in R^{k+1,k} of k Arnoldi steps (fewer in case of a
+// breakdown), cf. MATLAB's arnoldi(A, v0, k)
+/* SAM_LISTING_BEGIN_1 */
+template <class Op>
+std::pair<Eigen::MatrixXd, Eigen::MatrixXd> arnoldi(const Op &A,
+                                                   const Eigen::VectorXd &v0,
+                                                   Eigen::Index k) {
+  Arnoldi<const Op &> arn(A, v0, k);
+  while (arn.step()) {
+  }
+  const Eigen::Index m = arn.dim();
+  Eigen::MatrixXd V(v0.size(), m + 1), H = Eigen::MatrixXd::Zero(m + 1, m);
+  V << arn.V(), arn.vNext();
+  H.topRows(m) = arn.H();
+  if (m > 0) H(m, m - 1) = arn.hNext();
+  return {V, H};
+}
+/* SAM_LISTING_END_1 */
@@ -0,0 +1,94 @@
+#include <Eigen/Dense>
+#include <Eigen/Sparse>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+
+#include "arnoldi.hpp"
+
+template <class Action>
+double timeit(Action &&a) {
+  const auto start = std::chrono::high_resolution_clock::now();
+  a();
+  const auto end = std::chrono::high_resolution_clock::now();
+  return std::chrono::duration<double>(end - start).count();
+}
+
+// Upwind convection-diffusion -u'' + c u' on a uniform grid, h = 1/(n+1)
+Eigen::SparseMatrix<double> convDiff(Eigen::Index n, double c) {
+  const double h = 1. / (n + 1);
+  Eigen::SparseMatrix<double> A(n, n);
+  A.reserve(Eigen::VectorXi::Constant(n, 3));
+  for (Eigen::Index i = 0; i < n; ++i) {
+    A.insert(i, i) = 2. / (h * h) + c / h;
+    if (i > 0) A.insert(i, i - 1) = -1. / (h * h) - c / h;
+    if (i + 1 < n) A.insert(i, i + 1) = -1. / (h * h);
+  }
+  A.makeCompressed();
+  return A;
+}
+
+template <class Op>
+void report(const char *name, const Op &A, const Eigen::VectorXd &v,
+            Eigen::Index k, bool symmetric) {
+  Arnoldi<const Op &> arn(A, v.size(), k, symmetric);
+  const double t = timeit([&]() {
+    arn.restart(v);
+    while (arn.step()) {
+    }
+  });
+  const Eigen::Index m = arn.dim();
+  Eigen::MatrixXd AV(v.size(), m);
+  for (Eigen::Index j = 0; j < m; ++j) {
+    AV.col(j) = arnoldi_detail::apply(A, Eigen::VectorXd(arn.V().col(j)));
+  }
+  AV -= arn.V() * arn.H();
+  AV.col(m - 1) -= arn.hNext() * arn.vNext();
+  const Eigen::MatrixXd I = Eigen::MatrixXd::Identity(m, m);
+  const Eigen::VectorXd ritz = arn.H().eigenvalues().real();
+  const double loss = (I - arn.V().transpose() * arn.V()).norm();
+  std::cout << name << t << " s, m = " << m
+            << ", ||A V - V H~|| / ||H|| = " << AV.norm() / arn.H().norm()
+            << ", ||I - V^T V|| = " << loss
+            << ", max Ritz value " << ritz.maxCoeff() << "\n";
+}
+
+int main(int argc, char **argv) {
+  std::cout << std::setprecision(3) << std::scientific;
+  const Eigen::Index n = argc > 1 ? std::atol(argv[1]) : 100000;
+  const Eigen::Index k = 60;
+  const Eigen::VectorXd v = Eigen::VectorXd::Ones(n);
+
+  std::cout << "Convection-diffusion, n = " << n << ", k = " << k << "\n";
+  const Eigen::SparseMatrix<double> C = convDiff(n, 100.);
+  report("Arnoldi            ", C, v, k, false);
+
+  // Laplacian as a matrix-free operator: symmetric, Lanczos applies
+  std::cout << "Laplacian (matrix free), largest eigenvalue "
+            << 4. * std::pow(std::sin(M_PI * n / (2. * (n + 1))), 2) *
+                   (n + 1.) * (n + 1.)
+            << "\n";
+  const auto L = [](const Eigen::VectorXd &x) {
+    const Eigen::Index n = x.size();
+    const double h2 = (n + 1.) * (n + 1.);
+    Eigen::VectorXd y = 2. * h2 * x;
+    y.head(n - 1) -= h2 * x.tail(n - 1);
+    y.tail(n - 1) -= h2 * x.head(n - 1);
+    return y;
+  };
+  const Eigen::VectorXd r = Eigen::VectorXd::Random(n);
+  report("Arnoldi            ", L, r, k, false);
+  report("Lanczos            ", L, r, k, true);
+
+  // Invariant subspace: v in the span of 3 eigenvectors
+  Eigen::MatrixXd D = Eigen::VectorXd::LinSpaced(8, 1, 8).asDiagonal();
+  Eigen::VectorXd e = Eigen::VectorXd::Zero(8);
+  e.head(3).setOnes();
+  const auto [V, H] = arnoldi(D, e, 6);
+  std::cout << "Happy breakdown after " << H.cols()
+            << " steps, eigenvalues of H: "
+            << H.topRows(H.cols()).eigenvalues().real().transpose() << "\n";
+  return 0;
+}
@@ -0,0 +1,171 @@
+#pragma once
+
+#include <Eigen/Dense>
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+#include "parallel.hpp"
+#include "tsqr.hpp"
+
+/* Block classical Gram-Schmidt with reorthogonalization (BCGS2) of the
+ * columns of V in R^{m,n}, m >> n [Barlow, Smoktunowicz, Numer. Math. 123
+ * (2013)]. The columns are processed in blocks X of s columns; a block is
+ * projected out of the previous basis Q,
+ *   C = Q^T X,   X <- X - Q C   (two matrix-matrix products),
+ * and then orthonormalized within itself by a tall-skinny QR of the panel
+ * (TSQR or CholeskyQR2, see tsqr.hpp). Both steps are done twice, which
+ * gives ||I - Q^T Q|| = O(u) as long as cond(V) < u^{-1}, whereas classical
+ * Gram-Schmidt, see gso() and gramschmidt(), loses orthogonality like
+ * u cond(V)^2 and works on single columns (BLAS-1/2). All products are
+ * split into row blocks that are processed in parallel.
+ * - bcgs2Step(): orthonormalize a new block against an orthonormal basis,
+ *   the kernel needed by block Krylov and LOBPCG methods,
+ * - bcgs2(): V = Q R for a whole matrix, optionally monitoring the loss of
+ *   orthogonality ||I - Q^T Q||_F block by block. */
+
+enum class BcgsPanel { TSQR, CholeskyQR2 };
+
+struct BcgsOptions {
+  Eigen::Index block_size = 32;         // s: columns per block
+  BcgsPanel panel = BcgsPanel::TSQR;    // intra-block QR
+  bool monitor = false;                 // record ||I - Q^T Q||_F per block
+  unsigned int num_threads = 0;         // 0 = number of hardware threads
+};
+
+// Diagnostics of one block of bcgs2()
+struct BcgsBlockInfo {
+  Eigen::Index cols;  // columns of Q after this block
+  double first_pass;  // ||Q^T X||_F after the first pass
+  double loss;        // ||I - Q^T Q||_F, only with BcgsOptions::monitor
+};
+
+namespace bcgs2_detail {
+using ConstRef = Eigen::Ref<const Eigen::MatrixXd>;
+
+// C = Q^T X as a sum of thread-local products of row blocks
+inline Eigen::MatrixXd innerProducts(const ConstRef &Q, const ConstRef &X,
+                                     unsigned int num_threads) {
+  const unsigned int p = numThreadsFor(Q.rows(), num_threads);
+  std::vector<Eigen::MatrixXd> C(p,
+                                 Eigen::MatrixXd::Zero(Q.cols(), X.cols()));
+  if (Q.cols() == 0) return C[0];
+  parallelFor(
+      Q.rows(),
+      [&](std::size_t b, std::size_t e, unsigned int tid) {
+        C[tid].noalias() +=
+            Q.middleRows(b, e - b).transpose() * X.middleRows(b, e - b);
+      },
+      p);
+  for (unsigned int t = 1; t < p; ++t) C[0] += C[t];
+  return C[0];
+}
+
+// X <- X - Q C, row blocks in parallel
+inline void subtractProjection(const ConstRef &Q, const Eigen::MatrixXd &C,
+                               Eigen::MatrixXd &X, unsigned int num_threads) {
+  if (Q.cols() == 0) return;
+  parallelFor(
+      X.rows(),
+      [&](std::size_t b, std::size_t e, unsigned int) {
+        X.middleRows(b, e - b).noalias() -= Q.middleRows(b, e - b) * C;
+      },
+      num_threads);
+}
+
+// X <- Q with X = Q R. CholeskyQR2 falls back to TSQR if the Cholesky
+// decomposition breaks down, i.e. for cond(X) beyond about u^{-1/2}.
+inline void panelQR(Eigen::MatrixXd &X, Eigen::MatrixXd &R,
+                    const BcgsOptions &opt) {
+  if (opt.panel == BcgsPanel::CholeskyQR2) {
+    Eigen::MatrixXd Q;
+    if (choleskyQR2(X, Q, R, false, opt.num_threads)) {
+      X = std::move(Q);
+      return;
+    }
+  }
+  TsqrOptions topt;
+  topt.num_threads = opt.num_threads;
+  const TSQR qr(X, topt);
+  R = qr.matrixR();
+  X = qr.thinQ();
+}
+}  // namespace bcgs2_detail
+
+/* SAM_LISTING_BEGIN_0 */
+// Orthonormalizes the block X in R^{m,s} against the orthonormal columns of
+// Q in R^{m,j} and within itself: on return [Q X] has orthonormal columns
+// and X_in = Q C + X R with R in R^{s,s} upper triangular. Returns
+// ||Q^T X||_F after the first pass, a measure of the cancellation in it.
+inline double bcgs2Step(const bcgs2_detail::ConstRef &Q, Eigen::MatrixXd &X,
+                        Eigen::MatrixXd &C, Eigen::MatrixXd &R,
+                        const BcgsOptions &opt = {}) {
+  using namespace bcgs2_detail;
+  const unsigned int nt = opt.num_threads;
+  // first pass
+  C = innerProducts(Q, X, nt);
+  subtractProjection(Q, C, X, nt);
+  Eigen::MatrixXd R1;
+  panelQR(X, R1, opt);
+  if (Q.cols() == 0) {
+    R = R1;
+    return 0.0;
+  }
+  // second pass: repairs the orthogonality lost in the first one
+  const Eigen::MatrixXd C2 = innerProducts(Q, X, nt);
+  subtractProjection(Q, C2, X, nt);
+  Eigen::MatrixXd R2;
+  panelQR(X, R2, opt);
+  C += C2 * R1;
+  R = R2.triangularView<Eigen::Upper>() * R1;
+  return C2.norm();
+}
+/* SAM_LISTING_END_0 */
+
+/* SAM_LISTING_BEGIN_1 */
+// ||I - Q^T Q||_F, computed with a parallel Gram matrix
+inline double orthogonalityLoss(const Eigen::MatrixXd &Q,
+                                unsigned int num_threads = 0) {
+  Eigen::MatrixXd G = tsqr_detail::gram(Q, num_threads);
+  G.diagonal().array() -= 1.0;
+  return G.norm();
+}
+
+// V = Q R, Q in R^{m,n} with orthonormal columns, R upper triangular.
+// Requires m >= n. With opt.monitor the loss of orthogonality of the basis
+// is updated after every block from
+//   ||I - Q_k^T Q_k||_F^2 = ||I - Q_{k-1}^T Q_{k-1}||_F^2
+//                           + 2 ||Q_{k-1}^T X||_F^2 + ||I - X^T X||_F^2,
+// Q_k = [Q_{k-1} X], which costs one extra product Q_{k-1}^T X per block.
+inline std::vector<BcgsBlockInfo> bcgs2(const Eigen::MatrixXd &V,
+                                        Eigen::MatrixXd &Q,
+                                        Eigen::MatrixXd &R,
+                                        const BcgsOptions &opt = {}) {
+  using namespace bcgs2_detail;
+  const Eigen::Index m = V.rows(), n = V.cols();
+  const Eigen::Index s = std::max<Eigen::Index>(1, opt.block_size);
+  Q.resize(m, n);
+  R = Eigen::MatrixXd::Zero(n, n);
+  std::vector<BcgsBlockInfo> info;
+  double loss2 = 0.0;
+  Eigen::MatrixXd X, C, Rk;
+  for (Eigen::Index j = 0; j < n; j += s) {
+    const Eigen::Index sk = std::min(s, n - j);
+    X = V.middleCols(j, sk);
+    const auto Qj = Q.leftCols(j);
+    BcgsBlockInfo bi{j + sk, bcgs2Step(Qj, X, C, Rk, opt), -1.0};
+    R.block(0, j, j, sk) = C;
+    R.block(j, j, sk, sk) = Rk;
+    Q.middleCols(j, sk) = X;
+    if (opt.monitor) {
+      const double off = innerProducts(Qj, X, opt.num_threads).norm();
+      Eigen::MatrixXd G = tsqr_detail::gram(X, opt.num_threads);
+      G.diagonal().array() -= 1.0;
+      loss2 += 2 * off * off + G.squaredNorm();
+      bi.loss = std::sqrt(loss2);
+    }
+    info.push_back(bi);
+  }
+  return info;
+}
+/* SAM_LISTING_END_1 */
@@ -0,0 +1,85 @@
+#include <Eigen/Dense>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <random>
+
+#include "bcgs2.hpp"
+#include "gramschmidt.hpp"
+#include "gso.hpp"
+
+template <class Action>
+double timeit(Action &&a) {
+  const auto start = std::chrono::high_resolution_clock::now();
+  a();
+  const auto end = std::chrono::high_resolution_clock::now();
+  return std::chrono::duration<double>(end - start).count();
+}
+
+// m x n matrix G diag(s) W^T with Gaussian G and a random orthogonal W:
+// cond about s(0) / s(n-1) for m >> n
+Eigen::MatrixXd testMatrix(Eigen::Index m, const Eigen::VectorXd &s) {
+  const Eigen::Index n = s.size();
+  std::mt19937 gen(5);
+  std::normal_distribution<double> N01;
+  const Eigen::MatrixXd G = Eigen::MatrixXd::NullaryExpr(
+      m, n, [&]() { return N01(gen) / std::sqrt(double(m)); });
+  const Eigen::MatrixXd W =
+      Eigen::HouseholderQR<Eigen::MatrixXd>(Eigen::MatrixXd::Random(n, n))
+          .householderQ();
+  return G * s.asDiagonal() * W.transpose();
+}
+
+void report(const char *name, double t, const Eigen::MatrixXd &V,
+            const Eigen::MatrixXd &Q, const Eigen::MatrixXd *R = nullptr) {
+  std::cout << name << t << " s, ||I - Q^T Q|| = " << orthogonalityLoss(Q);
+  if (R) std::cout << ", ||V - QR||/||V|| = " << (V - Q * *R).norm() / V.norm();
+  std::cout << "\n";
+}
+
+int main(int argc, char **argv) {
+  std::cout << std::setprecision(3) << std::scientific;
+  const Eigen::Index m = argc > 1 ? std::atol(argv[1]) : 50000;
+  const Eigen::Index n = 256;
+  for (double cond : {1e2, 1e10}) {
+    const Eigen::VectorXd s = Eigen::VectorXd::LinSpaced(n, 0, -1).unaryExpr(
+        [cond](double e) { return std::pow(cond, e); });
+    const Eigen::MatrixXd V = testMatrix(m, s);
+    std::cout << "V: " << m << " x " << n << ", cond " << cond << "\n";
+    Eigen::MatrixXd Q, R;
+    double t = timeit([&] { Q = gso(V); });
+    report("  gso (CGS, BLAS-1):        ", t, V, Q);
+    t = timeit([&] { Q = gramschmidt(V); });
+    report("  gramschmidt (CGS, BLAS-2):", t, V, Q);
+    t = timeit([&] {
+      const Eigen::HouseholderQR<Eigen::MatrixXd> qr(V);
+      Q = qr.householderQ() * Eigen::MatrixXd::Identity(m, n);
+      R = qr.matrixQR().topRows(n).triangularView<Eigen::Upper>();
+    });
+    report("  Householder:              ", t, V, Q, &R);
+    BcgsOptions opt;
+    t = timeit([&] { bcgs2(V, Q, R, opt); });
+    report("  BCGS2 + TSQR:             ", t, V, Q, &R);
+    opt.panel = BcgsPanel::CholeskyQR2;
+    t = timeit([&] { bcgs2(V, Q, R, opt); });
+    report("  BCGS2 + CholeskyQR2:      ", t, V, Q, &R);
+  }
+
+  // Orthogonality monitor: loss of the basis after every block, and the
+  // cancellation in the first pass that the second one has to repair
+  const Eigen::VectorXd s = Eigen::VectorXd::LinSpaced(n, 0, -12).unaryExpr(
+      [](double e) { return std::pow(10.0, e); });
+  const Eigen::MatrixXd V = testMatrix(m, s);
+  BcgsOptions opt;
+  opt.block_size = 64;
+  opt.monitor = true;
+  Eigen::MatrixXd Q, R;
+  std::cout << "\ncond 1e12, blocks of " << opt.block_size << " columns\n";
+  for (const BcgsBlockInfo &bi : bcgs2(V, Q, R, opt)) {
+    std::cout << "  " << std::setw(3) << bi.cols << " columns: first pass "
+              << bi.first_pass << ", ||I - Q^T Q|| = " << bi.loss << "\n";
+  }
+  return 0;
+}
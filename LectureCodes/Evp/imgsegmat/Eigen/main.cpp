@@ -1,9 +1,56 @@
 #include <Eigen/Dense>
+#include <chrono>
 #include <iostream>
 #include <libgen.h>
+#include "imglaplacian.hpp"
 #include "imgsegmat.hpp"
 #include "imread.hpp"
 
+template <class Action>
+double timeit(Action &&a)
+{
+	const auto start = std::chrono::high_resolution_clock::now();
+	a();
+	const auto end = std::chrono::high_resolution_clock::now();
+	return std::chrono::duration<double>(end - start).count();
+}
+
+// Triplet assembly vs. stencil assembly and matrix-free application
+void compare(const Eigen::MatrixXd &P)
+{
+	std::cout << "image " << P.rows() << " x " << P.cols() << "\n";
+	Eigen::SparseMatrix<double> D, A;
+	auto Sfun = [](double a, double b) { return std::exp(-0.1*(a-b)*(a-b)); };
+	const double t0 = timeit([&] { std::tie(A,D) = imgsegmat(P, Sfun); });
+
+	// the same similarity function for whole array blocks
+	auto Sarr = [](auto x, auto y) { return (-0.1*(x-y).square()).exp(); };
+	ImgEdgeWeights E;
+	Eigen::SparseMatrix<double> B;
+	const double t1 = timeit([&] { E = imgEdgeWeights(P, Sarr); });
+	const double t2 = timeit([&] { B = imgLaplacianCSR(E); });
+	std::cout << "  triplets:         " << t0 << " s\n"
+	          << "  edge weights:     " << t1 << " s\n"
+	          << "  direct CSR:       " << t2 << " s\n"
+	          << "  |A - A_stencil| = " << (A - B).norm() << "\n";
+
+	ImgLaplacian L(E);
+	Eigen::VectorXd x = Eigen::VectorXd::Random(L.rows()), y, z;
+	const double t3 = timeit([&] { for (int r = 0; r < 10; ++r) y = A*x; });
+	const double t4 = timeit([&] { for (int r = 0; r < 10; ++r) L.apply(x, z); });
+	std::cout << "  10 x sparse A*x:  " << t3 << " s\n"
+	          << "  10 x matrix-free: " << t4 << " s, difference "
+	          << (y - z).norm() << "\n";
+
+	ImgEdgeWeights E8;
+	const double t5 = timeit([&] {
+		E8 = imgEdgeWeights(P, Sarr, ImgStencil::Eight);
+		B = imgLaplacianCSR(E8); });
+	ImgLaplacian L8(E8);
+	L8.apply(x, z);
+	std::cout << "  8 neighbours:     " << t5 << " s, nnz = " << B.nonZeros()
+	          << ", matrix-free difference " << (B*x - z).norm() << "\n";
+}
 
 int main(int arc, char** argv)
 {
@@ -11,12 +58,16 @@ int main(int arc, char** argv)
 
 	auto img = readBMP(path);
 	Eigen::MatrixXd P = greyscale(img);
+	compare(P);
 
-	Eigen::SparseMatrix<double> D;
-	Eigen::SparseMatrix<double> A;
-
-	auto Sfun = [](double a, double b) { return 1; };
-
-	std::tie(A,D) = imgsegmat(P, Sfun);
-
+	// synthetic 1000 x 1000 image: smooth background with a bright disk
+	const int n = 1000;
+	Eigen::MatrixXd Q(n, n);
+	for (int j = 0; j < n; ++j)
+		for (int i = 0; i < n; ++i)
+		{
+			const double r2 = (i-400.0)*(i-400.0) + (j-600.0)*(j-600.0);
+			Q(i,j) = 50.0*i/n + (r2 < 200.0*200.0 ? 150.0 : 0.0);
+		}
+	compare(Q);
 }
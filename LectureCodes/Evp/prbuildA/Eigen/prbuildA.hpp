@@ -15,7 +15,7 @@ Eigen::MatrixXd prbuildA(const Eigen::MatrixXi &G, double d)
 		if (sum(i) > 0)
 		{
 			ds(i) = d/N;
-			s(i) = d/N;
+			s(i) = 1.0/sum(i);
 		}
 	}
 
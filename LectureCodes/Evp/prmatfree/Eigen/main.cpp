@@ -0,0 +1,96 @@
+#include <libgen.h>
+
+#include <chrono>
+#include <iomanip>
+#include <iostream>
+#include <string>
+
+#include "prbuildA.hpp"
+#include "prmatfree.hpp"
+
+template <class Action>
+double timeit(Action &&a) {
+  const auto start = std::chrono::high_resolution_clock::now();
+  a();
+  const auto end = std::chrono::high_resolution_clock::now();
+  return std::chrono::duration<double>(end - start).count();
+}
+
+// Power iteration, power iteration with quadratic extrapolation and
+// Gauss-Seidel for the graph G
+void compareSolvers(const CsrGraph &G, unsigned int num_threads) {
+  PageRankOperator A(G, 0.15, num_threads);
+  PageRankOptions opt;
+  PageRankResult res;
+  double t = timeit([&] { res = pagerankPower(A, opt); });
+  std::cout << "  power:         " << std::setw(4) << res.iterations
+            << " iterations, residual " << res.residual << ", " << t
+            << " s\n";
+  opt.extrapolate = 10;
+  t = timeit([&] { res = pagerankPower(A, opt); });
+  std::cout << "  extrapolated:  " << std::setw(4) << res.iterations
+            << " iterations, residual " << res.residual << ", " << t
+            << " s\n";
+  t = timeit([&] { res = pagerankGaussSeidel(A, opt); });
+  std::cout << "  Gauss-Seidel:  " << std::setw(4) << res.iterations
+            << " iterations, residual " << res.residual << ", " << t
+            << " s\n";
+}
+
+int main(int argc, char **argv) {
+  std::cout << std::setprecision(3) << std::scientific;
+  const std::string path = std::string(dirname(argv[0])) + "/Harvard500.mtx";
+  CsrGraph G;
+  if (!loadMarketGraph(G, path)) return 1;
+  std::cout << "Harvard500: N = " << G.N << ", " << G.nnz() << " links\n";
+
+  // Comparison with the dense Google matrix of prbuildA()
+  {
+    Eigen::MatrixXi Gd = Eigen::MatrixXi::Zero(G.N, G.N);
+    for (unsigned int i = 0; i < G.N; ++i) {
+      for (std::size_t p = G.ptr[i]; p < G.ptr[i + 1]; ++p) Gd(i, G.idx[p]) = 1;
+    }
+    const Eigen::MatrixXd Ad = prbuildA(Gd, 0.15);
+    Eigen::VectorXd x = Eigen::VectorXd::Constant(G.N, 1.0 / G.N);
+    for (int l = 0; l < 200; ++l) x = Ad * x;
+    PageRankOperator A(G, 0.15);
+    const PageRankResult res = pagerankPower(A);
+    std::cout << "difference to dense prbuildA(): "
+              << (res.x.col(0) - x).cwiseAbs().sum() << "\n";
+  }
+  compareSolvers(G, 0);
+
+  // Larger graph: from the command line or a random web graph
+  CsrGraph H;
+  if (argc > 1) {
+    if (!loadMarketGraph(H, argv[1])) return 1;
+  } else {
+    H = randomWebGraph(500000, 8.0);
+  }
+  std::cout << "\nLarge graph: N = " << H.N << ", " << H.nnz() << " links\n";
+  for (unsigned int p : {1, 2, 4}) {
+    std::cout << p << " thread(s)\n";
+    compareSolvers(H, p);
+  }
+
+  // Personalized PageRank for 8 teleportation vectors: one batched power
+  // iteration vs. 8 separate ones
+  {
+    const unsigned int k = 8;
+    PageRankOperator A(H, 0.15);
+    Eigen::MatrixXd V = Eigen::MatrixXd::Zero(H.N, k);
+    for (unsigned int l = 0; l < k; ++l) V(l * (H.N / k), l) = 1.0;
+    PageRankResult batch;
+    const double tb = timeit([&] { batch = pagerankPower(A, {}, V); });
+    double ts = 0.0, diff = 0.0;
+    for (unsigned int l = 0; l < k; ++l) {
+      PageRankResult single;
+      ts += timeit([&] { single = pagerankPower(A, {}, V.col(l)); });
+      diff = std::max(diff, (single.x.col(0) - batch.x.col(l)).norm());
+    }
+    std::cout << "\nPersonalized PageRank, " << k
+              << " vectors: batched " << tb << " s, separately " << ts
+              << " s, difference " << diff << "\n";
+  }
+  return 0;
+}
@@ -0,0 +1,247 @@
+#pragma once
+
+#include <Eigen/Dense>
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <utility>
+#include <vector>
+
+#include "csrgraph.hpp"
+#include "parallel.hpp"
+
+/* Matrix-free PageRank. The Google matrix built by prbuildA(),
+ *   A = (1-d) G D^{-1} + v (d 1^T + (1-d) a^T),
+ * (D = diag(out-degrees) on the non-dangling pages, a = indicator vector
+ * of the dangling pages, v = teleportation distribution, uniform in
+ * prbuildA()) is never formed: A x only needs the CSR structure of G, the
+ * reciprocal out-degrees and the rank-one correction, O(N + nnz) memory and
+ * work. Columns of X are independent distributions (personalized PageRank
+ * for several teleportation vectors at once). */
+
+// The teleportation probability d and the number of threads are those of
+// the PageRankOperator passed to the solvers
+struct PageRankOptions {
+  double tol = 1e-10;             // stop if ||x_{k+1} - x_k||_1 <= tol
+  unsigned int maxit = 1000;
+  unsigned int extrapolate = 0;   // quadratic extrapolation every k steps
+};
+
+struct PageRankResult {
+  Eigen::MatrixXd x;  // page ranks, one column per teleportation vector
+  unsigned int iterations = 0;
+  double residual = 0.0;  // max_l ||A x_l - x_l||_1 on exit
+  bool converged = false;
+};
+
+/* SAM_LISTING_BEGIN_0 */
+class PageRankOperator {
+ public:
+  // Row-major storage: a row of X (one page, all distributions) is
+  // contiguous, which is what the gather over the in-links reads
+  using RowMatrix =
+      Eigen::Matrix<double, Eigen::Dynamic, Eigen::Dynamic, Eigen::RowMajor>;
+
+  // G: in-links of every page, i.e. the CSR structure of the connectivity
+  // matrix (G(i,j) = 1 if page j links to page i); the operator keeps its
+  // own copy, so G may be a temporary
+  PageRankOperator(CsrGraph G, double d = 0.15, unsigned int num_threads = 0)
+      : G_(std::move(G)), d_(d), num_threads_(num_threads) {
+    std::vector<unsigned int> outdeg(G_.N, 0);
+    for (unsigned int j : G_.idx) ++outdeg[j];
+    inv_deg_.resize(G_.N);
+    tele_.resize(G_.N);
+    for (unsigned int j = 0; j < G_.N; ++j) {
+      inv_deg_[j] = outdeg[j] > 0 ? 1.0 / outdeg[j] : 0.0;
+      // mass of page j that is redistributed according to v
+      tele_[j] = outdeg[j] > 0 ? d_ : 1.0;
+    }
+  }
+
+  unsigned int size() const { return G_.N; }
+  double d() const { return d_; }
+  const CsrGraph &graph() const { return G_; }
+  const Eigen::VectorXd &invDegree() const { return inv_deg_; }
+  const Eigen::VectorXd &teleport() const { return tele_; }
+
+  // Y = A X, column l of V is the teleportation vector of column l of X;
+  // V with a single column is used for all columns, an empty V means
+  // uniform teleportation as in prbuildA()
+  void apply(const RowMatrix &X, const RowMatrix &V, RowMatrix &Y) const {
+    const Eigen::Index k = X.cols();
+    assert(X.rows() == G_.N);
+    // mass redistributed by teleportation, c = X^T tele
+    const Eigen::RowVectorXd c = tele_.transpose() * X;
+    Y.resize(G_.N, k);
+    const double *xd = X.data();
+    parallelFor(
+        G_.N,
+        [&](std::size_t begin, std::size_t end, unsigned int) {
+          for (std::size_t i = begin; i < end; ++i) {
+            double *y = Y.data() + i * k;  // row i of Y
+            if (k == 1) {
+              // single distribution: scalar accumulation
+              double yi = 0.0;
+              for (std::size_t p = G_.ptr[i]; p < G_.ptr[i + 1]; ++p) {
+                yi += inv_deg_[G_.idx[p]] * xd[G_.idx[p]];
+              }
+              y[0] = (1.0 - d_) * yi;
+            } else {
+              Eigen::Map<Eigen::RowVectorXd> yi(y, k);
+              yi.setZero();
+              for (std::size_t p = G_.ptr[i]; p < G_.ptr[i + 1]; ++p) {
+                const unsigned int j = G_.idx[p];
+                yi.noalias() += inv_deg_[j] * X.row(j);
+              }
+              yi *= 1.0 - d_;
+            }
+            for (Eigen::Index l = 0; l < k; ++l) {
+              const double vil = V.size() == 0   ? 1.0 / G_.N
+                                 : V.cols() == 1 ? V(i, 0)
+                                                 : V(i, l);
+              y[l] += vil * c[l];
+            }
+          }
+        },
+        num_threads_);
+  }
+
+ private:
+  CsrGraph G_;
+  double d_;
+  unsigned int num_threads_;
+  Eigen::VectorXd inv_deg_;  // 1/out-degree, 0 for dangling pages
+  Eigen::VectorXd tele_;     // d, 1 for dangling pages
+};
+/* SAM_LISTING_END_0 */
+
+namespace prmatfree_detail {
+// Quadratic extrapolation [Kamvar, Haveliwala, Manning, Golub 2003] from
+// four successive power iterates x0, ..., x3 (one column each), assuming
+// that x0 is a combination of the dominant three eigenvectors
+inline Eigen::VectorXd quadExtrapolate(const Eigen::VectorXd &x0,
+                                       const Eigen::VectorXd &x1,
+                                       const Eigen::VectorXd &x2,
+                                       const Eigen::VectorXd &x3) {
+  Eigen::MatrixXd Y(x0.size(), 2);
+  Y.col(0) = x1 - x0;
+  Y.col(1) = x2 - x0;
+  const Eigen::Vector2d g = Y.householderQr().solve(x0 - x3);
+  const double b0 = g(0) + g(1) + 1.0, b1 = g(1) + 1.0;
+  Eigen::VectorXd x = b0 * x1 + b1 * x2 + x3;
+  x = x.cwiseAbs();
+  return x / x.sum();
+}
+
+inline PageRankOperator::RowMatrix startVectors(const PageRankOperator &A,
+                                                const Eigen::MatrixXd &V) {
+  if (V.size() == 0) {
+    return PageRankOperator::RowMatrix::Constant(A.size(), 1, 1.0 / A.size());
+  }
+  return V;
+}
+
+inline double residual(const PageRankOperator &A,
+                       const PageRankOperator::RowMatrix &X,
+                       const PageRankOperator::RowMatrix &V) {
+  PageRankOperator::RowMatrix Y;
+  A.apply(X, V, Y);
+  return (Y - X).cwiseAbs().colwise().sum().maxCoeff();
+}
+}  // namespace prmatfree_detail
+
+/* SAM_LISTING_BEGIN_1 */
+// Power iteration x_{k+1} = A x_k for all columns of V at once (V: N x k
+// teleportation distributions, empty = uniform), started from V. With
+// opt.extrapolate = m > 0 every m-th iterate is replaced by its quadratic
+// extrapolation.
+inline PageRankResult pagerankPower(const PageRankOperator &A,
+                                    const PageRankOptions &opt = {},
+                                    const Eigen::MatrixXd &V = {}) {
+  using RowMatrix = PageRankOperator::RowMatrix;
+  const RowMatrix Vr = V;
+  RowMatrix X = prmatfree_detail::startVectors(A, V), Y;
+  std::vector<RowMatrix> hist;  // the last iterates for extrapolation
+  PageRankResult res;
+  for (res.iterations = 1; res.iterations <= opt.maxit; ++res.iterations) {
+    A.apply(X, Vr, Y);
+    const double delta = (Y - X).cwiseAbs().colwise().sum().maxCoeff();
+    X.swap(Y);
+    if (delta <= opt.tol) {
+      res.converged = true;
+      break;
+    }
+    if (opt.extrapolate > 0) {
+      hist.push_back(X);
+      if (hist.size() > 4) hist.erase(hist.begin());
+      if (res.iterations % opt.extrapolate == 0 && hist.size() == 4) {
+        for (Eigen::Index l = 0; l < X.cols(); ++l) {
+          X.col(l) = prmatfree_detail::quadExtrapolate(
+              hist[0].col(l), hist[1].col(l), hist[2].col(l), hist[3].col(l));
+        }
+        hist.clear();
+      }
+    }
+  }
+  res.iterations = std::min(res.iterations, opt.maxit);
+  res.residual = prmatfree_detail::residual(A, X, Vr);
+  res.x = X;
+  return res;
+}
+/* SAM_LISTING_END_1 */
+
+/* SAM_LISTING_BEGIN_2 */
+// Gauss-Seidel iteration for the linear system
+//   x = (1-d) G D^{-1} x + v (d + (1-d) a^T x),   1^T x = 1,
+// the dangling mass a^T x is updated as soon as an entry changes. The sweeps
+// are inherently sequential, only the final residual uses the threads of A.
+// v: teleportation vector (empty = uniform).
+inline PageRankResult pagerankGaussSeidel(const PageRankOperator &A,
+                                          const PageRankOptions &opt = {},
+                                          const Eigen::VectorXd &v = {}) {
+  const CsrGraph &G = A.graph();
+  const unsigned int N = G.N;
+  const double d = A.d();
+  const Eigen::VectorXd &inv_deg = A.invDegree();
+  auto vi = [&v, N](unsigned int i) { return v.size() ? v[i] : 1.0 / N; };
+  Eigen::VectorXd x = v.size() ? v : Eigen::VectorXd::Constant(N, 1.0 / N);
+  double dangling = 0.0;  // a^T x
+  for (unsigned int i = 0; i < N; ++i) {
+    if (inv_deg[i] == 0.0) dangling += x[i];
+  }
+  PageRankResult res;
+  for (res.iterations = 1; res.iterations <= opt.maxit; ++res.iterations) {
+    double delta = 0.0;
+    for (unsigned int i = 0; i < N; ++i) {
+      double s = 0.0, diag = 0.0;
+      for (std::size_t p = G.ptr[i]; p < G.ptr[i + 1]; ++p) {
+        const unsigned int j = G.idx[p];
+        if (j == i) {
+          diag += inv_deg[j];  // self-link
+        } else {
+          s += inv_deg[j] * x[j];
+        }
+      }
+      const bool dang = inv_deg[i] == 0.0;
+      const double others = dang ? dangling - x[i] : dangling;
+      double xi = (1.0 - d) * s + vi(i) * (d + (1.0 - d) * others);
+      xi /= 1.0 - (1.0 - d) * (diag + (dang ? vi(i) : 0.0));
+      delta += std::abs(xi - x[i]);
+      if (dang) dangling += xi - x[i];
+      x[i] = xi;
+    }
+    const double sum = x.sum();
+    x /= sum;
+    dangling /= sum;
+    if (delta <= opt.tol) {
+      res.converged = true;
+      break;
+    }
+  }
+  res.iterations = std::min(res.iterations, opt.maxit);
+  const PageRankOperator::RowMatrix X = x, Vr = v;
+  res.residual = prmatfree_detail::residual(A, X, Vr);
+  res.x = x;
+  return res;
+}
+/* SAM_LISTING_END_2 */
@@ -1,32 +1,34 @@
 #include <Eigen/Dense>
 #include <Eigen/Sparse>
 #include <figure.hpp>
-#include "graphMarketMatrixLoader.hpp"
-#include "prbuildA.hpp"
+#include "csrgraph.hpp"
+#include "prmatfree.hpp"
 
 // sime page rank calculation by tracking fractions of many surfers
 void prpowitsim(std::string path, double d = 0.15, int Nsteps = 5)
 {	
-	// load connectivity matrix and build transition matrix
-	Eigen::MatrixXi G;
-	loadGraphMarketMatrix(G, path);
-	Eigen::MatrixXd A = prbuildA(G, 0.15);
+	// load connectivity matrix, the transition matrix is not formed,
+	// see prbuildA() for the dense version
+	CsrGraph G;
+	if (!loadMarketGraph(G, path)) return;
+	PageRankOperator A(G, d);
 
 	// initial distribution
-	int N = A.rows();
-	Eigen::VectorXd x = Eigen::VectorXd::Ones(N) / N;
+	int N = A.size();
+	PageRankOperator::RowMatrix x = Eigen::VectorXd::Ones(N) / N, y;
 
 	// Plain power iteration for stochastic matrix \Blue{$\VA$}
 	for (int l=0; l<Nsteps; ++l)
 	{
-		x = A*x;
+		A.apply(x, {}, y);
+		x.swap(y);
 	}
 
 	// plot result
 	Eigen::VectorXd pages = Eigen::VectorXd::LinSpaced(N, 1, N);
 	mgl::Figure fig;
 	std::string title = "bf step " + std::to_string(Nsteps);
-	fig.plot(pages, x, " *r");
+	fig.plot(pages, Eigen::VectorXd(x), " *r");
 	fig.title("bf step ");
 	fig.xlabel("harvard500: no. of page");
 	fig.ylabel("page rank");
@@ -4,55 +4,33 @@
 #include <string>
 #include <stdlib.h>
 #include <time.h>
-#include "graphMarketMatrixLoader.hpp"
+#include <iostream>
+#include "csrgraph.hpp"
+#include "prsurfer.hpp"
 
 
-// simplified page rank algorithm: simulates Nhops link clicks of a surfer
+// simplified page rank algorithm: simulates Nhops link clicks of surfers
 void prstochsim(std::string path, int Nhops)
 {
 
-	// Load web graph data stored in \Blue{$N\times N$}-matrix \Blue{$\VG$}
-	Eigen::SparseMatrix<double> G;
-	if (!loadGraphMarketMatrix<double>(G, path))
+	// Load web graph data: out-links of every page in CSR format
+	CsrGraph G;
+	if (!loadMarketGraph(G, path))
 	{
 		std::cerr << "Matrix Hardvard500.mtx has not been found." << std::endl;
 		exit(EXIT_FAILURE);
 	}
+	const CsrGraph out = transpose(G);
+	int N = G.N;
 
-	int N = G.rows();
-	double d = 0.15;
-	
-	int cp = 0; // current page index
-	Eigen::VectorXd count(N); // how often each page was visited
+	// Many independent surfers with O(1) hops, see prsurfer()
+	SurferOptions opt;
+	opt.seed = time(NULL); // initialize random seed
+	Eigen::VectorXd count = prsurfer(out, Nhops, opt); // visit frequencies
 
-	srand(time(NULL)); // initialize random seed
-
-	for (int i=0; i<Nhops; ++i)
-	{
-		// Find links from current page \texttt{cp}
-		Eigen::VectorXd col = G.col(cp).cast<double>();
-		std::vector<int> indices;	
-		for (int j=0; j<N; ++j) if (col(j) != 0) indices.push_back(j);
-
-
-		double rn = ((double) rand() / (RAND_MAX)); // random value in [0,1]
-
-	  	// If no links, jump to any other pages with equal probability
-		if (indices.size() == 0)	cp = floor(rn*N);
-
-		// With probabilty \Blue{$d$} jump to any other page  
-		else if (rn < d) 			cp = floor(rn/d*N);
-
-	  	// Follow outgoing links with equal probabilty
-		else cp = indices[floor((rn-d)/(1.-d)*indices.size())];
-
-		count(cp)++;
-	}	
-	
 	// plot result
 	Eigen::VectorXd pages = Eigen::VectorXd::LinSpaced(N, 1, N);
 	mgl::Figure fig;
-	count /= Nhops; // normalize visits
 	fig.plot(pages, count, " .r");
 	fig.xlabel("harvard500: no. of page");
 	fig.ylabel("page rank");
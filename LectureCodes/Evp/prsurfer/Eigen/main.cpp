@@ -0,0 +1,59 @@
+#include <libgen.h>
+
+#include <chrono>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <string>
+
+#include "prmatfree.hpp"
+#include "prsurfer.hpp"
+
+template <class Action>
+double timeit(Action &&a) {
+  const auto start = std::chrono::high_resolution_clock::now();
+  a();
+  const auto end = std::chrono::high_resolution_clock::now();
+  return std::chrono::duration<double>(end - start).count();
+}
+
+int main(int argc, char **argv) {
+  std::cout << std::setprecision(3) << std::scientific;
+  const std::string path = std::string(dirname(argv[0])) + "/Harvard500.mtx";
+  CsrGraph G;
+  if (!loadMarketGraph(G, path)) return 1;
+  const CsrGraph out = transpose(G);
+
+  // Convergence of the Monte Carlo estimate towards the page rank vector
+  // computed by the power method: the error decays like Nhops^(-1/2)
+  const PageRankResult ref = pagerankPower(PageRankOperator(G));
+  std::cout << "Harvard500, 1-norm error of the visit frequencies\n";
+  for (std::uint64_t Nhops = 100000; Nhops <= 100000000; Nhops *= 10) {
+    Eigen::VectorXd x;
+    const double t = timeit([&] { x = prsurfer(out, Nhops); });
+    std::cout << "Nhops = " << std::setw(9) << Nhops
+              << ": error = " << (x - ref.x.col(0)).cwiseAbs().sum()
+              << ", " << Nhops / t << " hops/s\n";
+  }
+
+  // Throughput on a large random web graph; the total number of hops may
+  // be passed on the command line (e.g. 1000000000)
+  const std::uint64_t Nhops = argc > 1 ? std::strtoull(argv[1], nullptr, 10)
+                                       : std::uint64_t(30000000);
+  const CsrGraph H = transpose(randomWebGraph(1000000, 8.0));
+  std::cout << "\nRandom web graph, N = " << H.N << ", " << Nhops
+            << " hops\n";
+  Eigen::VectorXd x1;
+  for (unsigned int p : {1, 2, 4, 8}) {
+    SurferOptions opt;
+    opt.num_threads = p;
+    Eigen::VectorXd x;
+    const double t = timeit([&] { x = prsurfer(H, Nhops, opt); });
+    if (p == 1) x1 = x;
+    // the surfers use their own random streams: same result for all p
+    std::cout << p << " thread(s): " << t << " s, " << Nhops / t
+              << " hops/s, difference to 1 thread "
+              << (x - x1).cwiseAbs().maxCoeff() << "\n";
+  }
+  return 0;
+}
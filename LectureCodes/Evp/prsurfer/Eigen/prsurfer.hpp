@@ -0,0 +1,152 @@
+#pragma once
+
+#include <Eigen/Dense>
+#include <algorithm>
+#include <array>
+#include <cassert>
+#include <cstdint>
+#include <vector>
+
+#include "csrgraph.hpp"
+#include "parallel.hpp"
+
+/* Monte Carlo PageRank: many independent random surfers, cf. prstochsim().
+ * - the out-links of a page are a contiguous CSR row, so a hop costs O(1)
+ *   instead of a scan of a dense column of G,
+ * - every surfer draws from its own counter-based Philox stream (key =
+ *   seed and surfer number), hence the result does not depend on the
+ *   number of threads and no generator state is shared,
+ * - visits are counted in thread-local arrays, which are summed up once at
+ *   the end. */
+
+/* SAM_LISTING_BEGIN_0 */
+// Philox4x32-10 counter-based random number generator [Salmon, Moraes,
+// Dror, Shaw, SC'11]: the n-th block of four 32-bit numbers of the stream
+// with key k is a bijective function (ten rounds) of the counter n.
+class Philox4x32 {
+ public:
+  using result_type = std::uint32_t;
+
+  explicit Philox4x32(std::uint64_t seed = 0, std::uint64_t stream = 0)
+      : key_{static_cast<std::uint32_t>(seed),
+             static_cast<std::uint32_t>(stream)},
+        ctr_{0, 0, static_cast<std::uint32_t>(stream >> 32),
+             static_cast<std::uint32_t>(seed >> 32)} {}
+
+  static constexpr result_type min() { return 0; }
+  static constexpr result_type max() { return 0xFFFFFFFFu; }
+
+  result_type operator()() {
+    if (pos_ == 4) {
+      block_ = generate(ctr_, key_);
+      // 64-bit block counter in the first two words
+      if (++ctr_[0] == 0) ++ctr_[1];
+      pos_ = 0;
+    }
+    return block_[pos_++];
+  }
+
+  // Uniformly distributed integer in [0,n) by multiply-shift; the bias is
+  // at most n/2^32, which is negligible for n << 2^32
+  std::uint32_t below(std::uint32_t n) {
+    return static_cast<std::uint32_t>((std::uint64_t((*this)()) * n) >> 32);
+  }
+
+  using Block = std::array<std::uint32_t, 4>;
+  static Block generate(Block c, std::array<std::uint32_t, 2> k) {
+    constexpr std::uint32_t M0 = 0xD2511F53u, M1 = 0xCD9E8D57u;
+    constexpr std::uint32_t W0 = 0x9E3779B9u, W1 = 0xBB67AE85u;
+    for (unsigned int r = 0; r < 10; ++r) {
+      if (r > 0) {
+        k[0] += W0;
+        k[1] += W1;
+      }
+      const std::uint64_t p0 = std::uint64_t(M0) * c[0];
+      const std::uint64_t p1 = std::uint64_t(M1) * c[2];
+      c = {static_cast<std::uint32_t>(p1 >> 32) ^ c[1] ^ k[0],
+           static_cast<std::uint32_t>(p1),
+           static_cast<std::uint32_t>(p0 >> 32) ^ c[3] ^ k[1],
+           static_cast<std::uint32_t>(p0)};
+    }
+    return c;
+  }
+
+ private:
+  std::array<std::uint32_t, 2> key_;
+  Block ctr_;
+  Block block_{};
+  unsigned int pos_ = 4;
+};
+/* SAM_LISTING_END_0 */
+
+struct SurferOptions {
+  double d = 0.15;               // probability of a random jump
+  unsigned int surfers = 1024;   // number of independent surfers
+  unsigned int burnin = 50;      // initial hops of each surfer not counted
+  std::uint64_t seed = 42;
+  unsigned int num_threads = 0;  // 0 = number of hardware threads
+};
+
+/* SAM_LISTING_BEGIN_1 */
+// Fraction of visits of every page in Nhops counted link clicks of
+// opt.surfers random surfers. out: out-links of every page, i.e.
+// transpose() of the CSR structure of the connectivity matrix G. A surfer
+// on a page without links jumps to any page, otherwise it jumps with
+// probability d and follows one of the links with equal probability else.
+inline Eigen::VectorXd prsurfer(const CsrGraph &out, std::uint64_t Nhops,
+                                const SurferOptions &opt = {}) {
+  const unsigned int N = out.N;
+  assert(N > 0 && opt.surfers > 0);
+  // jump if a 32-bit random number is below d 2^32
+  const std::uint32_t jump = static_cast<std::uint32_t>(
+      std::min(opt.d * 4294967296.0, 4294967295.0));
+  const unsigned int p = numThreadsFor(opt.surfers, opt.num_threads);
+  std::vector<std::vector<std::uint64_t>> counts(p);
+  parallelFor(
+      opt.surfers,
+      [&](std::size_t begin, std::size_t end, unsigned int tid) {
+        std::vector<std::uint64_t> &count = counts[tid];
+        count.assign(N, 0);
+        // surfers are advanced in groups in lockstep: their hops are
+        // independent, so the cache misses of the group overlap
+        constexpr std::size_t group = 16;
+        Philox4x32 rng[group];
+        std::uint32_t cp[group];     // current pages
+        std::uint64_t hops[group];   // remaining hops incl. burn-in
+        for (std::size_t s0 = begin; s0 < end; s0 += group) {
+          const std::size_t m = std::min(group, end - s0);
+          std::uint64_t maxhops = 0;
+          for (std::size_t g = 0; g < m; ++g) {
+            const std::size_t s = s0 + g;
+            rng[g] = Philox4x32(opt.seed, s);
+            cp[g] = rng[g].below(N);
+            // the remainder of Nhops goes to the first surfers
+            hops[g] = Nhops / opt.surfers + (s < Nhops % opt.surfers ? 1 : 0) +
+                      opt.burnin;
+            maxhops = std::max(maxhops, hops[g]);
+          }
+          for (std::uint64_t i = 0; i < maxhops; ++i) {
+            for (std::size_t g = 0; g < m; ++g) {
+              if (i >= hops[g]) continue;
+              const unsigned int deg = out.degree(cp[g]);
+              if (deg == 0 || rng[g]() < jump) {
+                cp[g] = rng[g].below(N);
+              } else {
+                cp[g] = out.idx[out.ptr[cp[g]] + rng[g].below(deg)];
+              }
+              if (i >= opt.burnin) ++count[cp[g]];
+            }
+          }
+        }
+      },
+      opt.num_threads);
+  // reduction of the thread-local counters
+  Eigen::VectorXd x = Eigen::VectorXd::Zero(N);
+  for (const auto &count : counts) {
+    for (unsigned int i = 0; i < N && !count.empty(); ++i) {
+      x[i] += static_cast<double>(count[i]);
+    }
+  }
+  return x / static_cast<double>(Nhops);
+}
+/* SAM_LISTING_END_1 */
@@ -1,16 +1,24 @@
 #include <libgen.h>
+#include <iostream>
 #include "seg.hpp"
 
-//TODO: test with MKL (without Eigen is too slow)
-
 //1st stage of segmentation of grayscale image
 int main(int argc, char** argv)
 {
 	std::string path = std::string(dirname(argv[0])) +	"/test.bmp";
 
 	auto img = readBMP(path);
-	Eigen::MatrixXd P = greyscale(img);
+	// grey values scaled to [0,10]: weights of at least exp(-10) keep the
+	// pixel graph connected
+	Eigen::MatrixXd P = greyscale(img)/25.5;
 
-	seg(P);
+	Eigen::MatrixXd xs = seg(P);
 
+	// pixels above the mean of the eigenvector form one segment
+	const double mean = xs.mean();
+	for (int i = 0; i < xs.rows(); ++i)
+	{
+		for (int j = 0; j < xs.cols(); ++j) std::cout << (xs(i,j) > mean ? '#' : '.');
+		std::cout << "\n";
+	}
 }
@@ -1,53 +1,86 @@
 #include <Eigen/Dense>
 #include <Eigen/Sparse>
 #include <Eigen/Eigenvalues>
-#include "spdiags.hpp"
-#include "imgsegmat.hpp"
+#include <cmath>
+#include <utility>
+#include "imglaplacian.hpp"
 #include "imread.hpp"
 
-// segmentation of P: build matrices, see \cref{mc:imgsegmat} and \eqref{eq:segmat}
-void seg(Eigen::MatrixXd &P)
+// Largest eigenvalue and eigenvector of the symmetric operator op
+// (op(x, y) computes y = op x) on the orthogonal complement of the unit
+// vector c: Lanczos process with k steps and full reorthogonalization,
+// restarted with the current Ritz vector. Memory: k vectors.
+template <class Operator>
+std::pair<double, Eigen::VectorXd> lanczosMax(Operator &&op,
+                                              const Eigen::VectorXd &c,
+                                              unsigned int k = 30,
+                                              double tol = 1e-8,
+                                              unsigned int maxrestart = 200)
 {
-	int m = P.rows(); int n = P.cols();	
-
-	Eigen::SparseMatrix<double> D;
-	Eigen::SparseMatrix<double> A;
-
-	auto Sfun = [](double x, double y) 
-		{ return std::exp(-0.1*std::pow(x-y, 2)); };
-
-	std::tie(A,D) = imgsegmat(P, Sfun);
-
-	// Build scaling matrics 
-	
-	int N = A.rows();
-	Eigen::VectorXd dv = A.diagonal().array().square();
-
-	Eigen::VectorXi d(1); d << 0; // represents the main diagonal
-
-	Eigen::SparseMatrix<double> Dm = spdiags<double>(dv.cwiseInverse(),d,N,N); // \Blue{$\VD^{-\nicefrac{1}{2}}$}
-	Eigen::SparseMatrix<double> Dp = spdiags<double>(dv,d,N,N);     // \Blue{$\VD^{\nicefrac{1}{2}}$%
-
-	// Build (densely populated !) matrix \Blue{$\wh{\VA}$}
-	Eigen::VectorXd c = Dp*Eigen::VectorXd::Constant(N,1); 
-	Eigen::SparseMatrix<double> Ahtemp = Dm*A*Dm;
-	Eigen::MatrixXd Ah = Eigen::MatrixXd(Ahtemp) + 2*c*c.transpose();
+	const Eigen::Index N = c.size();
+	Eigen::VectorXd u = Eigen::VectorXd::Random(N);
+	u -= c.dot(u)*c;
+	u.normalize();
+	Eigen::MatrixXd V(N, k);
+	Eigen::VectorXd alpha(k), beta(k), w;
+	double theta = 0;
+	for (unsigned int r = 0; r <= maxrestart; ++r)
+	{
+		V.col(0) = u;
+		unsigned int j = 0;
+		for (; j < k; ++j)
+		{
+			op(Eigen::VectorXd(V.col(j)), w);
+			alpha(j) = V.col(j).dot(w);
+			// full reorthogonalization, also against c
+			w -= c.dot(w)*c;
+			w -= V.leftCols(j+1)*(V.leftCols(j+1).transpose()*w);
+			beta(j) = w.norm();
+			if (j+1 < k)
+			{
+				if (beta(j) <= 1e-14*std::abs(alpha(j))) { ++j; break; } // invariant subspace
+				V.col(j+1) = w/beta(j);
+			}
+		}
+		// Ritz pair for the largest eigenvalue of the tridiagonal matrix
+		Eigen::SelfAdjointEigenSolver<Eigen::MatrixXd> es;
+		es.computeFromTridiagonal(alpha.head(j), beta.head(j-1));
+		theta = es.eigenvalues()(j-1);
+		const Eigen::VectorXd s = es.eigenvectors().col(j-1);
+		u = V.leftCols(j)*s;
+		u.normalize();
+		if (std::abs(beta(j-1)*s(j-1)) <= tol*std::abs(theta)) break;
+	}
+	return {theta, u};
+}
 
+// segmentation of P: build matrices, see \cref{mc:imgsegmat} and \eqref{eq:segmat}
+// Returns the eigenvector \Blue{$\Vx^{\ast}$} belonging to the 2nd smallest
+// generalized eigenvalue of \Blue{$\VA$} and \Blue{$\VD$}, reshaped to the size of P
+Eigen::MatrixXd seg(const Eigen::MatrixXd &P, ImgStencil stencil = ImgStencil::Four)
+{
+	int m = P.rows(); int n = P.cols();
 
-	// Compute eigenvalues; grossly inefficient \Red{!}
-	Eigen::EigenSolver<Eigen::MatrixXd> solver(Ah, true);
-	auto E = solver.eigenvectors().real();
-	auto W = solver.eigenvalues().real();
+	// similarity function, evaluated for whole image blocks
+	auto Sfun = [](auto x, auto y)
+		{ return (-0.1*(x-y).square()).exp(); };
 
+	// matrix-free Laplacian \Blue{$\VA = \VD - \VW$}, see imglaplacian.hpp
+	ImgLaplacian L(imgEdgeWeights(P, Sfun, stencil));
 
-	// Obtain eigenvector \Blue{$\Vx^{\ast}$} belonging to 2nd smallest generalized
-	int maxIndex;
-	W.maxCoeff(&maxIndex);
+	// Scaling vectors: \Blue{$\VD^{\nicefrac{1}{2}}\mathbf{1}$} spans the kernel of
+	// \Blue{$\VD^{-\nicefrac{1}{2}}\VA\VD^{-\nicefrac{1}{2}}$}
+	Eigen::VectorXd dv = L.degrees().cwiseSqrt();
+	Eigen::VectorXd c = dv.normalized();
 
-	// eigenvalue of \Blue{$\VA$} and \Blue{$\VD$}
-	Eigen::VectorXd x = W.col(maxIndex);
-	x = Dm*x;
+	// 2nd smallest eigenvalue of \Blue{$\VD^{-\nicefrac{1}{2}}\VA\VD^{-\nicefrac{1}{2}}$}
+	// = largest eigenvalue of \Blue{$2\VI - \VD^{-\nicefrac{1}{2}}\VA\VD^{-\nicefrac{1}{2}}$}
+	// on the orthogonal complement of its kernel; no dense matrix is formed
+	auto op = [&L](const Eigen::VectorXd &x, Eigen::VectorXd &y)
+		{ L.applyNormalized(x, y); y = 2*x - y; };
+	Eigen::VectorXd v = lanczosMax(op, c).second;
+	Eigen::VectorXd x = v.cwiseQuotient(dv);
 
 	// Extract segmented image
-	//Eigen::MatrixXd xs = reshape(x,m,n); 
+	return Eigen::Map<Eigen::MatrixXd>(x.data(), m, n);
 }
@@ -0,0 +1,134 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <fstream>
+#include <iostream>
+#include <random>
+#include <sstream>
+#include <string>
+#include <utility>
+#include <vector>
+
+/* Directed graph in compressed sparse row (CSR) format: the neighbours of
+ * node i are idx[ptr[i]], ..., idx[ptr[i+1]-1] (sorted, no duplicates).
+ * For a web graph with connectivity matrix G (G(i,j) = 1 if page j links
+ * to page i) the CSR structure of G lists the in-links of every page, that
+ * of G^T (see transpose()) the out-links. Memory: O(N + nnz), in contrast
+ * to the dense matrices built by loadGraphMarketMatrix(). */
+struct CsrGraph {
+  unsigned int N = 0;
+  std::vector<std::size_t> ptr{0};
+  std::vector<unsigned int> idx;
+
+  std::size_t nnz() const { return idx.size(); }
+  unsigned int degree(unsigned int i) const {
+    return static_cast<unsigned int>(ptr[i + 1] - ptr[i]);
+  }
+};
+
+// Build the CSR structure from the (0-based) positions (i,j) of the
+// non-zero entries of an N x N matrix, duplicates are removed
+inline CsrGraph csrFromPairs(
+    unsigned int N, const std::vector<std::pair<unsigned int, unsigned int>>
+                        &entries) {
+  CsrGraph G;
+  G.N = N;
+  G.ptr.assign(N + 1, 0);
+  for (const auto &e : entries) ++G.ptr[e.first + 1];
+  for (unsigned int i = 0; i < N; ++i) G.ptr[i + 1] += G.ptr[i];
+  G.idx.resize(entries.size());
+  std::vector<std::size_t> fill(G.ptr.begin(), G.ptr.end() - 1);
+  for (const auto &e : entries) G.idx[fill[e.first]++] = e.second;
+  // sort the rows and squeeze out duplicates
+  std::size_t pos = 0;
+  for (unsigned int i = 0; i < N; ++i) {
+    const auto first = G.idx.begin() + G.ptr[i];
+    const auto last = G.idx.begin() + G.ptr[i + 1];
+    std::sort(first, last);
+    const auto uend = std::unique(first, last);
+    G.ptr[i] = pos;
+    pos = std::move(first, uend, G.idx.begin() + pos) - G.idx.begin();
+  }
+  G.ptr[N] = pos;
+  G.idx.resize(pos);
+  G.idx.shrink_to_fit();
+  return G;
+}
+
+// CSR structure of the transposed matrix
+inline CsrGraph transpose(const CsrGraph &G) {
+  CsrGraph T;
+  T.N = G.N;
+  T.ptr.assign(G.N + 1, 0);
+  for (unsigned int j : G.idx) ++T.ptr[j + 1];
+  for (unsigned int i = 0; i < G.N; ++i) T.ptr[i + 1] += T.ptr[i];
+  T.idx.resize(G.nnz());
+  std::vector<std::size_t> fill(T.ptr.begin(), T.ptr.end() - 1);
+  // rows of G are traversed in ascending order, so the rows of T are sorted
+  for (unsigned int i = 0; i < G.N; ++i) {
+    for (std::size_t k = G.ptr[i]; k < G.ptr[i + 1]; ++k) {
+      T.idx[fill[G.idx[k]]++] = i;
+    }
+  }
+  return T;
+}
+
+// Read the sparsity pattern of a square matrix in MatrixMarket coordinate
+// format (1-based indices, values are ignored) into CSR format.
+// Returns false if the file cannot be read.
+inline bool loadMarketGraph(CsrGraph &G, const std::string &path) {
+  std::ifstream file(path);
+  if (!file.is_open()) {
+    std::cerr << "Error reading file " << path << std::endl;
+    return false;
+  }
+  std::string line;
+  long M = -1, N = -1, count = -1;
+  std::vector<std::pair<unsigned int, unsigned int>> entries;
+  while (std::getline(file, line)) {
+    if (line.empty() || line[0] == '%') continue;
+    std::istringstream str(line);
+    if (M < 0) {
+      str >> M >> N >> count;
+      if (M != N || count < 0) {
+        std::cerr << path << ": not a square coordinate matrix" << std::endl;
+        return false;
+      }
+      entries.reserve(count);
+    } else {
+      long i = 0, j = 0;
+      str >> i >> j;
+      if (i >= 1 && j >= 1 && i <= M && j <= N) {
+        entries.emplace_back(i - 1, j - 1);
+      }
+    }
+  }
+  if (M < 0) return false;
+  G = csrFromPairs(static_cast<unsigned int>(N), entries);
+  return true;
+}
+
+// Random web graph for benchmarks: page j has a random number of out-links
+// (mean avg_deg, a fraction of about 1/(avg_deg+1) of the pages is
+// dangling), the targets are biased towards pages with small index, which
+// mimics the skewed in-degree distribution of real web graphs. Returns the
+// CSR structure of the connectivity matrix G (in-links).
+inline CsrGraph randomWebGraph(unsigned int N, double avg_deg,
+                               unsigned int seed = 42) {
+  std::mt19937_64 gen(seed);
+  std::geometric_distribution<unsigned int> deg(1.0 / (avg_deg + 1.0));
+  std::uniform_real_distribution<double> u(0.0, 1.0);
+  std::vector<std::pair<unsigned int, unsigned int>> entries;
+  entries.reserve(static_cast<std::size_t>(N * avg_deg));
+  for (unsigned int j = 0; j < N; ++j) {
+    const unsigned int dj = std::min(deg(gen), N);
+    for (unsigned int l = 0; l < dj; ++l) {
+      const double v = u(gen);
+      const unsigned int i =
+          std::min(N - 1, static_cast<unsigned int>(N * v * v * v));
+      entries.emplace_back(i, j);  // page j links to page i
+    }
+  }
+  return csrFromPairs(N, entries);
+}
@@ -0,0 +1,114 @@
+#include <Eigen/Dense>
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <complex>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+
+#include "nufft.hpp"
+#include "parallel.hpp"
+
+template <class Action>
+double timeit(Action &&a) {
+  const auto start = std::chrono::high_resolution_clock::now();
+  a();
+  const auto end = std::chrono::high_resolution_clock::now();
+  return std::chrono::duration<double>(end - start).count();
+}
+
+// f_k = sum_j c_j exp(isign 2 pi i s_k x_j), O(M K)
+Eigen::VectorXcd directSum(const Eigen::VectorXd &x, const Eigen::VectorXd &s,
+                           const Eigen::VectorXcd &c, int isign) {
+  Eigen::VectorXcd f(s.size());
+  parallelFor(s.size(), [&](std::size_t b, std::size_t e, unsigned int) {
+    for (std::size_t k = b; k < e; ++k) {
+      std::complex<double> v = 0.;
+      for (Eigen::Index j = 0; j < x.size(); ++j) {
+        v += c(j) * std::polar(1., isign * 2. * M_PI * s(k) * x(j));
+      }
+      f(k) = v;
+    }
+  });
+  return f;
+}
+
+int main(int argc, char **argv) {
+  std::cout << std::setprecision(3) << std::scientific;
+  std::srand(1);
+
+  // 1. Accuracy against the direct sums
+  {
+    const Eigen::Index M = 4000, ms = 3001;
+    const Eigen::VectorXd x = Eigen::VectorXd::Random(M) * 3.;
+    const Eigen::VectorXcd c = Eigen::VectorXcd::Random(M);
+    const Eigen::VectorXcd fk = Eigen::VectorXcd::Random(ms);
+    const Eigen::VectorXd k =
+        Eigen::VectorXd::LinSpaced(ms, -(ms / 2), ms - 1 - ms / 2);
+    // type 3: frequencies in [-500, 1500], points in [-3, 3]
+    const Eigen::VectorXd s =
+        500. + 1000. * Eigen::VectorXd::Random(ms).array();
+    const Eigen::VectorXcd f1 = directSum(x, k, c, -1);
+    const Eigen::VectorXcd c2 = directSum(k, x, fk, 1);
+    const Eigen::VectorXcd f3 = directSum(x, s, c, -1);
+    std::cout << "M = " << M << " points, " << ms << " modes\n";
+    for (double tol : {1e-3, 1e-6, 1e-9, 1e-12, 1e-14}) {
+      NufftOptions opt;
+      opt.tol = tol;
+      const Nufft P(ms, x, opt);
+      const Nufft3 P3(x, s, opt);
+      const double e1 = (P.type1(c) - f1).norm() / f1.norm();
+      const double e2 = (P.type2(fk) - c2).norm() / c2.norm();
+      const double e3 = (P3.type3(c) - f3).norm() / f3.norm();
+      std::cout << "  tol = " << tol << ": width " << EsKernel(tol).width()
+                << ", error type 1 " << e1 << ", type 2 " << e2 << ", type 3 "
+                << e3 << " (grid " << P3.gridSize() << ")\n";
+    }
+  }
+
+  // 2. O(ms log ms + M) cost, tol = 1e-12, a plan for every size is set
+  // up once and applied repeatedly
+  {
+    const Eigen::Index M_max = argc > 1 ? std::atol(argv[1]) : 10000000;
+    const Eigen::Index ms = 100001;
+    std::cout << ms << " modes, tol = 1e-12, "
+              << numThreadsFor(M_max / NufftOptions().min_chunk, 0)
+              << " threads\n";
+    for (Eigen::Index M = M_max / 8; M <= M_max; M *= 2) {
+      const Eigen::VectorXd x =
+          0.5 * (Eigen::VectorXd::Random(M).array() + 1.);
+      const Eigen::VectorXcd c = Eigen::VectorXcd::Random(M);
+      const Eigen::VectorXcd fk = Eigen::VectorXcd::Random(ms);
+      std::unique_ptr<Nufft> P;
+      const double t_plan = timeit([&] { P.reset(new Nufft(ms, x)); });
+      Eigen::VectorXcd f, cx;
+      double t1 = timeit([&] { f = P->type1(c); });
+      double t2 = timeit([&] { cx = P->type2(fk); });
+      // second application: cached FFT plan
+      t1 = std::min(t1, timeit([&] { f = P->type1(c); }));
+      t2 = std::min(t2, timeit([&] { cx = P->type2(fk); }));
+      // error on 20 points and modes
+      const Eigen::VectorXi I = Eigen::VectorXi::LinSpaced(20, 0, M - 1);
+      const Eigen::VectorXi K = Eigen::VectorXi::LinSpaced(20, 0, ms - 1);
+      Eigen::VectorXd xI(20), kK(20);
+      Eigen::VectorXcd cI(20), fK(20);
+      for (int i = 0; i < 20; ++i) {
+        xI(i) = x(I(i));
+        kK(i) = P->kmin() + K(i);
+        cI(i) = cx(I(i));
+        fK(i) = f(K(i));
+      }
+      const Eigen::VectorXd k =
+          Eigen::VectorXd::LinSpaced(ms, -(ms / 2), ms - 1 - ms / 2);
+      const Eigen::VectorXcd f1 = directSum(x, kK, c, -1);
+      const Eigen::VectorXcd c2 = directSum(k, xI, fk, 1);
+      std::cout << "  M = " << std::setw(8) << M << ": plan " << t_plan
+                << " s, type 1 " << t1 << " s, type 2 " << t2 << " s, "
+                << t2 / M << " s / M, error " << (fK - f1).norm() / f1.norm()
+                << ", " << (cI - c2).norm() / c2.norm() << "\n";
+    }
+  }
+  return 0;
+}
@@ -0,0 +1,322 @@
+#pragma once
+
+#include <Eigen/Dense>
+#include <algorithm>
+#include <cmath>
+#include <complex>
+#include <memory>
+#include <unsupported/Eigen/FFT>
+#include <vector>
+
+#include "gaussrules.hpp"
+#include "parallel.hpp"
+
+/* Non-uniform fast Fourier transforms in 1-D [Dutt, Rokhlin, SIAM J. Sci.
+ * Comput. 14 (1993); Barnett, Magland, af Klinteberg, SIAM J. Sci. Comput.
+ * 41 (2019)] for points x_j, j = 1, ..., M, and modes
+ * k = -floor(ms/2), ..., ceil(ms/2) - 1 (k = -n, ..., n for ms = 2n + 1):
+ *   type 1:  f_k = sum_j c_j exp(+-2 pi i k x_j),
+ *   type 2:  c_j = sum_k f_k exp(+-2 pi i k x_j),
+ *   type 3:  f_k = sum_j c_j exp(+-2 pi i s_k x_j), s_k arbitrary real.
+ * The direct sums cost O(M ms), the NUFFTs O(ms log ms + M w) with a
+ * kernel width w ~ log10(1/tol) for the requested accuracy tol.
+ *
+ * Types 1 and 2 use an oversampled grid of nf >= 2 ms points with spacing
+ * 1/nf on the period [0,1[ and the "exponential of semicircle" kernel
+ *   phi(z) = exp(beta (sqrt(1 - z^2) - 1)),   |z| <= 1,
+ * stretched to psi(u) = phi(2u/w) of width w grid cells, w ~ log10(1/tol),
+ * beta = 2.3 w. Type 1 spreads c_j * psi(l - nf x_j) to the grid points l,
+ * applies an FFT and divides by the Fourier transform psihat(k/nf) of the
+ * kernel (deconvolution); type 2 is the transpose: deconvolution, FFT and
+ * interpolation with psi from the grid to the points. Type 3 spreads the
+ * (centered) points to a grid with spacing h = 1/(4 max|s_k|) and
+ * evaluates the Fourier sum of the grid values at s_k h by a type-2 NUFFT.
+ *
+ * The points are sorted into bins of the grid once, when they are set
+ * (counting sort). Spreading and interpolation run over the sorted points
+ * in parallel: for spreading every thread owns a contiguous range of
+ * sorted points and adds into a private piece of the grid, which is then
+ * added to the grid. A plan keeps its Eigen::FFT object, whose
+ * implementation caches the FFT plan (twiddle factors) of every length,
+ * so repeated transforms and new points of the same plan reuse it. A plan
+ * must not be used by several threads at once. */
+
+struct NufftOptions {
+  double tol = 1e-12;                // requested relative accuracy
+  unsigned int num_threads = 0;      // 0 = defaultNumThreads()
+  Eigen::Index min_chunk = 1 << 14;  // minimal number of points per thread
+};
+
+// Exponential of semicircle kernel psi(u) = phi(2u/w) of width w
+class EsKernel {
+ public:
+  explicit EsKernel(double tol) {
+    w_ = std::min(16, std::max(2, int(std::ceil(-std::log10(tol))) + 1));
+    beta_ = 2.3 * w_;
+  }
+  int width() const { return w_; }
+  // psi(l - u) for l = l0, ..., l0 + w - 1 in v, returns l0
+  int eval(double u, double *v) const {
+    const int l0 = int(std::ceil(u - 0.5 * w_));
+    for (int m = 0; m < w_; ++m) {
+      const double z = 2. * (l0 + m - u) / w_;
+      v[m] = std::exp(beta_ * (std::sqrt(std::max(1. - z * z, 0.)) - 1.));
+    }
+    return l0;
+  }
+  // psihat(xi) = int psi(u) exp(2 pi i xi u) du
+  //            = w/2 int_{-1}^1 phi(z) cos(pi w xi z) dz
+  Eigen::VectorXd fourier(const Eigen::VectorXd &xi,
+                          unsigned int num_threads = 0) const {
+    const auto qr = gaussRule(GaussFamily::Legendre, 3 * w_ + 20);
+    Eigen::VectorXd phi(qr->nodes.size());
+    for (Eigen::Index q = 0; q < phi.size(); ++q) {
+      const double z = qr->nodes(q);
+      phi(q) = 0.5 * w_ * qr->weights(q) *
+               std::exp(beta_ * (std::sqrt(1. - z * z) - 1.));
+    }
+    Eigen::VectorXd F(xi.size());
+    parallelFor(xi.size(), [&](std::size_t b, std::size_t e, unsigned int) {
+      for (std::size_t k = b; k < e; ++k) {
+        double v = 0.;
+        for (Eigen::Index q = 0; q < phi.size(); ++q) {
+          v += phi(q) * std::cos(M_PI * w_ * xi(k) * qr->nodes(q));
+        }
+        F(k) = v;
+      }
+    }, num_threads);
+    return F;
+  }
+
+ private:
+  int w_;
+  double beta_;
+};
+
+// Spreading to and interpolation from a periodic grid of n points for
+// points u_j in grid coordinates
+class EsSpreader {
+ public:
+  EsSpreader(const EsKernel &psi, Eigen::Index n, const Eigen::VectorXd &u,
+             const NufftOptions &opt)
+      : psi_(psi), n_(n), opt_(opt) {
+    const Eigen::Index M = u.size();
+    // Counting sort of the points by bins of bin_ grid cells
+    const Eigen::Index nb = n / bin_ + 1;
+    std::vector<Eigen::Index> key(M), start(nb + 1, 0);
+    for (Eigen::Index j = 0; j < M; ++j) {
+      key[j] = std::min<Eigen::Index>(Eigen::Index(reduce(u(j))) / bin_,
+                                      nb - 1);
+      ++start[key[j] + 1];
+    }
+    for (Eigen::Index b = 0; b < nb; ++b) start[b + 1] += start[b];
+    order_.resize(M);
+    u_.resize(M);
+    for (Eigen::Index j = 0; j < M; ++j) order_[start[key[j]]++] = j;
+    for (Eigen::Index i = 0; i < M; ++i) u_(i) = reduce(u(order_[i]));
+  }
+
+  Eigen::Index size() const { return u_.size(); }
+
+  // b_l = sum_j c_j psi(l - u_j) (periodic), l = 0, ..., n-1
+  void spread(const Eigen::VectorXcd &c, Eigen::VectorXcd &b) const {
+    const Eigen::Index M = u_.size();
+    const int w = psi_.width();
+    const unsigned int p = tasks();
+    std::vector<Eigen::Index> lo(p, 0);
+    std::vector<Eigen::VectorXcd> buf(p);
+    parallelFor(p, [&](std::size_t tb, std::size_t te, unsigned int) {
+      std::vector<double> v(w);
+      for (std::size_t t = tb; t < te; ++t) {
+        const Eigen::Index i0 = M * t / p, i1 = M * (t + 1) / p;
+        if (i0 == i1) continue;
+        // sorted by bins: the pieces of the grid of the threads overlap
+        // by about w cells only
+        lo[t] = Eigen::Index(u_(i0)) / bin_ * bin_ - w;
+        buf[t].setZero(Eigen::Index(u_(i1 - 1)) / bin_ * bin_ + bin_ + w -
+                       lo[t] + 1);
+        for (Eigen::Index i = i0; i < i1; ++i) {
+          const std::complex<double> ci = c(order_[i]);
+          const int l0 = psi_.eval(u_(i), v.data());
+          std::complex<double> *bl = buf[t].data() + (l0 - lo[t]);
+          for (int m = 0; m < w; ++m) bl[m] += v[m] * ci;
+        }
+      }
+    }, p);
+    b.setZero(n_);
+    for (unsigned int t = 0; t < p; ++t) {
+      Eigen::Index l = ((lo[t] % n_) + n_) % n_;
+      for (Eigen::Index k = 0; k < buf[t].size(); ++k) {
+        b(l) += buf[t](k);
+        if (++l == n_) l = 0;
+      }
+    }
+  }
+
+  // c_j = sum_l g_l psi(l - u_j) (periodic)
+  void interp(const Eigen::VectorXcd &g, Eigen::VectorXcd &c) const {
+    const Eigen::Index M = u_.size();
+    const int w = psi_.width(), P = w + 1;
+    // periodic extension by P cells on both sides
+    Eigen::VectorXcd gp(n_ + 2 * P + w);
+    for (Eigen::Index k = 0, l = ((-P % n_) + n_) % n_; k < gp.size(); ++k) {
+      gp(k) = g(l);
+      if (++l == n_) l = 0;
+    }
+    c.resize(M);
+    const unsigned int p = tasks();
+    parallelFor(M, [&](std::size_t i0, std::size_t i1, unsigned int) {
+      std::vector<double> v(w);
+      for (std::size_t i = i0; i < i1; ++i) {
+        const int l0 = psi_.eval(u_(i), v.data());
+        const std::complex<double> *gl = gp.data() + (l0 + P);
+        std::complex<double> s = 0.;
+        for (int m = 0; m < w; ++m) s += v[m] * gl[m];
+        c(order_[i]) = s;
+      }
+    }, p);
+  }
+
+ private:
+  // u mod n in [0, n)
+  double reduce(double u) const {
+    u -= n_ * std::floor(u / n_);
+    return u < n_ ? u : 0.;
+  }
+  unsigned int tasks() const {
+    const Eigen::Index M = u_.size();
+    return numThreadsFor(
+        (M + opt_.min_chunk - 1) / std::max<Eigen::Index>(opt_.min_chunk, 1),
+        opt_.num_threads);
+  }
+
+  static constexpr Eigen::Index bin_ = 16;
+  EsKernel psi_;
+  Eigen::Index n_;
+  NufftOptions opt_;
+  std::vector<Eigen::Index> order_;  // points in the order of the bins
+  Eigen::VectorXd u_;                // sorted grid coordinates in [0, n)
+};
+
+// Types 1 and 2 for ms modes and the points x (period 1)
+class Nufft {
+ public:
+  Nufft(Eigen::Index ms, const Eigen::VectorXd &x,
+        const NufftOptions &opt = {})
+      : opt_(opt), psi_(opt.tol), ms_(std::max<Eigen::Index>(ms, 1)) {
+    nf_ = smooth(std::max<Eigen::Index>(2 * ms_, 2 * psi_.width()));
+    Eigen::VectorXd xi(ms_);
+    for (Eigen::Index k = 0; k < ms_; ++k) xi(k) = double(kmin() + k) / nf_;
+    psihat_ = psi_.fourier(xi, opt_.num_threads);
+    setPoints(x);
+  }
+
+  // New points for the same modes, reuses grid, kernel and FFT plan
+  void setPoints(const Eigen::VectorXd &x) {
+    spreader_.reset(new EsSpreader(psi_, nf_, x * double(nf_), opt_));
+  }
+
+  Eigen::Index modes() const { return ms_; }
+  Eigen::Index gridSize() const { return nf_; }
+  Eigen::Index kmin() const { return -(ms_ / 2); }
+
+  // f_k = sum_j c_j exp(isign 2 pi i k x_j)
+  Eigen::VectorXcd type1(const Eigen::VectorXcd &c, int isign = -1) const {
+    Eigen::VectorXcd b, B;
+    spreader_->spread(c, b);
+    fft_.fwd(B, b);
+    Eigen::VectorXcd f(ms_);
+    for (Eigen::Index k = 0; k < ms_; ++k) {
+      f(k) = B(index(kmin() + k, isign)) / psihat_(k);
+    }
+    return f;
+  }
+
+  // c_j = sum_k f_k exp(isign 2 pi i k x_j)
+  Eigen::VectorXcd type2(const Eigen::VectorXcd &f, int isign = 1) const {
+    Eigen::VectorXcd g = Eigen::VectorXcd::Zero(nf_), G, c;
+    for (Eigen::Index k = 0; k < ms_; ++k) {
+      g(index(kmin() + k, isign)) = f(k) / psihat_(k);
+    }
+    fft_.fwd(G, g);
+    spreader_->interp(G, c);
+    return c;
+  }
+
+  // smallest n' >= n with prime factors 2, 3, 5 only
+  static Eigen::Index smooth(Eigen::Index n) {
+    for (;; ++n) {
+      Eigen::Index m = n;
+      for (int p : {2, 3, 5}) {
+        while (m % p == 0) m /= p;
+      }
+      if (m == 1) return n;
+    }
+  }
+
+ private:
+  // grid index of mode k: the FFT computes sums with exp(-2 pi i m l/nf)
+  Eigen::Index index(Eigen::Index k, int isign) const {
+    const Eigen::Index m = isign < 0 ? k : -k;
+    return ((m % nf_) + nf_) % nf_;
+  }
+
+  NufftOptions opt_;
+  EsKernel psi_;
+  Eigen::Index ms_, nf_;
+  Eigen::VectorXd psihat_;  // kernel transform for the modes
+  std::unique_ptr<EsSpreader> spreader_;
+  mutable Eigen::FFT<double> fft_;  // caches the FFT plans
+};
+
+// Type 3 for the points x and the frequencies s
+class Nufft3 {
+ public:
+  Nufft3(const Eigen::VectorXd &x, const Eigen::VectorXd &s,
+         const NufftOptions &opt = {})
+      : opt_(opt), psi_(opt.tol) {
+    const auto center = [](const Eigen::VectorXd &v, double &c, double &h) {
+      const double a = v.size() ? v.minCoeff() : 0.;
+      const double b = v.size() ? v.maxCoeff() : 0.;
+      c = 0.5 * (a + b);
+      h = 0.5 * (b - a);
+    };
+    double X, S;
+    center(x, xc_, X);
+    center(s, sc_, S);
+    // |s' h| <= 1/4 as for the modes of types 1 and 2
+    h_ = S > 0. ? 0.25 / S : 1.;
+    L_ = Eigen::Index(std::ceil(X / h_ + 0.5 * psi_.width())) + 1;
+    xs_ = x.array() - xc_;
+    const Eigen::VectorXd y = (s.array() - sc_) * h_;
+    spreader_.reset(new EsSpreader(psi_, 2 * L_ + 1,
+                                   xs_.array() / h_ + double(L_), opt_));
+    inner_.reset(new Nufft(2 * L_ + 1, y, opt_));
+    s_ = s;
+    psihat_ = psi_.fourier(y, opt_.num_threads);
+  }
+
+  Eigen::Index gridSize() const { return 2 * L_ + 1; }
+
+  // f_k = sum_j c_j exp(isign 2 pi i s_k x_j)
+  Eigen::VectorXcd type3(const Eigen::VectorXcd &c, int isign = -1) const {
+    const std::complex<double> I(0., 2. * M_PI * (isign < 0 ? -1 : 1));
+    const Eigen::VectorXcd cs =
+        c.array() * (I * sc_ * xs_.array().cast<std::complex<double>>()).exp();
+    Eigen::VectorXcd b;
+    spreader_->spread(cs, b);
+    // grid index l + L of the mode l = -L, ..., L of the inner plan
+    const Eigen::VectorXcd f = inner_->type2(b, isign);
+    return f.array() / psihat_.array().cast<std::complex<double>>() *
+           (I * xc_ * s_.array().cast<std::complex<double>>()).exp();
+  }
+
+ private:
+  NufftOptions opt_;
+  EsKernel psi_;
+  double xc_, sc_, h_;  // centers of the points and frequencies, spacing
+  Eigen::Index L_;      // grid points l h, l = -L, ..., L
+  Eigen::VectorXd xs_, s_, psihat_;
+  std::unique_ptr<EsSpreader> spreader_;
+  std::unique_ptr<Nufft> inner_;
+};
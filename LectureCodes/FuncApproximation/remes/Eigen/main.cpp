@@ -1,4 +1,8 @@
+# include <chrono>
+# include <iomanip>
+
 # include "./remes.hpp"
+# include "./remezcheb.hpp"
 
 int main () {
   auto f = [](double x){ return 1/(1 + x*x); };
@@ -8,5 +12,35 @@ int main () {
   std::cout << "RESULT ===============================================\n"
             << c.transpose() << "\n";
 
+  // Same problem, Chebyshev-basis Remez: the coefficients refer to the
+  // Chebyshev polynomials on [0,1]
+  MinimaxApprox r = remezCheb(f, 0, 1, 5);
+  std::cout << "remezCheb: Chebyshev coefficients " << r.p.transpose()
+            << "\n           max error " << r.err << ", levelled error "
+            << std::abs(r.h) << ", " << r.iterations << " iterations\n";
+
+  // High degrees: best approximation of |x| on [-1,1], the error behaves
+  // like 0.2801.../n (Bernstein's constant). For even degrees the problem
+  // is degenerate (E_{2k} = E_{2k+1}), hence odd n.
+  std::cout << std::setprecision(4) << "\n|x| on [-1,1]\n";
+  auto fabs = [](double x) { return std::abs(x); };
+  for (unsigned n : {11, 51, 101, 251, 501}) {
+    const auto start = std::chrono::high_resolution_clock::now();
+    r = remezCheb(fabs, -1, 1, n);
+    const auto end = std::chrono::high_resolution_clock::now();
+    std::cout << "n = " << std::setw(3) << n << ": n*E_n = " << n * r.err
+              << ", iterations = " << std::setw(2) << r.iterations
+              << ", converged = " << r.converged << ", time = "
+              << std::chrono::duration<double>(end - start).count() << " s\n";
+  }
+
+  // Rational best approximation of exp on [-1,1], type (n,n)
+  std::cout << "\nexp on [-1,1], rational type (n,n)\n";
+  auto fexp = [](double x) { return std::exp(x); };
+  for (unsigned n = 1; n <= 4; ++n) {
+    r = remezRational(fexp, -1, 1, n, n);
+    std::cout << "n = " << n << ": error = " << r.err << " (levelled "
+              << std::abs(r.h) << "), converged = " << r.converged << "\n";
+  }
   return 0;
 }
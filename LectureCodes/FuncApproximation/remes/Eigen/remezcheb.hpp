@@ -0,0 +1,429 @@
+#pragma once
+
+#include <Eigen/Dense>
+#include <Eigen/Eigenvalues>
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <limits>
+#include <vector>
+
+#include "parallel.hpp"
+
+/* Remez exchange algorithm for best uniform approximation on [a,b] by
+ * polynomials of degree n and rational functions of type (m,n).
+ * In contrast to remez() in remes.hpp
+ * - no monomial Vandermonde system is formed: the levelled-error polynomial
+ *   interpolant is evaluated by the barycentric formula in the reference
+ *   points, rational approximants are computed in the Chebyshev basis,
+ * - all approximants are returned as Chebyshev expansions, evaluated by
+ *   the Clenshaw algorithm, which allows degrees n > 500,
+ * - the extrema of the error are located on a grid adapted to the current
+ *   reference, every local extremum is refined by safeguarded parabolic
+ *   interpolation (a root search for the derivative of the error that does
+ *   not need f'); the grid and the refinements are processed in parallel. */
+
+struct RemezOptions {
+  unsigned int maxit = 40;       // maximal number of exchange steps
+  double tol = 1e-6;             // stop if max|e| - |h| <= tol max|e|
+  unsigned int samples = 8;      // grid points between reference points
+  unsigned int num_threads = 0;  // 0 = number of hardware threads
+};
+
+// Rational function p/q given by Chebyshev expansions on [a,b]
+struct MinimaxApprox {
+  double a = -1.0, b = 1.0;
+  Eigen::VectorXd p;    // coefficients of the numerator
+  Eigen::VectorXd q;    // coefficients of the denominator, [1] for polynomials
+  Eigen::VectorXd ref;  // last reference (alternant)
+  double h = 0.0;       // levelled error on the reference
+  double err = 0.0;     // max |f - p/q| found by the extremum search
+  unsigned int iterations = 0;
+  bool converged = false;
+
+  double operator()(double x) const;
+};
+
+namespace remez_detail {
+// Clenshaw algorithm for sum_k c_k T_k(t), t in [-1,1]
+inline double chebEval(const Eigen::VectorXd &c, double t) {
+  double b1 = 0.0, b2 = 0.0;
+  for (Eigen::Index k = c.size() - 1; k >= 1; --k) {
+    const double b0 = 2.0 * t * b1 - b2 + c[k];
+    b2 = b1;
+    b1 = b0;
+  }
+  return t * b1 - b2 + (c.size() > 0 ? c[0] : 0.0);
+}
+
+inline double toRef(double x, double a, double b) {
+  return (2.0 * x - a - b) / (b - a);
+}
+
+// n+1 Chebyshev extrema on [a,b] in ascending order
+inline Eigen::VectorXd chebExtrema(unsigned int n, double a, double b) {
+  Eigen::VectorXd x(n + 1);
+  if (n == 0) {
+    x[0] = 0.5 * (a + b);
+    return x;
+  }
+  for (unsigned int j = 0; j <= n; ++j) {
+    x[j] = 0.5 * (a + b) - 0.5 * (b - a) * std::cos(M_PI * j / n);
+  }
+  return x;
+}
+
+// Chebyshev coefficients of the polynomial of degree n with the values v
+// in chebExtrema(n,a,b) (discrete cosine transform, O(n^2))
+inline Eigen::VectorXd chebCoeffs(const Eigen::VectorXd &v) {
+  const Eigen::Index n = v.size() - 1;
+  if (n == 0) return v;
+  Eigen::VectorXd cs(2 * n);  // cos(pi k/n), k = 0,...,2n-1
+  for (Eigen::Index k = 0; k < 2 * n; ++k) cs[k] = std::cos(M_PI * k / n);
+  Eigen::VectorXd c(n + 1);
+  for (Eigen::Index k = 0; k <= n; ++k) {
+    double s = 0.0;
+    for (Eigen::Index j = 0; j <= n; ++j) {
+      // the extrema are ascending: x_j corresponds to t = -cos(pi j/n)
+      const double vj = (j == 0 || j == n) ? 0.5 * v[j] : v[j];
+      s += vj * cs[(k * (n - j)) % (2 * n)];
+    }
+    c[k] = (k == 0 || k == n ? 1.0 : 2.0) * s / n;
+  }
+  return c;
+}
+
+// Barycentric weights of the nodes x (up to a common factor), accumulated
+// as logarithms of the distances scaled by the capacity (b-a)/4 of [a,b]
+// to avoid over- and underflow for many nodes
+inline Eigen::VectorXd baryWeights(const Eigen::VectorXd &x, double a,
+                                   double b) {
+  const Eigen::Index n = x.size();
+  const double C = 4.0 / (b - a);
+  Eigen::VectorXd logw(n), sgn(n);
+  for (Eigen::Index i = 0; i < n; ++i) {
+    double l = 0.0, s = 1.0;
+    for (Eigen::Index j = 0; j < n; ++j) {
+      if (j == i) continue;
+      const double d = C * (x[i] - x[j]);
+      l -= std::log(std::abs(d));
+      if (d < 0) s = -s;
+    }
+    logw[i] = l;
+    sgn[i] = s;
+  }
+  return sgn.cwiseProduct(
+      (logw.array() - logw.maxCoeff()).exp().matrix());
+}
+
+// Second (true) barycentric formula
+inline double baryEval(const Eigen::VectorXd &x, const Eigen::VectorXd &w,
+                       const Eigen::VectorXd &v, double t) {
+  double num = 0.0, den = 0.0;
+  for (Eigen::Index j = 0; j < x.size(); ++j) {
+    const double d = t - x[j];
+    if (d == 0.0) return v[j];
+    num += w[j] * v[j] / d;
+    den += w[j] / d;
+  }
+  return num / den;
+}
+
+// Point of the error curve
+struct Extremum {
+  double x, e;
+};
+
+// Maximize g on [lo,hi], x in (lo,hi) with g(x) >= g(lo), g(hi): golden
+// section search combined with parabolic interpolation [Brent 1973]
+template <class Function>
+double brentMax(Function &&g, double lo, double hi, double x, double gx,
+                double atol) {
+  constexpr double cgold = 0.3819660112501051;
+  const double rtol = std::sqrt(std::numeric_limits<double>::epsilon());
+  double v = x, w = x, fx = -gx, fv = fx, fw = fx, d = 0.0, e = 0.0;
+  for (unsigned int it = 0; it < 100; ++it) {
+    const double xm = 0.5 * (lo + hi);
+    const double tol1 = rtol * std::abs(x) + atol, tol2 = 2.0 * tol1;
+    if (std::abs(x - xm) <= tol2 - 0.5 * (hi - lo)) break;
+    bool golden = true;
+    if (std::abs(e) > tol1) {
+      // parabola through (v,fv), (w,fw), (x,fx)
+      const double r = (x - w) * (fx - fv);
+      double q = (x - v) * (fx - fw);
+      double p = (x - v) * q - (x - w) * r;
+      q = 2.0 * (q - r);
+      if (q > 0.0) p = -p;
+      q = std::abs(q);
+      const double etemp = e;
+      e = d;
+      if (std::abs(p) < std::abs(0.5 * q * etemp) && p > q * (lo - x) &&
+          p < q * (hi - x)) {
+        d = p / q;
+        const double u = x + d;
+        if (u - lo < tol2 || hi - u < tol2) d = xm >= x ? tol1 : -tol1;
+        golden = false;
+      }
+    }
+    if (golden) {
+      e = x >= xm ? lo - x : hi - x;
+      d = cgold * e;
+    }
+    const double u =
+        std::abs(d) >= tol1 ? x + d : x + (d >= 0.0 ? tol1 : -tol1);
+    const double fu = -g(u);
+    if (fu <= fx) {
+      (u >= x ? lo : hi) = x;
+      v = w;
+      fv = fw;
+      w = x;
+      fw = fx;
+      x = u;
+      fx = fu;
+    } else {
+      (u < x ? lo : hi) = u;
+      if (fu <= fw || w == x) {
+        v = w;
+        fv = fw;
+        w = u;
+        fw = fu;
+      } else if (fu <= fv || v == x || v == w) {
+        v = u;
+        fv = fu;
+      }
+    }
+  }
+  return x;
+}
+
+// All local extrema of the error e on [a,b]: sampling on a grid with
+// `samples` points between consecutive reference points, refinement of the
+// local maxima of |e|, merging of neighbours with the same sign
+template <class Error>
+std::vector<Extremum> findExtrema(Error &&e, const Eigen::VectorXd &ref,
+                                  double a, double b,
+                                  const RemezOptions &opt) {
+  // breakpoints of the grid
+  std::vector<double> bp{a};
+  for (Eigen::Index i = 0; i < ref.size(); ++i) {
+    if (ref[i] > bp.back() && ref[i] < b) bp.push_back(ref[i]);
+  }
+  bp.push_back(b);
+  const unsigned int m = std::max(opt.samples, 2u);
+  const std::size_t ng = (bp.size() - 1) * m + 1;
+  std::vector<Extremum> grid(ng);
+  parallelFor(
+      ng,
+      [&](std::size_t begin, std::size_t end, unsigned int) {
+        for (std::size_t k = begin; k < end; ++k) {
+          const std::size_t i = std::min(k / m, bp.size() - 2);
+          const double x = bp[i] + (bp[i + 1] - bp[i]) * (k - i * m) / m;
+          grid[k] = {x, e(x)};
+        }
+      },
+      opt.num_threads);
+  // local maxima of sign(e_k) e on the grid (a local minimum of a positive
+  // error is not an extremum, a kink of f where e changes sign may be one)
+  std::vector<std::size_t> loc;
+  for (std::size_t k = 0; k < ng; ++k) {
+    const double s = grid[k].e >= 0 ? 1.0 : -1.0, ek = s * grid[k].e;
+    if ((k == 0 || ek > s * grid[k - 1].e) &&
+        (k + 1 == ng || ek >= s * grid[k + 1].e)) {
+      loc.push_back(k);
+    }
+  }
+  std::vector<Extremum> ext(loc.size());
+  const double atol = 1e-3 * std::numeric_limits<double>::epsilon() * (b - a);
+  parallelFor(
+      loc.size(),
+      [&](std::size_t begin, std::size_t end, unsigned int) {
+        for (std::size_t i = begin; i < end; ++i) {
+          const std::size_t k = loc[i];
+          ext[i] = grid[k];
+          if (k == 0 || k + 1 == ng) continue;
+          const double s = grid[k].e >= 0 ? 1.0 : -1.0;
+          const double x = brentMax([&e, s](double t) { return s * e(t); },
+                                    grid[k - 1].x, grid[k + 1].x, grid[k].x,
+                                    s * grid[k].e, atol);
+          const double ex = e(x);
+          if (s * ex > s * ext[i].e) ext[i] = {x, ex};
+        }
+      },
+      opt.num_threads);
+  // keep the larger one of neighbours with the same sign
+  std::vector<Extremum> alt;
+  for (const auto &p : ext) {
+    if (!alt.empty() && (alt.back().e >= 0) == (p.e >= 0)) {
+      if (std::abs(p.e) > std::abs(alt.back().e)) alt.back() = p;
+    } else {
+      alt.push_back(p);
+    }
+  }
+  return alt;
+}
+
+// Reduce an alternating sequence of extrema to N points, the global
+// maximum of |e| is always kept
+inline void exchange(std::vector<Extremum> &alt, std::size_t N) {
+  auto absless = [](const Extremum &p, const Extremum &q) {
+    return std::abs(p.e) < std::abs(q.e);
+  };
+  while (alt.size() > N) {
+    if (alt.size() == N + 1) {
+      // removing an interior point breaks the alternation, drop an end
+      if (absless(alt.front(), alt.back())) {
+        alt.erase(alt.begin());
+      } else {
+        alt.pop_back();
+      }
+      continue;
+    }
+    const auto it = std::min_element(alt.begin(), alt.end(), absless);
+    const std::size_t i = it - alt.begin();
+    if (i == 0 || i + 1 == alt.size()) {
+      alt.erase(it);
+    } else {
+      // the neighbours of i have equal signs, keep the larger one
+      const std::size_t j = absless(alt[i - 1], alt[i + 1]) ? i - 1 : i + 1;
+      alt.erase(alt.begin() + std::max(i, j));
+      alt.erase(alt.begin() + std::min(i, j));
+    }
+  }
+}
+
+// Exchange iteration, generic in the solver for the reference equations
+// f(x_i) - r(x_i) = (-1)^i h, i = 0,...,N-1, which fills r and returns
+// false if the equations have no admissible solution
+template <class Function, class Solver>
+MinimaxApprox remezExchange(const Function &f, double a, double b,
+                            std::size_t N, Solver &&solve,
+                            const RemezOptions &opt) {
+  assert(a < b && N >= 2);
+  Eigen::VectorXd ref = chebExtrema(N - 1, a, b);
+  MinimaxApprox best;
+  best.a = a;
+  best.b = b;
+  for (unsigned int it = 1; it <= opt.maxit; ++it) {
+    Eigen::VectorXd fx(N);
+    for (std::size_t i = 0; i < N; ++i) fx[i] = f(ref[i]);
+    MinimaxApprox r;
+    r.a = a;
+    r.b = b;
+    if (!solve(ref, fx, r)) break;
+    std::vector<Extremum> ext = findExtrema(
+        [&f, &r](double x) { return f(x) - r(x); }, ref, a, b, opt);
+    r.ref = ref;
+    r.iterations = it;
+    for (const auto &p : ext) r.err = std::max(r.err, std::abs(p.e));
+    best = r;
+    exchange(ext, N);
+    if (ext.size() < N) break;  // too few alternation points
+    // the gap cannot become smaller than the round-off in f - r
+    const double eps = std::numeric_limits<double>::epsilon();
+    if (r.err - std::abs(r.h) <=
+        opt.tol * r.err + 64.0 * eps * fx.cwiseAbs().maxCoeff()) {
+      best.converged = true;
+      break;
+    }
+    for (std::size_t i = 0; i < N; ++i) ref[i] = ext[i].x;
+  }
+  return best;
+}
+}  // namespace remez_detail
+
+inline double MinimaxApprox::operator()(double x) const {
+  const double t = remez_detail::toRef(x, a, b);
+  return remez_detail::chebEval(p, t) / remez_detail::chebEval(q, t);
+}
+
+/* SAM_LISTING_BEGIN_0 */
+// Best approximation of f on [a,b] by a polynomial of degree n. On the
+// reference x_0 < ... < x_{n+1} with barycentric weights w_i the levelled
+// error is h = sum w_i f(x_i) / sum w_i (-1)^i, the interpolant of
+// f(x_i) - (-1)^i h in the n+2 points has degree n. f must be thread-safe.
+template <class Function>
+MinimaxApprox remezCheb(const Function &f, double a, double b,
+                        unsigned int n, const RemezOptions &opt = {}) {
+  using namespace remez_detail;
+  auto solve = [a, b, n](const Eigen::VectorXd &ref,
+                         const Eigen::VectorXd &fx, MinimaxApprox &r) {
+    const Eigen::VectorXd w = baryWeights(ref, a, b);
+    Eigen::VectorXd s(ref.size());
+    for (Eigen::Index i = 0; i < s.size(); ++i) s[i] = i % 2 ? -1.0 : 1.0;
+    const double ws = w.dot(s);
+    // e.g. even f, symmetric reference and even n: h is not determined
+    if (std::abs(ws) <= 1e-12 * w.cwiseAbs().sum()) return false;
+    r.h = w.dot(fx) / ws;
+    const Eigen::VectorXd v = fx - r.h * s;
+    // Chebyshev expansion from the values in the Chebyshev extrema
+    const Eigen::VectorXd xc = chebExtrema(n, a, b);
+    Eigen::VectorXd vc(n + 1);
+    for (unsigned int j = 0; j <= n; ++j) vc[j] = baryEval(ref, w, v, xc[j]);
+    r.p = chebCoeffs(vc);
+    r.q = Eigen::VectorXd::Ones(1);
+    return true;
+  };
+  return remezExchange(f, a, b, n + 2, solve, opt);
+}
+/* SAM_LISTING_END_0 */
+
+/* SAM_LISTING_BEGIN_1 */
+// Best approximation of f on [a,b] by a rational function p/q of type (m,n).
+// With p = sum_k alpha_k T_k and q = sum_k beta_k T_k the reference equations
+//   p(x_i) - (f(x_i) - (-1)^i h) q(x_i) = 0,  i = 0,...,m+n+1,
+// form the generalized eigenvalue problem
+//   [P, -diag(f) Q] c = h [0, -diag((-1)^i) Q] c
+// for c = [alpha; beta]. Of its real eigenvalues the one of smallest modulus
+// whose denominator has no sign change on the reference is taken.
+template <class Function>
+MinimaxApprox remezRational(const Function &f, double a, double b,
+                            unsigned int m, unsigned int n,
+                            const RemezOptions &opt = {}) {
+  using namespace remez_detail;
+  if (n == 0) return remezCheb(f, a, b, m, opt);
+  auto solve = [a, b, m, n](const Eigen::VectorXd &ref,
+                            const Eigen::VectorXd &fx, MinimaxApprox &r) {
+    const Eigen::Index N = ref.size(), dmax = std::max(m, n);
+    // Chebyshev-Vandermonde matrix T(i,k) = T_k(t_i)
+    Eigen::MatrixXd T(N, dmax + 1);
+    for (Eigen::Index i = 0; i < N; ++i) {
+      const double t = toRef(ref[i], a, b);
+      T(i, 0) = 1.0;
+      if (dmax >= 1) T(i, 1) = t;
+      for (Eigen::Index k = 2; k <= dmax; ++k) {
+        T(i, k) = 2.0 * t * T(i, k - 1) - T(i, k - 2);
+      }
+    }
+    Eigen::VectorXd s(N);
+    for (Eigen::Index i = 0; i < N; ++i) s[i] = i % 2 ? -1.0 : 1.0;
+    Eigen::MatrixXd A(N, N), B = Eigen::MatrixXd::Zero(N, N);
+    A.leftCols(m + 1) = T.leftCols(m + 1);
+    A.rightCols(n + 1) = -(fx.asDiagonal() * T.leftCols(n + 1));
+    B.rightCols(n + 1) = -(s.asDiagonal() * T.leftCols(n + 1));
+    Eigen::GeneralizedEigenSolver<Eigen::MatrixXd> ges(A, B, false);
+    const Eigen::VectorXcd lambda = ges.eigenvalues();
+    bool found = false;
+    for (Eigen::Index k = 0; k < N; ++k) {
+      const std::complex<double> hk = lambda[k];
+      if (!std::isfinite(hk.real()) || !std::isfinite(hk.imag()) ||
+          std::abs(hk.imag()) > 1e-8 * std::abs(hk.real())) {
+        continue;
+      }
+      if (found && std::abs(hk.real()) >= std::abs(r.h)) continue;
+      // coefficients: null vector of A - h B
+      Eigen::JacobiSVD<Eigen::MatrixXd> svd(A - hk.real() * B,
+                                            Eigen::ComputeFullV);
+      Eigen::VectorXd c = svd.matrixV().col(N - 1);
+      const Eigen::VectorXd qx = T.leftCols(n + 1) * c.tail(n + 1);
+      if (qx.minCoeff() * qx.maxCoeff() <= 0.0) continue;  // pole
+      if (qx[0] < 0.0) c = -c;
+      r.h = hk.real();
+      r.p = c.head(m + 1);
+      r.q = c.tail(n + 1);
+      found = true;
+    }
+    return found;
+  };
+  return remezExchange(f, a, b, m + n + 2, solve, opt);
+}
+/* SAM_LISTING_END_1 */
@@ -1,6 +1,8 @@
+# include <chrono>
+# include <cstdlib>
 # include "./trigpolyval.hpp"
 
-int main() {
+int main(int argc, char **argv) {
   const unsigned N = 5;
   VectorXd t = VectorXd::LinSpaced(N, 0, 2*M_PI),
     y = t,
@@ -10,5 +12,39 @@ int main() {
   q1 = trigpolyval(t, y, x);
   std::cout << " q = " << q.real().transpose() << "\n";
   std::cout << " q1 = " << q1.real().transpose() << "\n";
+
+  // Equidistant nodes in [0,1[ and many scattered evaluation points:
+  // FFT and NUFFT instead of the barycentric formula
+  const int n = 500, Nn = 2*n + 1;
+  const long M = argc > 1 ? std::atol(argv[1]) : 10000000;
+  const VectorXd tn = VectorXd::LinSpaced(Nn, 0, 1 - 1./Nn),
+    yn = (2*M_PI*tn).array().cos().exp().matrix(),
+    xn = 0.5*(VectorXd::Random(M).array() + 1.).matrix();
+  auto start = std::chrono::high_resolution_clock::now();
+  const VectorXd p = trigpolyvalfast(tn, yn, xn);
+  auto end = std::chrono::high_resolution_clock::now();
+  std::cout << " N = " << Nn << ", M = " << M << " points: NUFFT "
+            << std::chrono::duration<double>(end - start).count() << " s\n";
+  // direct summation of the trigonometric polynomial, O(N M), on the first
+  // 10000 points, and the error of the interpolant
+  const VectorXd x0 = xn.head(10000);
+  const std::complex<double> I(0, 2*M_PI);
+  start = std::chrono::high_resolution_clock::now();
+  VectorXcd gamma(Nn), p0 = VectorXcd::Zero(x0.size());
+  for (int j = -n; j <= n; ++j) {
+    gamma(j + n) =
+      (yn.array()*(-I*double(j)*tn.array()).exp()).sum()/double(Nn);
+  }
+  for (int j = -n; j <= n; ++j) {
+    p0 += (gamma(j + n)*(I*double(j)*x0.array()).exp()).matrix();
+  }
+  end = std::chrono::high_resolution_clock::now();
+  const double td = std::chrono::duration<double>(end - start).count();
+  std::cout << " direct summation: " << td << " s for 10000 points, "
+            << td*M/10000 << " s for all, max. difference "
+            << (p.head(10000) - p0.real()).cwiseAbs().maxCoeff()
+            << ", max. error " << ((2*M_PI*x0).array().cos().exp()
+                                   - p.head(10000).array()).abs().maxCoeff()
+            << "\n";
   return 0;
 }
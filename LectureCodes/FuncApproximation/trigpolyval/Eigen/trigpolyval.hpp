@@ -1,14 +1,45 @@
 # include <iostream>
 # include <complex>
 # include <Eigen/Dense>
+# include <unsupported/Eigen/FFT>
 
 // Local includes
 # include "intpolyval_complex.hpp"
 # include "ipvclass.hpp"
+# include "nufft.hpp" // FuncApproximation/nufft/Eigen
 
 using Eigen::VectorXd;
 using Eigen::VectorXcd;
 
+// Fast path of trigpolyvalfast() for equidistant nodes t_k = t_0 + k/N,
+// k = 0, ..., N-1: the coefficients gamma_j, j = -n, ..., n, are computed
+// by an FFT and the interpolant p(x) = sum_j gamma_j exp(2 pi i j x) is
+// evaluated at the scattered points x by a type-2 NUFFT,
+// O(N log N + M) instead of O(N M)
+inline bool trigpolyvalUseNufft(const VectorXd& t, const VectorXd& x) {
+  const VectorXd::Index N = t.size();
+  if (N % 2 == 0 || N < 33 || double(N) * x.size() < 1e5) return false;
+  for (VectorXd::Index k = 1; k < N; ++k) {
+    if (std::abs(t(k) - t(0) - double(k)/N) > 1e-12) return false;
+  }
+  return true;
+}
+
+inline VectorXd trigpolyvalnufft(double t0, const VectorXd& y,
+                                 const VectorXd& x, double tol = 1e-13) {
+  const VectorXd::Index N = y.size(), n = (N - 1)/2;
+  Eigen::FFT<double> fft;
+  const VectorXcd yc = y.cast<std::complex<double>>();
+  VectorXcd c = fft.fwd(yc);
+  // c(j mod N) = N gamma_j exp(2 pi i j t_0), modes j = -n, ..., n
+  VectorXcd gamma(N);
+  gamma << c.tail(n), c.head(n + 1);
+  NufftOptions opt;
+  opt.tol = tol;
+  const Nufft P(N, (x.array() - t0).matrix(), opt);
+  return P.type2(gamma / double(N), 1).real();
+}
+
 
 /* SAM_LISTING_BEGIN_0 */
 // Evaluation of trigonometric interpolant at numerous points
@@ -64,3 +95,11 @@ void trigpolyval(const VectorXd& t, const VectorXd& y, const VectorXd& x, Vector
   q = qc.real(); // imaginary part is zero, cut it off
 }
 /* SAM_LISTING_END_1 */
+
+// Same as trigpolyval(), but for many points and equidistant nodes the
+// interpolant is evaluated by FFT and NUFFT, see trigpolyvalUseNufft()
+inline VectorXd trigpolyvalfast(const VectorXd& t, const VectorXd& y,
+                                const VectorXd& x) {
+  if (trigpolyvalUseNufft(t, x)) return trigpolyvalnufft(t(0), y, x);
+  return trigpolyval(t, y, x);
+}
@@ -0,0 +1,86 @@
+#ifndef LMBROYD_HPP
+#define LMBROYD_HPP
+
+#include <Eigen/Dense>
+#include <functional>
+#include <vector>
+
+#include "broyd.hpp"
+
+/**
+ * \brief Limited-memory good Broyden quasi-Newton method
+ * Same recursion as upbroyd(), but the initial Jacobian J_0 is only needed
+ * through a solver v -> J_0^{-1} v (e.g. a diagonal, a preconditioner or
+ * an LU-decomposition computed elsewhere), and at most memory rank-1
+ * updates, i.e. 2 * memory vectors of length n, are stored: when the
+ * memory is full, the updates are discarded and the iteration restarts
+ * with J_0 at the current iterate. Thus no n x n matrix is ever formed.
+ * \param F Non-linear mapping in n dimensions
+ * \param x initial guess
+ * \param J0inv solver for the initial guess of the Jacobian at x0
+ * \param reltol relative tolerance for termination
+ * \param abstol absolute tolerance for termination
+ * \param maxit maximal number of iterations
+ * \param memory maximal number of stored rank-1 updates
+ * \param monitor callback to be run in every iteration step
+ */
+/* SAM_LISTING_BEGIN_1 */
+template <typename FUNCTION, typename SOLVER, typename SCALAR,
+          int N = Eigen::Dynamic,
+          typename MONITOR =
+              std::function<void(unsigned int, Vector<SCALAR, N>,
+                                 Vector<SCALAR, N>, Vector<SCALAR, N>)>>
+Vector<SCALAR, N> lmbroyd(
+    FUNCTION &&F, Vector<SCALAR, N> x, SOLVER &&J0inv, SCALAR reltol,
+    SCALAR abstol, unsigned int maxit = 50, unsigned int memory = 20,
+    MONITOR &&monitor = [](unsigned int /*itnum*/,
+                           const Vector<SCALAR, N> & /*x*/,
+                           const Vector<SCALAR, N> & /*fx*/,
+                           const Vector<SCALAR, N> & /*dx*/) {}) {
+  // First quasi-Newton correction $\cob{\Delta\Vx^{(0)} := -\VJ_0^{-1}F(\Vx^{(0)})}$
+  Vector<SCALAR, N> s = -J0inv(F(x));
+  // Quasi-Newton corrections, simplified ones and denominators since the
+  // last restart, cf. upbroyd()
+  std::vector<Vector<SCALAR, N>> dx{s}, dxs;
+  std::vector<SCALAR> den;
+  dx.reserve(memory + 1);
+  dxs.reserve(memory);
+  den.reserve(memory);
+  x += s;
+  auto f = F(x);
+  monitor(0, x, f, s);
+  for (unsigned int k = 1;
+       ((s.norm() >= reltol * x.norm()) && (s.norm() >= abstol) && (k < maxit));
+       ++k) {
+    // Memory full: restart with $\cob{\VJ_0}$
+    if (dxs.size() == memory) {
+      s = -J0inv(f);
+      dx.assign(1, s);
+      dxs.clear();
+      den.clear();
+    } else {
+      // Compute $\cob{\VJ_{0}^{-1}F(\Vx^{(k)})}$, needed for both recursions
+      s = J0inv(f);
+      // \eqref{eq:qncrec}: next simplified quasi-Newton correction
+      const std::size_t l_max = dx.size();
+      Vector<SCALAR, N> ss = s;
+      for (std::size_t l = 0; l + 1 < l_max; ++l) {
+        ss -= dxs[l] * (dx[l].dot(ss)) / den[l];
+      }
+      den.push_back(dx[l_max - 1].squaredNorm() + dx[l_max - 1].dot(ss));
+      dxs.push_back(std::move(ss));
+      // \eqref{eq:broyrec}: next quasi-Newton correction
+      for (std::size_t l = 0; l < l_max; ++l) {
+        s -= dxs[l] * (dx[l].dot(s)) / den[l];
+      }
+      s *= (-1.0);
+      dx.push_back(s);
+    }
+    x += s;
+    f = F(x);
+    monitor(k, x, f, s);
+  }
+  return x;
+}
+/* SAM_LISTING_END_1 */
+#endif
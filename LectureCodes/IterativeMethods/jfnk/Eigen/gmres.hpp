@@ -0,0 +1,104 @@
+#pragma once
+
+#include <Eigen/Dense>
+#include <cmath>
+#include <limits>
+
+#include "arnoldi.hpp"
+
+/* Restarted GMRES(m) for A x = b with right preconditioning,
+ *   A M^{-1} z = b,  x = M^{-1} z,
+ * so that the residuals monitored are those of the original system. Each
+ * cycle of m steps builds the Krylov space K_m(A M^{-1}, r_0) with the
+ * Arnoldi process, see Evp/arnoldi, and minimizes
+ *   ||b - A x|| = ||beta e_1 - H~_m y||,  x = x_0 + M^{-1} V_m y,
+ * where the Givens rotations that reduce H~_m to triangular form are
+ * applied column by column, which yields the residual norm after every
+ * step at no extra cost. A and M^{-1} are matrices or functors
+ * v -> A v; A is only needed through products, e.g. for the finite
+ * difference Jacobian-vector products of jfnk(). Inexact products limit
+ * the attainable residual, so the iteration also stops when a whole cycle
+ * fails to reduce the true residual computed at its restart. */
+
+struct GmresResult {
+  unsigned int iterations = 0;  // products with A
+  double residual = 0.;         // ||b - A x|| / ||b||
+  bool converged = false;
+};
+
+namespace gmres_detail {
+// M^{-1} = I
+struct Identity {
+  Eigen::VectorXd operator()(const Eigen::VectorXd &v) const { return v; }
+};
+}  // namespace gmres_detail
+
+/* SAM_LISTING_BEGIN_0 */
+template <class Op, class Prec = gmres_detail::Identity>
+GmresResult gmres(const Op &A, const Eigen::VectorXd &b, Eigen::VectorXd &x,
+                  double tol, unsigned int restart, unsigned int maxit,
+                  const Prec &Minv = Prec()) {
+  GmresResult res;
+  const double nb = b.norm();
+  if (nb == 0.) {
+    x.setZero();
+    res.converged = true;
+    return res;
+  }
+  const auto AM = [&](const Eigen::VectorXd &v) {
+    ++res.iterations;
+    return arnoldi_detail::apply(A, arnoldi_detail::apply(Minv, v));
+  };
+  const Eigen::Index m = restart;
+  Arnoldi<decltype(AM)> arn(AM, b.size(), m);
+  Eigen::MatrixXd R(m, m);  // triangular factor of H~
+  Eigen::VectorXd g(m + 1), c(m), s(m);
+  // true residual at the previous restart, none before the first cycle
+  double last = std::numeric_limits<double>::infinity();
+  while (true) {
+    Eigen::VectorXd r = b;
+    if (!x.isZero(0.)) {
+      r -= arnoldi_detail::apply(A, x);
+      ++res.iterations;
+    }
+    res.residual = r.norm() / nb;
+    if (res.residual <= tol || res.iterations >= maxit) break;
+    // Stagnation, e.g. below the accuracy of the products with A
+    if (res.residual > 0.99 * last) break;
+    last = res.residual;
+    arn.restart(r);
+    g.setZero();
+    g(0) = arn.beta();
+    Eigen::Index j = 0;
+    while (j < m && res.iterations < maxit) {
+      const bool more = arn.step();
+      // New column of H~, rotated by the previous Givens rotations
+      Eigen::VectorXd h = arn.H().col(j).head(j + 1);
+      double hn = arn.hNext();
+      for (Eigen::Index i = 0; i < j; ++i) {
+        const double t = c(i) * h(i) + s(i) * h(i + 1);
+        h(i + 1) = -s(i) * h(i) + c(i) * h(i + 1);
+        h(i) = t;
+      }
+      const double d = std::hypot(h(j), hn);
+      c(j) = h(j) / d;
+      s(j) = hn / d;
+      h(j) = d;
+      g(j + 1) = -s(j) * g(j);
+      g(j) *= c(j);
+      R.col(j).head(j + 1) = h;
+      ++j;
+      res.residual = std::abs(g(j)) / nb;
+      if (!more || res.residual <= tol) break;
+    }
+    // x = x_0 + M^{-1} V_j y,  R y = g
+    const Eigen::VectorXd y = R.topLeftCorner(j, j)
+                                  .triangularView<Eigen::Upper>()
+                                  .solve(g.head(j));
+    x += arnoldi_detail::apply(Minv, Eigen::VectorXd(arn.V().leftCols(j) * y));
+    if (arn.breakdown()) break;
+  }
+  res.converged = res.residual <= tol;
+  return res;
+}
+/* SAM_LISTING_END_0 */
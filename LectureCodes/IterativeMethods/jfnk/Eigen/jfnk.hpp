@@ -0,0 +1,106 @@
+#pragma once
+
+#include <Eigen/Dense>
+#include <algorithm>
+#include <cmath>
+#include <functional>
+#include <limits>
+
+#include "gmres.hpp"
+
+/* Jacobian-free Newton-Krylov method for F(x) = 0 [Knoll, Keyes, J.
+ * Comput. Phys. 193 (2004)]. The Newton correction s is an inexact
+ * solution of DF(x) s = -F(x) computed by GMRES with
+ *   ||F(x) + DF(x) s|| <= eta_k ||F(x)|| ,
+ * and GMRES needs DF(x) only through the finite differences
+ *   DF(x) v ~ (F(x + h v) - F(x)) / h,  h = sqrt(eps) max(||x||, 1) / ||v||,
+ * so that neither the Jacobian nor its LU-decomposition are ever formed,
+ * unlike in dampnewton(); storage is O(n m) for GMRES(m).
+ * The forcing terms follow Eisenstat and Walker [SISC 17 (1996)],
+ *   eta_k = gamma (||F(x_k)|| / ||F(x_{k-1})||)^2 ,
+ * safeguarded against a too rapid decrease and against oversolving near
+ * the solution: far from it a crude linear solve suffices, close to it
+ * eta_k -> 0 preserves the fast local convergence of Newton's method.
+ * Inexact corrections do not allow the natural monotonicity test of
+ * dampnewton() (it needs simplified Newton corrections), so the damping
+ * factor lambda is chosen by backtracking until
+ *   ||F(x + lambda s)|| <= (1 - 1e-4 lambda) ||F(x)|| .
+ * The iteration stops when ||F(x)|| <= rtol ||F(x_0)|| + atol. */
+
+struct JfnkOptions {
+  bool eisenstat_walker = true;    // adaptive forcing terms
+  double eta_max = 0.9;            // largest (or constant) forcing term
+  double gamma = 0.9;              // Eisenstat-Walker parameter
+  unsigned int restart = 30;       // m of GMRES(m)
+  unsigned int max_krylov = 300;   // GMRES iterations per Newton step
+  unsigned int maxit = 100;        // Newton steps
+  double lmin = 1e-3;              // minimal damping factor
+  // Preconditioner v -> M^{-1} v with M ~ DF(x), none if empty
+  std::function<Eigen::VectorXd(const Eigen::VectorXd &)> precond;
+};
+
+struct JfnkStatistics {
+  unsigned int newton_steps = 0;
+  unsigned int gmres_iterations = 0;  // Jacobian-vector products
+  unsigned int funcalls = 0;          // including those for DF(x) v
+  unsigned int backtracks = 0;        // reductions of lambda
+};
+
+/* SAM_LISTING_BEGIN_0 */
+template <typename FuncType, typename VecType>
+void jfnk(const FuncType &F, VecType &x, double rtol, double atol,
+          const JfnkOptions &opt = {}, JfnkStatistics *stats = nullptr) {
+  JfnkStatistics dummy;
+  JfnkStatistics &st = stats ? *stats : dummy;
+  const auto Fc = [&](const Eigen::VectorXd &y) -> Eigen::VectorXd {
+    ++st.funcalls;
+    return F(y);
+  };
+  Eigen::VectorXd f = Fc(x);
+  double fn = f.norm();
+  const double stop_tol = rtol * fn + atol;
+  double eta = opt.eta_max, fn_old = fn;
+  while (fn > stop_tol) {
+    if (st.newton_steps++ >= opt.maxit) throw "No convergence: maxit";
+    if (opt.eisenstat_walker && st.newton_steps > 1) {
+      const double eta_old = eta;
+      eta = opt.gamma * (fn / fn_old) * (fn / fn_old);
+      if (opt.gamma * eta_old * eta_old > 0.1) {
+        eta = std::max(eta, opt.gamma * eta_old * eta_old);
+      }
+      eta = std::min(opt.eta_max, std::max(eta, 0.5 * stop_tol / fn));
+    }
+    // Directional derivatives DF(x) v by forward differences
+    const double xn = std::max(1., Eigen::VectorXd(x).norm());
+    const auto Jv = [&](const Eigen::VectorXd &v) -> Eigen::VectorXd {
+      const double vn = v.norm();
+      if (vn == 0.) return Eigen::VectorXd::Zero(v.size());
+      const double h =
+          std::sqrt(std::numeric_limits<double>::epsilon()) * xn / vn;
+      return (Fc(x + h * v) - f) / h;
+    };
+    Eigen::VectorXd s = Eigen::VectorXd::Zero(f.size());
+    const GmresResult g =
+        opt.precond
+            ? gmres(Jv, Eigen::VectorXd(-f), s, eta, opt.restart,
+                    opt.max_krylov, opt.precond)
+            : gmres(Jv, Eigen::VectorXd(-f), s, eta, opt.restart,
+                    opt.max_krylov);
+    st.gmres_iterations += g.iterations;
+    // Backtracking on ||F||
+    double lambda = 1.;
+    Eigen::VectorXd xt = x + s, ft = Fc(xt);
+    while (ft.norm() > (1. - 1e-4 * lambda) * fn) {
+      lambda /= 2;
+      ++st.backtracks;
+      if (lambda < opt.lmin) throw "No convergence: lambda -> 0";
+      xt = x + lambda * s;
+      ft = Fc(xt);
+    }
+    x = xt;
+    f = std::move(ft);
+    fn_old = fn;
+    fn = f.norm();
+  }
+}
+/* SAM_LISTING_END_0 */
@@ -0,0 +1,172 @@
+#include <Eigen/Dense>
+#include <Eigen/Sparse>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <vector>
+
+#include "broyd.hpp"
+#include "dampnewton.hpp"
+#include "jfnk.hpp"
+#include "lmbroyd.hpp"
+
+template <class Action>
+double timeit(Action &&a) {
+  const auto start = std::chrono::high_resolution_clock::now();
+  a();
+  const auto end = std::chrono::high_resolution_clock::now();
+  return std::chrono::duration<double>(end - start).count();
+}
+
+// F(x) = x .* (A x) - b with A = I + a a^T and solution x = 1, the test
+// problem of IterativeMethods/broyden, with A never formed
+struct RankOneProblem {
+  Eigen::VectorXd a, b;
+  explicit RankOneProblem(Eigen::Index n)
+      : a(Eigen::VectorXd::LinSpaced(n, 0.0, n - 1) /
+          std::sqrt(0.5 * n * (n - 1) - 1.0)) {
+    b = Eigen::VectorXd::Zero(n);
+    b = (*this)(Eigen::VectorXd::Ones(n));
+  }
+  Eigen::VectorXd Ax(const Eigen::VectorXd &x) const {
+    return x + a * a.dot(x);
+  }
+  Eigen::VectorXd operator()(const Eigen::VectorXd &x) const {
+    return x.cwiseProduct(Ax(x)) - b;
+  }
+  // diagonal of DF(x) = diag(x) A + diag(A x)
+  Eigen::VectorXd diagDF(const Eigen::VectorXd &x) const {
+    return x.cwiseProduct(Eigen::VectorXd::Ones(a.size()) +
+                          a.cwiseProduct(a)) +
+           Ax(x);
+  }
+};
+
+int main(int argc, char **argv) {
+  std::cout << std::setprecision(3) << std::scientific;
+  const Eigen::Index n = argc > 1 ? std::atol(argv[1]) : 1000000;
+
+  // 1. x .* (A x) = b with A = I + a a^T
+  {
+    std::cout << "x .* (A x) = b, A = I + a a^T\n";
+    const auto report = [](const char *name, double t, const auto &x,
+                           const auto &F) {
+      std::cout << "  " << name << t << " s, |F(x)| = " << F(x).norm()
+                << ", |x - 1| = "
+                << (x - Eigen::VectorXd::Ones(x.size())).norm();
+    };
+    // dense Jacobian for upbroyd() (J_0 = DF(x_0), O(n^3)) against the
+    // limited-memory variant with J_0 = diag(DF(x_0)) (O(n) storage)
+    for (Eigen::Index m : {Eigen::Index(2000), n}) {
+      const RankOneProblem F(m);
+      const Eigen::VectorXd x0 = Eigen::VectorXd::LinSpaced(m, 0.5, 1.0);
+      std::cout << " n = " << m << "\n";
+      Eigen::VectorXd x;
+      if (m <= 4000) {
+        const double t = timeit([&] {
+          Eigen::MatrixXd J = x0.asDiagonal() *
+                              (Eigen::MatrixXd::Identity(m, m) +
+                               F.a * F.a.transpose());
+          J.diagonal() += F.Ax(x0);
+          x = upbroyd(F, x0, J, 1e-10, 1e-12, 50);
+        });
+        report("upbroyd, dense J_0:           ", t, x, F);
+        std::cout << "\n";
+      }
+      const Eigen::VectorXd d = F.diagDF(x0);
+      const auto J0inv = [&](const Eigen::VectorXd &v) {
+        return Eigen::VectorXd(v.cwiseQuotient(d));
+      };
+      unsigned int its = 0;
+      const auto count = [&](unsigned int k, const Eigen::VectorXd &,
+                             const Eigen::VectorXd &,
+                             const Eigen::VectorXd &) { its = k + 1; };
+      double t = timeit(
+          [&] { x = lmbroyd(F, x0, J0inv, 1e-10, 1e-12, 100, 20, count); });
+      report("lmbroyd, diagonal J_0, m = 20:", t, x, F);
+      std::cout << ", " << its << " iterations\n";
+      // JFNK with the same diagonal as preconditioner
+      for (bool ew : {true, false}) {
+        JfnkOptions opt;
+        opt.precond = J0inv;
+        opt.eisenstat_walker = ew;
+        if (!ew) opt.eta_max = 1e-4;
+        JfnkStatistics st;
+        x = x0;
+        t = timeit([&] { jfnk(F, x, 1e-13, 1e-9, opt, &st); });
+        report(ew ? "JFNK, Eisenstat-Walker:       "
+                  : "JFNK, eta = 1e-4:             ",
+               t, x, F);
+        std::cout << ", " << st.newton_steps << " Newton steps, "
+                  << st.gmres_iterations << " GMRES iterations\n";
+      }
+    }
+  }
+
+  // 2. -Laplace u + u^3 = 1 on an m x m grid (5-point stencil)
+  {
+    const Eigen::Index m = 200, nn = m * m;
+    const double c2 = double(m + 1) * (m + 1);
+    const auto F = [&](const Eigen::VectorXd &u) {
+      Eigen::VectorXd r(nn);
+      for (Eigen::Index i = 0; i < m; ++i) {
+        for (Eigen::Index j = 0; j < m; ++j) {
+          const Eigen::Index k = i * m + j;
+          double s = 4 * u(k);
+          if (i > 0) s -= u(k - m);
+          if (i < m - 1) s -= u(k + m);
+          if (j > 0) s -= u(k - 1);
+          if (j < m - 1) s -= u(k + 1);
+          r(k) = c2 * s + u(k) * u(k) * u(k) - 1;
+        }
+      }
+      return r;
+    };
+    std::vector<Eigen::Triplet<double>> trip;
+    for (Eigen::Index k = 0; k < nn; ++k) {
+      const Eigen::Index i = k / m, j = k % m;
+      trip.emplace_back(k, k, 4 * c2);
+      if (i > 0) trip.emplace_back(k, k - m, -c2);
+      if (i < m - 1) trip.emplace_back(k, k + m, -c2);
+      if (j > 0) trip.emplace_back(k, k - 1, -c2);
+      if (j < m - 1) trip.emplace_back(k, k + 1, -c2);
+    }
+    Eigen::SparseMatrix<double> L(nn, nn);
+    L.setFromTriplets(trip.begin(), trip.end());
+    std::cout << "\n-Laplace u + u^3 = 1, " << m << " x " << m << " grid\n";
+    // Newton with sparse LU of the exact Jacobian
+    const auto DF = [&](const Eigen::VectorXd &u) {
+      Eigen::SparseMatrix<double> J = L;
+      J.diagonal() += 3 * u.cwiseProduct(u);
+      return J;
+    };
+    Eigen::VectorXd u = Eigen::VectorXd::Zero(nn);
+    double t = timeit([&] { dampnewton(F, DF, u, 1e-10, 1e-12); });
+    std::cout << "  damped Newton, sparse LU:     " << t
+              << " s, |F(u)| = " << F(u).norm()
+              << ", u(center) = " << u((m / 2) * m + m / 2) << "\n";
+    // JFNK, preconditioned by the Laplacian (decomposed once)
+    Eigen::SimplicialLDLT<Eigen::SparseMatrix<double>> ldlt(L);
+    for (bool prec : {false, true}) {
+      JfnkOptions opt;
+      opt.max_krylov = 1000;
+      if (prec) {
+        opt.precond = [&](const Eigen::VectorXd &v) {
+          return Eigen::VectorXd(ldlt.solve(v));
+        };
+      }
+      JfnkStatistics st;
+      u.setZero();
+      t = timeit([&] { jfnk(F, u, 1e-12, 1e-6, opt, &st); });
+      std::cout << (prec ? "  JFNK, Laplacian precond.:     "
+                         : "  JFNK, no preconditioner:      ")
+                << t << " s, |F(u)| = " << F(u).norm()
+                << ", u(center) = " << u((m / 2) * m + m / 2) << ", "
+                << st.newton_steps << " Newton steps, " << st.gmres_iterations
+                << " GMRES iterations\n";
+    }
+  }
+  return 0;
+}
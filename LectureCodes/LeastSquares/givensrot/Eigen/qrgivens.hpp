@@ -32,7 +32,8 @@ void qrgivens(const MatrixXd &A, MatrixXd &Q, MatrixXd &R) {
       tmp(0) = R(j - 1, i);
       tmp(1) = R(j, i);
       planerot(tmp, G, xDummy); // see Code~\ref{cpp:planerot}
-      R.block(j - 1, 0, 2, n) = G.transpose() * R.block(j - 1, 0, 2, n);
+      // columns 0..i-1 of rows j-1, j are zero already
+      R.block(j - 1, i, 2, n - i) = G.transpose() * R.block(j - 1, i, 2, n - i);
       Q.block(0, j - 1, n, 2) = Q.block(0, j - 1, n, 2) * G;
     }
   }
@@ -0,0 +1,332 @@
+#pragma once
+
+#include <Eigen/Dense>
+#include <Eigen/OrderingMethods>
+#include <Eigen/QR>
+#include <Eigen/Sparse>
+#include <Eigen/SparseCholesky>
+#include <Eigen/SparseQR>
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "parallel.hpp"
+
+/* Levenberg-Marquardt method for nonlinear least squares problems
+ * ||F(x)||_2 -> min, F: R^n -> R^m, cf. the Gauss-Newton method gn().
+ * The correction s solves the damped linear least squares problem
+ *   ||F(x) + J(x) s||^2 + lambda ||D s||^2 -> min,
+ * lambda is adapted to the ratio of actual and predicted reduction.
+ * - Dense Jacobians are factored once, J = QR; a new lambda only costs a
+ *   QR decomposition of the (2n) x n matrix [R; sqrt(lambda) D].
+ * - Sparse Jacobians (Eigen::SparseMatrix) are handled by SparseQR of
+ *   [J; sqrt(lambda) D]. Eigen's SparseQR becomes slow for large tall
+ *   matrices; then the normal equations (J^T J + lambda D^2) s = -J^T F
+ *   can be solved by a sparse Cholesky decomposition instead.
+ * - Optional geodesic acceleration [Transtrum, Sethna, arXiv:1201.5885]:
+ *   a second order correction from a finite difference of F along s.
+ * - Optional Broyden updates of J after accepted steps instead of new
+ *   evaluations (Schubert's update, which preserves the sparsity pattern,
+ *   for sparse J); J is evaluated again after a rejected step.
+ * - PointwiseLeastSquares evaluates F and J in parallel over the data
+ *   points of a fitting problem. */
+
+struct LMOptions {
+  double rtol = 1.0E-6;            // relative step tolerance, cf. gn()
+  double atol = 1.0E-8;            // absolute step tolerance
+  double gtol = 1.0E-12;           // tolerance for ||J^T F||_inf
+  unsigned int maxit = 200;
+  double lambda0 = 1.0E-3;         // initial damping relative to max D_i^2
+  bool geodesic = false;           // geodesic acceleration
+  double geodesic_ratio = 0.75;    // accept if 2|a|/|v| <= ratio
+  unsigned int broyden = 0;        // max. consecutive Broyden updates
+  bool sparse_normal_equations = false;  // sparse J: Cholesky, not QR
+};
+
+struct LMIteration {
+  double seconds;          // wall time of the iteration
+  double cost;             // ||F(x)||^2 / 2 after the iteration
+  double lambda;
+  bool accepted;
+  bool jacobian_evaluated;
+};
+
+struct LMResult {
+  Eigen::VectorXd x;
+  double cost = 0;
+  bool converged = false;
+  unsigned int residual_evals = 0, jacobian_evals = 0;
+  std::vector<LMIteration> history;
+};
+
+namespace levmar_detail {
+/* SAM_LISTING_BEGIN_0 */
+// Solver for ||F + J s||^2 + lambda ||D s||^2 -> min with dense J: the QR
+// decomposition of J is computed once per Jacobian
+class DenseLMSolver {
+ public:
+  explicit DenseLMSolver(const LMOptions &) {}
+  void factor(const Eigen::MatrixXd &J) {
+    qr_.compute(J);
+    n_ = J.cols();
+    R_ = qr_.matrixQR().topRows(n_).triangularView<Eigen::Upper>();
+  }
+  Eigen::VectorXd solve(const Eigen::VectorXd &F, double lambda,
+                        const Eigen::VectorXd &D) const {
+    // Q^T F, only the first n components enter
+    const Eigen::VectorXd qtf =
+        (qr_.householderQ().transpose() * F).head(n_);
+    Eigen::MatrixXd S(2 * n_, n_);
+    S << R_, (std::sqrt(lambda) * D).asDiagonal().toDenseMatrix();
+    Eigen::VectorXd rhs = Eigen::VectorXd::Zero(2 * n_);
+    rhs.head(n_) = -qtf;
+    return S.householderQr().solve(rhs);
+  }
+
+ private:
+  Eigen::HouseholderQR<Eigen::MatrixXd> qr_;
+  Eigen::MatrixXd R_;
+  Eigen::Index n_ = 0;
+};
+/* SAM_LISTING_END_0 */
+
+// Sparse J: SparseQR of the stacked sparse matrix for every lambda, or
+// sparse Cholesky decomposition of J^T J + lambda D^2 with the pattern
+// analyzed once per Jacobian
+class SparseLMSolver {
+ public:
+  explicit SparseLMSolver(const LMOptions &opt)
+      : normal_(opt.sparse_normal_equations) {}
+  void factor(const Eigen::SparseMatrix<double> &J) {
+    J_ = J;
+    if (normal_) {
+      JtJ_ = J_.transpose() * J_;
+      JtJ_.makeCompressed();
+      ldlt_.analyzePattern(JtJ_ + diag(J_.cols(), 1.0));
+    }
+  }
+  Eigen::VectorXd solve(const Eigen::VectorXd &F, double lambda,
+                        const Eigen::VectorXd &D) {
+    if (normal_) {
+      ldlt_.factorize(JtJ_ + diag(lambda * D.cwiseAbs2()));
+      return ldlt_.solve(-(J_.transpose() * F));
+    }
+    const Eigen::Index m = J_.rows(), n = J_.cols();
+    std::vector<Eigen::Triplet<double>> t;
+    t.reserve(J_.nonZeros() + n);
+    for (Eigen::Index k = 0; k < J_.outerSize(); ++k) {
+      for (Eigen::SparseMatrix<double>::InnerIterator it(J_, k); it; ++it) {
+        t.emplace_back(it.row(), it.col(), it.value());
+      }
+    }
+    for (Eigen::Index i = 0; i < n; ++i) {
+      t.emplace_back(m + i, i, std::sqrt(lambda) * D(i));
+    }
+    Eigen::SparseMatrix<double> S(m + n, n);
+    S.setFromTriplets(t.begin(), t.end());
+    S.makeCompressed();
+    Eigen::SparseQR<Eigen::SparseMatrix<double>, Eigen::COLAMDOrdering<int>>
+        qr(S);
+    Eigen::VectorXd rhs = Eigen::VectorXd::Zero(m + n);
+    rhs.head(m) = -F;
+    return qr.solve(rhs);
+  }
+
+ private:
+  static Eigen::SparseMatrix<double> diag(const Eigen::VectorXd &d) {
+    Eigen::SparseMatrix<double> S(d.size(), d.size());
+    S.reserve(Eigen::VectorXi::Ones(d.size()));
+    for (Eigen::Index i = 0; i < d.size(); ++i) S.insert(i, i) = d(i);
+    return S;
+  }
+  static Eigen::SparseMatrix<double> diag(Eigen::Index n, double v) {
+    return diag(Eigen::VectorXd::Constant(n, v));
+  }
+
+  bool normal_;
+  Eigen::SparseMatrix<double> J_, JtJ_;
+  Eigen::SimplicialLDLT<Eigen::SparseMatrix<double>> ldlt_;
+};
+
+template <class JacobianMatrix>
+using LMSolver =
+    typename std::conditional<std::is_base_of<Eigen::SparseMatrixBase<
+                                                  JacobianMatrix>,
+                                              JacobianMatrix>::value,
+                              SparseLMSolver, DenseLMSolver>::type;
+
+// Column norms of J
+inline Eigen::VectorXd columnNorms(const Eigen::MatrixXd &J) {
+  return J.colwise().norm().transpose();
+}
+inline Eigen::VectorXd columnNorms(const Eigen::SparseMatrix<double> &J) {
+  Eigen::VectorXd c(J.cols());
+  for (Eigen::Index k = 0; k < J.outerSize(); ++k) c(k) = J.col(k).norm();
+  return c;
+}
+
+// Broyden's rank-1 update J <- J + (y - J s) s^T / (s^T s)
+inline void broydenUpdate(Eigen::MatrixXd &J, const Eigen::VectorXd &s,
+                          const Eigen::VectorXd &y) {
+  J += ((y - J * s) / s.squaredNorm()) * s.transpose();
+}
+// Schubert's update: row i only changes on its sparsity pattern S_i,
+// J_i <- J_i + (y_i - J_i s) s_{S_i}^T / |s_{S_i}|^2
+inline void broydenUpdate(Eigen::SparseMatrix<double> &J,
+                          const Eigen::VectorXd &s, const Eigen::VectorXd &y) {
+  const Eigen::VectorXd r = y - J * s;
+  Eigen::VectorXd d = Eigen::VectorXd::Zero(J.rows());
+  for (Eigen::Index k = 0; k < J.outerSize(); ++k) {
+    for (Eigen::SparseMatrix<double>::InnerIterator it(J, k); it; ++it) {
+      d(it.row()) += s(k) * s(k);
+    }
+  }
+  for (Eigen::Index k = 0; k < J.outerSize(); ++k) {
+    for (Eigen::SparseMatrix<double>::InnerIterator it(J, k); it; ++it) {
+      if (d(it.row()) > 0) it.valueRef() += r(it.row()) * s(k) / d(it.row());
+    }
+  }
+}
+}  // namespace levmar_detail
+
+/* SAM_LISTING_BEGIN_1 */
+// F(x) returns the residual vector, J(x) its Jacobian as Eigen::MatrixXd or
+// Eigen::SparseMatrix<double>
+template <class Function, class Jacobian>
+LMResult levenbergMarquardt(const Eigen::VectorXd &x0, Function &&F,
+                            Jacobian &&J, const LMOptions &opt = {}) {
+  using JacobianMatrix = typename std::decay<decltype(J(x0))>::type;
+  using clock = std::chrono::high_resolution_clock;
+  levmar_detail::LMSolver<JacobianMatrix> solver(opt);
+  LMResult res;
+  res.x = x0;
+  Eigen::VectorXd Fx = F(res.x);
+  ++res.residual_evals;
+  JacobianMatrix Jx = J(res.x);
+  ++res.jacobian_evals;
+  bool exact = true;            // Jx is the exact Jacobian at x
+  unsigned int updates = 0;     // consecutive Broyden updates
+  solver.factor(Jx);
+  // Marquardt scaling: D_i = largest norm of column i of J so far
+  Eigen::VectorXd D = levmar_detail::columnNorms(Jx).cwiseMax(1e-12);
+  double lambda = opt.lambda0 * D.cwiseAbs2().maxCoeff(), nu = 2.0;
+  double cost = 0.5 * Fx.squaredNorm();
+  for (unsigned int k = 0; k < opt.maxit; ++k) {
+    const auto start = clock::now();
+    LMIteration it{0, cost, lambda, false, false};
+    if ((Jx.transpose() * Fx).cwiseAbs().maxCoeff() <= opt.gtol && exact) {
+      res.converged = true;
+      break;
+    }
+    Eigen::VectorXd s = solver.solve(Fx, lambda, D);
+    if (opt.geodesic) {
+      // directional second derivative of F along s by finite differences
+      const double h = 0.1;
+      const Eigen::VectorXd Fh = F(res.x + h * s);
+      ++res.residual_evals;
+      const Eigen::VectorXd r2 = (2.0 / h) * ((Fh - Fx) / h - Jx * s);
+      const Eigen::VectorXd a = solver.solve(r2, lambda, D);
+      if (2 * a.norm() <= opt.geodesic_ratio * s.norm()) s += 0.5 * a;
+    }
+    const Eigen::VectorXd xnew = res.x + s;
+    const Eigen::VectorXd Fnew = F(xnew);
+    ++res.residual_evals;
+    const double costnew = 0.5 * Fnew.squaredNorm();
+    // gain ratio: actual vs. predicted reduction of the linear model
+    const double pred = cost - 0.5 * (Fx + Jx * s).squaredNorm();
+    const double rho = pred > 0 ? (cost - costnew) / pred : -1.0;
+    if (rho > 0) {
+      it.accepted = true;
+      lambda *= std::max(1.0 / 3.0, 1.0 - std::pow(2.0 * rho - 1.0, 3));
+      nu = 2.0;
+      if (updates < opt.broyden) {
+        levmar_detail::broydenUpdate(Jx, s, Fnew - Fx);
+        ++updates;
+        exact = false;
+      } else {
+        Jx = J(xnew);
+        ++res.jacobian_evals;
+        it.jacobian_evaluated = true;
+        updates = 0;
+        exact = true;
+      }
+      res.x = xnew;
+      Fx = Fnew;
+      cost = costnew;
+    } else if (!exact) {
+      // the rejection may be caused by the approximate Jacobian
+      Jx = J(res.x);
+      ++res.jacobian_evals;
+      it.jacobian_evaluated = true;
+      updates = 0;
+      exact = true;
+    } else {
+      lambda *= nu;
+      nu *= 2.0;
+    }
+    if (it.accepted || it.jacobian_evaluated) {
+      solver.factor(Jx);
+      D = D.cwiseMax(levmar_detail::columnNorms(Jx));
+    }
+    it.cost = cost;
+    it.lambda = lambda;
+    it.seconds = std::chrono::duration<double>(clock::now() - start).count();
+    res.history.push_back(it);
+    // termination as in gn(): small accepted correction
+    if (it.accepted &&
+        (s.norm() <= opt.rtol * res.x.norm() || s.norm() <= opt.atol)) {
+      res.converged = true;
+      break;
+    }
+  }
+  res.cost = cost;
+  return res;
+}
+/* SAM_LISTING_END_1 */
+
+/* SAM_LISTING_BEGIN_2 */
+// Fitting problem with residuals F_i(x) = model.residual(x, i), i < N, and
+// gradients model.gradient(x, i, g) (g: row i of the Jacobian). F and J
+// evaluate the data points in parallel. The model is stored by value;
+// move it in to avoid copying its data.
+template <class Model>
+class PointwiseLeastSquares {
+ public:
+  PointwiseLeastSquares(Model model, Eigen::Index N,
+                        unsigned int num_threads = 0)
+      : model_(std::move(model)), N_(N), num_threads_(num_threads) {}
+
+  Eigen::VectorXd F(const Eigen::VectorXd &x) const {
+    Eigen::VectorXd r(N_);
+    parallelFor(
+        N_,
+        [&](std::size_t b, std::size_t e, unsigned int) {
+          for (std::size_t i = b; i < e; ++i) r(i) = model_.residual(x, i);
+        },
+        num_threads_);
+    return r;
+  }
+
+  Eigen::MatrixXd J(const Eigen::VectorXd &x) const {
+    Eigen::MatrixXd Jx(N_, x.size());
+    parallelFor(
+        N_,
+        [&](std::size_t b, std::size_t e, unsigned int) {
+          for (std::size_t i = b; i < e; ++i) {
+            auto g = Jx.row(i);
+            model_.gradient(x, i, g);
+          }
+        },
+        num_threads_);
+    return Jx;
+  }
+
+ private:
+  Model model_;
+  Eigen::Index N_;
+  unsigned int num_threads_;
+};
+/* SAM_LISTING_END_2 */
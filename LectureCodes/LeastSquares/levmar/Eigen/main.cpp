@@ -0,0 +1,146 @@
+#include <Eigen/Dense>
+#include <Eigen/Sparse>
+#include <chrono>
+#include <cmath>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <vector>
+
+#include "gn.hpp"
+#include "levmar.hpp"
+
+void report(const char *name, const LMResult &r) {
+  double t = 0;
+  for (const LMIteration &it : r.history) t += it.seconds;
+  std::cout << name << ": x = " << r.x.transpose() << "\n    cost "
+            << r.cost << ", " << r.history.size() << " iterations, "
+            << r.residual_evals << " F / " << r.jacobian_evals
+            << " J evaluations, " << t << " s"
+            << (r.converged ? "" : " (not converged)") << "\n";
+}
+
+// Exponential decay y = x0 + x1 exp(-x2 t), cf. gnrandinit
+struct DecayModel {
+  const Eigen::VectorXd &t, &y;
+  double residual(const Eigen::VectorXd &x, Eigen::Index i) const {
+    return x(0) + x(1) * std::exp(-x(2) * t(i)) - y(i);
+  }
+  template <class Row>
+  void gradient(const Eigen::VectorXd &x, Eigen::Index i, Row &g) const {
+    const double e = std::exp(-x(2) * t(i));
+    g << 1.0, e, -x(1) * t(i) * e;
+  }
+};
+
+// K independent circle fits with a block diagonal sparse Jacobian:
+// residuals |p_j - c_k| - r_k for 40 points per circle
+void circleFits(int K, std::mt19937 &gen) {
+  const int P = 40;
+  std::uniform_real_distribution<double> U(0.0, 1.0);
+  std::normal_distribution<double> noise(0.0, 0.01);
+  Eigen::MatrixXd pts(2, K * P);
+  Eigen::VectorXd exact(3 * K), xc(3 * K);
+  for (int k = 0; k < K; ++k) {
+    exact.segment<3>(3 * k) << 10 * U(gen), 10 * U(gen), 1 + U(gen);
+    for (int j = 0; j < P; ++j) {
+      const double phi = 2 * M_PI * U(gen);
+      pts.col(k * P + j) = exact.segment<2>(3 * k) +
+                           (exact(3 * k + 2) + noise(gen)) *
+                               Eigen::Vector2d(std::cos(phi), std::sin(phi));
+    }
+    // initial guess: perturbed centroid, radius 0.5
+    const Eigen::Vector2d c = pts.middleCols(k * P, P).rowwise().mean();
+    xc.segment<3>(3 * k) << c(0) + 0.3, c(1) - 0.3, 0.5;
+  }
+  auto F = [&](const Eigen::VectorXd &x) {
+    Eigen::VectorXd r(K * P);
+    for (int i = 0; i < K * P; ++i) {
+      const int k = i / P;
+      r(i) = (pts.col(i) - x.segment<2>(3 * k)).norm() - x(3 * k + 2);
+    }
+    return r;
+  };
+  auto J = [&](const Eigen::VectorXd &x) {
+    std::vector<Eigen::Triplet<double>> trp;
+    trp.reserve(3 * K * P);
+    for (int i = 0; i < K * P; ++i) {
+      const int k = i / P;
+      const Eigen::Vector2d d = pts.col(i) - x.segment<2>(3 * k);
+      const double nd = d.norm();
+      trp.emplace_back(i, 3 * k, -d(0) / nd);
+      trp.emplace_back(i, 3 * k + 1, -d(1) / nd);
+      trp.emplace_back(i, 3 * k + 2, -1.0);
+    }
+    Eigen::SparseMatrix<double> Jx(K * P, 3 * K);
+    Jx.setFromTriplets(trp.begin(), trp.end());
+    return Jx;
+  };
+  // Eigen's SparseQR only for the smaller problem
+  const bool cholesky = K > 100;
+  std::cout << "\n" << K << " circles, sparse Jacobian " << K * P << " x "
+            << 3 * K << (cholesky ? ", normal equations" : ", SparseQR")
+            << "\n";
+  for (unsigned int broyden : {0, 3}) {
+    LMOptions opt;
+    opt.broyden = broyden;
+    opt.sparse_normal_equations = cholesky;
+    const LMResult r = levenbergMarquardt(xc, F, J, opt);
+    double t = 0;
+    for (const LMIteration &it : r.history) t += it.seconds;
+    std::cout << "  Broyden updates " << broyden << ": " << r.history.size()
+              << " iterations, " << r.jacobian_evals << " J evaluations, "
+              << t << " s, max. error "
+              << (r.x - exact).cwiseAbs().maxCoeff() << "\n";
+  }
+}
+
+int main() {
+  std::cout << std::setprecision(6);
+  // Rate model from the gn demo: y = x0 t / (x1 + t)
+  Eigen::VectorXd X(7), Y(7);
+  X << 0.038, 0.194, 0.425, 0.626, 1.253, 2.500, 3.740;
+  Y << 0.050, 0.127, 0.094, 0.2122, 0.2729, 0.2665, 0.3317;
+  auto F = [&](const Eigen::VectorXd &b) -> Eigen::VectorXd {
+    return b(0) * X.array() / (b(1) + X.array()) - Y.array();
+  };
+  auto J = [&](const Eigen::VectorXd &b) {
+    Eigen::MatrixXd Jb(X.size(), 2);
+    Jb.col(0) = X.array() / (b(1) + X.array());
+    Jb.col(1) = -b(0) * X.array() / (b(1) + X.array()).square();
+    return Jb;
+  };
+  Eigen::VectorXd b0(2);
+  b0 << 0.9, 0.2;
+  std::cout << "rate model, gn: " << gn(b0, F, J).transpose() << "\n";
+  report("  LM", levenbergMarquardt(b0, F, J));
+
+  // Exponential decay with 10^6 noisy data points and a poor initial guess
+  const Eigen::Index N = 1000000;
+  std::mt19937 gen(3);
+  std::normal_distribution<double> noise(0.0, 0.05);
+  const Eigen::VectorXd t = Eigen::VectorXd::LinSpaced(N, 0.0, 10.0);
+  Eigen::VectorXd y(N);
+  for (Eigen::Index i = 0; i < N; ++i) {
+    y(i) = 1.0 + 2.0 * std::exp(-0.7 * t(i)) + noise(gen);
+  }
+  PointwiseLeastSquares<DecayModel> lsq(DecayModel{t, y}, N);
+  auto Fd = [&](const Eigen::VectorXd &x) { return lsq.F(x); };
+  auto Jd = [&](const Eigen::VectorXd &x) { return lsq.J(x); };
+  Eigen::VectorXd x0(3);
+  x0 << 0.0, 0.1, 5.0;
+  std::cout << "\nexponential decay, " << N << " data points\n";
+  LMOptions opt;
+  report("  LM", levenbergMarquardt(x0, Fd, Jd, opt));
+  opt.geodesic = true;
+  report("  LM + geodesic acceleration",
+         levenbergMarquardt(x0, Fd, Jd, opt));
+  opt.geodesic = false;
+  opt.broyden = 5;
+  report("  LM + Broyden updates", levenbergMarquardt(x0, Fd, Jd, opt));
+
+  // block diagonal sparse Jacobians
+  circleFits(100, gen);
+  circleFits(2000, gen);
+  return 0;
+}
@@ -0,0 +1,428 @@
+#pragma once
+
+#include <Eigen/Dense>
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <limits>
+#include <numeric>
+#include <random>
+#include <stdexcept>
+#include <vector>
+
+#include "parallel.hpp"
+
+/* k-means clustering (Lloyd-Max algorithm, cf. lloydmax()) for large point
+ * sets X in R^{d,N}, the points being the columns of X.
+ * - Distances of many points to all k centers are computed tile by tile
+ *   from ||x - c||^2 = ||x||^2 - 2 c^T x + ||c||^2, i.e. by one matrix
+ *   product C^T X_tile per tile of opt.tile points.
+ * - Most distance computations of later iterations are skipped using the
+ *   triangle inequality: Hamerly's algorithm keeps an upper bound for the
+ *   distance to the assigned center and one lower bound for all others
+ *   (O(N) memory), Elkan's algorithm one lower bound per center (O(Nk)
+ *   memory and O(k) bound updates per point; prunes more and pays off
+ *   when distances are expensive, i.e. in high dimension d).
+ * - Points are processed in parallel, every thread accumulates the sums of
+ *   its points for the new centers in a private array.
+ * - kmeansPlusPlus(): D^2 seeding [Arthur, Vassilvitskii, SODA 2007].
+ * - MiniBatchKMeans: centers updated from batches of points delivered
+ *   once, e.g. read from a file [Sculley, WWW 2010]. */
+
+enum class KMeansPruning { None, Hamerly, Elkan };
+
+struct KMeansOptions {
+  unsigned int max_iterations = 300;
+  KMeansPruning pruning = KMeansPruning::Hamerly;
+  Eigen::Index tile = 256;       // points per tile of the distance products
+  unsigned int num_threads = 0;  // 0 = number of hardware threads
+};
+
+struct KMeansResult {
+  Eigen::MatrixXd C;             // centers, one per column
+  Eigen::VectorXi idx;           // idx(i): center of point i
+  Eigen::VectorXd cds;           // sum of squared distances per cluster
+  double sumd;                   // sum of all squared distances
+  unsigned int iterations;
+  bool converged;                // no point changed its cluster
+  std::size_t distance_evals;    // point-center distances computed
+};
+
+namespace kmeans_detail {
+// Squared distances D(j, i) of the points X.col(b + i), i < D.cols(), to
+// the centers C.col(j), c2 = squared norms of the centers
+inline void squaredDistances(const Eigen::MatrixXd &X, Eigen::Index b,
+                             Eigen::Index e, const Eigen::MatrixXd &C,
+                             const Eigen::VectorXd &c2, Eigen::MatrixXd &D) {
+  const auto Xt = X.middleCols(b, e - b);
+  D.resize(C.cols(), e - b);
+  D.noalias() = -2.0 * C.transpose() * Xt;
+  D.colwise() += c2;
+  D.rowwise() += Xt.colwise().squaredNorm();
+  D = D.cwiseMax(0.0);
+}
+
+// Calls f(i, D.col(i - b)) for every point i with its squared distances to
+// all centers, tiles of points in parallel
+template <class Visit>
+void forAllDistances(const Eigen::MatrixXd &X, const Eigen::MatrixXd &C,
+                     Eigen::Index tile, unsigned int num_threads,
+                     Visit &&f) {
+  const Eigen::Index N = X.cols();
+  tile = std::max<Eigen::Index>(1, tile);
+  const Eigen::VectorXd c2 = C.colwise().squaredNorm().transpose();
+  parallelFor(
+      (N + tile - 1) / tile,
+      [&](std::size_t tb, std::size_t te, unsigned int tid) {
+        Eigen::MatrixXd D;
+        for (std::size_t t = tb; t < te; ++t) {
+          const Eigen::Index b = t * tile, e = std::min(N, b + tile);
+          squaredDistances(X, b, e, C, c2, D);
+          for (Eigen::Index i = b; i < e; ++i) f(i, D.col(i - b), tid);
+        }
+      },
+      num_threads);
+}
+
+// Per-thread sums and counts of the points of every cluster
+struct Accumulator {
+  Eigen::MatrixXd sums;
+  Eigen::VectorXi counts;
+  std::size_t changed = 0, evals = 0;
+  Accumulator(Eigen::Index d, Eigen::Index k)
+      : sums(Eigen::MatrixXd::Zero(d, k)), counts(Eigen::VectorXi::Zero(k)) {}
+  void add(const Eigen::MatrixXd &X, Eigen::Index i, int a) {
+    sums.col(a) += X.col(i);
+    ++counts(a);
+  }
+};
+
+inline Accumulator reduce(std::vector<Accumulator> &acc) {
+  for (std::size_t t = 1; t < acc.size(); ++t) {
+    acc[0].sums += acc[t].sums;
+    acc[0].counts += acc[t].counts;
+    acc[0].changed += acc[t].changed;
+    acc[0].evals += acc[t].evals;
+  }
+  return acc[0];
+}
+
+// New centers of gravity, empty clusters keep their center
+inline void updateCenters(const Accumulator &acc, Eigen::MatrixXd &C) {
+  for (Eigen::Index j = 0; j < C.cols(); ++j) {
+    if (acc.counts(j) > 0) C.col(j) = acc.sums.col(j) / acc.counts(j);
+  }
+}
+
+// Nearest and second nearest center of x by direct computation
+inline void nearestTwo(const Eigen::MatrixXd &X, Eigen::Index i,
+                       const Eigen::MatrixXd &C, int &a, double &d1,
+                       double &d2) {
+  d1 = d2 = std::numeric_limits<double>::infinity();
+  for (Eigen::Index j = 0; j < C.cols(); ++j) {
+    const double dj = (X.col(i) - C.col(j)).norm();
+    if (dj < d1) {
+      d2 = d1;
+      d1 = dj;
+      a = j;
+    } else if (dj < d2) {
+      d2 = dj;
+    }
+  }
+}
+
+// Half the distance of every center to its nearest other center, and the
+// matrix of all center-center distances
+inline Eigen::VectorXd halfSeparation(const Eigen::MatrixXd &C,
+                                      Eigen::MatrixXd &CC) {
+  const Eigen::VectorXd c2 = C.colwise().squaredNorm().transpose();
+  CC = -2.0 * C.transpose() * C;
+  CC.colwise() += c2;
+  CC.rowwise() += c2.transpose();
+  CC = CC.cwiseMax(0.0).cwiseSqrt();
+  CC.diagonal().setConstant(std::numeric_limits<double>::infinity());
+  Eigen::VectorXd s = 0.5 * CC.colwise().minCoeff().transpose();
+  CC.diagonal().setZero();
+  return s;
+}
+
+// Hamerly's test for point i: u, l are the bounds, moved by the center
+// movements ma (assigned center) and mo (largest movement of the others);
+// distances are only computed if u exceeds the lower bound of the others
+// or half the distance s(a) to the nearest other center
+inline void hamerlyStep(const Eigen::MatrixXd &X, Eigen::Index i,
+                        const Eigen::MatrixXd &C, double ma, double mo,
+                        const Eigen::VectorXd &s, int &a, double &u,
+                        double &l, std::size_t &evals) {
+  u += ma;
+  l -= mo;
+  const double bound = std::max(s(a), l);
+  if (u <= bound) return;
+  u = (X.col(i) - C.col(a)).norm();
+  ++evals;
+  if (u <= bound) return;
+  nearestTwo(X, i, C, a, u, l);
+  evals += C.cols();
+}
+
+// Elkan's tests for point i with a lower bound L(j) for every center; the
+// distance to center j is only computed if u exceeds L(j) and half the
+// distance CC(a, j) between the centers
+inline void elkanStep(const Eigen::MatrixXd &X, Eigen::Index i,
+                      const Eigen::MatrixXd &C, const Eigen::VectorXd &move,
+                      const Eigen::VectorXd &s, const Eigen::MatrixXd &CC,
+                      int &a, double &u, Eigen::Ref<Eigen::VectorXd> L,
+                      std::size_t &evals) {
+  L = (L - move).cwiseMax(0.0);
+  u += move(a);
+  bool tight = false;
+  for (Eigen::Index j = 0; j < C.cols() && u > s(a); ++j) {
+    if (j == a || u <= L(j) || u <= 0.5 * CC(a, j)) continue;
+    if (!tight) {
+      u = L(a) = (X.col(i) - C.col(a)).norm();
+      ++evals;
+      tight = true;
+      if (u <= L(j) || u <= 0.5 * CC(a, j)) continue;
+    }
+    L(j) = (X.col(i) - C.col(j)).norm();
+    ++evals;
+    if (L(j) < u) {
+      a = j;
+      u = L(j);
+    }
+  }
+}
+}  // namespace kmeans_detail
+
+/* SAM_LISTING_BEGIN_0 */
+// Nearest center idx(i) and squared distance d(i) for every point
+inline void kmeansAssign(const Eigen::MatrixXd &X, const Eigen::MatrixXd &C,
+                         Eigen::VectorXi &idx, Eigen::VectorXd &d,
+                         const KMeansOptions &opt = {}) {
+  idx.resize(X.cols());
+  d.resize(X.cols());
+  kmeans_detail::forAllDistances(
+      X, C, opt.tile, opt.num_threads,
+      [&](Eigen::Index i, const auto &Di, unsigned int) {
+        d(i) = Di.minCoeff(&idx(i));
+      });
+}
+
+// k-means++ seeding: the first center is a random point, every further one
+// is a point drawn with probability proportional to its squared distance to
+// the nearest center chosen so far. Cost O(Nkd). Needs 1 <= k <= N.
+inline Eigen::MatrixXd kmeansPlusPlus(const Eigen::MatrixXd &X, Eigen::Index k,
+                                      std::uint64_t seed = 42,
+                                      unsigned int num_threads = 0) {
+  const Eigen::Index N = X.cols();
+  if (k < 1 || k > N) {
+    throw std::invalid_argument("kmeansPlusPlus: need 1 <= k <= N");
+  }
+  std::mt19937_64 gen(seed);
+  Eigen::MatrixXd C(X.rows(), k);
+  C.col(0) = X.col(std::uniform_int_distribution<Eigen::Index>(0, N - 1)(gen));
+  Eigen::VectorXd D2 =
+      Eigen::VectorXd::Constant(N, std::numeric_limits<double>::infinity());
+  const unsigned int p = numThreadsFor(N, num_threads);
+  std::vector<double> partial(p);
+  std::vector<std::size_t> first(p + 1, N);
+  for (Eigen::Index j = 1; j < k; ++j) {
+    // update the distances and their sums over the chunks of the threads
+    parallelFor(
+        N,
+        [&](std::size_t b, std::size_t e, unsigned int tid) {
+          double s = 0.0;
+          for (std::size_t i = b; i < e; ++i) {
+            D2(i) = std::min(D2(i), (X.col(i) - C.col(j - 1)).squaredNorm());
+            s += D2(i);
+          }
+          partial[tid] = s;
+          first[tid] = b;
+        },
+        p);
+    double r = std::uniform_real_distribution<double>(0.0, 1.0)(gen) *
+               std::accumulate(partial.begin(), partial.end(), 0.0);
+    unsigned int t = 0;
+    while (t + 1 < p && r >= partial[t]) r -= partial[t++];
+    std::size_t i = first[t];
+    const std::size_t end = t + 1 < p ? first[t + 1] : N;
+    while (i + 1 < end && r >= D2(i)) r -= D2(i++);
+    C.col(j) = X.col(i);
+  }
+  return C;
+}
+/* SAM_LISTING_END_0 */
+
+/* SAM_LISTING_BEGIN_1 */
+// Lloyd-Max iteration from the initial centers C0 (e.g. kmeansPlusPlus())
+// until no point changes its cluster. Every iteration is one parallel pass
+// over the points that assigns them and accumulates the new centers.
+// Without convergence within max_iterations, C and idx are the centers and
+// the assignment of the last pass.
+inline KMeansResult kmeans(const Eigen::MatrixXd &X, const Eigen::MatrixXd &C0,
+                           const KMeansOptions &opt = {}) {
+  using namespace kmeans_detail;
+  const Eigen::Index d = X.rows(), N = X.cols(), k = C0.cols();
+  if (k < 1 || k > N) throw std::invalid_argument("kmeans: need 1 <= k <= N");
+  if (C0.rows() != d) throw std::invalid_argument("kmeans: dimension mismatch");
+  const unsigned int p = numThreadsFor(N, opt.num_threads);
+  KMeansResult res{C0, Eigen::VectorXi(N), Eigen::VectorXd(), 0.0, 0, false,
+                   0};
+  Eigen::MatrixXd &C = res.C;
+  Eigen::VectorXi &a = res.idx;
+  // u: upper bound of the distance to the assigned center,
+  // l: lower bound(s) of the distances to the other centers
+  Eigen::VectorXd u(N), l;
+  Eigen::MatrixXd L;
+  if (opt.pruning == KMeansPruning::Hamerly) l.resize(N);
+  if (opt.pruning == KMeansPruning::Elkan) L.resize(k, N);
+  std::vector<Accumulator> acc(p, Accumulator(d, k));
+  // initial assignment with matrix products
+  forAllDistances(X, C, opt.tile, p,
+                  [&](Eigen::Index i, const auto &Di, unsigned int tid) {
+                    double d1 = std::numeric_limits<double>::infinity();
+                    double d2 = d1;
+                    for (Eigen::Index j = 0; j < k; ++j) {
+                      if (Di(j) < d1) {
+                        d2 = d1;
+                        d1 = Di(j);
+                        a(i) = j;
+                      } else if (Di(j) < d2) {
+                        d2 = Di(j);
+                      }
+                    }
+                    u(i) = std::sqrt(d1);
+                    if (l.size()) l(i) = std::sqrt(d2);
+                    if (L.size()) L.col(i) = Di.cwiseSqrt();
+                    acc[tid].add(X, i, a(i));
+                  });
+  Accumulator total = reduce(acc);
+  res.distance_evals = std::size_t(N) * k;
+  Eigen::MatrixXd CC;
+  while (res.iterations < opt.max_iterations) {
+    ++res.iterations;
+    const Eigen::MatrixXd Cold = C;
+    updateCenters(total, C);
+    const Eigen::VectorXd move = (C - Cold).colwise().norm().transpose();
+    // largest and second largest move, for the common lower bound
+    Eigen::Index jmax;
+    const double pmax = move.maxCoeff(&jmax);
+    double pmax2 = 0.0;
+    for (Eigen::Index j = 0; j < k; ++j) {
+      if (j != jmax) pmax2 = std::max(pmax2, move(j));
+    }
+    const Eigen::VectorXd s = halfSeparation(C, CC);
+    acc.assign(p, Accumulator(d, k));
+    if (opt.pruning == KMeansPruning::None) {
+      forAllDistances(X, C, opt.tile, p,
+                      [&](Eigen::Index i, const auto &Di, unsigned int tid) {
+                        const int ai = a(i);
+                        Di.minCoeff(&a(i));
+                        if (a(i) != ai) ++acc[tid].changed;
+                        acc[tid].add(X, i, a(i));
+                      });
+      acc[0].evals = std::size_t(N) * k;
+    } else {
+      parallelFor(
+          N,
+          [&](std::size_t b, std::size_t e, unsigned int tid) {
+            Accumulator &ac = acc[tid];
+            for (std::size_t i = b; i < e; ++i) {
+              const int ai = a(i);
+              if (opt.pruning == KMeansPruning::Hamerly) {
+                hamerlyStep(X, i, C, move(ai),
+                            ai == jmax ? pmax2 : pmax, s, a(i), u(i), l(i),
+                            ac.evals);
+              } else {
+                elkanStep(X, i, C, move, s, CC, a(i), u(i), L.col(i),
+                          ac.evals);
+              }
+              if (a(i) != ai) ++ac.changed;
+              ac.add(X, i, a(i));
+            }
+          },
+          p);
+    }
+    total = reduce(acc);
+    res.distance_evals += total.evals;
+    if (total.changed == 0) {
+      res.converged = true;
+      break;
+    }
+  }
+  // centers of gravity of the final clusters; they do not move after
+  // convergence, otherwise idx would refer to other centers
+  if (res.converged) updateCenters(total, C);
+  // exact distances to the final centers
+  std::vector<Eigen::VectorXd> cds(p, Eigen::VectorXd::Zero(k));
+  parallelFor(
+      N,
+      [&](std::size_t b, std::size_t e, unsigned int tid) {
+        for (std::size_t i = b; i < e; ++i) {
+          cds[tid](a(i)) += (X.col(i) - C.col(a(i))).squaredNorm();
+        }
+      },
+      p);
+  res.cds = Eigen::VectorXd::Zero(k);
+  for (const Eigen::VectorXd &c : cds) res.cds += c;
+  res.sumd = res.cds.sum();
+  return res;
+}
+/* SAM_LISTING_END_1 */
+
+/* SAM_LISTING_BEGIN_2 */
+// Mini-batch k-means: every center is the mean of all points assigned to it
+// so far, updated batch by batch, c_j <- c_j + (sum of the new points of
+// cluster j - n_j c_j) / (total count of cluster j). Only the k centers and
+// their counts are kept.
+class MiniBatchKMeans {
+ public:
+  explicit MiniBatchKMeans(const Eigen::MatrixXd &C0,
+                           const KMeansOptions &opt = {})
+      : C_(C0), counts_(Eigen::VectorXd::Zero(C0.cols())), opt_(opt) {}
+
+  void addBatch(const Eigen::MatrixXd &B) {
+    const Eigen::Index k = C_.cols();
+    const unsigned int p = numThreadsFor(B.cols(), opt_.num_threads);
+    std::vector<kmeans_detail::Accumulator> acc(
+        p, kmeans_detail::Accumulator(B.rows(), k));
+    kmeans_detail::forAllDistances(
+        B, C_, opt_.tile, p,
+        [&](Eigen::Index i, const auto &Di, unsigned int tid) {
+          Eigen::Index j;
+          Di.minCoeff(&j);
+          acc[tid].add(B, i, j);
+        });
+    const kmeans_detail::Accumulator total = kmeans_detail::reduce(acc);
+    for (Eigen::Index j = 0; j < k; ++j) {
+      if (total.counts(j) == 0) continue;
+      counts_(j) += total.counts(j);
+      C_.col(j) += (total.sums.col(j) - total.counts(j) * C_.col(j)) /
+                   counts_(j);
+    }
+  }
+
+  const Eigen::MatrixXd &centers() const { return C_; }
+  const Eigen::VectorXd &counts() const { return counts_; }
+
+ private:
+  Eigen::MatrixXd C_;
+  Eigen::VectorXd counts_;
+  KMeansOptions opt_;
+};
+
+// k centers of points delivered in batches by next(B) (false at the end of
+// the data), cf. tsqrStream(); seeded by k-means++ on the first batch
+template <class BlockReader>
+Eigen::MatrixXd miniBatchKMeans(BlockReader &&next, Eigen::Index k,
+                                const KMeansOptions &opt = {},
+                                std::uint64_t seed = 42) {
+  Eigen::MatrixXd B;
+  if (!next(B)) return Eigen::MatrixXd();
+  MiniBatchKMeans mb(kmeansPlusPlus(B, k, seed, opt.num_threads), opt);
+  do {
+    mb.addBatch(B);
+  } while (next(B));
+  return mb.centers();
+}
+/* SAM_LISTING_END_2 */
@@ -12,26 +12,20 @@
 
 #include <Eigen/Dense>
 
+#include "kmeans.hpp"
+
 using namespace std;
 using namespace Eigen;
 
 /* SAM_LISTING_BEGIN_0 */
 template <class Derived>
 std::tuple<double, VectorXi, VectorXd> distcomp(const MatrixXd & X, const MatrixBase<Derived> & C){
-  // Compute squared distances
-  // d.row(j) = squared distances from all points in X to cluster j
-  MatrixXd d(C.cols(), X.cols());
-  for(int j = 0; j < C.cols(); ++j){
-	  MatrixXd Dv = X - C.col(j).replicate(1, X.cols());
-	  d.row(j) = Dv.array().square().colwise().sum();
-  }
-  // Compute minimum distance point association and sum of minimal squared distances
-  VectorXi idx(d.cols());  VectorXd mx(d.cols());
-  for(int j = 0; j < d.cols(); ++j){
-	  // mx(j) tells the minimal squared distance of point j to the nearest cluster
-	  // idx(j) tells to which cluster point j belongs
-	  mx(j) = d.col(j).minCoeff(&idx(j));
-  }
+  // Compute squared distances of all points to their nearest cluster
+  // center, tile by tile with matrix products, see kmeans.hpp.
+  // mx(j) tells the minimal squared distance of point j to the nearest cluster
+  // idx(j) tells to which cluster point j belongs
+  VectorXi idx;  VectorXd mx;
+  kmeansAssign(X, C, idx, mx);
   double sumd = mx.sum();	// sum of all squared distances
   // Computer sum of squared distances within each cluster
   VectorXd cds(C.cols()); cds.setZero();
@@ -80,6 +74,6 @@ void lloydmax(const MatrixXd & X, MatrixBase<Derived> & C, VectorXi & idx, Vecto
 // such as C.leftCols(nc) to be passed by reference (\cpp 11 feature)
 template <class Derived>
 void lloydmax(const MatrixXd & X, MatrixBase<Derived> && C, VectorXi & idx, VectorXd & cds, const double tol = 0.0001){
-	lloydmax(X, C, idx, cds);
+	lloydmax(X, C, idx, cds, tol);
 }
 /* SAM_LISTING_END_0 */
@@ -6,24 +6,90 @@
 /// Do not remove this header.
 //////////////////////////////////////////////////////////////////////////
 
+#include <chrono>
+#include <cstdlib>
+#include <iomanip>
 #include <iostream>
+#include <random>
 
 #include <Eigen/Dense>
 
 #include "lloydmax.hpp"
+#include "kmeans.hpp"
 
+template <class Action>
+double timeit(Action &&a) {
+	const auto start = std::chrono::high_resolution_clock::now();
+	a();
+	const auto end = std::chrono::high_resolution_clock::now();
+	return std::chrono::duration<double>(end - start).count();
+}
+
+void report(const char *name, double t, const KMeansResult &r) {
+	std::cout << name << t << " s, " << r.iterations << " iterations, "
+		<< r.distance_evals << " distances, sum of squared distances "
+		<< r.sumd << std::endl;
+}
 
-int main () {
+int main (int argc, char **argv) {
 	Eigen::MatrixXd X(2,5);
 	X 	<<	10,	2,	3,	4,	5,
 			2,	4,	8,	1,	25;
-	Eigen::MatrixXd C(2,3);
+	Eigen::MatrixXd C = X.leftCols(3);	// initial centers
 	Eigen::VectorXi idx;
 	Eigen::VectorXd cds;
 	double tol = 1e-5;
 	
 	lloydmax(X, C, idx, cds, tol);
 	std::cout << C << std::endl << idx << std::endl;
-	
+
+	// N points in R^8 around k random centers
+	const int N = argc > 1 ? std::atoi(argv[1]) : 200000;
+	const int d = 8, k = 64;
+	std::mt19937 gen(17);
+	std::normal_distribution<double> N01;
+	const Eigen::MatrixXd M = 10 * Eigen::MatrixXd::NullaryExpr(d, k,
+		[&]() { return N01(gen); });
+	Eigen::MatrixXd P(d, N);
+	std::uniform_int_distribution<int> cl(0, k-1);
+	for(int i = 0; i < N; ++i)
+		P.col(i) = M.col(cl(gen)) + Eigen::VectorXd::NullaryExpr(d,
+			[&]() { return 2 * N01(gen); });
+	std::cout << std::setprecision(3) << std::scientific
+		<< N << " points, " << k << " clusters" << std::endl;
+
+	// lloydmax() with random initial centers
+	Eigen::MatrixXd C0 = P.leftCols(k);
+	C = C0;
+	double t = timeit([&] { lloydmax(P, C, idx, cds, 1e-6); });
+	std::cout << "lloydmax, random centers: " << t << " s, sum of squared "
+		<< "distances " << cds.sum() << std::endl;
+	t = timeit([&] { C0 = kmeansPlusPlus(P, k); });
+	std::cout << "k-means++ seeding:         " << t << " s" << std::endl;
+	KMeansOptions opt;
+	KMeansResult r;
+	for(auto pr : {KMeansPruning::None, KMeansPruning::Hamerly,
+			KMeansPruning::Elkan}){
+		opt.pruning = pr;
+		t = timeit([&] { r = kmeans(P, C0, opt); });
+		report(pr == KMeansPruning::None ? "k-means, no pruning: " :
+			pr == KMeansPruning::Hamerly ? "k-means, Hamerly:    " :
+			"k-means, Elkan:      ", t, r);
+	}
+
+	// Mini-batches of 10000 points, e.g. read from a file
+	int pos = 0;
+	auto batches = [&](Eigen::MatrixXd &B) {
+		if(pos >= N) return false;
+		const int b = std::min(10000, N - pos);
+		B = P.middleCols(pos, b);
+		pos += b;
+		return true;
+	};
+	t = timeit([&] { C = miniBatchKMeans(batches, k); });
+	Eigen::VectorXd mx;
+	kmeansAssign(P, C, idx, mx);
+	std::cout << "mini-batch, one pass:      " << t << " s, sum of squared "
+		<< "distances " << mx.sum() << std::endl;
 	return 0;
 }
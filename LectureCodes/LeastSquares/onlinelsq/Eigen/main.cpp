@@ -0,0 +1,139 @@
+#include <libgen.h>
+
+#include <Eigen/Dense>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <string>
+
+#include "onlinelsq.hpp"
+#include "polyfit.hpp"
+
+template <class Action>
+double timeit(Action &&a) {
+  const auto start = std::chrono::high_resolution_clock::now();
+  a();
+  const auto end = std::chrono::high_resolution_clock::now();
+  return std::chrono::duration<double>(end - start).count();
+}
+
+// Basis functions of the linear data fit (cf. LinearDataFit)
+Eigen::MatrixXd makeA(const Eigen::VectorXd &t) {
+  Eigen::MatrixXd A(t.size(), 4);
+  A.col(0) = t.cwiseInverse();
+  A.col(1) = t.cwiseInverse().cwiseAbs2();
+  A.col(2) = (1.0 - t.array()).exp();
+  A.col(3) = (2.0 - 2.0 * t.array()).exp();
+  return A;
+}
+
+int main(int argc, char **argv) {
+  std::cout << std::setprecision(3) << std::scientific;
+  const std::string dir = dirname(argv[0]);
+  const Eigen::Vector4d gamma(1.0, -0.5, 2.0, 0.25);
+  std::mt19937 gen(7);
+  std::uniform_real_distribution<double> tdist(0.5, 4.0);
+  std::normal_distribution<double> noise(0.0, 1e-3);
+
+  // Write 10^5 samples (t, y) to a CSV file and 10^6 to a binary file
+  const std::string csv = dir + "/samples.csv", bin = dir + "/samples.bin";
+  Eigen::VectorXd t(100000), y;
+  for (Eigen::Index i = 0; i < t.size(); ++i) t(i) = tdist(gen);
+  y = makeA(t) * gamma;
+  for (Eigen::Index i = 0; i < y.size(); ++i) y(i) += noise(gen);
+  {
+    std::ofstream out(csv);
+    out << "# t, y\n" << std::setprecision(17);
+    for (Eigen::Index i = 0; i < t.size(); ++i) {
+      out << t(i) << ", " << y(i) << "\n";
+    }
+  }
+  const Eigen::Index Nbin = 1000000;
+  {
+    std::ofstream out(bin, std::ios::binary);
+    for (Eigen::Index i = 0; i < Nbin; ++i) {
+      Eigen::Vector2d row;
+      row(0) = tdist(gen);
+      row(1) = (makeA(row.head(1)) * gamma)(0) + noise(gen);
+      out.write(reinterpret_cast<const char *>(row.data()), sizeof(row));
+    }
+  }
+
+  // Streaming fits of the CSV data vs. fits with the full matrix in memory
+  auto fitFile = [](auto &&next, NormalEquationsAccumulator &ne,
+                    OnlineQR &qr) {
+    Eigen::MatrixXd B, E;
+    while (next(B)) {
+      E.resize(B.rows(), 5);
+      E << makeA(B.col(0)), B.col(1);
+      ne.addRows(E);
+      qr.addRows(E);
+    }
+  };
+  NormalEquationsAccumulator ne(4);
+  OnlineQR qr(4);
+  fitFile(CsvChunkReader(csv, 2), ne, qr);
+  const Eigen::MatrixXd A = makeA(t);
+  const Eigen::VectorXd g0 = A.colPivHouseholderQr().solve(y);
+  std::cout << "CSV, " << ne.rowsSeen() << " samples\n"
+            << "  in memory (QR):     " << g0.transpose() << "\n"
+            << "  normal equations:   |g - g0| = "
+            << (ne.solve() - g0).norm() << "\n"
+            << "  QR updating:        |g - g0| = " << (qr.solve() - g0).norm()
+            << ", residual " << qr.residualNorm() << " vs "
+            << (A * g0 - y).norm() << "\n";
+
+  NormalEquationsAccumulator ne2(4);
+  OnlineQR qr2(4);
+  const double tb =
+      timeit([&] { fitFile(BinaryChunkReader(bin, 2), ne2, qr2); });
+  std::cout << "binary, " << qr2.rowsSeen() << " samples: " << tb
+            << " s\n  normal equations:   " << ne2.solve().transpose()
+            << "\n  QR updating:        " << qr2.solve().transpose() << "\n";
+
+  // polyfit of the same data, degree 6
+  std::cout << "\npolyfit, degree 6: |p - p_stream| = "
+            << (polyfit(t, y, 6) - polyfitStream(CsvChunkReader(csv, 2), 6))
+                   .norm()
+            << "\n";
+
+  // Sliding window of the last W samples of a signal with drifting
+  // coefficients: every step adds one row (Givens) and removes the oldest
+  // one (downdating)
+  const Eigen::Index W = 2000, steps = 20000;
+  OnlineQR win(4);
+  Eigen::MatrixXd E(steps, 5);
+  for (Eigen::Index i = 0; i < steps; ++i) {
+    const Eigen::VectorXd ti = Eigen::VectorXd::Constant(1, tdist(gen));
+    const Eigen::Vector4d gi = gamma * (1.0 + 1e-4 * i);
+    E.row(i) << makeA(ti), (makeA(ti) * gi)(0) + noise(gen);
+  }
+  unsigned int failures = 0;
+  const double ts = timeit([&] {
+    for (Eigen::Index i = 0; i < steps; ++i) {
+      win.addRow(E.row(i).head(4).transpose(), E(i, 4));
+      if (i >= W && !win.removeRow(E.row(i - W).head(4).transpose(),
+                                   E(i - W, 4))) {
+        ++failures;
+      }
+    }
+  });
+  const Eigen::VectorXd gw =
+      E.bottomRows(W).leftCols(4).colPivHouseholderQr().solve(
+          E.bottomRows(W).col(4));
+  std::cout << "\nsliding window of " << W << " samples, " << steps
+            << " updates/downdates: " << ts << " s, " << failures
+            << " failures\n"
+            << "  |g - g_window| = " << (win.solve() - gw).norm()
+            << ", fitted drift factor "
+            << win.solve()(0) / gamma(0) << " (exact "
+            << 1.0 + 1e-4 * (steps - 1 - W / 2.0) << ")\n";
+
+  std::remove(csv.c_str());
+  std::remove(bin.c_str());
+  return 0;
+}
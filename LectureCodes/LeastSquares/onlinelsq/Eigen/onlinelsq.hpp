@@ -0,0 +1,280 @@
+#pragma once
+
+#include <Eigen/Dense>
+#include <Eigen/QR>
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <cstdlib>
+#include <fstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+/* Online linear least squares for data that do not fit into memory: the
+ * rows [a_i^T, b_i] of the extended matrix [A, b] are fed in blocks or one
+ * by one, only O(n^2) numbers are stored.
+ * - NormalEquationsAccumulator: A^T A, A^T b and b^T b (cf. normeqsolve()),
+ *   blocks enter as rank-k updates, the running sums are compensated.
+ * - OnlineQR: R-factor of [A, b] (cf. qrlsqsolve()), updated by Householder
+ *   (blocks) or Givens rotations (single rows) and downdated by the LINPACK
+ *   algorithm, which gives sliding-window fits.
+ * - CsvChunkReader, BinaryChunkReader: blocks of rows from files.
+ * The readers have the interface bool next(Eigen::MatrixXd &B) (false at
+ * the end of the data) also used by tsqrStream(). */
+
+/* SAM_LISTING_BEGIN_0 */
+class NormalEquationsAccumulator {
+ public:
+  explicit NormalEquationsAccumulator(Eigen::Index n = 0)
+      : S_(Eigen::MatrixXd::Zero(n + 1, n + 1)),
+        C_(Eigen::MatrixXd::Zero(n + 1, n + 1)) {}
+
+  Eigen::Index cols() const { return S_.cols() - 1; }
+  Eigen::Index rowsSeen() const { return rows_; }
+
+  // Rows of the extended matrix B = [A_block, b_block]
+  void addRows(const Eigen::Ref<const Eigen::MatrixXd> &B) {
+    assert(B.cols() == S_.cols());
+    Eigen::MatrixXd P = Eigen::MatrixXd::Zero(S_.rows(), S_.cols());
+    P.selfadjointView<Eigen::Lower>().rankUpdate(B.transpose());
+    add(P);
+    rows_ += B.rows();
+  }
+  void addRows(const Eigen::Ref<const Eigen::MatrixXd> &A,
+               const Eigen::Ref<const Eigen::VectorXd> &b) {
+    Eigen::MatrixXd B(A.rows(), A.cols() + 1);
+    B << A, b;
+    addRows(B);
+  }
+
+  // Sums of disjoint row sets
+  void merge(const NormalEquationsAccumulator &other) {
+    add(other.S_);
+    add(other.C_);
+    rows_ += other.rows_;
+  }
+
+  // A^T A and A^T b
+  Eigen::MatrixXd gram() const {
+    const Eigen::Index n = cols();
+    return sum().topLeftCorner(n, n).selfadjointView<Eigen::Lower>();
+  }
+  Eigen::VectorXd rhs() const {
+    return sum().row(cols()).head(cols()).transpose();
+  }
+
+  // Least squares solution by Cholesky decomposition of A^T A
+  Eigen::VectorXd solve() const { return gram().llt().solve(rhs()); }
+
+  // ||Ax - b||^2 = x^T A^T A x - 2 x^T A^T b + b^T b (suffers from
+  // cancellation if the residual is small)
+  double residualNorm(const Eigen::VectorXd &x) const {
+    const double r2 =
+        x.dot(gram() * x) - 2 * x.dot(rhs()) + sum()(cols(), cols());
+    return std::sqrt(std::max(r2, 0.0));
+  }
+
+ private:
+  // Neumaier's variant of Kahan summation, entrywise in the lower triangle
+  void add(const Eigen::MatrixXd &P) {
+    const Eigen::ArrayXXd t = S_.array() + P.array();
+    C_.array() += (S_.array().abs() >= P.array().abs())
+                      .select((S_.array() - t) + P.array(),
+                              (P.array() - t) + S_.array());
+    S_ = t.matrix();
+  }
+  Eigen::MatrixXd sum() const {
+    return (S_ + C_).triangularView<Eigen::Lower>();
+  }
+
+  Eigen::MatrixXd S_, C_;  // running sum and compensation
+  Eigen::Index rows_ = 0;
+};
+/* SAM_LISTING_END_0 */
+
+/* SAM_LISTING_BEGIN_1 */
+// Upper triangular R in R^{n+1,n+1} with R^T R = [A, b]^T [A, b]
+class OnlineQR {
+ public:
+  explicit OnlineQR(Eigen::Index n = 0)
+      : R_(Eigen::MatrixXd::Zero(n + 1, n + 1)) {}
+
+  Eigen::Index cols() const { return R_.cols() - 1; }
+  Eigen::Index rowsSeen() const { return rows_; }
+  const Eigen::MatrixXd &matrixR() const { return R_; }
+
+  // Block of rows of [A, b]: Householder QR of [R; B]
+  void addRows(const Eigen::Ref<const Eigen::MatrixXd> &B) {
+    assert(B.cols() == R_.cols());
+    if (B.rows() == 0) return;
+    const Eigen::Index k = R_.rows();
+    Eigen::MatrixXd S(k + B.rows(), k);
+    S << R_, B;
+    Eigen::HouseholderQR<Eigen::MatrixXd> qr(S);
+    R_ = qr.matrixQR().topRows(k).triangularView<Eigen::Upper>();
+    rows_ += B.rows();
+  }
+
+  // Single row [a^T, beta]: k Givens rotations annihilate it against R
+  void addRow(const Eigen::VectorXd &a, double beta) {
+    Eigen::VectorXd z(R_.cols());
+    z << a, beta;
+    const Eigen::Index k = R_.rows();
+    for (Eigen::Index i = 0; i < k; ++i) {
+      if (z(i) == 0.0) continue;
+      const double r = std::hypot(R_(i, i), z(i));
+      const double c = R_(i, i) / r, s = z(i) / r;
+      for (Eigen::Index j = i; j < k; ++j) {
+        const double t = c * R_(i, j) + s * z(j);
+        z(j) = c * z(j) - s * R_(i, j);
+        R_(i, j) = t;
+      }
+    }
+    ++rows_;
+  }
+
+  // Removes a row [a^T, beta] that has been added before: R^T R - z z^T
+  // (LINPACK dchdd). Solves R^T p = z and applies the rotations that
+  // annihilate p against sqrt(1 - |p|^2). Returns false (and leaves R
+  // unchanged) if the downdated matrix would not be positive definite.
+  bool removeRow(const Eigen::VectorXd &a, double beta) {
+    const Eigen::Index k = R_.rows();
+    Eigen::VectorXd p(k);
+    p << a, beta;
+    R_.triangularView<Eigen::Upper>().transpose().solveInPlace(p);
+    const double norm2 = p.squaredNorm();
+    if (!(norm2 < 1.0)) return false;
+    Eigen::VectorXd c(k), s(k);
+    double alpha = std::sqrt(1.0 - norm2);
+    for (Eigen::Index i = k - 1; i >= 0; --i) {
+      const double scale = alpha + std::abs(p(i));
+      const double ai = alpha / scale, bi = p(i) / scale;
+      const double r = std::sqrt(ai * ai + bi * bi);
+      c(i) = ai / r;
+      s(i) = bi / r;
+      alpha = scale * r;
+    }
+    for (Eigen::Index j = 0; j < k; ++j) {
+      double xx = 0.0;
+      for (Eigen::Index i = j; i >= 0; --i) {
+        const double t = c(i) * xx + s(i) * R_(i, j);
+        R_(i, j) = c(i) * R_(i, j) - s(i) * xx;
+        xx = t;
+      }
+    }
+    --rows_;
+    return true;
+  }
+
+  // x = R(0:n-1,0:n-1)^{-1} R(0:n-1,n), residual norm |R(n,n)|
+  Eigen::VectorXd solve() const {
+    const Eigen::Index n = cols();
+    return R_.topLeftCorner(n, n).triangularView<Eigen::Upper>().solve(
+        R_.col(n).head(n));
+  }
+  double residualNorm() const { return std::abs(R_(cols(), cols())); }
+
+ private:
+  Eigen::MatrixXd R_;
+  Eigen::Index rows_ = 0;
+};
+/* SAM_LISTING_END_1 */
+
+/* SAM_LISTING_BEGIN_2 */
+// Blocks of at most `rows` lines of a text file with `cols` numbers per
+// line, separated by commas, semicolons or white space. Empty lines and
+// lines starting with '#' are skipped, as are the first `skip` lines
+// (header). Throws std::runtime_error for malformed lines.
+class CsvChunkReader {
+ public:
+  CsvChunkReader(const std::string &path, Eigen::Index cols,
+                 Eigen::Index rows = 4096, unsigned int skip = 0)
+      : in_(path), cols_(cols), rows_(rows) {
+    if (!in_) throw std::runtime_error("Cannot open " + path);
+    std::string line;
+    for (unsigned int i = 0; i < skip && std::getline(in_, line); ++i) {
+      ++lineno_;
+    }
+  }
+
+  bool operator()(Eigen::MatrixXd &B) {
+    B.resize(rows_, cols_);
+    Eigen::Index r = 0;
+    std::string line;
+    while (r < rows_ && std::getline(in_, line)) {
+      ++lineno_;
+      const char *s = line.c_str();
+      while (*s == ' ' || *s == '\t') ++s;
+      if (*s == '\0' || *s == '#' || *s == '\r') continue;
+      for (Eigen::Index j = 0; j < cols_; ++j) {
+        char *end;
+        B(r, j) = std::strtod(s, &end);
+        if (end == s) {
+          throw std::runtime_error("Malformed line " +
+                                   std::to_string(lineno_));
+        }
+        s = end;
+        while (*s == ',' || *s == ';' || *s == ' ' || *s == '\t') ++s;
+      }
+      ++r;
+    }
+    B.conservativeResize(r, cols_);
+    return r > 0;
+  }
+
+ private:
+  std::ifstream in_;
+  Eigen::Index cols_, rows_;
+  std::size_t lineno_ = 0;
+};
+
+// Blocks of at most `rows` rows of a binary file of doubles stored row by
+// row (native byte order), `cols` numbers per row
+class BinaryChunkReader {
+ public:
+  BinaryChunkReader(const std::string &path, Eigen::Index cols,
+                    Eigen::Index rows = 65536)
+      : in_(path, std::ios::binary), cols_(cols), rows_(rows),
+        buf_(rows * cols) {
+    if (!in_) throw std::runtime_error("Cannot open " + path);
+  }
+
+  bool operator()(Eigen::MatrixXd &B) {
+    in_.read(reinterpret_cast<char *>(buf_.data()),
+             static_cast<std::streamsize>(buf_.size() * sizeof(double)));
+    const Eigen::Index r = in_.gcount() / (cols_ * sizeof(double));
+    B = Eigen::Map<const Eigen::Matrix<double, Eigen::Dynamic, Eigen::Dynamic,
+                                       Eigen::RowMajor>>(buf_.data(), r,
+                                                         cols_);
+    return r > 0;
+  }
+
+ private:
+  std::ifstream in_;
+  Eigen::Index cols_, rows_;
+  std::vector<double> buf_;
+};
+/* SAM_LISTING_END_2 */
+
+/* SAM_LISTING_BEGIN_3 */
+// Polynomial least squares fit of degree d to data points (t_i, y_i)
+// delivered in blocks [t, y] by next() (cf. polyfit()). The Vandermonde
+// blocks are formed on the fly, memory O(d^2). Coefficients are returned
+// highest degree first, as by polyfit().
+template <class BlockReader>
+Eigen::VectorXd polyfitStream(BlockReader &&next, unsigned int d) {
+  OnlineQR qr(d + 1);
+  Eigen::MatrixXd B, V;
+  while (next(B)) {
+    V.resize(B.rows(), d + 2);
+    V.col(0).setOnes();
+    for (unsigned int j = 1; j <= d; ++j) {
+      V.col(j) = V.col(j - 1).cwiseProduct(B.col(0));
+    }
+    V.col(d + 1) = B.col(1);
+    qr.addRows(V);
+  }
+  return qr.solve().reverse();
+}
+/* SAM_LISTING_END_3 */
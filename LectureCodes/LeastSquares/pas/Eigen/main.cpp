@@ -6,19 +6,94 @@
 /// Do not remove this header.
 //////////////////////////////////////////////////////////////////////////
 
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <iomanip>
 #include <iostream>
+#include <random>
 
 #include <Eigen/Dense>
 
 #include "pas.hpp"
+#include "pcatree.hpp"
 
+template <class Action>
+double timeit(Action &&a) {
+	const auto start = std::chrono::high_resolution_clock::now();
+	a();
+	const auto end = std::chrono::high_resolution_clock::now();
+	return std::chrono::duration<double>(end - start).count();
+}
+
+// Recursive principal axis separation on copies of the points with
+// princaxissep(), for comparison; returns the number of leaves
+int pasRecursive(const MatrixXd & X, Eigen::Index leaf_size){
+	if(X.cols() <= leaf_size) return 1;
+	VectorXi i1, i2;
+	std::tie(i1, i2) = princaxissep(X);
+	if(i1.size() == 0 || i2.size() == 0) return 1;
+	MatrixXd X1(X.rows(), i1.size()), X2(X.rows(), i2.size());
+	for(int i = 0; i < i1.size(); ++i) X1.col(i) = X.col(i1(i));
+	for(int i = 0; i < i2.size(); ++i) X2.col(i) = X.col(i2(i));
+	return pasRecursive(X1, leaf_size) + pasRecursive(X2, leaf_size);
+}
 
-int main () {
+int main (int argc, char **argv) {
 	Eigen::MatrixXd X(2,5);
 	X 	<<	10,	2,	3,	4,	5,
 			2,	4,	8,	1,	25;
 	Eigen::VectorXi i1, i2;
 	std::tie(i1, i2) = princaxissep(X);
 	std::cout << i1 << std::endl << std::endl << i2 << std::endl;
+
+	// PCA tree of N points in R^8 around 64 random centers
+	const int N = argc > 1 ? std::atoi(argv[1]) : 1000000;
+	const int d = 8;
+	std::mt19937 gen(17);
+	std::normal_distribution<double> N01;
+	const Eigen::MatrixXd M = 10 * Eigen::MatrixXd::NullaryExpr(d, 64,
+		[&]() { return N01(gen); });
+	Eigen::MatrixXd P(d, N);
+	std::uniform_int_distribution<int> cl(0, 63);
+	for(int i = 0; i < N; ++i)
+		P.col(i) = M.col(cl(gen)) + Eigen::VectorXd::NullaryExpr(d,
+			[&]() { return 2 * N01(gen); });
+	std::cout << std::setprecision(3) << std::scientific
+		<< N << " points in R^" << d << std::endl;
+	PcaTreeOptions opt;
+	opt.leaf_size = std::max(1, N / 1000);
+	int leaves = 0;
+	double t = timeit([&] { leaves = pasRecursive(P, opt.leaf_size); });
+	std::cout << "princaxissep on copies: " << t << " s, " << leaves
+		<< " leaves" << std::endl;
+	PcaTree tree;
+	t = timeit([&] { tree.build(P, opt); });
+	std::cout << "PCA tree:               " << t << " s, " << tree.numLeaves()
+		<< " leaves, " << tree.nodes().size() << " nodes" << std::endl;
+
+	// nearest leaf centers of query points: tree vs. all centers
+	const Eigen::MatrixXd C = tree.leafCenters();
+	const int Q = std::min(N, 100000);
+	const Eigen::MatrixXd Xq = P.leftCols(Q) + Eigen::MatrixXd::NullaryExpr(
+		d, Q, [&]() { return N01(gen); });
+	Eigen::VectorXi brute(Q), nearest(Q), descent(Q);
+	t = timeit([&] {
+		for(int i = 0; i < Q; ++i)
+			(C.colwise() - Xq.col(i)).colwise().squaredNorm().minCoeff(&brute(i));
+	});
+	std::cout << "nearest center, all centers: " << t << " s" << std::endl;
+	t = timeit([&] {
+		for(int i = 0; i < Q; ++i) nearest(i) = tree.nearestLeaf(Xq.col(i));
+	});
+	std::cout << "nearest center, tree:        " << t << " s, "
+		<< (nearest.array() == brute.array()).count() << " of " << Q
+		<< " equal" << std::endl;
+	t = timeit([&] {
+		for(int i = 0; i < Q; ++i) descent(i) = tree.leafOf(Xq.col(i));
+	});
+	std::cout << "descent to a leaf:           " << t << " s, "
+		<< (descent.array() == brute.array()).count() << " of " << Q
+		<< " equal" << std::endl;
 	return 0;
 }
@@ -0,0 +1,314 @@
+#pragma once
+
+#include <Eigen/Dense>
+#include <algorithm>
+#include <cmath>
+#include <deque>
+#include <limits>
+#include <random>
+#include <utility>
+#include <vector>
+
+#include "parallel.hpp"
+
+/* PCA tree: recursive principal axis separation, cf. princaxissep(), of the
+ * points given by the columns of X in R^{d,N}. A node holds the points
+ * perm(begin), ..., perm(end-1); it is split by the hyperplane through
+ * their center of gravity g orthogonal to their major principal axis a,
+ * and the split only reorders this range of perm, the points are never
+ * copied. The axis is computed by the power iteration
+ *   w = sum_i (x_i - g) (x_i - g)^T v,   v <- w / ||w||,
+ * i.e. with the covariance matrix applied implicitly, one pass over the
+ * points of the node per step, O(d) memory. For small d the d x d
+ * covariance matrix is accumulated in a single pass instead and the power
+ * iteration runs on it. Points are gathered in tiles of 256 so that the
+ * passes are matrix-vector (or rank-k update) operations.
+ * The top levels of the tree are split with parallel passes over the
+ * points, below them the subtrees are built in parallel. The nodes are
+ * stored in a flat array with their centers and axes in the columns of two
+ * matrices; the leaves are the clusters. */
+
+struct PcaTreeOptions {
+  Eigen::Index leaf_size = 64;         // no splitting of smaller nodes
+  unsigned int max_depth = 40;
+  unsigned int power_iterations = 30;  // max. steps per node
+  double tol = 1e-3;                   // on the change of the axis
+  Eigen::Index covariance_dim = 32;    // d x d covariance matrix up to this d
+  unsigned int num_threads = 0;        // 0 = number of hardware threads
+};
+
+class PcaTree {
+ public:
+  struct Node {
+    Eigen::Index begin, end;  // points perm(begin), ..., perm(end-1)
+    int left = -1, right = -1;  // children, -1 for a leaf
+    int leaf = -1;              // cluster number of a leaf
+    double offset = 0.0;  // left child: axis^T x >= offset, else right
+  };
+
+  PcaTree() = default;
+  explicit PcaTree(const Eigen::MatrixXd &X, const PcaTreeOptions &opt = {}) {
+    build(X, opt);
+  }
+  PcaTree &build(const Eigen::MatrixXd &X, const PcaTreeOptions &opt = {});
+
+  const std::vector<Node> &nodes() const { return nodes_; }
+  const Eigen::VectorXi &permutation() const { return perm_; }
+  // centers of gravity and unit principal axes of the nodes
+  const Eigen::MatrixXd &centers() const { return centers_; }
+  const Eigen::MatrixXd &axes() const { return axes_; }
+
+  Eigen::Index numLeaves() const { return leaves_.size(); }
+  Eigen::MatrixXd leafCenters() const;
+  // cluster number of every point
+  Eigen::VectorXi labels() const;
+  // leaf reached by descending the tree: O(depth d)
+  int leafOf(const Eigen::VectorXd &x) const;
+  // leaf with the nearest center, by branch and bound: the centers of a
+  // subtree lie in its half-space, so they are at least as far from x as
+  // the splitting hyperplane
+  int nearestLeaf(const Eigen::VectorXd &x, double *dist2 = nullptr) const;
+
+ private:
+  struct LocalNode {
+    Node node;
+    Eigen::VectorXd center, axis;
+  };
+  struct Range {
+    Eigen::Index begin, end;
+    unsigned int depth;
+    int parent;  // index in nodes, -1 for the root
+    bool left;
+  };
+
+  bool split(const Eigen::MatrixXd &X, const Range &r, LocalNode &ln,
+             Eigen::Index &mid, unsigned int num_threads);
+  void buildSubtree(const Eigen::MatrixXd &X, const Range &r,
+                    std::vector<LocalNode> &out);
+
+  PcaTreeOptions opt_;
+  std::vector<Node> nodes_;
+  Eigen::MatrixXd centers_, axes_;
+  Eigen::VectorXi perm_;
+  std::vector<int> leaves_;  // node index of every leaf
+};
+
+/* SAM_LISTING_BEGIN_0 */
+// Center and principal axis of the points of the range r, split of the
+// range, perm(begin..mid-1) on the positive side of the axis; false if the
+// node is a leaf
+inline bool PcaTree::split(const Eigen::MatrixXd &X, const Range &r,
+                           LocalNode &ln, Eigen::Index &mid,
+                           unsigned int num_threads) {
+  const Eigen::Index d = X.rows(), n = r.end - r.begin;
+  ln.node.begin = r.begin;
+  ln.node.end = r.end;
+  const unsigned int p = numThreadsFor(n, num_threads);
+  // sum of f(Y) over tiles Y of at most 256 points of the range, shifted
+  // by c and gathered into a small buffer, in parallel
+  auto sum = [&](auto &&f, const Eigen::VectorXd &c, Eigen::Index rows,
+                 Eigen::Index cols) {
+    std::vector<Eigen::MatrixXd> part(p, Eigen::MatrixXd::Zero(rows, cols));
+    parallelFor(
+        n,
+        [&](std::size_t b, std::size_t e, unsigned int tid) {
+          Eigen::MatrixXd Y(d, 256);
+          for (std::size_t i = r.begin + b; i < r.begin + e; i += 256) {
+            const Eigen::Index m = std::min<Eigen::Index>(256, r.begin + e - i);
+            for (Eigen::Index j = 0; j < m; ++j) {
+              Y.col(j) = X.col(perm_(i + j)) - c;
+            }
+            f(Y.leftCols(m), part[tid]);
+          }
+        },
+        p);
+    for (unsigned int t = 1; t < p; ++t) part[0] += part[t];
+    return part[0];
+  };
+  // center, and the covariance matrix for small d; the points are shifted
+  // by the first one against cancellation
+  const Eigen::VectorXd x0 = X.col(perm_(r.begin));
+  const bool explicitcov = d <= opt_.covariance_dim;
+  const Eigen::MatrixXd S = sum(
+      [&](const auto &Y, Eigen::MatrixXd &s) {
+        s.col(0) += Y.rowwise().sum();
+        if (explicitcov) s.rightCols(d).noalias() += Y * Y.transpose();
+      },
+      x0, d, explicitcov ? d + 1 : 1);
+  ln.center = x0 + S.col(0) / n;
+  ln.axis = Eigen::VectorXd::Zero(d);
+  if (n <= opt_.leaf_size || r.depth >= opt_.max_depth) return false;
+  const Eigen::VectorXd &g = ln.center;
+  Eigen::MatrixXd cov;
+  if (explicitcov) {
+    cov = S.rightCols(d) - S.col(0) * S.col(0).transpose() / n;
+  }
+  std::mt19937 gen(r.begin);
+  std::normal_distribution<double> N01;
+  Eigen::VectorXd v =
+      Eigen::VectorXd::NullaryExpr(d, [&]() { return N01(gen); });
+  v.normalize();
+  for (unsigned int k = 0; k < opt_.power_iterations; ++k) {
+    Eigen::VectorXd w;
+    if (explicitcov) {
+      w = cov * v;
+    } else {
+      w = sum(
+          [&](const auto &Y, Eigen::MatrixXd &s) {
+            s.noalias() += Y * (Y.transpose() * v);
+          },
+          g, d, 1);
+    }
+    const double lambda = w.norm();
+    if (lambda == 0.0) return false;  // all points coincide
+    w /= lambda;
+    const double change = (w - v).norm();
+    v = w;
+    if (change < opt_.tol) break;
+  }
+  ln.axis = v;
+  ln.node.offset = v.dot(g);
+  const double offset = ln.node.offset;
+  mid = std::partition(perm_.data() + r.begin, perm_.data() + r.end,
+                       [&](int i) { return v.dot(X.col(i)) >= offset; }) -
+        perm_.data();
+  return mid > r.begin && mid < r.end;
+}
+
+// Subtree of the range r in preorder, node indices relative to out
+inline void PcaTree::buildSubtree(const Eigen::MatrixXd &X, const Range &r,
+                                  std::vector<LocalNode> &out) {
+  const int me = out.size();
+  out.emplace_back();
+  Eigen::Index mid;
+  if (!split(X, r, out[me], mid, 1)) return;
+  out[me].node.left = out.size();
+  buildSubtree(X, {r.begin, mid, r.depth + 1, me, true}, out);
+  out[me].node.right = out.size();
+  buildSubtree(X, {mid, r.end, r.depth + 1, me, false}, out);
+}
+
+inline PcaTree &PcaTree::build(const Eigen::MatrixXd &X,
+                               const PcaTreeOptions &opt) {
+  opt_ = opt;
+  const Eigen::Index N = X.cols();
+  perm_ = Eigen::VectorXi::LinSpaced(N, 0, N - 1);
+  std::vector<LocalNode> top;
+  // top levels breadth first with parallel passes, until there are enough
+  // subtrees to keep the threads busy
+  const unsigned int p = numThreadsFor(N, opt.num_threads);
+  std::deque<Range> queue{{0, N, 0, -1, false}};
+  std::vector<Range> subtrees;
+  while (!queue.empty()) {
+    const Range r = queue.front();
+    queue.pop_front();
+    if (p > 1 && queue.size() + subtrees.size() >= 4 * p) {
+      subtrees.push_back(r);
+      continue;
+    }
+    const int me = top.size();
+    top.emplace_back();
+    if (r.parent >= 0) {
+      (r.left ? top[r.parent].node.left : top[r.parent].node.right) = me;
+    }
+    Eigen::Index mid;
+    if (split(X, r, top[me], mid, p)) {
+      queue.push_back({r.begin, mid, r.depth + 1, me, true});
+      queue.push_back({mid, r.end, r.depth + 1, me, false});
+    }
+  }
+  std::vector<std::vector<LocalNode>> sub(subtrees.size());
+  parallelFor(
+      subtrees.size(),
+      [&](std::size_t b, std::size_t e, unsigned int) {
+        for (std::size_t s = b; s < e; ++s) {
+          buildSubtree(X, subtrees[s], sub[s]);
+        }
+      },
+      p);
+  // splice the subtrees behind the top levels
+  for (std::size_t s = 0; s < subtrees.size(); ++s) {
+    const int offset = top.size();
+    const Range &r = subtrees[s];
+    (r.left ? top[r.parent].node.left : top[r.parent].node.right) = offset;
+    for (LocalNode &ln : sub[s]) {
+      if (ln.node.left >= 0) ln.node.left += offset;
+      if (ln.node.right >= 0) ln.node.right += offset;
+      top.push_back(std::move(ln));
+    }
+  }
+  // flat arrays
+  nodes_.resize(top.size());
+  centers_.resize(X.rows(), top.size());
+  axes_.resize(X.rows(), top.size());
+  leaves_.clear();
+  for (std::size_t k = 0; k < top.size(); ++k) {
+    nodes_[k] = top[k].node;
+    centers_.col(k) = top[k].center;
+    axes_.col(k) = top[k].axis;
+    if (nodes_[k].left < 0) {
+      nodes_[k].leaf = leaves_.size();
+      leaves_.push_back(k);
+    }
+  }
+  return *this;
+}
+/* SAM_LISTING_END_0 */
+
+inline Eigen::MatrixXd PcaTree::leafCenters() const {
+  Eigen::MatrixXd C(centers_.rows(), leaves_.size());
+  for (std::size_t l = 0; l < leaves_.size(); ++l) {
+    C.col(l) = centers_.col(leaves_[l]);
+  }
+  return C;
+}
+
+inline Eigen::VectorXi PcaTree::labels() const {
+  Eigen::VectorXi idx(perm_.size());
+  for (int k : leaves_) {
+    for (Eigen::Index i = nodes_[k].begin; i < nodes_[k].end; ++i) {
+      idx(perm_(i)) = nodes_[k].leaf;
+    }
+  }
+  return idx;
+}
+
+/* SAM_LISTING_BEGIN_1 */
+inline int PcaTree::leafOf(const Eigen::VectorXd &x) const {
+  int k = 0;
+  while (nodes_[k].left >= 0) {
+    k = axes_.col(k).dot(x) >= nodes_[k].offset ? nodes_[k].left
+                                                : nodes_[k].right;
+  }
+  return nodes_[k].leaf;
+}
+
+inline int PcaTree::nearestLeaf(const Eigen::VectorXd &x,
+                                double *dist2) const {
+  double best = std::numeric_limits<double>::infinity();
+  int leaf = -1;
+  // nodes to visit with a lower bound for the squared distance
+  std::vector<std::pair<int, double>> stack{{0, 0.0}};
+  while (!stack.empty()) {
+    const int k = stack.back().first;
+    const double bound = stack.back().second;
+    stack.pop_back();
+    if (bound >= best) continue;
+    const Node &nd = nodes_[k];
+    if (nd.left < 0) {
+      const double d2 = (x - centers_.col(k)).squaredNorm();
+      if (d2 < best) {
+        best = d2;
+        leaf = nd.leaf;
+      }
+      continue;
+    }
+    const double s = axes_.col(k).dot(x) - nd.offset;
+    // the far side first on the stack, the near side is visited first
+    stack.emplace_back(s >= 0 ? nd.right : nd.left, std::max(bound, s * s));
+    stack.emplace_back(s >= 0 ? nd.left : nd.right, bound);
+  }
+  if (dist2) *dist2 = best;
+  return leaf;
+}
+/* SAM_LISTING_END_1 */
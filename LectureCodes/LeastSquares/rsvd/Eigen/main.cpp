@@ -0,0 +1,110 @@
+#include <Eigen/Dense>
+#include <Eigen/SVD>
+#include <chrono>
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+
+#include "lsqsvd.hpp"
+#include "rsvd.hpp"
+
+template <class Action>
+double timeit(Action &&a) {
+  const auto start = std::chrono::high_resolution_clock::now();
+  a();
+  const auto end = std::chrono::high_resolution_clock::now();
+  return std::chrono::duration<double>(end - start).count();
+}
+
+// m x n test matrix with prescribed singular values s
+Eigen::MatrixXd testMatrix(Eigen::Index m, const Eigen::VectorXd &s) {
+  const Eigen::Index n = s.size();
+  const Eigen::MatrixXd U =
+      Eigen::HouseholderQR<Eigen::MatrixXd>(Eigen::MatrixXd::Random(m, n))
+          .householderQ() *
+      Eigen::MatrixXd::Identity(m, n);
+  const Eigen::MatrixXd V =
+      Eigen::HouseholderQR<Eigen::MatrixXd>(Eigen::MatrixXd::Random(n, n))
+          .householderQ();
+  return U * s.asDiagonal() * V.transpose();
+}
+
+// Reader delivering A in blocks of 100 rows, cf. singlePassSVD()
+auto rowBlocks(const Eigen::MatrixXd &A) {
+  return [&A, pos = Eigen::Index(0)](Eigen::MatrixXd &B) mutable {
+    if (pos >= A.rows()) return false;
+    const Eigen::Index r = std::min<Eigen::Index>(100, A.rows() - pos);
+    B = A.middleRows(pos, r);
+    pos += r;
+    return true;
+  };
+}
+
+int main(int argc, char **argv) {
+  std::cout << std::setprecision(3) << std::scientific;
+  const Eigen::Index m = argc > 1 ? std::atol(argv[1]) : 600;
+  const Eigen::Index n = m / 2, k = 20;
+  // slowly decaying singular values 1/j
+  const Eigen::VectorXd s =
+      Eigen::VectorXd::LinSpaced(n, 1, n).cwiseInverse();
+  const Eigen::MatrixXd A = testMatrix(m, s);
+  // error of the best rank-k approximation (Eckart-Young)
+  const double best = s.tail(n - k).norm();
+  std::cout << "A: " << m << " x " << n << ", rank " << k
+            << ", best error ||A - A_k||_F = " << best << "\n";
+
+  Eigen::MatrixXd Ak;
+  const double tj = timeit([&] { Ak = lowrankbestapprox(A, k); });
+  std::cout << "JacobiSVD:             " << tj
+            << " s, error/best = " << (A - Ak).norm() / best << "\n";
+  const double tb = timeit([&] {
+    const Eigen::BDCSVD<Eigen::MatrixXd> svd(
+        A, Eigen::ComputeThinU | Eigen::ComputeThinV);
+    Ak = svd.matrixU().leftCols(k) *
+         svd.singularValues().head(k).asDiagonal() *
+         svd.matrixV().leftCols(k).transpose();
+  });
+  std::cout << "BDCSVD:                " << tb
+            << " s, error/best = " << (A - Ak).norm() / best << "\n";
+
+  // Power iterations are needed for slowly decaying singular values
+  for (unsigned int q : {0, 1, 2}) {
+    RsvdOptions opt;
+    opt.power_iterations = q;
+    LowRankSVD usv;
+    const double t = timeit([&] { usv = randomizedSVD(A, k, opt); });
+    std::cout << "randomized, q = " << q << ":   " << t
+              << " s, error/best = " << (A - usv.matrix()).norm() / best
+              << "\n";
+  }
+
+  // Adaptive rank for a relative tolerance
+  for (double tol : {1e-1, 1e-2}) {
+    LowRankSVD usv;
+    const double t =
+        timeit([&] { usv = adaptiveRandomizedSVD(A, tol, 10); });
+    std::cout << "adaptive, tol = " << tol << ": " << t << " s, rank "
+              << usv.rank() << ", relative error "
+              << (A - usv.matrix()).norm() / A.norm() << "\n";
+  }
+
+  // Single pass over blocks of rows
+  LowRankSVD usv;
+  const double t = timeit([&] { usv = singlePassSVD(rowBlocks(A), n, k); });
+  std::cout << "single pass:           " << t
+            << " s, error/best = " << (A - usv.matrix()).norm() / best
+            << "\n";
+
+  // Rapidly decaying singular values: a single pass is as good as the SVD
+  const Eigen::VectorXd s2 = Eigen::VectorXd::LinSpaced(n, 0, n - 1)
+                                 .unaryExpr([](double j) {
+                                   return std::exp(-j / 4.0);
+                                 });
+  const Eigen::MatrixXd A2 = testMatrix(m, s2);
+  usv = singlePassSVD(rowBlocks(A2), n, k);
+  std::cout << "exp(-j/4), single pass: error/best = "
+            << (A2 - usv.matrix()).norm() / s2.tail(n - k).norm() << "\n";
+  return 0;
+}
@@ -0,0 +1,193 @@
+#pragma once
+
+#include <Eigen/Dense>
+#include <Eigen/QR>
+#include <Eigen/SVD>
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <cstdint>
+#include <random>
+#include <vector>
+
+/* Randomized low-rank approximation A ~ U diag(S) V^T of A in R^{m,n}
+ * [Halko, Martinsson, Tropp, SIAM Rev. 53 (2011)]: the range of A is
+ * sampled by Y = A Omega with a Gaussian n x l matrix Omega, and only the
+ * small matrix Q^T A, Q an orthonormal basis of Y, is decomposed by an SVD.
+ * Cost O(mnl) instead of O(mn min(m,n)) for lowrankbestapprox().
+ * - randomizedSVD(): fixed rank k, oversampling p, q power iterations
+ *   (A A^T)^q A Omega for slowly decaying singular values,
+ * - adaptiveRandomizedSVD(): blocked range finder that stops when the
+ *   relative Frobenius error drops below a tolerance,
+ * - singlePassSVD(): A is delivered once, by blocks of rows; it is sketched
+ *   from both sides and never stored.
+ * A may be any matrix type supporting products with dense matrices and
+ * transpose(), e.g. Eigen::SparseMatrix. */
+
+struct RsvdOptions {
+  unsigned int oversampling = 10;     // p: l = k + p samples
+  unsigned int power_iterations = 2;  // q
+  std::uint64_t seed = 42;
+};
+
+struct LowRankSVD {
+  Eigen::MatrixXd U;
+  Eigen::VectorXd S;
+  Eigen::MatrixXd V;
+
+  Eigen::Index rank() const { return S.size(); }
+  Eigen::MatrixXd matrix() const {
+    return U * S.asDiagonal() * V.transpose();
+  }
+};
+
+namespace rsvd_detail {
+inline Eigen::MatrixXd gaussian(Eigen::Index m, Eigen::Index n,
+                                std::mt19937_64 &gen) {
+  std::normal_distribution<double> N01;
+  return Eigen::MatrixXd::NullaryExpr(m, n, [&]() { return N01(gen); });
+}
+
+// Orthonormal basis of the columns of Y (thin Q of a QR decomposition)
+inline Eigen::MatrixXd orth(const Eigen::MatrixXd &Y) {
+  const Eigen::HouseholderQR<Eigen::MatrixXd> qr(Y);
+  return qr.householderQ() *
+         Eigen::MatrixXd::Identity(Y.rows(), std::min(Y.rows(), Y.cols()));
+}
+
+// U diag(S) V^T from A ~ Q B with an SVD of the small matrix B, truncated
+// to rank k
+inline LowRankSVD svdOfQB(const Eigen::MatrixXd &Q, const Eigen::MatrixXd &B,
+                          Eigen::Index k) {
+  const Eigen::BDCSVD<Eigen::MatrixXd> svd(
+      B, Eigen::ComputeThinU | Eigen::ComputeThinV);
+  k = std::min<Eigen::Index>(k, svd.singularValues().size());
+  return {Q * svd.matrixU().leftCols(k), svd.singularValues().head(k),
+          svd.matrixV().leftCols(k)};
+}
+}  // namespace rsvd_detail
+
+/* SAM_LISTING_BEGIN_0 */
+// Orthonormal Q in R^{m,l} with A ~ Q Q^T A: power iterations with
+// re-orthonormalization after every product to keep the small singular
+// values from being swamped by round-off
+template <class Matrix>
+Eigen::MatrixXd randomizedRangeFinder(const Matrix &A, Eigen::Index l,
+                                      unsigned int q, std::mt19937_64 &gen) {
+  using rsvd_detail::orth;
+  Eigen::MatrixXd Q = orth(A * rsvd_detail::gaussian(A.cols(), l, gen));
+  for (unsigned int i = 0; i < q; ++i) {
+    const Eigen::MatrixXd Z = orth(A.transpose() * Q);
+    Q = orth(A * Z);
+  }
+  return Q;
+}
+
+template <class Matrix>
+LowRankSVD randomizedSVD(const Matrix &A, Eigen::Index k,
+                         const RsvdOptions &opt = {}) {
+  std::mt19937_64 gen(opt.seed);
+  const Eigen::Index l = std::min<Eigen::Index>(
+      k + opt.oversampling, std::min(A.rows(), A.cols()));
+  const Eigen::MatrixXd Q =
+      randomizedRangeFinder(A, l, opt.power_iterations, gen);
+  // B = Q^T A, computed as (A^T Q)^T for sparse A
+  const Eigen::MatrixXd B = (A.transpose() * Q).transpose();
+  return rsvd_detail::svdOfQB(Q, B, k);
+}
+/* SAM_LISTING_END_0 */
+
+/* SAM_LISTING_BEGIN_1 */
+// Rank adapted to the relative tolerance tol: ||A - U S V^T||_F <= tol
+// ||A||_F (up to round-off, tol should exceed about 1e-7). Blocks of b
+// samples are added until the error ||A||_F^2 - ||B||_F^2 of the
+// approximation Q B is small enough [Martinsson, Voronin, SISC 38 (2016)].
+template <class Matrix>
+LowRankSVD adaptiveRandomizedSVD(const Matrix &A, double tol,
+                                 Eigen::Index b = 10,
+                                 Eigen::Index maxrank = -1,
+                                 const RsvdOptions &opt = {}) {
+  using rsvd_detail::orth;
+  std::mt19937_64 gen(opt.seed);
+  const Eigen::Index m = A.rows(), n = A.cols();
+  if (maxrank < 0) maxrank = std::min(m, n);
+  Eigen::MatrixXd Q(m, 0), B(0, n);
+  const double normA2 = A.squaredNorm();
+  double err2 = normA2;
+  while (Q.cols() < maxrank && err2 > tol * tol * normA2) {
+    const Eigen::Index bi = std::min(b, maxrank - Q.cols());
+    Eigen::MatrixXd Qi = A * rsvd_detail::gaussian(n, bi, gen);
+    for (unsigned int i = 0; i < opt.power_iterations; ++i) {
+      Qi = orth(Qi - Q * (Q.transpose() * Qi));
+      Qi = A * orth(A.transpose() * Qi);
+    }
+    // orthogonalize twice against the previous blocks
+    Qi = orth(Qi - Q * (Q.transpose() * Qi));
+    Qi = orth(Qi - Q * (Q.transpose() * Qi));
+    const Eigen::MatrixXd Bi = (A.transpose() * Qi).transpose();
+    Q.conservativeResize(m, Q.cols() + bi);
+    Q.rightCols(bi) = Qi;
+    B.conservativeResize(B.rows() + bi, n);
+    B.bottomRows(bi) = Bi;
+    err2 -= Bi.squaredNorm();
+  }
+  LowRankSVD usv = rsvd_detail::svdOfQB(Q, B, Q.cols());
+  // truncate: discard the tail of singular values below the tolerance
+  Eigen::Index k = usv.rank();
+  double tail2 = std::max(err2, 0.0);
+  while (k > 1 && tail2 + usv.S(k - 1) * usv.S(k - 1) <=
+                      tol * tol * normA2) {
+    tail2 += usv.S(k - 1) * usv.S(k - 1);
+    --k;
+  }
+  return {usv.U.leftCols(k), usv.S.head(k), usv.V.leftCols(k)};
+}
+/* SAM_LISTING_END_1 */
+
+/* SAM_LISTING_BEGIN_2 */
+// Rank-k approximation of a matrix with n columns whose rows are delivered
+// once by next(B) (false at the end of the data), cf. tsqrStream(). With
+// Omega in R^{n,l} and Psi in R^{l2,m}, l2 = 2l + 1, the sketches
+//   Y = A Omega (m x l),   W = Psi A (l2 x n)
+// are accumulated block by block; then A ~ Q X with Q = orth(Y) and
+// X = (Psi Q)^+ W [Tropp, Yurtsever, Udell, Cevher, SIMAX 38 (2017)].
+// The blocks of Psi are generated again from their seed instead of being
+// stored. Memory O((m + n) l).
+template <class BlockReader>
+LowRankSVD singlePassSVD(BlockReader &&next, Eigen::Index n, Eigen::Index k,
+                         const RsvdOptions &opt = {}) {
+  std::mt19937_64 gen(opt.seed);
+  const Eigen::Index l = std::min<Eigen::Index>(k + opt.oversampling, n);
+  const Eigen::Index l2 = 2 * l + 1;
+  const Eigen::MatrixXd Omega = rsvd_detail::gaussian(n, l, gen);
+  std::mt19937_64 psigen(opt.seed + 1);
+  std::vector<Eigen::MatrixXd> Y;
+  Eigen::MatrixXd W = Eigen::MatrixXd::Zero(l2, n), Ab;
+  Eigen::Index m = 0;
+  while (next(Ab)) {
+    assert(Ab.cols() == n);
+    Y.push_back(Ab * Omega);
+    W += rsvd_detail::gaussian(l2, Ab.rows(), psigen) * Ab;
+    m += Ab.rows();
+  }
+  Eigen::MatrixXd Yall(m, l);
+  std::vector<Eigen::Index> rows;
+  Eigen::Index r = 0;
+  for (const Eigen::MatrixXd &Yb : Y) {
+    Yall.middleRows(r, Yb.rows()) = Yb;
+    r += Yb.rows();
+    rows.push_back(Yb.rows());
+  }
+  Y.clear();
+  const Eigen::MatrixXd Q = rsvd_detail::orth(Yall);
+  // Psi Q with the same random numbers as above, block by block
+  psigen.seed(opt.seed + 1);
+  Eigen::MatrixXd PsiQ = Eigen::MatrixXd::Zero(l2, Q.cols());
+  r = 0;
+  for (Eigen::Index rb : rows) {
+    PsiQ += rsvd_detail::gaussian(l2, rb, psigen) * Q.middleRows(r, rb);
+    r += rb;
+  }
+  return rsvd_detail::svdOfQB(Q, PsiQ.householderQr().solve(W), k);
+}
+/* SAM_LISTING_END_2 */
@@ -0,0 +1,118 @@
+#include <Eigen/Dense>
+#include <chrono>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <random>
+
+#include "tsqr.hpp"
+
+template <class Action>
+double timeit(Action &&a) {
+  const auto start = std::chrono::high_resolution_clock::now();
+  a();
+  const auto end = std::chrono::high_resolution_clock::now();
+  return std::chrono::duration<double>(end - start).count();
+}
+
+// m x n matrix with singular values logspaced in [1/cond, 1]
+Eigen::MatrixXd illConditioned(Eigen::Index m, Eigen::Index n, double cond) {
+  const Eigen::MatrixXd U =
+      Eigen::HouseholderQR<Eigen::MatrixXd>(Eigen::MatrixXd::Random(m, n))
+          .householderQ() *
+      Eigen::MatrixXd::Identity(m, n);
+  const Eigen::MatrixXd V =
+      Eigen::HouseholderQR<Eigen::MatrixXd>(Eigen::MatrixXd::Random(n, n))
+          .householderQ();
+  const Eigen::VectorXd s =
+      Eigen::VectorXd::LinSpaced(n, 0, -std::log10(cond)).unaryExpr(
+          [](double e) { return std::pow(10.0, e); });
+  return U * s.asDiagonal() * V.transpose();
+}
+
+double orthogonalityLoss(const Eigen::MatrixXd &Q) {
+  return (Q.transpose() * Q -
+          Eigen::MatrixXd::Identity(Q.cols(), Q.cols()))
+      .norm();
+}
+
+int main(int argc, char **argv) {
+  std::cout << std::setprecision(3) << std::scientific;
+  const Eigen::Index m = argc > 1 ? std::atol(argv[1]) : 200000, n = 50;
+
+  // Tall-skinny least squares problem: TSQR vs. Householder QR of Eigen
+  const Eigen::MatrixXd A = Eigen::MatrixXd::Random(m, n);
+  const Eigen::VectorXd b = Eigen::VectorXd::Random(m);
+  Eigen::VectorXd x0, x1;
+  Eigen::MatrixXd R0;
+  TSQR tsqr;
+  const double t0 = timeit([&] {
+    Eigen::HouseholderQR<Eigen::MatrixXd> qr(A);
+    x0 = qr.solve(b);
+    R0 = qr.matrixQR().topRows(n).triangularView<Eigen::Upper>();
+  });
+  // 16 leaf blocks, i.e. a reduction tree with 4 levels, for any number of
+  // threads
+  TsqrOptions opt;
+  opt.block_rows = m / 16;
+  const double t1 = timeit([&] { tsqr.compute(A, opt); });
+  const double t2 = timeit([&] { tsqrLsqSolve(A, b, x1); });
+  // R-factors agree up to the signs of their rows
+  const Eigen::MatrixXd R1 = tsqr.matrixR();
+  const Eigen::VectorXd sgn =
+      (R0.diagonal().array() * R1.diagonal().array()).sign();
+  std::cout << "A: " << m << " x " << n << "\n"
+            << "Householder QR + solve: " << t0 << " s\n"
+            << "TSQR:                   " << t1 << " s, |R - R_H| = "
+            << (sgn.asDiagonal() * R1 - R0).norm() / R0.norm() << "\n"
+            << "TSQR least squares:     " << t2 << " s, |x - x_H| = "
+            << (x1 - x0).norm() / x0.norm() << "\n";
+  const Eigen::MatrixXd Q = tsqr.thinQ();
+  std::cout << "TSQR: |Q^T Q - I| = " << orthogonalityLoss(Q)
+            << ", |A - QR| = " << (A - Q * R1).norm() / A.norm() << "\n";
+
+  // Streaming: a regression with 10^6 rows generated block by block, the
+  // matrix is never stored
+  const Eigen::Index M = 1000000, rows = 10000;
+  const Eigen::VectorXd beta = Eigen::VectorXd::LinSpaced(n, 1.0, 2.0);
+  Eigen::Index pos = 0;
+  std::mt19937 gen(1);
+  std::normal_distribution<double> noise(0.0, 0.01);
+  auto next = [&](Eigen::MatrixXd &B) {
+    if (pos >= M) return false;
+    const Eigen::Index r = std::min(rows, M - pos);
+    B.resize(r, n + 1);
+    B.leftCols(n).setRandom();
+    B.col(n) = B.leftCols(n) * beta;
+    for (Eigen::Index i = 0; i < r; ++i) B(i, n) += noise(gen);
+    pos += r;
+    return true;
+  };
+  Eigen::VectorXd xs;
+  double res;
+  const double t3 =
+      timeit([&] { res = lsqFromExtendedR(tsqrStream(next, n + 1), xs); });
+  std::cout << "\nstreaming " << M << " x " << n << ": " << t3
+            << " s, |x - beta| = " << (xs - beta).norm()
+            << ", residual/sqrt(m) = " << res / std::sqrt(double(M)) << "\n";
+
+  // CholeskyQR2 and its shifted variant for increasing condition numbers
+  std::cout << "\ncond(A)    |Q^TQ-I|: TSQR   CholQR2    sCholQR3\n";
+  for (double cond : {1e2, 1e6, 1e10, 1e13}) {
+    const Eigen::MatrixXd B = illConditioned(20000, n, cond);
+    Eigen::MatrixXd Qc, Rc;
+    std::cout << cond << "  " << orthogonalityLoss(TSQR(B).thinQ()) << "  ";
+    if (choleskyQR2(B, Qc, Rc)) {
+      std::cout << orthogonalityLoss(Qc) << "  ";
+    } else {
+      std::cout << "breakdown  ";
+    }
+    if (choleskyQR2(B, Qc, Rc, true)) {
+      std::cout << orthogonalityLoss(Qc) << ", |B - QR| = "
+                << (B - Qc * Rc).norm() / B.norm() << "\n";
+    } else {
+      std::cout << "breakdown\n";
+    }
+  }
+  return 0;
+}
@@ -0,0 +1,334 @@
+#pragma once
+
+#include <Eigen/Dense>
+#include <Eigen/QR>
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <limits>
+#include <mutex>
+#include <vector>
+
+#include "parallel.hpp"
+
+/* QR decomposition of tall and skinny matrices A in R^{m,n}, m >> n.
+ * - TSQR: the rows of A are split into blocks which are factored
+ *   independently (in parallel); their n x n R-factors are combined
+ *   pairwise in a binary reduction tree, A = Q R with Q the product of the
+ *   block-diagonal leaf factors and the tree factors. The Householder
+ *   vectors of all nodes are kept, so the thin Q can be formed, too.
+ * - TsqrAccumulator: R-factor of a matrix whose rows arrive in blocks; only
+ *   an n x n triangle is kept, so A never has to be in memory.
+ * - CholeskyQR2: two steps of A = Q R with R^T R = A^T A; costs two Gram
+ *   matrices and two triangular solves, both of which are (parallel)
+ *   matrix-matrix operations. Needs cond(A) < u^{-1/2}; the shifted variant
+ *   (shifted CholeskyQR3) works up to cond(A) ~ u^{-1} / (mn). */
+
+struct TsqrOptions {
+  Eigen::Index block_rows = 0;   // rows of a leaf block, 0 = automatic
+  unsigned int num_threads = 0;  // 0 = number of hardware threads
+};
+
+namespace tsqr_detail {
+// Upper triangular part of the first min(rows, n) rows of a QR factor
+inline Eigen::MatrixXd upperR(const Eigen::HouseholderQR<Eigen::MatrixXd> &qr) {
+  const Eigen::Index r = std::min(qr.rows(), qr.cols());
+  return qr.matrixQR().topRows(r).triangularView<Eigen::Upper>();
+}
+
+// Leaf row blocks: p blocks of at least n rows each
+inline std::vector<Eigen::Index> leafOffsets(Eigen::Index m, Eigen::Index n,
+                                             const TsqrOptions &opt) {
+  Eigen::Index p;
+  if (opt.block_rows > 0) {
+    p = std::max<Eigen::Index>(1, m / std::max(opt.block_rows, n));
+  } else {
+    p = std::min<Eigen::Index>(numThreadsFor(m, opt.num_threads),
+                               std::max<Eigen::Index>(1, m / n));
+  }
+  std::vector<Eigen::Index> start(p + 1);
+  for (Eigen::Index i = 0; i <= p; ++i) start[i] = m * i / p;
+  return start;
+}
+}  // namespace tsqr_detail
+
+/* SAM_LISTING_BEGIN_0 */
+class TSQR {
+ public:
+  TSQR() = default;
+  explicit TSQR(const Eigen::MatrixXd &A, const TsqrOptions &opt = {}) {
+    compute(A, opt);
+  }
+
+  // Requires A.rows() >= A.cols()
+  TSQR &compute(const Eigen::MatrixXd &A, const TsqrOptions &opt = {}) {
+    using tsqr_detail::upperR;
+    m_ = A.rows();
+    n_ = A.cols();
+    assert(m_ >= n_);
+    num_threads_ = opt.num_threads;
+    start_ = tsqr_detail::leafOffsets(m_, n_, opt);
+    const std::size_t p = start_.size() - 1;
+    // leaves: independent QR decompositions of the row blocks
+    leaves_.assign(p, Eigen::HouseholderQR<Eigen::MatrixXd>());
+    std::vector<Eigen::MatrixXd> R(p);
+    parallelFor(
+        p,
+        [&](std::size_t b, std::size_t e, unsigned int) {
+          for (std::size_t i = b; i < e; ++i) {
+            leaves_[i].compute(
+                A.middleRows(start_[i], start_[i + 1] - start_[i]));
+            R[i] = upperR(leaves_[i]);
+          }
+        },
+        num_threads_);
+    // reduction tree: node k of a level factors [R_{2k}; R_{2k+1}]
+    tree_.clear();
+    while (R.size() > 1) {
+      const std::size_t q = (R.size() + 1) / 2;
+      std::vector<Eigen::HouseholderQR<Eigen::MatrixXd>> level(q);
+      std::vector<Eigen::MatrixXd> Rnext(q);
+      parallelFor(
+          q,
+          [&](std::size_t b, std::size_t e, unsigned int) {
+            for (std::size_t k = b; k < e; ++k) {
+              const std::size_t c = std::min<std::size_t>(2, R.size() - 2 * k);
+              Eigen::MatrixXd S(c * n_, n_);
+              for (std::size_t j = 0; j < c; ++j) {
+                S.middleRows(j * n_, n_) = R[2 * k + j];
+              }
+              level[k].compute(S);
+              Rnext[k] = upperR(level[k]);
+            }
+          },
+          num_threads_);
+      tree_.push_back(std::move(level));
+      R = std::move(Rnext);
+    }
+    R_ = R[0];
+    return *this;
+  }
+
+  const Eigen::MatrixXd &matrixR() const { return R_; }
+
+  // Thin factor Q in R^{m,n}: top-down through the tree, node k passes the
+  // blocks of its n x n-columned Q-factor (times its own transformation)
+  // to its children, the leaves apply their Householder reflections
+  Eigen::MatrixXd thinQ() const {
+    const Eigen::Index n = n_;
+    std::vector<Eigen::MatrixXd> M(1, Eigen::MatrixXd::Identity(n, n));
+    for (auto level = tree_.rbegin(); level != tree_.rend(); ++level) {
+      std::vector<Eigen::MatrixXd> Mnext;
+      for (std::size_t k = 0; k < level->size(); ++k) {
+        const auto &qr = (*level)[k];
+        Eigen::MatrixXd Qk = Eigen::MatrixXd::Zero(qr.rows(), n);
+        Qk.topRows(n) = M[k];
+        Qk.applyOnTheLeft(qr.householderQ());
+        for (Eigen::Index j = 0; j < qr.rows() / n; ++j) {
+          Mnext.push_back(Qk.middleRows(j * n, n));
+        }
+      }
+      M = std::move(Mnext);
+    }
+    Eigen::MatrixXd Q(m_, n);
+    parallelFor(
+        leaves_.size(),
+        [&](std::size_t b, std::size_t e, unsigned int) {
+          for (std::size_t i = b; i < e; ++i) {
+            Eigen::MatrixXd Qi =
+                Eigen::MatrixXd::Zero(start_[i + 1] - start_[i], n);
+            Qi.topRows(n) = M[i];
+            Qi.applyOnTheLeft(leaves_[i].householderQ());
+            Q.middleRows(start_[i], Qi.rows()) = Qi;
+          }
+        },
+        num_threads_);
+    return Q;
+  }
+
+ private:
+  Eigen::Index m_ = 0, n_ = 0;
+  unsigned int num_threads_ = 0;
+  std::vector<Eigen::Index> start_;  // first rows of the leaf blocks
+  std::vector<Eigen::HouseholderQR<Eigen::MatrixXd>> leaves_;
+  std::vector<std::vector<Eigen::HouseholderQR<Eigen::MatrixXd>>> tree_;
+  Eigen::MatrixXd R_;
+};
+/* SAM_LISTING_END_0 */
+
+/* SAM_LISTING_BEGIN_1 */
+// R-factor of a matrix with n columns given by consecutive blocks of rows:
+// after every block B the triangle R is replaced by the R-factor of [R; B].
+// Accumulators of disjoint row sets can be merged.
+class TsqrAccumulator {
+ public:
+  explicit TsqrAccumulator(Eigen::Index n = 0) : R_(0, n) {}
+
+  void addRows(const Eigen::Ref<const Eigen::MatrixXd> &B) {
+    assert(B.cols() == R_.cols());
+    if (B.rows() == 0) return;
+    Eigen::MatrixXd S(R_.rows() + B.rows(), R_.cols());
+    S << R_, B;
+    R_ = tsqr_detail::upperR(Eigen::HouseholderQR<Eigen::MatrixXd>(S));
+    rows_ += B.rows();
+  }
+
+  void merge(const TsqrAccumulator &other) {
+    const Eigen::Index rows = rows_ + other.rows_;
+    addRows(other.R_);
+    rows_ = rows;
+  }
+
+  // min(rowsSeen(), n) x n upper triangular matrix
+  const Eigen::MatrixXd &matrixR() const { return R_; }
+  Eigen::Index rowsSeen() const { return rows_; }
+
+ private:
+  Eigen::MatrixXd R_;
+  Eigen::Index rows_ = 0;
+};
+/* SAM_LISTING_END_1 */
+
+/* SAM_LISTING_BEGIN_2 */
+// R-factor of a matrix with n columns delivered by next(B), which fills B
+// with the next block of rows and returns false at the end of the data.
+// The worker threads fetch blocks one at a time (reading is serialized)
+// and factor them concurrently into private accumulators.
+template <class BlockReader>
+Eigen::MatrixXd tsqrStream(BlockReader &&next, Eigen::Index n,
+                           unsigned int num_threads = 0) {
+  // the number of blocks is not known in advance: an explicit num_threads
+  // is used as given, threads without blocks contribute nothing
+  const unsigned int p = num_threads > 0 ? num_threads : defaultNumThreads();
+  std::vector<TsqrAccumulator> acc(p, TsqrAccumulator(n));
+  std::mutex read;
+  parallelFor(
+      p,
+      [&](std::size_t b, std::size_t, unsigned int) {
+        Eigen::MatrixXd B;
+        for (;;) {
+          {
+            std::lock_guard<std::mutex> lock(read);
+            if (!next(B)) break;
+          }
+          acc[b].addRows(B);
+        }
+      },
+      p);
+  for (unsigned int t = 1; t < p; ++t) acc[0].merge(acc[t]);
+  return acc[0].matrixR();
+}
+/* SAM_LISTING_END_2 */
+
+/* SAM_LISTING_BEGIN_3 */
+// Least squares solution from the R-factor of the extended matrix [A, b]
+// (cf. qrlsqsolve()): x = R(0:n-1,0:n-1)^{-1} R(0:n-1,n), the residual norm
+// |R(n,n)| is returned
+inline double lsqFromExtendedR(const Eigen::MatrixXd &R, Eigen::VectorXd &x) {
+  const Eigen::Index n = R.cols() - 1;
+  assert(R.rows() >= n);
+  x = R.topLeftCorner(n, n).triangularView<Eigen::Upper>().solve(
+      R.col(n).head(n));
+  return R.rows() > n ? std::abs(R(n, n)) : 0.0;
+}
+
+// Full-rank linear least squares problem by TSQR of [A, b]; the blocks of
+// the extended matrix are formed on the fly, so [A, b] is never stored
+inline double tsqrLsqSolve(const Eigen::MatrixXd &A, const Eigen::VectorXd &b,
+                           Eigen::VectorXd &x, const TsqrOptions &opt = {}) {
+  const Eigen::Index m = A.rows(), n = A.cols();
+  const Eigen::Index rows =
+      opt.block_rows > 0 ? opt.block_rows : std::max<Eigen::Index>(
+                                                4 * (n + 1), 1024);
+  const Eigen::Index nblocks = (m + rows - 1) / rows;
+  const unsigned int p = numThreadsFor(nblocks, opt.num_threads);
+  std::vector<TsqrAccumulator> acc(p, TsqrAccumulator(n + 1));
+  parallelFor(
+      nblocks,
+      [&](std::size_t bb, std::size_t be, unsigned int tid) {
+        Eigen::MatrixXd B;
+        for (std::size_t k = bb; k < be; ++k) {
+          const Eigen::Index r0 = k * rows, r = std::min(rows, m - r0);
+          B.resize(r, n + 1);
+          B << A.middleRows(r0, r), b.segment(r0, r);
+          acc[tid].addRows(B);
+        }
+      },
+      p);
+  for (unsigned int t = 1; t < p; ++t) acc[0].merge(acc[t]);
+  return lsqFromExtendedR(acc[0].matrixR(), x);
+}
+/* SAM_LISTING_END_3 */
+
+namespace tsqr_detail {
+// Gram matrix A^T A as a sum of thread-local rank-k updates
+inline Eigen::MatrixXd gram(const Eigen::MatrixXd &A,
+                            unsigned int num_threads) {
+  const Eigen::Index n = A.cols();
+  const unsigned int p = numThreadsFor(A.rows(), num_threads);
+  std::vector<Eigen::MatrixXd> G(p, Eigen::MatrixXd::Zero(n, n));
+  parallelFor(
+      A.rows(),
+      [&](std::size_t b, std::size_t e, unsigned int tid) {
+        G[tid].selfadjointView<Eigen::Lower>().rankUpdate(
+            A.middleRows(b, e - b).transpose());
+      },
+      p);
+  for (unsigned int t = 1; t < p; ++t) G[0] += G[t];
+  return G[0].selfadjointView<Eigen::Lower>();
+}
+
+// Q <- Q R^{-1} by row blocks
+inline void solveRight(const Eigen::MatrixXd &R, Eigen::MatrixXd &Q,
+                       unsigned int num_threads) {
+  parallelFor(
+      Q.rows(),
+      [&](std::size_t b, std::size_t e, unsigned int) {
+        auto Qb = Q.middleRows(b, e - b);
+        R.triangularView<Eigen::Upper>().solveInPlace<Eigen::OnTheRight>(Qb);
+      },
+      num_threads);
+}
+
+// One step Q <- Q R^{-1}, R^T R = Q^T Q + shift I; false if the Cholesky
+// decomposition breaks down
+inline bool choleskyQRStep(Eigen::MatrixXd &Q, Eigen::MatrixXd &R,
+                           double shift, unsigned int num_threads) {
+  Eigen::MatrixXd G = gram(Q, num_threads);
+  G.diagonal().array() += shift;
+  Eigen::LLT<Eigen::MatrixXd> llt(G);
+  if (llt.info() != Eigen::Success) return false;
+  R = llt.matrixU();
+  solveRight(R, Q, num_threads);
+  return true;
+}
+}  // namespace tsqr_detail
+
+/* SAM_LISTING_BEGIN_4 */
+// CholeskyQR2: A = Q R by two CholeskyQR steps, the second one repairs the
+// loss of orthogonality of the first. With shifted = true a first step with
+// the shift 11 (mn + n(n+1)) u ||A||_F^2 makes the Cholesky decomposition
+// succeed for cond(A) up to about u^{-1} / (11 (mn + n(n+1))) (shifted
+// CholeskyQR3 of Fukaya, Kannan, Nakatsukasa, Yamamoto, Yanagisawa).
+// Returns false on breakdown.
+inline bool choleskyQR2(const Eigen::MatrixXd &A, Eigen::MatrixXd &Q,
+                        Eigen::MatrixXd &R, bool shifted = false,
+                        unsigned int num_threads = 0) {
+  using tsqr_detail::choleskyQRStep;
+  const double m = A.rows(), n = A.cols();
+  Q = A;
+  R = Eigen::MatrixXd::Identity(A.cols(), A.cols());
+  Eigen::MatrixXd Rk;
+  if (shifted) {
+    const double u = std::numeric_limits<double>::epsilon() / 2;
+    const double s = 11 * (m * n + n * (n + 1)) * u * A.squaredNorm();
+    if (!choleskyQRStep(Q, Rk, s, num_threads)) return false;
+    R = Rk;
+  }
+  for (int k = 0; k < 2; ++k) {
+    if (!choleskyQRStep(Q, Rk, 0.0, num_threads)) return false;
+    R = Rk.triangularView<Eigen::Upper>() * R;
+  }
+  return true;
+}
+/* SAM_LISTING_END_4 */
@@ -0,0 +1,240 @@
+#pragma once
+
+#include <Eigen/Dense>
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <limits>
+#include <queue>
+#include <utility>
+#include <vector>
+
+#include "parallel.hpp"
+
+/* Non-recursive adaptive quadrature based on the Gauss-Kronrod pair G7/K15.
+ * - global error control: the interval with the largest local error
+ *   estimate is bisected first (priority queue),
+ * - several intervals are refined per sweep, all their nodes are passed to
+ *   the integrand in one call (batched, vectorizable evaluation),
+ * - the batches of a sweep are processed by several threads,
+ * - the integrand is evaluated exactly once at every node; the contribution
+ *   of an interval is stored and never recomputed,
+ * - vector-valued integrands and (semi-)infinite intervals are supported. */
+
+/* SAM_LISTING_BEGIN_0 */
+// Gauss-Kronrod 7/15 rule on [-1,1]: positive Kronrod nodes (in decreasing
+// order, last one = 0) and weights; the Gauss nodes are xgk[1], xgk[3], ...
+namespace GK15 {
+constexpr double xgk[8] = {
+    0.991455371120812639206854697526329, 0.949107912342758524526189684047851,
+    0.864864423359769072789712788640926, 0.741531185599394439863864773280788,
+    0.586087235467691130294144845693013, 0.405845151377397166906606412076961,
+    0.207784955007898467600689403773245, 0.000000000000000000000000000000000};
+constexpr double wgk[8] = {
+    0.022935322010529224963732008058970, 0.063092092629978553290700663189204,
+    0.104790010322250183839876322541518, 0.140653259715525918745189590510238,
+    0.169004726639267902826583426598550, 0.190350578064785409913256402421014,
+    0.204432940075298892414161999234649, 0.209482141084727828012999174891714};
+constexpr double wg[4] = {
+    0.129484966168869693270611432679082, 0.279705391489276667901467771423780,
+    0.381830050505118944950369775488975, 0.417959183673469387755102040816327};
+constexpr unsigned int n_nodes = 15;
+}  // namespace GK15
+/* SAM_LISTING_END_0 */
+
+struct AdaptQuadOptions {
+  double rtol = 1e-10;               // relative tolerance
+  double atol = 1e-12;               // absolute tolerance
+  unsigned int max_intervals = 100000;  // limit for the number of intervals
+  unsigned int init_intervals = 4;   // initial uniform partition
+  unsigned int batch = 32;           // intervals bisected per sweep
+  unsigned int num_threads = 0;      // 0 = number of hardware threads
+};
+
+struct AdaptQuadResult {
+  Eigen::VectorXd I;             // approximation of the integral
+  double err = 0.0;              // estimated error (Euclidean norm)
+  unsigned int num_intervals = 0;
+  unsigned int num_evals = 0;    // number of points at which f was evaluated
+  bool converged = false;
+};
+
+namespace adaptquad_detail {
+// An interval with its Kronrod approximation and error estimate
+struct Interval {
+  double a, b;
+  Eigen::VectorXd K;
+  double err;
+  bool operator<(const Interval& other) const { return err < other.err; }
+};
+
+// Fill x with the 15 Kronrod nodes on [a,b]
+inline void kronrodNodes(double a, double b, double* x) {
+  const double c = 0.5 * (a + b), h = 0.5 * (b - a);
+  for (unsigned int j = 0; j < 7; ++j) {
+    x[2 * j] = c - h * GK15::xgk[j];
+    x[2 * j + 1] = c + h * GK15::xgk[j];
+  }
+  x[14] = c;
+}
+
+// Kronrod approximation and error estimate |K-G| from the values fx
+// (columns ordered as in kronrodNodes()); h < 0 for a > b, the estimate is
+// nonnegative nevertheless
+template <class Values>
+void kronrodEstimate(const Values& fx, Interval& iv) {
+  const double h = 0.5 * (iv.b - iv.a);
+  Eigen::VectorXd K = GK15::wgk[7] * fx.col(14);
+  Eigen::VectorXd G = GK15::wg[3] * fx.col(14);
+  for (unsigned int j = 0; j < 7; ++j) {
+    const Eigen::VectorXd s = fx.col(2 * j) + fx.col(2 * j + 1);
+    K += GK15::wgk[j] * s;
+    if (j % 2 == 1) G += GK15::wg[j / 2] * s;
+  }
+  iv.K = h * K;
+  iv.err = std::abs(h) * (K - G).norm();
+}
+
+// Evaluate the batched integrand on the given intervals, several threads
+// work on contiguous chunks, each with a single call of F
+template <class BatchFunction>
+void evaluate(BatchFunction& F, std::vector<Interval>& ivs,
+              unsigned int num_threads) {
+  parallelFor(
+      ivs.size(),
+      [&F, &ivs](std::size_t begin, std::size_t end, unsigned int) {
+        constexpr unsigned int q = GK15::n_nodes;
+        Eigen::VectorXd x((end - begin) * q);
+        for (std::size_t k = begin; k < end; ++k) {
+          kronrodNodes(ivs[k].a, ivs[k].b, x.data() + (k - begin) * q);
+        }
+        const Eigen::MatrixXd fx = F(x);  // d x (#nodes)
+        assert(fx.cols() == x.size() && "F must return one column per node");
+        for (std::size_t k = begin; k < end; ++k) {
+          kronrodEstimate(fx.middleCols((k - begin) * q, q), ivs[k]);
+        }
+      },
+      num_threads);
+}
+}  // namespace adaptquad_detail
+
+/* SAM_LISTING_BEGIN_1 */
+// Adaptive quadrature of a vector-valued integrand over the finite interval
+// [a,b]. F takes a vector x of m nodes and returns the d x m matrix of the
+// values f(x_j) in its columns. F may be called concurrently from several
+// threads.
+template <class BatchFunction>
+AdaptQuadResult adaptquadgkBatch(BatchFunction&& F, double a, double b,
+                                 const AdaptQuadOptions& opt = {}) {
+  using adaptquad_detail::Interval;
+  assert(opt.init_intervals >= 1 && opt.batch >= 1);
+  AdaptQuadResult res;
+  // Initial partition
+  std::vector<Interval> ivs(opt.init_intervals);
+  for (unsigned int k = 0; k < opt.init_intervals; ++k) {
+    ivs[k].a = a + (b - a) * k / opt.init_intervals;
+    ivs[k].b = a + (b - a) * (k + 1) / opt.init_intervals;
+  }
+  adaptquad_detail::evaluate(F, ivs, opt.num_threads);
+  res.num_evals = ivs.size() * GK15::n_nodes;
+  std::priority_queue<Interval> queue;
+  Eigen::VectorXd I = Eigen::VectorXd::Zero(ivs[0].K.size());
+  double err = 0.0;
+  for (auto& iv : ivs) {
+    I += iv.K;
+    err += iv.err;
+    queue.push(std::move(iv));
+  }
+  // Refinement: bisect the intervals with the largest error estimates
+  while (err > std::max(opt.atol, opt.rtol * I.norm()) &&
+         queue.size() + opt.batch <= opt.max_intervals) {
+    ivs.clear();
+    for (unsigned int k = 0; k < opt.batch && !queue.empty(); ++k) {
+      const Interval& top = queue.top();
+      // do not refine intervals that carry no error anymore
+      if (top.err <= std::numeric_limits<double>::epsilon() * I.norm()) break;
+      I -= top.K;
+      err -= top.err;
+      const double m = 0.5 * (top.a + top.b);
+      ivs.push_back({top.a, m, {}, 0.0});
+      ivs.push_back({m, top.b, {}, 0.0});
+      queue.pop();
+    }
+    if (ivs.empty()) break;
+    adaptquad_detail::evaluate(F, ivs, opt.num_threads);
+    res.num_evals += ivs.size() * GK15::n_nodes;
+    for (auto& iv : ivs) {
+      I += iv.K;
+      err += iv.err;
+      queue.push(std::move(iv));
+    }
+  }
+  // Sum up once more to get rid of the round-off in the running sums
+  res.I = Eigen::VectorXd::Zero(I.size());
+  res.err = 0.0;
+  res.num_intervals = queue.size();
+  while (!queue.empty()) {
+    res.I += queue.top().K;
+    res.err += queue.top().err;
+    queue.pop();
+  }
+  res.converged = res.err <= std::max(opt.atol, opt.rtol * res.I.norm());
+  return res;
+}
+/* SAM_LISTING_END_1 */
+
+/* SAM_LISTING_BEGIN_2 */
+// Same as adaptquadgkBatch(), but a and/or b may be +-infinity. Infinite
+// intervals are mapped to finite ones by
+//   [a,infty):       x = a + t/(1-t),   t in [0,1)
+//   (-infty,b]:      x = b - t/(1-t),   t in [0,1)
+//   (-infty,infty):  x = t/(1-t^2),     t in (-1,1)
+// Since Gauss-Kronrod nodes are interior, the singular endpoints of the
+// transformation are never evaluated.
+template <class BatchFunction>
+AdaptQuadResult adaptquadgkInf(BatchFunction&& F, double a, double b,
+                               const AdaptQuadOptions& opt = {}) {
+  if (!std::isinf(a) && !std::isinf(b)) return adaptquadgkBatch(F, a, b, opt);
+  double sign = 1.0;
+  if (a > b) {  // reverse orientation
+    std::swap(a, b);
+    sign = -1.0;
+  }
+  // after the swap, a = +infty is impossible and so is b = -infty
+  const bool ainf = std::isinf(a), binf = std::isinf(b);
+  auto Ft = [&F, a, b, ainf, binf](const Eigen::VectorXd& t) {
+    Eigen::VectorXd x(t.size()), jac(t.size());
+    for (Eigen::Index j = 0; j < t.size(); ++j) {
+      if (ainf && binf) {
+        const double s = 1.0 - t(j) * t(j);
+        x(j) = t(j) / s;
+        jac(j) = (1.0 + t(j) * t(j)) / (s * s);
+      } else {
+        const double s = 1.0 - t(j);
+        x(j) = ainf ? b - t(j) / s : a + t(j) / s;
+        jac(j) = 1.0 / (s * s);
+      }
+    }
+    Eigen::MatrixXd fx = F(x);
+    return Eigen::MatrixXd(fx * jac.asDiagonal());
+  };
+  AdaptQuadResult res =
+      ainf && binf ? adaptquadgkBatch(Ft, -1.0, 1.0, opt)
+                   : adaptquadgkBatch(Ft, 0.0, 1.0, opt);
+  res.I *= sign;
+  return res;
+}
+/* SAM_LISTING_END_2 */
+
+// Convenience interface for a scalar integrand f(double) -> double, which
+// is evaluated node by node; a and b may be infinite.
+template <class Function>
+double adaptquadgk(Function&& f, double a, double b,
+                   const AdaptQuadOptions& opt = {}) {
+  auto F = [&f](const Eigen::VectorXd& x) {
+    Eigen::MatrixXd fx(1, x.size());
+    for (Eigen::Index j = 0; j < x.size(); ++j) fx(0, j) = f(x(j));
+    return fx;
+  };
+  return adaptquadgkInf(F, a, b, opt).I(0);
+}
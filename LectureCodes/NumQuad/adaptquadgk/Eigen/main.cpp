@@ -0,0 +1,84 @@
+#include <chrono>
+#include <cmath>
+#include <iomanip>
+#include <iostream>
+#include <limits>
+
+#include "../../adaptquad/Eigen/adaptquad.hpp"
+#include "adaptquadgk.hpp"
+
+int main() {
+  std::cout << std::setprecision(3) << std::scientific;
+  const double inf = std::numeric_limits<double>::infinity();
+
+  // Comparison with the recursive adaptquad() from the lecture
+  {
+    unsigned int cnt = 0;
+    auto f = [&cnt](double x) {
+      ++cnt;
+      return std::exp(-x * x);
+    };
+    VectorXd M(4);
+    M << -100, 0.1, 0.5, 100;
+    const double I1 = adaptquad(f, M, 1e-10, 1e-12);
+    std::cout << "adaptquad:   error = " << std::abs(I1 - std::sqrt(M_PI))
+              << ", f-evaluations = " << cnt << "\n";
+    cnt = 0;
+    AdaptQuadOptions opt;
+    opt.num_threads = 1;  // f is not thread-safe because of the counter
+    const double I2 = adaptquadgk(f, -100, 100, opt);
+    std::cout << "adaptquadgk: error = " << std::abs(I2 - std::sqrt(M_PI))
+              << ", f-evaluations = " << cnt << "\n";
+  }
+
+  // Batched, vectorized evaluation of an integrand with a sharp peak
+  {
+    auto F = [](const Eigen::VectorXd& x) -> Eigen::MatrixXd {
+      return (1.0 / (1e-4 + (x.array() - 0.3).square())).matrix().transpose();
+    };
+    const double exact =
+        100.0 * (std::atan(0.7 / 1e-2) + std::atan(0.3 / 1e-2));
+    AdaptQuadOptions opt;
+    opt.rtol = 1e-13;
+    for (unsigned int p : {1, 2, 4}) {
+      opt.num_threads = p;
+      const auto start = std::chrono::high_resolution_clock::now();
+      AdaptQuadResult res;
+      for (int r = 0; r < 100; ++r) res = adaptquadgkBatch(F, 0.0, 1.0, opt);
+      const auto end = std::chrono::high_resolution_clock::now();
+      std::cout << "peak, " << p << " thread(s): error = "
+                << std::abs(res.I(0) - exact) / exact << " (estimate "
+                << res.err / exact << "), intervals = " << res.num_intervals
+                << ", time = "
+                << std::chrono::duration<double>(end - start).count() / 100
+                << " s\n";
+    }
+  }
+
+  // Vector-valued integrand: moments of the Gaussian density over R
+  {
+    auto F = [](const Eigen::VectorXd& x) {
+      const Eigen::ArrayXd g = (-0.5 * x.array().square()).exp() /
+                               std::sqrt(2 * M_PI);
+      Eigen::MatrixXd fx(3, x.size());
+      fx.row(0) = g.matrix().transpose();
+      fx.row(1) = (x.array() * g).matrix().transpose();
+      fx.row(2) = (x.array().square() * g).matrix().transpose();
+      return fx;
+    };
+    const AdaptQuadResult res = adaptquadgkInf(F, -inf, inf);
+    std::cout << "moments of N(0,1): " << res.I.transpose()
+              << " (converged = " << res.converged << ")\n";
+  }
+
+  // Semi-infinite intervals
+  {
+    auto f = [](double x) { return std::exp(-x) * std::cos(x); };
+    std::cout << "int_0^inf exp(-x)cos(x) dx - 1/2 = "
+              << adaptquadgk(f, 0.0, inf) - 0.5 << "\n";
+    auto g = [](double x) { return 1.0 / (1.0 + x * x); };
+    std::cout << "int_-inf^1 1/(1+x^2) dx - 3pi/4 = "
+              << adaptquadgk(g, -inf, 1.0) - 0.75 * M_PI << "\n";
+  }
+  return 0;
+}
@@ -0,0 +1,68 @@
+#include <cmath>
+#include <iomanip>
+#include <iostream>
+#include <limits>
+
+#include "adaptquadgk.hpp"
+
+// Checks of the orientation: for a > b the integrals over [b, a] are
+// reproduced with the opposite sign and the requested accuracy, also for
+// infinite endpoints. Returns the number of failed checks.
+int main() {
+  std::cout << std::setprecision(3) << std::scientific;
+  const double inf = std::numeric_limits<double>::infinity();
+  int failed = 0;
+  auto check = [&failed](const char* name, double I, double exact,
+                         double tol, bool converged) {
+    const double err = std::abs(I - exact);
+    const bool ok = converged && err <= tol;
+    std::cout << (ok ? "passed: " : "FAILED: ") << name << ", error = " << err
+              << ", converged = " << converged << "\n";
+    failed += !ok;
+  };
+  AdaptQuadOptions opt;
+  opt.rtol = 1e-12;
+  opt.atol = 0.;
+
+  // Sharp peak: the unrefined K15 result is far off
+  {
+    auto F = [](const Eigen::VectorXd& x) -> Eigen::MatrixXd {
+      return (1.0 / (1e-4 + (x.array() - 0.3).square())).matrix().transpose();
+    };
+    const double exact =
+        100.0 * (std::atan(0.7 / 1e-2) + std::atan(0.3 / 1e-2));
+    const AdaptQuadResult fwd = adaptquadgkBatch(F, 0.0, 1.0, opt);
+    const AdaptQuadResult rev = adaptquadgkBatch(F, 1.0, 0.0, opt);
+    check("peak on [0,1]", fwd.I(0), exact, 1e-10 * exact, fwd.converged);
+    check("peak on [1,0]", rev.I(0), -exact, 1e-10 * exact, rev.converged);
+    if (rev.num_intervals != fwd.num_intervals) {
+      std::cout << "FAILED: " << rev.num_intervals << " intervals on [1,0], "
+                << fwd.num_intervals << " on [0,1]\n";
+      ++failed;
+    }
+  }
+
+  // Reversed semi-infinite and infinite intervals
+  {
+    auto I = [&opt](auto f, double a, double b) {
+      auto F = [&f](const Eigen::VectorXd& x) {
+        Eigen::MatrixXd fx(1, x.size());
+        for (Eigen::Index j = 0; j < x.size(); ++j) fx(0, j) = f(x(j));
+        return fx;
+      };
+      return adaptquadgkInf(F, a, b, opt);
+    };
+    auto f = [](double x) { return std::exp(-x) * std::cos(x); };
+    auto g = [](double x) { return 1.0 / (1.0 + x * x); };
+    auto h = [](double x) { return std::exp(-x * x); };
+    AdaptQuadResult res = I(f, inf, 0.0);
+    check("exp(-x)cos(x) on [inf,0]", res.I(0), -0.5, 1e-10, res.converged);
+    res = I(g, 1.0, -inf);
+    check("1/(1+x^2) on [1,-inf]", res.I(0), -0.75 * M_PI, 1e-10,
+          res.converged);
+    res = I(h, inf, -inf);
+    check("exp(-x^2) on [inf,-inf]", res.I(0), -std::sqrt(M_PI), 1e-10,
+          res.converged);
+  }
+  return failed;
+}
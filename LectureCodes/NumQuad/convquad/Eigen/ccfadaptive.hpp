@@ -0,0 +1,70 @@
+#pragma once
+
+#include <Eigen/Dense>
+#include <cassert>
+#include <cmath>
+#include <complex>
+#include <unsupported/Eigen/FFT>
+#include <utility>
+
+// Weights of the Clenshaw-Curtis-Fejer rule with the n+1 nodes cos(j pi/n)
+// on [-1,1], O(n log n) by FFT, cf. CCFQuadRule_Fast in the
+// ClenshawCurtisFejer problem
+inline Eigen::VectorXd ccfWeights(unsigned int n) {
+  assert(n > 0);
+  Eigen::VectorXd w(n + 1);
+  if (n == 1) {
+    w << 1.0, 1.0;
+    return w;
+  }
+  const unsigned int m = n / 2;
+  Eigen::VectorXcd z = Eigen::VectorXcd::Zero(n);
+  z[0] = 1.0;
+  for (unsigned int l = 1; l <= m; ++l) z[l] = -2.0 / (4.0 * l * l - 1.0);
+  if (n % 2 == 0) z[m] /= 2.0;
+  Eigen::FFT<double> fft;
+  Eigen::VectorXcd fz(n);
+  fft.fwd(fz, z);
+  w.head(n) = 2.0 * fz.real() / n;
+  w[0] /= 2.0;
+  w[n] = w[0];
+  return w;
+}
+
+/* SAM_LISTING_BEGIN_0 */
+// Adaptive Clenshaw-Curtis-Fejer quadrature on [a,b] with n = n0, 2n0,
+// 4n0, ... subintervals. The nodes of the rule for n are the even-numbered
+// nodes of the rule for 2n, so the values of f are kept and f is only
+// evaluated at the new nodes. Returns the integral and the error estimate
+// |Q_2n - Q_n|.
+template <class Function>
+std::pair<double, double> ccfAdaptive(Function &&f, double a, double b,
+                                      double rtol = 1e-10,
+                                      double atol = 1e-14,
+                                      unsigned int n0 = 8,
+                                      unsigned int nmax = 1u << 16) {
+  assert(n0 >= 1);
+  const double c = 0.5 * (a + b), h = 0.5 * (b - a);
+  unsigned int n = n0;
+  Eigen::VectorXd fx(n + 1);
+  for (unsigned int j = 0; j <= n; ++j) {
+    fx[j] = f(c + h * std::cos(j * M_PI / n));
+  }
+  double Q = h * ccfWeights(n).dot(fx);
+  double err = std::abs(Q);
+  while (2 * n <= nmax) {
+    Eigen::VectorXd fx2(2 * n + 1);
+    for (unsigned int j = 0; j <= n; ++j) fx2[2 * j] = fx[j];  // reuse
+    for (unsigned int j = 0; j < n; ++j) {
+      fx2[2 * j + 1] = f(c + h * std::cos((2 * j + 1) * M_PI / (2 * n)));
+    }
+    n *= 2;
+    fx.swap(fx2);
+    const double Q2 = h * ccfWeights(n).dot(fx);
+    err = std::abs(Q2 - Q);
+    Q = Q2;
+    if (err <= std::max(atol, rtol * std::abs(Q))) break;
+  }
+  return {Q, err};
+}
+/* SAM_LISTING_END_0 */
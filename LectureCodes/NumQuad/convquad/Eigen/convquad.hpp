@@ -0,0 +1,334 @@
+#pragma once
+
+#include <Eigen/Dense>
+#include <cassert>
+#include <cmath>
+#include <complex>
+#include <limits>
+#include <unsupported/Eigen/FFT>
+#include <utility>
+#include <vector>
+
+/* Convolution quadrature (CQ) time stepping based on the implicit Euler
+ * method (BDF1), for problems of the form
+ *   u_n = sum_{k=0}^n omega_{n-k} g_k,
+ *   g_n = step(n, sum_{k<n} omega_{n-k} g_k),
+ * where omega_j are the CQ weights of a Laplace transform F. The callback
+ * step() solves for g_n once the history sum is known (e.g. a Volterra
+ * integral equation or a fractional differential equation).
+ * Three drivers:
+ * - cqSolveNaive():     direct summation, O(N^2) work, O(N) memory,
+ * - cqSolveFFT():       Hairer-Lubich-Schlichte block-triangular splitting,
+ *                       off-diagonal blocks by FFT, O(N log^2 N) work,
+ * - FastObliviousCQ:    Lubich-Schaedle fast and oblivious CQ, the history
+ *                       is kept in O(K log N) contour states, O(K N log N)
+ *                       work (K nodes per contour). */
+
+using Comp = std::complex<double>;
+
+/* SAM_LISTING_BEGIN_0 */
+// CQ weights omega_0,...,omega_N for the Laplace transform F and BDF1,
+// computed by the trapezoidal rule on the circle of radius r and one FFT,
+// cf. compute_cq_weights() in the ConvolutionQuadrature problem. The number
+// of points L >= 2(N+1) is a power of two, which keeps the FFT fast for all N
+// and limits the amplification r^(-N) of round-off to eps^(-1/4).
+template <typename FFUNCTOR>
+Eigen::VectorXd cqWeights(FFUNCTOR &&F, unsigned int N, double tau,
+                          double r = 0.0) {
+  unsigned int L = 1;
+  while (L < 2 * (N + 1)) L *= 2;
+  if (r == 0.0) {
+    r = std::pow(std::numeric_limits<double>::epsilon(), 0.5 / L);
+  }
+  Eigen::VectorXcd v(L);
+  const Comp expfac = 2.0 * M_PI * Comp(0.0, 1.0) / double(L);
+  for (unsigned int k = 0; k < L; ++k) {
+    v[k] = F((1.0 - r * std::exp(expfac * static_cast<double>(k))) / tau);
+  }
+  Eigen::FFT<double> fft;
+  Eigen::VectorXcd w(L);
+  fft.fwd(w, v);
+  Eigen::VectorXd omega(N + 1);
+  double fac = L;
+  for (unsigned int k = 0; k <= N; ++k) {
+    omega[k] = w[k].real() / fac;
+    fac *= r;
+  }
+  return omega;
+}
+/* SAM_LISTING_END_0 */
+
+// Naive CQ time stepping: O(N^2) operations
+template <typename STEPFUNCTOR>
+Eigen::VectorXd cqSolveNaive(const Eigen::VectorXd &omega,
+                             STEPFUNCTOR &&step) {
+  const unsigned int N = omega.size() - 1;
+  Eigen::VectorXd g(N + 1);
+  for (unsigned int n = 0; n <= N; ++n) {
+    double h = 0.0;
+    for (unsigned int k = 0; k < n; ++k) h += omega[n - k] * g[k];
+    g[n] = step(n, h);
+  }
+  return g;
+}
+
+namespace convquad_detail {
+// Linear convolution of two real sequences by zero-padded FFT
+inline Eigen::VectorXd fftConv(const Eigen::VectorXd &a,
+                               const Eigen::VectorXd &b,
+                               Eigen::FFT<double> &fft) {
+  const Eigen::Index m = a.size() + b.size() - 1;
+  Eigen::Index L = 1;
+  while (L < m) L *= 2;
+  Eigen::VectorXcd ap = Eigen::VectorXcd::Zero(L), bp = ap;
+  ap.head(a.size()) = a.cast<Comp>();
+  bp.head(b.size()) = b.cast<Comp>();
+  Eigen::VectorXcd fa(L), fb(L), c(L);
+  fft.fwd(fa, ap);
+  fft.fwd(fb, bp);
+  fa = fa.cwiseProduct(fb);
+  fft.inv(c, fa);
+  return c.head(m).real();
+}
+
+// Hairer-Lubich-Schlichte recursion: computes g_n for n in [lo,hi), given
+// that hist[n] already contains all contributions of g_k, k < lo
+template <typename STEPFUNCTOR>
+void hlsRecursion(const Eigen::VectorXd &omega, STEPFUNCTOR &step,
+                  Eigen::VectorXd &g, Eigen::VectorXd &hist, unsigned int lo,
+                  unsigned int hi, unsigned int nmin, Eigen::FFT<double> &fft) {
+  if (hi - lo <= nmin) {
+    // small diagonal block: direct summation
+    for (unsigned int n = lo; n < hi; ++n) {
+      double h = hist[n];
+      for (unsigned int k = lo; k < n; ++k) h += omega[n - k] * g[k];
+      g[n] = step(n, h);
+    }
+    return;
+  }
+  const unsigned int mid = lo + (hi - lo) / 2;
+  hlsRecursion(omega, step, g, hist, lo, mid, nmin, fft);
+  // off-diagonal block: hist[n] += sum_{k=lo}^{mid-1} omega_{n-k} g_k for
+  // n in [mid,hi) is a piece of a Toeplitz matrix-vector product
+  const Eigen::VectorXd c =
+      fftConv(g.segment(lo, mid - lo), omega.head(hi - lo), fft);
+  hist.segment(mid, hi - mid) += c.segment(mid - lo, hi - mid);
+  hlsRecursion(omega, step, g, hist, mid, hi, nmin, fft);
+}
+}  // namespace convquad_detail
+
+/* SAM_LISTING_BEGIN_1 */
+// CQ time stepping with O(N log^2 N) operations: the lower triangular
+// Toeplitz matrix of the weights is split recursively into diagonal blocks,
+// which are treated recursively, and square off-diagonal blocks, whose
+// products with the already known g_k are computed by FFT.
+template <typename STEPFUNCTOR>
+Eigen::VectorXd cqSolveFFT(const Eigen::VectorXd &omega, STEPFUNCTOR &&step,
+                           unsigned int nmin = 64) {
+  const unsigned int N = omega.size() - 1;
+  Eigen::VectorXd g(N + 1), hist = Eigen::VectorXd::Zero(N + 1);
+  Eigen::FFT<double> fft;
+  convquad_detail::hlsRecursion(omega, step, g, hist, 0, N + 1,
+                                std::max(nmin, 1u), fft);
+  return g;
+}
+/* SAM_LISTING_END_1 */
+
+/* SAM_LISTING_BEGIN_2 */
+// Fast and oblivious convolution quadrature [Schaedle, Lopez-Fernandez,
+// Lubich, SIAM J. Sci. Comput. 28 (2006)] for BDF1.
+// With the local block length n_0 and the sizes s_l = n_0 B^l, the history
+// sum is split as
+//   sum_{k<n} omega_{n-k} g_k = sum_{k=b_0}^{n-1} omega_{n-k} g_k
+//                               + sum_{l>=1} sum_{k=b_l}^{b_{l-1}-1} ...,
+// b_l = s_l (floor(n/s_l) - 1), so that n-k is in [s_{l-1}, 2 s_l] on
+// level l. There, the weights are represented as contour integrals
+//   omega_m = 1/(2 pi i) int_Gamma_l F(lambda) tau (1-tau lambda)^(-m-1)
+// along a hyperbola Gamma_l adapted to [s_{l-1} tau, 2 s_l tau]. Then the
+// sum over a block is given by the (frozen) implicit Euler solutions
+// y' = lambda y + g at the quadrature nodes. Only 2 n_0 recent values of g
+// and O(K) complex states per level are stored.
+template <typename FFUNCTOR>
+class FastObliviousCQ {
+ public:
+  // F: Laplace transform, analytic in the complex plane outside the sector
+  //    |arg(-s)| <= delta around the negative real axis
+  // tau: time step, B: base of the geometric splitting, K: number of
+  //    quadrature nodes on each contour (2K+1 in total), n0: length of the
+  //    blocks summed directly (0 = B^2; for smaller distances the implicit
+  //    Euler weights are not well represented by the contour integral)
+  FastObliviousCQ(FFUNCTOR F, double tau, unsigned int B = 5,
+                  unsigned int K = 30, unsigned int n0 = 0, double delta = 0.0)
+      : F_(std::move(F)), tau_(tau), B_(B), K_(K), n0_(n0 ? n0 : B * B),
+        delta_(delta) {
+    assert(B_ >= 2 && K_ >= 1);
+    local_omega_ = cqWeights(F_, 2 * n0_, tau_);
+  }
+
+  // Run N+1 steps with the callback g_n = step(n, history sum)
+  template <typename STEPFUNCTOR>
+  Eigen::VectorXd solve(unsigned int N, STEPFUNCTOR &&step);
+
+  // Number of complex numbers kept for the history (memory footprint)
+  std::size_t numStates() const {
+    std::size_t s = 0;
+    for (const auto &lev : levels_) {
+      s += (lev.acc.size() + lev.snaps.size() + 1) * lev.lambda.size();
+    }
+    return s;
+  }
+
+ private:
+  // Running implicit-Euler state for all k >= start
+  struct Accumulator {
+    unsigned long start;
+    Eigen::VectorXcd y;
+  };
+  // Frozen state y = sum_{k in [start,end)} e_{end-1-k} g_k
+  struct Snapshot {
+    unsigned long start, end;
+    Eigen::VectorXcd y;
+  };
+  struct Level {
+    unsigned long sub, size;  // s_{l-1}, s_l
+    Eigen::VectorXcd lambda;  // quadrature nodes on the contour
+    Eigen::VectorXcd coef;    // weights h/(2 pi i) F(lambda) lambda'(x)
+    Eigen::VectorXcd amp;     // 1/(1-tau lambda)
+    std::vector<Accumulator> acc;
+    std::vector<Snapshot> snaps;
+    // snapshot of the block [cur_lo,cur_hi) propagated to the current step
+    unsigned long cur_lo = 0, cur_hi = 0;
+    Eigen::VectorXcd cur;
+  };
+
+  void addLevel(unsigned long sub);
+  double levelSum(Level &lev, unsigned long b_lo, unsigned long b_hi,
+                  unsigned long n) const;
+
+  FFUNCTOR F_;
+  double tau_;
+  unsigned long B_;
+  unsigned int K_;
+  unsigned long n0_;
+  double delta_;
+  Eigen::VectorXd local_omega_;
+  std::vector<Level> levels_;  // levels_[0] is level l = 1
+};
+
+// Hyperbolic contour lambda(x) = mu (1 + sin(i x - alpha)), trapezoidal rule
+// with nodes x_j = j h, |j| <= K, parameters from [Lopez-Fernandez, Palencia,
+// Schaedle, SINUM 44 (2006)] for t in [t0, Lambda t0]. The contour is
+// symmetric, only nodes with x_j >= 0 are stored, the others enter through
+// complex conjugation.
+template <typename FFUNCTOR>
+void FastObliviousCQ<FFUNCTOR>::addLevel(unsigned long sub) {
+  Level lev;
+  lev.sub = sub;
+  lev.size = sub * B_;
+  const double t0 = tau_ * sub, Lambda = 2.0 * B_;
+  const double alpha = 0.5 * (M_PI_2 - delta_) + 0.05;
+  const double d = 0.5 * (M_PI_2 - delta_) - 0.1;
+  const double theta = 0.7;  // balances discretization and round-off error
+  const double a = std::acosh(Lambda / ((1.0 - theta) * std::sin(alpha)));
+  const double h = a / K_;
+  const double mu = 2.0 * M_PI * d * K_ * (1.0 - theta) / (t0 * Lambda * a);
+  lev.lambda.resize(K_ + 1);
+  lev.coef.resize(K_ + 1);
+  lev.amp.resize(K_ + 1);
+  for (unsigned int j = 0; j <= K_; ++j) {
+    const Comp ix(0.0, j * h);
+    const Comp lambda = mu * (1.0 + std::sin(ix - alpha));
+    const Comp dlambda = Comp(0.0, 1.0) * mu * std::cos(ix - alpha);
+    lev.lambda[j] = lambda;
+    // node x = 0 is counted once, the others twice (conjugate pairs)
+    lev.coef[j] = (j == 0 ? 0.5 : 1.0) * h / (2.0 * M_PI * Comp(0.0, 1.0)) *
+                  F_(lambda) * dlambda;
+    lev.amp[j] = 1.0 / (1.0 - tau_ * lambda);
+  }
+  levels_.push_back(std::move(lev));
+}
+
+// Contribution sum_{k=b_lo}^{b_hi-1} omega_{n-k} g_k of one level from the
+// snapshot of the block [b_lo,b_hi). Must be called in every step in which
+// the block is non-empty: the propagated state is advanced by one implicit
+// Euler step per call, powers of amp are only formed when the block changes.
+template <typename FFUNCTOR>
+double FastObliviousCQ<FFUNCTOR>::levelSum(Level &lev, unsigned long b_lo,
+                                           unsigned long b_hi,
+                                           unsigned long n) const {
+  if (b_hi <= b_lo) return 0.0;
+  if (b_lo == lev.cur_lo && b_hi == lev.cur_hi) {
+    lev.cur = lev.cur.cwiseProduct(lev.amp);
+  } else {
+    const Snapshot *snap = nullptr;
+    for (const auto &s : lev.snaps) {
+      if (s.start == b_lo && s.end == b_hi) snap = &s;
+    }
+    assert(snap != nullptr && "FastObliviousCQ: missing snapshot");
+    // propagate the frozen state from time b_hi-1 to time n
+    lev.cur.resize(lev.amp.size());
+    for (Eigen::Index j = 0; j < lev.amp.size(); ++j) {
+      lev.cur[j] = std::pow(lev.amp[j], double(n - b_hi + 1)) * snap->y[j];
+    }
+    lev.cur_lo = b_lo;
+    lev.cur_hi = b_hi;
+  }
+  return 2.0 * lev.coef.dot(lev.cur.conjugate()).real();
+}
+
+template <typename FFUNCTOR>
+template <typename STEPFUNCTOR>
+Eigen::VectorXd FastObliviousCQ<FFUNCTOR>::solve(unsigned int N,
+                                                 STEPFUNCTOR &&step) {
+  // levels l = 1,...,L with 2 s_{l-1} <= N, their accumulators must start
+  // at k = 0
+  levels_.clear();
+  for (unsigned long sub = n0_; 2 * sub <= N; sub *= B_) addLevel(sub);
+  Eigen::VectorXd g(N + 1);  // returned to the caller, not used for history
+  std::vector<double> recent(2 * n0_, 0.0);  // ring buffer of recent g_k
+  for (unsigned long n = 0; n <= N; ++n) {
+    // local part: k in [b_0, n), direct summation
+    const unsigned long b0 = n >= n0_ ? n0_ * (n / n0_ - 1) : 0;
+    double h = 0.0;
+    for (unsigned long k = b0; k < n; ++k) {
+      h += local_omega_[n - k] * recent[k % (2 * n0_)];
+    }
+    // levels l >= 1
+    unsigned long b_hi = b0;
+    for (auto &lev : levels_) {
+      const unsigned long q = n / lev.size;
+      const unsigned long b_lo = q >= 1 ? lev.size * (q - 1) : 0;
+      h += levelSum(lev, b_lo, b_hi, n);
+      b_hi = b_lo;
+    }
+    const double gn = step(n, h);
+    g[n] = gn;
+    recent[n % (2 * n0_)] = gn;
+    // update the states of all levels with g_n
+    for (auto &lev : levels_) {
+      if (n % lev.size == 0) {
+        lev.acc.push_back({n, Eigen::VectorXcd::Zero(lev.lambda.size())});
+        // only the two most recent accumulators can still be needed
+        if (lev.acc.size() > 2) lev.acc.erase(lev.acc.begin());
+      }
+      for (auto &a : lev.acc) {
+        // implicit Euler step for y' = lambda y + g
+        a.y = ((a.y.array() + tau_ * gn) * lev.amp.array()).matrix();
+      }
+      if ((n + 1) % lev.sub == 0) {
+        for (const auto &a : lev.acc) {
+          lev.snaps.push_back({a.start, n + 1, a.y});
+        }
+        // drop snapshots ending before b_{l-1} of the next step
+        const unsigned long bmin = n + 1 - lev.sub;
+        std::vector<Snapshot> keep;
+        for (auto &s : lev.snaps) {
+          if (s.end >= bmin) keep.push_back(std::move(s));
+        }
+        lev.snaps.swap(keep);
+      }
+    }
+  }
+  return g;
+}
+/* SAM_LISTING_END_2 */
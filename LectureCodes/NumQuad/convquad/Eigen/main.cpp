@@ -0,0 +1,84 @@
+#include <chrono>
+#include <cmath>
+#include <iomanip>
+#include <iostream>
+
+#include "ccfadaptive.hpp"
+#include "convquad.hpp"
+
+template <class Action>
+double timeit(Action &&a) {
+  const auto start = std::chrono::high_resolution_clock::now();
+  a();
+  const auto end = std::chrono::high_resolution_clock::now();
+  return std::chrono::duration<double>(end - start).count();
+}
+
+int main() {
+  std::cout << std::setprecision(3) << std::scientific;
+  constexpr double T = 1.0;
+
+  // Fractional relaxation equation D^{1/2} u = -lambda u + f on [0,T] with
+  // exact solution u(t) = t. CQ for F(s) = sqrt(s):
+  //   sum_{k<=n} omega_{n-k} u_k = -lambda u_n + f(t_n)
+  constexpr double lambda = 2.0;
+  auto F = [](Comp s) { return std::sqrt(s); };
+  auto f = [](double t) { return 2.0 * std::sqrt(t / M_PI) + lambda * t; };
+  std::cout << "Fractional relaxation, error at t = T\n"
+            << std::setw(8) << "N" << std::setw(11) << "naive" << std::setw(11)
+            << "t_naive" << std::setw(11) << "HLS-FFT" << std::setw(11)
+            << "t_FFT" << std::setw(11) << "FOCQ" << std::setw(11) << "t_FOCQ"
+            << std::setw(9) << "#states\n";
+  for (unsigned int N = 1u << 8; N <= (1u << 18); N *= 4) {
+    const double tau = T / N;
+    const Eigen::VectorXd omega = cqWeights(F, N, tau);
+    auto step = [&omega, tau, f](unsigned int n, double h) {
+      return (f(n * tau) - h) / (omega[0] + lambda);
+    };
+    std::cout << std::setw(8) << N;
+    if (N <= (1u << 14)) {
+      Eigen::VectorXd u;
+      const double t = timeit([&] { u = cqSolveNaive(omega, step); });
+      std::cout << std::setw(11) << std::abs(u[N] - T) << std::setw(11) << t;
+    } else {
+      std::cout << std::setw(11) << "-" << std::setw(11) << "-";
+    }
+    Eigen::VectorXd u;
+    double t = timeit([&] { u = cqSolveFFT(omega, step); });
+    std::cout << std::setw(11) << std::abs(u[N] - T) << std::setw(11) << t;
+    FastObliviousCQ<decltype(F)> focq(F, tau);
+    auto step_focq = [tau, f, w0 = omega[0]](unsigned int n, double h) {
+      return (f(n * tau) - h) / (w0 + lambda);
+    };
+    t = timeit([&] { u = focq.solve(N, step_focq); });
+    std::cout << std::setw(11) << std::abs(u[N] - T) << std::setw(11) << t
+              << std::setw(8) << focq.numStates() << "\n";
+  }
+
+  // Riemann-Liouville integral I^{1/2} cos, F(s) = s^{-1/2}; the reference
+  // value int_0^t (t-s)^{-1/2} cos(s) ds / sqrt(pi), transformed by
+  // t-s = v^2, is computed by adaptive Clenshaw-Curtis-Fejer quadrature
+  {
+    auto G = [](Comp s) { return 1.0 / std::sqrt(s); };
+    auto ref = ccfAdaptive(
+        [T](double v) { return 2.0 * std::cos(T - v * v) / std::sqrt(M_PI); },
+        0.0, std::sqrt(T));
+    std::cout << "\nRiemann-Liouville integral, reference "
+              << std::setprecision(15) << ref.first << std::setprecision(3)
+              << " (estimated error " << ref.second << ")\n";
+    for (unsigned int N = 1u << 8; N <= (1u << 16); N *= 4) {
+      const double tau = T / N;
+      const Eigen::VectorXd omega = cqWeights(G, N, tau);
+      double uN = 0.0;
+      auto step = [&](unsigned int n, double h) {
+        const double g = std::cos(n * tau);
+        if (n == N) uN = h + omega[0] * g;
+        return g;
+      };
+      cqSolveFFT(omega, step);
+      std::cout << "N = " << std::setw(6) << N
+                << ": error = " << std::abs(uN - ref.first) << "\n";
+    }
+  }
+  return 0;
+}
@@ -0,0 +1,299 @@
+#pragma once
+
+#include <Eigen/Dense>
+#include <cassert>
+#include <cmath>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <tuple>
+#include <vector>
+
+#include "gaussrules.hpp"
+#include "parallel.hpp"
+
+/* Cubature in d dimensions:
+ * - tensor-product Gauss-Legendre rules on [-1,1]^d,
+ * - Smolyak sparse grids built from nested Clenshaw-Curtis rules,
+ * - conical product (collapsed coordinates) rules on the unit simplex,
+ * - a cache for the node sets and a batched, parallel evaluation of the
+ *   integrand: F receives a d x m matrix of nodes and returns m values. */
+
+// Cubature rule: nodes in the columns of a d x N matrix
+struct CubatureRule {
+  Eigen::MatrixXd nodes;
+  Eigen::VectorXd weights;
+};
+
+/* SAM_LISTING_BEGIN_0 */
+// Clenshaw-Curtis rule on [-1,1] with n = 2^(l-1)+1 nodes for level l >= 2
+// and the midpoint rule for l = 1. The node sets are nested.
+inline GaussRule clenshawCurtis(unsigned int l) {
+  assert(l >= 1);
+  GaussRule qr;
+  if (l == 1) {
+    qr.nodes = Eigen::VectorXd::Zero(1);
+    qr.weights = Eigen::VectorXd::Constant(1, 2.0);
+    return qr;
+  }
+  const unsigned int N = 1u << (l - 1);  // number of subintervals
+  qr.nodes.resize(N + 1);
+  qr.weights.resize(N + 1);
+  for (unsigned int j = 0; j <= N; ++j) {
+    // explicit formula for the weights [Waldvogel 2006]
+    double s = 0.0;
+    for (unsigned int k = 1; k <= N / 2; ++k) {
+      const double b = (2 * k == N) ? 1.0 : 2.0;
+      s += b / (4.0 * k * k - 1.0) * std::cos(2.0 * k * j * M_PI / N);
+    }
+    const double c = (j == 0 || j == N) ? 1.0 : 2.0;
+    // ascending order: x_j = -cos(j pi/N)
+    qr.nodes(j) = -std::cos(j * M_PI / N);
+    qr.weights(j) = c / N * (1.0 - s);
+  }
+  if (N % 2 == 0) qr.nodes(N / 2) = 0.0;
+  return qr;
+}
+/* SAM_LISTING_END_0 */
+
+// Tensor product of the one-dimensional rules Q[0],...,Q[d-1]
+inline CubatureRule tensorRule(const std::vector<GaussRule>& Q) {
+  const unsigned int d = Q.size();
+  assert(d >= 1);
+  Eigen::Index N = 1;
+  for (const auto& q : Q) N *= q.nodes.size();
+  CubatureRule cr;
+  cr.nodes.resize(d, N);
+  cr.weights.resize(N);
+  std::vector<Eigen::Index> idx(d, 0);  // multi-index, first index fastest
+  for (Eigen::Index k = 0; k < N; ++k) {
+    double w = 1.0;
+    for (unsigned int i = 0; i < d; ++i) {
+      cr.nodes(i, k) = Q[i].nodes(idx[i]);
+      w *= Q[i].weights(idx[i]);
+    }
+    cr.weights(k) = w;
+    for (unsigned int i = 0; i < d; ++i) {  // increment multi-index
+      if (++idx[i] < Q[i].nodes.size()) break;
+      idx[i] = 0;
+    }
+  }
+  return cr;
+}
+
+// Tensor-product Gauss-Legendre rule with n^d nodes on [-1,1]^d
+inline CubatureRule tensorGauss(unsigned int d, unsigned int n) {
+  const auto qr = gaussRule(GaussFamily::Legendre, n);
+  return tensorRule(std::vector<GaussRule>(d, *qr));
+}
+
+/* SAM_LISTING_BEGIN_1 */
+// Smolyak sparse grid on [-1,1]^d of level k >= 0 based on nested
+// Clenshaw-Curtis rules (combination technique):
+//   A(q,d) = sum_{q-d+1 <= |l| <= q} (-1)^(q-|l|) binom(d-1,q-|l|)
+//            U^{l_1} x ... x U^{l_d},   q = d+k,  l_i >= 1.
+// Because of nestedness every node is a node of the level-(k+1) CC rule in
+// each direction; coinciding nodes of different tensor grids are merged by
+// their integer coordinates on that finest grid.
+inline CubatureRule smolyakCC(unsigned int d, unsigned int k) {
+  assert(d >= 1);
+  const unsigned int q = d + k, lmax = k + 1;
+  const unsigned int Nmax = lmax == 1 ? 0 : 1u << (lmax - 1);
+  std::vector<GaussRule> cc(lmax + 1);
+  for (unsigned int l = 1; l <= lmax; ++l) cc[l] = clenshawCurtis(l);
+  // integer coordinate on the finest grid of node j of the level-l rule
+  auto finest = [Nmax](unsigned int l, unsigned int j) -> unsigned int {
+    return l == 1 ? Nmax / 2 : j * (Nmax >> (l - 1));
+  };
+  auto binom = [](unsigned int n, unsigned int r) {
+    double b = 1.0;
+    for (unsigned int i = 1; i <= r; ++i) b = b * (n - r + i) / i;
+    return b;
+  };
+  std::map<std::vector<unsigned int>, double> grid;
+  // enumerate all level multi-indices l with d <= |l| <= q
+  std::vector<unsigned int> l(d, 1);
+  while (true) {
+    unsigned int norm = 0;
+    for (auto li : l) norm += li;
+    if (norm + d > q) {  // |l| >= q-d+1 is required
+      const double coef = ((q - norm) % 2 == 0 ? 1.0 : -1.0) *
+                          binom(d - 1, q - norm);
+      // add the tensor grid U^{l_1} x ... x U^{l_d}
+      std::vector<unsigned int> j(d, 0), key(d);
+      while (true) {
+        double w = coef;
+        for (unsigned int i = 0; i < d; ++i) {
+          key[i] = finest(l[i], j[i]);
+          w *= cc[l[i]].weights(j[i]);
+        }
+        grid[key] += w;
+        unsigned int i = 0;
+        for (; i < d; ++i) {
+          if (++j[i] < cc[l[i]].nodes.size()) break;
+          j[i] = 0;
+        }
+        if (i == d) break;
+      }
+    }
+    // next multi-index with |l| <= q
+    unsigned int i = 0;
+    for (; i < d; ++i) {
+      ++l[i];
+      unsigned int s = 0;
+      for (auto li : l) s += li;
+      if (s <= q) break;
+      l[i] = 1;
+    }
+    if (i == d) break;
+  }
+  CubatureRule cr;
+  cr.nodes.resize(d, grid.size());
+  cr.weights.resize(grid.size());
+  Eigen::Index c = 0;
+  const GaussRule& fine = cc[lmax];
+  for (const auto& node : grid) {
+    for (unsigned int i = 0; i < d; ++i) {
+      cr.nodes(i, c) = fine.nodes(node.first[i]);
+    }
+    cr.weights(c++) = node.second;
+  }
+  return cr;
+}
+/* SAM_LISTING_END_1 */
+
+/* SAM_LISTING_BEGIN_2 */
+// Conical product rule with n^d nodes on the unit simplex
+// {x_i >= 0, x_1+...+x_d <= 1}, exact for polynomials of degree 2n-1.
+// Collapsed coordinates x_1 = t_1, x_i = t_i (1-t_1)...(1-t_{i-1}) have the
+// Jacobian prod_i (1-t_i)^(d-i), which is absorbed into Gauss-Jacobi weights.
+inline CubatureRule simplexRule(unsigned int d, unsigned int n) {
+  assert(d >= 1 && n >= 1);
+  std::vector<GaussRule> Q(d);
+  for (unsigned int i = 0; i < d; ++i) {
+    const double alpha = d - 1 - i;
+    Q[i] = *gaussRule(GaussFamily::Jacobi, n, alpha, 0.0);
+    // map from [-1,1] to [0,1]: (1-t)^alpha dt = 2^(-alpha-1) (1-s)^alpha ds
+    Q[i].nodes = 0.5 * (Q[i].nodes.array() + 1.0);
+    Q[i].weights *= std::pow(0.5, alpha + 1.0);
+  }
+  CubatureRule cr = tensorRule(Q);
+  for (Eigen::Index k = 0; k < cr.nodes.cols(); ++k) {
+    double s = 1.0;  // (1-t_1)...(1-t_{i-1})
+    for (unsigned int i = 0; i < d; ++i) {
+      const double t = cr.nodes(i, k);
+      cr.nodes(i, k) = t * s;
+      s *= 1.0 - t;
+    }
+  }
+  return cr;
+}
+/* SAM_LISTING_END_2 */
+
+enum class CubatureKind { TensorGauss, SmolyakCC, Simplex };
+
+// Thread-safe cache of cubature rules keyed by (kind, d, n), where n is the
+// number of 1D nodes (TensorGauss, Simplex) or the Smolyak level
+class CubatureRuleCache {
+ public:
+  static CubatureRuleCache& instance() {
+    static CubatureRuleCache cache;
+    return cache;
+  }
+
+  std::shared_ptr<const CubatureRule> get(CubatureKind kind, unsigned int d,
+                                          unsigned int n) {
+    const Key key{kind, d, n};
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      auto it = rules_.find(key);
+      if (it != rules_.end()) return it->second;
+    }
+    std::shared_ptr<const CubatureRule> rule;
+    switch (kind) {
+      case CubatureKind::TensorGauss:
+        rule = std::make_shared<const CubatureRule>(tensorGauss(d, n));
+        break;
+      case CubatureKind::SmolyakCC:
+        rule = std::make_shared<const CubatureRule>(smolyakCC(d, n));
+        break;
+      case CubatureKind::Simplex:
+        rule = std::make_shared<const CubatureRule>(simplexRule(d, n));
+        break;
+    }
+    std::lock_guard<std::mutex> lock(mutex_);
+    return rules_.emplace(key, std::move(rule)).first->second;
+  }
+
+  void clear() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    rules_.clear();
+  }
+
+ private:
+  CubatureRuleCache() = default;
+  using Key = std::tuple<CubatureKind, unsigned int, unsigned int>;
+  std::mutex mutex_;
+  std::map<Key, std::shared_ptr<const CubatureRule>> rules_;
+};
+
+/* SAM_LISTING_BEGIN_3 */
+// Apply the rule (nodes affinely mapped by x -> A*x + c, weights multiplied
+// by scale) to the batched integrand F: (d x m nodes) -> m values.
+// Nodes are passed to F in blocks of at most block_size columns, blocks are
+// distributed over threads, the per-thread partial sums are added in a fixed
+// order, so that the result does not depend on timing.
+template <class BatchFunction>
+double applyCubature(BatchFunction&& F, const CubatureRule& cr,
+                     const Eigen::MatrixXd& A, const Eigen::VectorXd& c,
+                     double scale, unsigned int num_threads = 0,
+                     Eigen::Index block_size = 4096) {
+  const Eigen::Index N = cr.nodes.cols();
+  const Eigen::Index nblocks = (N + block_size - 1) / block_size;
+  std::vector<double> partial(numThreadsFor(nblocks, num_threads), 0.0);
+  parallelFor(
+      nblocks,
+      [&](std::size_t begin, std::size_t end, unsigned int t) {
+        for (std::size_t blk = begin; blk < end; ++blk) {
+          const Eigen::Index first = blk * block_size;
+          const Eigen::Index m = std::min(block_size, N - first);
+          const Eigen::MatrixXd X =
+              (A * cr.nodes.middleCols(first, m)).colwise() + c;
+          const Eigen::VectorXd fx = F(X);
+          partial[t] += cr.weights.segment(first, m).dot(fx);
+        }
+      },
+      num_threads);
+  double I = 0.0;
+  for (double p : partial) I += p;
+  return scale * I;
+}
+/* SAM_LISTING_END_3 */
+
+// Integral of F over the box [a_1,b_1] x ... x [a_d,b_d] using a rule on
+// [-1,1]^d (kind = TensorGauss with n nodes per direction, or SmolyakCC of
+// level n)
+template <class BatchFunction>
+double cubatureBox(BatchFunction&& F, const Eigen::VectorXd& a,
+                   const Eigen::VectorXd& b, CubatureKind kind, unsigned int n,
+                   unsigned int num_threads = 0) {
+  assert(a.size() == b.size() && kind != CubatureKind::Simplex);
+  const auto cr = CubatureRuleCache::instance().get(kind, a.size(), n);
+  const Eigen::VectorXd h = 0.5 * (b - a);
+  return applyCubature(F, *cr, h.asDiagonal().toDenseMatrix(), a + h, h.prod(),
+                       num_threads);
+}
+
+// Integral of F over the simplex with vertices in the columns of V (d x d+1)
+// using the conical product rule with n^d nodes
+template <class BatchFunction>
+double cubatureSimplex(BatchFunction&& F, const Eigen::MatrixXd& V,
+                       unsigned int n, unsigned int num_threads = 0) {
+  const Eigen::Index d = V.rows();
+  assert(V.cols() == d + 1);
+  const auto cr =
+      CubatureRuleCache::instance().get(CubatureKind::Simplex, d, n);
+  const Eigen::MatrixXd A = V.rightCols(d).colwise() - V.col(0);
+  return applyCubature(F, *cr, A, V.col(0), std::abs(A.determinant()),
+                       num_threads);
+}
@@ -0,0 +1,90 @@
+#include <chrono>
+#include <cmath>
+#include <iomanip>
+#include <iostream>
+
+#include "cubature.hpp"
+
+int main() {
+  std::cout << std::setprecision(3) << std::scientific;
+
+  // Laser beam intensity on the unit triangle, cf. NestedQuad
+  {
+    constexpr double I_ex = 0.366046550000405;
+    auto F = [](const Eigen::MatrixXd& X) -> Eigen::VectorXd {
+      return (-X.colwise().squaredNorm().array()).exp().matrix().transpose();
+    };
+    Eigen::MatrixXd V(2, 3);
+    V << 0, 1, 0, 0, 0, 1;
+    std::cout << "Unit triangle, exp(-x^2-y^2)\n";
+    for (unsigned int n = 1; n <= 10; ++n) {
+      std::cout << "n = " << std::setw(2) << n
+                << ", error = " << std::abs(cubatureSimplex(F, V, n) - I_ex)
+                << "\n";
+    }
+    // exactness on the unit tetrahedron: int x y^2 z^3 = 1! 2! 3! / 9!
+    auto G = [](const Eigen::MatrixXd& X) -> Eigen::VectorXd {
+      return (X.row(0).array() * X.row(1).array().square() *
+              X.row(2).array().cube())
+          .matrix()
+          .transpose();
+    };
+    Eigen::MatrixXd T(3, 4);
+    T << 0, 1, 0, 0, 0, 0, 1, 0, 0, 0, 0, 1;
+    std::cout << "tetrahedron, degree 6 monomial, n = 4: error = "
+              << std::abs(cubatureSimplex(G, T, 4) - 12.0 / 362880.0) << "\n";
+  }
+
+  // Smooth integrand on [0,1]^d: tensor-product Gauss vs sparse grid
+  std::cout << "\nexp(-|x|^2) on [0,1]^d\n";
+  for (unsigned int d : {4, 6, 8}) {
+    auto F = [](const Eigen::MatrixXd& X) -> Eigen::VectorXd {
+      return (-X.colwise().squaredNorm().array()).exp().matrix().transpose();
+    };
+    const double I_ex = std::pow(0.5 * std::sqrt(M_PI) * std::erf(1.0), d);
+    const Eigen::VectorXd a = Eigen::VectorXd::Zero(d);
+    const Eigen::VectorXd b = Eigen::VectorXd::Ones(d);
+    for (unsigned int n = 2; n <= 5; ++n) {
+      const auto N = CubatureRuleCache::instance()
+                         .get(CubatureKind::TensorGauss, d, n)
+                         ->nodes.cols();
+      std::cout << "d = " << d << ", tensor Gauss n = " << n << ": "
+                << std::setw(7) << N << " nodes, error = "
+                << std::abs(cubatureBox(F, a, b, CubatureKind::TensorGauss, n) -
+                            I_ex) / I_ex
+                << "\n";
+    }
+    for (unsigned int k = 1; k <= 5; ++k) {
+      const auto N = CubatureRuleCache::instance()
+                         .get(CubatureKind::SmolyakCC, d, k)
+                         ->nodes.cols();
+      std::cout << "d = " << d << ", Smolyak level " << k << ":   "
+                << std::setw(7) << N << " nodes, error = "
+                << std::abs(cubatureBox(F, a, b, CubatureKind::SmolyakCC, k) -
+                            I_ex) / I_ex
+                << "\n";
+    }
+  }
+
+  // Runtime of cached rule vs. rule generation, and threaded evaluation
+  {
+    const unsigned int d = 8, n = 6;
+    auto F = [](const Eigen::MatrixXd& X) -> Eigen::VectorXd {
+      return X.colwise().norm().array().cos().matrix().transpose();
+    };
+    const Eigen::VectorXd a = Eigen::VectorXd::Zero(d);
+    const Eigen::VectorXd b = Eigen::VectorXd::Ones(d);
+    std::cout << "\nd = 8, 6^8 tensor Gauss nodes (first run generates the "
+                 "rule, later runs take it from the cache)\n";
+    for (unsigned int p : {1, 2, 4}) {
+      const auto start = std::chrono::high_resolution_clock::now();
+      const double I = cubatureBox(F, a, b, CubatureKind::TensorGauss, n, p);
+      const auto end = std::chrono::high_resolution_clock::now();
+      std::cout << p << " thread(s): I = " << std::setprecision(12) << I
+                << std::setprecision(3) << ", time = "
+                << std::chrono::duration<double>(end - start).count()
+                << " s\n";
+    }
+  }
+  return 0;
+}
@@ -0,0 +1,317 @@
+#pragma once
+
+#include <Eigen/Dense>
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <limits>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <numeric>
+#include <stdexcept>
+#include <tuple>
+#include <vector>
+
+/* Generation of Gauss quadrature rules without dense eigensolvers:
+ * - O(n) Gauss-Legendre rules from asymptotic expansions + Newton's method
+ *   (Hale & Townsend, SIAM J. Sci. Comput. 35(2), 2013),
+ * - Golub-Welsch working on the tridiagonal Jacobi matrix only: implicit QL
+ *   iteration that tracks the first eigenvector components, O(n) memory,
+ * - a thread-safe cache, so that a rule is computed only once per process. */
+
+// Gauss rule: nodes sorted in ascending order and matching weights
+struct GaussRule {
+  Eigen::VectorXd nodes, weights;
+};
+
+// Weight functions for which Gauss rules can be generated
+//   Legendre: w(x) = 1 on [-1,1]
+//   Jacobi:   w(x) = (1-x)^alpha (1+x)^beta on [-1,1]
+//   Laguerre: w(x) = x^alpha exp(-x) on [0,infty)
+//   Hermite:  w(x) = exp(-x^2) on (-infty,infty)
+enum class GaussFamily { Legendre, Jacobi, Laguerre, Hermite };
+
+/* SAM_LISTING_BEGIN_0 */
+// Golub-Welsch algorithm on the symmetric tridiagonal Jacobi matrix with
+// diagonal a (length n) and off-diagonal b (length n-1), mu0 = int w(x) dx.
+// The nodes are the eigenvalues, the weights mu0 times the squares of the
+// first components of the normalized eigenvectors. Implicit QL with Wilkinson
+// shifts only needs to update the first row of the eigenvector matrix.
+inline GaussRule golubwelschTridiag(const Eigen::VectorXd& a,
+                                    const Eigen::VectorXd& b, double mu0) {
+  const int n = a.size();
+  assert(n >= 1 && b.size() >= n - 1 && "Inconsistent Jacobi matrix");
+  Eigen::VectorXd d = a;  // diagonal, converges to eigenvalues
+  Eigen::VectorXd e = Eigen::VectorXd::Zero(n);  // off-diagonal, padded
+  e.head(n - 1) = b.head(n - 1);
+  Eigen::VectorXd z = Eigen::VectorXd::Zero(n);  // first row of eigenvectors
+  z(0) = 1.0;
+  const double eps = std::numeric_limits<double>::epsilon();
+  for (int l = 0; l < n; ++l) {
+    int iter = 0;
+    int m;
+    do {
+      // Look for a single small off-diagonal entry to split the matrix
+      for (m = l; m < n - 1; ++m) {
+        const double dd = std::abs(d(m)) + std::abs(d(m + 1));
+        if (std::abs(e(m)) <= eps * dd) break;
+      }
+      if (m != l) {
+        if (iter++ == 60) {
+          throw std::runtime_error("golubwelschTridiag: no convergence");
+        }
+        // Wilkinson shift
+        double g = (d(l + 1) - d(l)) / (2.0 * e(l));
+        double r = std::hypot(g, 1.0);
+        g = d(m) - d(l) + e(l) / (g + std::copysign(r, g));
+        double s = 1.0, c = 1.0, p = 0.0;
+        int i;
+        for (i = m - 1; i >= l; --i) {
+          // Givens rotation chasing the bulge upwards
+          double f = s * e(i);
+          const double bb = c * e(i);
+          e(i + 1) = (r = std::hypot(f, g));
+          if (r == 0.0) {  // underflow: deflate
+            d(i + 1) -= p;
+            e(m) = 0.0;
+            break;
+          }
+          s = f / r;
+          c = g / r;
+          g = d(i + 1) - p;
+          r = (d(i) - g) * s + 2.0 * c * bb;
+          d(i + 1) = g + (p = s * r);
+          g = c * r - bb;
+          // Apply rotation to the first row of the eigenvector matrix only
+          f = z(i + 1);
+          z(i + 1) = s * z(i) + c * f;
+          z(i) = c * z(i) - s * f;
+        }
+        if (r == 0.0 && i >= l) continue;
+        d(l) -= p;
+        e(l) = g;
+        e(m) = 0.0;
+      }
+    } while (m != l);
+  }
+  // Sort nodes in ascending order
+  std::vector<int> idx(n);
+  std::iota(idx.begin(), idx.end(), 0);
+  std::sort(idx.begin(), idx.end(),
+            [&d](int i, int j) { return d(i) < d(j); });
+  GaussRule qr;
+  qr.nodes.resize(n);
+  qr.weights.resize(n);
+  for (int k = 0; k < n; ++k) {
+    qr.nodes(k) = d(idx[k]);
+    qr.weights(k) = mu0 * z(idx[k]) * z(idx[k]);
+  }
+  return qr;
+}
+/* SAM_LISTING_END_0 */
+
+// Gauss-Jacobi rule for the weight (1-x)^alpha (1+x)^beta, alpha,beta > -1,
+// from the three-term recursion of the orthonormal Jacobi polynomials
+inline GaussRule gaussJacobi(unsigned int n, double alpha, double beta) {
+  assert(n >= 1 && alpha > -1.0 && beta > -1.0);
+  const double ab = alpha + beta;
+  Eigen::VectorXd a(n), b(n - 1);
+  a(0) = (beta - alpha) / (ab + 2.0);
+  for (unsigned int k = 1; k < n; ++k) {
+    const double t = 2.0 * k + ab;
+    a(k) = (beta * beta - alpha * alpha) / (t * (t + 2.0));
+    if (k == 1) {  // (k+alpha+beta)/(t-1) cancels, avoids 0/0 for ab = -1
+      b(0) = std::sqrt(4.0 * (1.0 + alpha) * (1.0 + beta) /
+                       ((ab + 2.0) * (ab + 2.0) * (ab + 3.0)));
+    } else {
+      b(k - 1) = std::sqrt(4.0 * k * (k + alpha) * (k + beta) * (k + ab) /
+                           (t * t * (t + 1.0) * (t - 1.0)));
+    }
+  }
+  const double mu0 =
+      std::exp((ab + 1.0) * std::log(2.0) + std::lgamma(alpha + 1.0) +
+               std::lgamma(beta + 1.0) - std::lgamma(ab + 2.0));
+  return golubwelschTridiag(a, b, mu0);
+}
+
+// Generalized Gauss-Laguerre rule for the weight x^alpha exp(-x) on [0,infty)
+inline GaussRule gaussLaguerre(unsigned int n, double alpha = 0.0) {
+  assert(n >= 1 && alpha > -1.0);
+  Eigen::VectorXd a(n), b(n - 1);
+  for (unsigned int k = 0; k < n; ++k) {
+    a(k) = 2.0 * k + alpha + 1.0;
+    if (k > 0) b(k - 1) = std::sqrt(k * (k + alpha));
+  }
+  return golubwelschTridiag(a, b, std::tgamma(alpha + 1.0));
+}
+
+// Gauss-Hermite rule for the weight exp(-x^2) on the real axis
+inline GaussRule gaussHermite(unsigned int n) {
+  assert(n >= 1);
+  Eigen::VectorXd a = Eigen::VectorXd::Zero(n), b(n - 1);
+  for (unsigned int k = 1; k < n; ++k) b(k - 1) = std::sqrt(0.5 * k);
+  return golubwelschTridiag(a, b, std::sqrt(M_PI));
+}
+
+// Legendre polynomial P_n and its derivative at x by the three-term recursion,
+// O(n) operations
+inline std::pair<double, double> legendreRec(unsigned int n, double x) {
+  double p0 = 1.0, p1 = x;
+  for (unsigned int j = 2; j <= n; ++j) {
+    const double p2 = ((2.0 * j - 1.0) * x * p1 - (j - 1.0) * p0) / j;
+    p0 = p1;
+    p1 = p2;
+  }
+  return {p1, n * (x * p1 - p0) / (x * x - 1.0)};
+}
+
+// P_n(cos(theta)) and its derivative w.r.t. theta from the Stieltjes-type
+// asymptotic expansion [Hale & Townsend, (3.1)], O(1) operations per call.
+// Accurate to machine precision if n*sin(theta) is not small.
+inline std::pair<double, double> legendreAsy(unsigned int n, double theta) {
+  constexpr unsigned int M = 30;  // maximal number of terms
+  const double s = std::sin(theta), c = std::cos(theta);
+  // C_n = 4/pi * prod_{j=1}^n j/(j+1/2) = 2/sqrt(pi) Gamma(n+1)/Gamma(n+3/2)
+  const double Cn = 2.0 / std::sqrt(M_PI) *
+                    std::exp(std::lgamma(n + 1.0) - std::lgamma(n + 1.5));
+  double h = 1.0;                   // h_{n,m}
+  double den = std::sqrt(2.0 * s);  // (2 sin(theta))^{m+1/2}
+  double P = 0.0, dP = 0.0;
+  for (unsigned int m = 0; m < M; ++m) {
+    const double alpha = (n + m + 0.5) * theta - (m + 0.5) * M_PI_2;
+    const double ca = std::cos(alpha), sa = std::sin(alpha);
+    const double term = h * ca / den;
+    P += term;
+    dP += -h * (n + m + 0.5) * sa / den - (m + 0.5) * term * c / s;
+    if (std::abs(h / den) < 1e-17 * std::abs(P) + 1e-300) break;
+    h *= (m + 0.5) * (m + 0.5) / ((m + 1.0) * (n + m + 1.5));
+    den *= 2.0 * s;
+  }
+  return {Cn * P, Cn * dP};
+}
+
+/* SAM_LISTING_BEGIN_1 */
+// Gauss-Legendre rule with O(n) cost: Newton's method in theta = arccos(x)
+// started from Tricomi's initial guesses, where P_n is evaluated by an O(1)
+// asymptotic expansion in the interior and by the recursion for the few nodes
+// close to +-1. Only half of the nodes are computed, the rest by symmetry.
+inline GaussRule gaussLegendreAsy(unsigned int n) {
+  assert(n >= 1);
+  GaussRule qr;
+  qr.nodes.resize(n);
+  qr.weights.resize(n);
+  // threshold for n*sin(theta) beyond which the expansion is accurate
+  constexpr double asy_min = 20.0;
+  for (unsigned int k = 1; k <= (n + 1) / 2; ++k) {
+    double theta = M_PI * (4.0 * k - 1.0) / (4.0 * n + 2.0);
+    double x, w;
+    if (n >= 2 * asy_min && n * std::sin(theta) > asy_min) {
+      std::pair<double, double> P;
+      for (int it = 0; it < 10; ++it) {
+        P = legendreAsy(n, theta);
+        const double dtheta = P.first / P.second;
+        theta -= dtheta;
+        if (std::abs(dtheta) < 1e-15 * theta) break;
+      }
+      P = legendreAsy(n, theta);
+      x = std::cos(theta);
+      w = 2.0 / (P.second * P.second);
+    } else {
+      // Newton iteration for x with three-term recursion, O(n) per node
+      x = std::cos(theta);
+      std::pair<double, double> P;
+      for (int it = 0; it < 100; ++it) {
+        P = legendreRec(n, x);
+        const double dx = P.first / P.second;
+        x -= dx;
+        if (std::abs(dx) < 1e-16) break;
+      }
+      P = legendreRec(n, x);
+      w = 2.0 / ((1.0 - x * x) * P.second * P.second);
+    }
+    if (2 * k - 1 == n) x = 0.0;  // center node for odd n
+    qr.nodes(n - k) = x;
+    qr.nodes(k - 1) = -x;
+    qr.weights(n - k) = qr.weights(k - 1) = w;
+  }
+  return qr;
+}
+/* SAM_LISTING_END_1 */
+
+// Compute a Gauss rule of the given family, using the O(n) algorithm for
+// Gauss-Legendre and the tridiagonal Golub-Welsch algorithm otherwise.
+inline GaussRule computeGaussRule(GaussFamily family, unsigned int n,
+                                  double alpha = 0.0, double beta = 0.0) {
+  switch (family) {
+    case GaussFamily::Legendre:
+      return gaussLegendreAsy(n);
+    case GaussFamily::Jacobi:
+      if (alpha == 0.0 && beta == 0.0) return gaussLegendreAsy(n);
+      return gaussJacobi(n, alpha, beta);
+    case GaussFamily::Laguerre:
+      return gaussLaguerre(n, alpha);
+    case GaussFamily::Hermite:
+      return gaussHermite(n);
+  }
+  throw std::invalid_argument("computeGaussRule: unknown family");
+}
+
+/* SAM_LISTING_BEGIN_2 */
+// Process-wide, thread-safe cache of Gauss rules keyed by
+// (family, n, alpha, beta). Rules are handed out as shared pointers to
+// immutable objects, so they remain valid even after clear().
+class GaussRuleCache {
+ public:
+  static GaussRuleCache& instance() {
+    static GaussRuleCache cache;
+    return cache;
+  }
+
+  std::shared_ptr<const GaussRule> get(GaussFamily family, unsigned int n,
+                                       double alpha = 0.0, double beta = 0.0) {
+    // parameters that do not enter the weight function are normalized
+    if (family == GaussFamily::Legendre || family == GaussFamily::Hermite) {
+      alpha = beta = 0.0;
+    } else if (family == GaussFamily::Laguerre) {
+      beta = 0.0;
+    }
+    const Key key{family, n, alpha, beta};
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      auto it = rules_.find(key);
+      if (it != rules_.end()) return it->second;
+    }
+    // Compute outside the lock: other threads may retrieve other rules
+    auto rule = std::make_shared<const GaussRule>(
+        computeGaussRule(family, n, alpha, beta));
+    std::lock_guard<std::mutex> lock(mutex_);
+    // if another thread was faster, its rule wins
+    return rules_.emplace(key, std::move(rule)).first->second;
+  }
+
+  std::size_t size() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return rules_.size();
+  }
+
+  void clear() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    rules_.clear();
+  }
+
+ private:
+  GaussRuleCache() = default;
+  using Key = std::tuple<GaussFamily, unsigned int, double, double>;
+  mutable std::mutex mutex_;
+  std::map<Key, std::shared_ptr<const GaussRule>> rules_;
+};
+/* SAM_LISTING_END_2 */
+
+// Shorthand for retrieving a cached Gauss rule
+inline std::shared_ptr<const GaussRule> gaussRule(GaussFamily family,
+                                                  unsigned int n,
+                                                  double alpha = 0.0,
+                                                  double beta = 0.0) {
+  return GaussRuleCache::instance().get(family, n, alpha, beta);
+}
@@ -0,0 +1,121 @@
+#include <chrono>
+#include <cmath>
+#include <iomanip>
+#include <iostream>
+#include <thread>
+#include <vector>
+
+#include "gaussrules.hpp"
+
+// Reference: Golub-Welsch with a dense eigensolver, as in gaussquad.hpp
+GaussRule gaussDense(unsigned int n) {
+  Eigen::MatrixXd M = Eigen::MatrixXd::Zero(n, n);
+  for (unsigned int i = 1; i < n; ++i) {
+    const double b = i / std::sqrt(4. * i * i - 1.);
+    M(i, i - 1) = M(i - 1, i) = b;
+  }
+  Eigen::SelfAdjointEigenSolver<Eigen::MatrixXd> eig(M);
+  return {eig.eigenvalues(),
+          2 * eig.eigenvectors().topRows<1>().array().pow(2).transpose()};
+}
+
+template <class Action>
+double timeit(Action&& a) {
+  const auto start = std::chrono::high_resolution_clock::now();
+  a();
+  const auto end = std::chrono::high_resolution_clock::now();
+  return std::chrono::duration<double>(end - start).count();
+}
+
+int main() {
+  std::cout << std::setprecision(3) << std::scientific;
+  // Agreement of the three Gauss-Legendre algorithms
+  std::cout << "Gauss-Legendre: max deviation from dense Golub-Welsch\n";
+  for (unsigned int n : {5, 20, 64, 200, 500}) {
+    const GaussRule ref = gaussDense(n);
+    const GaussRule asy = gaussLegendreAsy(n);
+    const GaussRule tri = gaussJacobi(n, 0.0, 0.0);
+    std::cout << "n = " << std::setw(4) << n << ": asy nodes "
+              << (asy.nodes - ref.nodes).cwiseAbs().maxCoeff() << ", weights "
+              << (asy.weights - ref.weights).cwiseAbs().maxCoeff()
+              << " | tridiag nodes "
+              << (tri.nodes - ref.nodes).cwiseAbs().maxCoeff() << ", weights "
+              << (tri.weights - ref.weights).cwiseAbs().maxCoeff() << "\n";
+  }
+
+  // Runtimes
+  std::cout << "\nRuntimes [s]\n"
+            << std::setw(8) << "n" << std::setw(12) << "dense" << std::setw(12)
+            << "tridiag" << std::setw(12) << "O(n)" << "\n";
+  for (unsigned int n : {100, 400, 1600, 6400, 100000, 1000000}) {
+    std::cout << std::setw(8) << n;
+    if (n <= 1600) {
+      std::cout << std::setw(12) << timeit([n] { gaussDense(n); });
+    } else {
+      std::cout << std::setw(12) << "-";
+    }
+    if (n <= 6400) {
+      std::cout << std::setw(12) << timeit([n] { gaussJacobi(n, 0.0, 0.0); });
+    } else {
+      std::cout << std::setw(12) << "-";
+    }
+    GaussRule qr;
+    std::cout << std::setw(12)
+              << timeit([n, &qr] { qr = gaussLegendreAsy(n); });
+    // integrate cos on [-1,1] as a sanity check
+    const double I = qr.weights.dot(qr.nodes.array().cos().matrix());
+    std::cout << "   |I-2sin(1)| = " << std::abs(I - 2 * std::sin(1.0))
+              << "\n";
+  }
+
+  // Other weight functions
+  std::cout << "\nOther families, n = 40\n";
+  {
+    // Gauss-Jacobi(1/2,1/2) = Chebyshev 2nd kind: explicit weights and nodes
+    const unsigned int n = 40;
+    const GaussRule qr = gaussJacobi(n, 0.5, 0.5);
+    double err = 0.0;
+    for (unsigned int j = 0; j < n; ++j) {
+      const double w =
+          M_PI / (n + 1) * std::pow(std::sin((n - j) * M_PI / (n + 1)), 2);
+      const double x = std::cos((n - j) * M_PI / (n + 1));
+      err = std::max(
+          {err, std::abs(w - qr.weights(j)), std::abs(x - qr.nodes(j))});
+    }
+    std::cout << "Jacobi(1/2,1/2) vs closed form: " << err << "\n";
+    const GaussRule lag = gaussLaguerre(n, 0.5);
+    // int_0^infty x^{1/2} exp(-x) x^2 dx = Gamma(7/2)
+    std::cout << "Laguerre(1/2): "
+              << std::abs(lag.weights.dot(lag.nodes.array().square().matrix()) -
+                          std::tgamma(3.5))
+              << "\n";
+    const GaussRule her = gaussHermite(n);
+    // int exp(-x^2) cos(x) dx = sqrt(pi) exp(-1/4)
+    std::cout << "Hermite: "
+              << std::abs(her.weights.dot(her.nodes.array().cos().matrix()) -
+                          std::sqrt(M_PI) * std::exp(-0.25))
+              << "\n";
+  }
+
+  // Cache: concurrent requests for the same rule compute it at most a few
+  // times, later requests are lookups
+  std::cout << "\nRule cache\n";
+  std::vector<std::thread> threads;
+  for (int t = 0; t < 4; ++t) {
+    threads.emplace_back([] {
+      for (unsigned int n = 1; n <= 50; ++n) {
+        gaussRule(GaussFamily::Legendre, n);
+        gaussRule(GaussFamily::Hermite, n);
+        gaussRule(GaussFamily::Jacobi, n, -0.5, 0.5);
+      }
+    });
+  }
+  for (auto& t : threads) t.join();
+  std::cout << "cached rules: " << GaussRuleCache::instance().size() << "\n";
+  std::cout << "first call n=100000: "
+            << timeit([] { gaussRule(GaussFamily::Legendre, 100000); })
+            << " s, second call: "
+            << timeit([] { gaussRule(GaussFamily::Legendre, 100000); })
+            << " s\n";
+  return 0;
+}
@@ -0,0 +1,107 @@
+#include <Eigen/Dense>
+#include <chrono>
+#include <cmath>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "ode45.hpp"
+#include "parallel.hpp"
+#include "parareal.hpp"
+#include "rkintegrator.hpp"
+
+template <class Action>
+double timeit(Action &&a) {
+  const auto start = std::chrono::high_resolution_clock::now();
+  a();
+  const auto end = std::chrono::high_resolution_clock::now();
+  return std::chrono::duration<double>(end - start).count();
+}
+
+// Parareal for y' = f(y) on [0, T] with N slices: coarse propagator
+// RKIntegrator (classical RK4, m steps per slice), fine propagator ode45
+// with tight tolerances, compared with the serial fine solution
+template <class Rhs>
+void run(const std::string &name, const Rhs &f, const Eigen::Vector2d &y0,
+         double T, unsigned int N, unsigned int m) {
+  Eigen::MatrixXd A = Eigen::MatrixXd::Zero(4, 4);
+  A(1, 0) = A(2, 1) = 0.5;
+  A(3, 2) = 1.;
+  Eigen::VectorXd b(4);
+  b << 1. / 6., 1. / 3., 1. / 3., 1. / 6.;
+  const RKIntegrator<Eigen::Vector2d> rk4(A, b);
+  const auto G = [&](const Eigen::Vector2d &y, double dt) {
+    return rk4.solve(f, dt, y, m).back();
+  };
+  // ode45 changes its options in solve(): one instance per call
+  const auto F = [&](const Eigen::Vector2d &y, double dt) {
+    ode45<Eigen::Vector2d> O(f);
+    O.options.rtol = 1e-12;
+    O.options.atol = 1e-14;
+    return O.solve(y, dt).back().first;
+  };
+
+  std::cout << name << ", T = " << T << ", " << N << " slices, "
+            << m << " RK4 steps per slice, "
+            << numThreadsFor(N, 0) << " threads\n";
+  // Serial fine solution, restarted at the slice boundaries: the limit of
+  // the parareal iteration
+  std::vector<Eigen::Vector2d> Y(N + 1, y0);
+  const double t_fine = timeit([&] {
+    for (unsigned int n = 0; n < N; ++n) Y[n + 1] = F(Y[n], T / N);
+  });
+  const Eigen::Vector2d yG = rk4.solve(f, T, y0, N * m).back();
+  std::cout << "  serial ode45:   " << t_fine << " s, coarse error at T "
+            << (yG - Y[N]).norm() / Y[N].norm() << "\n";
+
+  PararealOptions opt;
+  opt.tol = 1e-10;
+  PararealStatistics st;
+  std::vector<Eigen::Vector2d> U;
+  const double t_par =
+      timeit([&] { U = parareal(G, F, y0, T, N, opt, &st); });
+  double err = 0.;
+  for (unsigned int n = 0; n <= N; ++n) {
+    err = std::max(err, (U[n] - Y[n]).norm() / Y[n].norm());
+  }
+  std::cout << "  parareal:       " << t_par << " s, " << st.iterations
+            << " iterations, error " << err << ", speedup "
+            << std::setprecision(2) << std::fixed << t_fine / t_par
+            << std::setprecision(3) << std::scientific << "\n  defects:";
+  for (double d : st.defects) std::cout << " " << d;
+  // Wall clock time on p threads predicted from the cost of one fine
+  // propagation: sum_k ceil((N - k) / p) fine calls plus the coarse sweeps
+  const double c_fine = t_fine / N;
+  std::cout << "\n  predicted speedup on p threads:";
+  for (unsigned int p : {4u, 8u, 16u, 32u, 64u}) {
+    double t = st.coarse_time;
+    for (unsigned int k = 0; k < st.iterations; ++k) {
+      t += c_fine * ((N - k + p - 1) / p);
+    }
+    std::cout << std::setprecision(2) << std::fixed << " p = " << p << ": "
+              << t_fine / t;
+  }
+  std::cout << std::setprecision(3) << std::scientific << "\n";
+}
+
+int main() {
+  std::cout << std::setprecision(3) << std::scientific;
+
+  // Lotka-Volterra predator-prey model, cf. ODE/InitCondLV
+  const auto lv = [](const Eigen::Vector2d &y) {
+    return Eigen::Vector2d((2. - y(1)) * y(0), (y(0) - 1.) * y(1));
+  };
+  run("Lotka-Volterra", lv, Eigen::Vector2d(3., 1.), 200., 128, 16);
+
+  // Strongly attractive limit cycle, cf. StiffIntegration/limitcycle
+  const double lambda = 5.;
+  const auto lc = [lambda](const Eigen::Vector2d &y) {
+    return Eigen::Vector2d(
+        Eigen::Vector2d(-y(1), y(0)) +
+        lambda * (1. - y.squaredNorm()) * y);
+  };
+  run("Limit cycle, lambda = 5", lc, Eigen::Vector2d(0.1, 0.), 80. * M_PI,
+      128, 16);
+  return 0;
+}
@@ -0,0 +1,114 @@
+#include <Eigen/Dense>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <utility>
+#include <vector>
+
+#include "parallel.hpp"
+#include "symplecticint.hpp"
+
+template <class Action>
+double timeit(Action &&a) {
+  const auto start = std::chrono::high_resolution_clock::now();
+  a();
+  const auto end = std::chrono::high_resolution_clock::now();
+  return std::chrono::duration<double>(end - start).count();
+}
+
+const std::vector<std::pair<SymplecticMethod, const char *>> methods = {
+    {SymplecticMethod::StormerVerlet, "Stoermer-Verlet"},
+    {SymplecticMethod::McLachlan2, "McLachlan 2"},
+    {SymplecticMethod::ForestRuth4, "Forest-Ruth 4"},
+    {SymplecticMethod::Yoshida6, "Yoshida 6"}};
+
+int main(int argc, char **argv) {
+  std::cout << std::setprecision(3) << std::scientific;
+
+  // 1. Kepler problem, V(q) = -1/|q|, eccentricity 0.5: after one period
+  // T = 2 pi the exact solution returns to its initial value
+  {
+    using Array = Eigen::Array<double, Eigen::Dynamic, 2>;
+    const auto kepler = [](const Array &q, Array &f) {
+      const double r = std::sqrt(q.square().sum());
+      f = -q / (r * r * r);
+      return -1. / r;
+    };
+    const double e = 0.5;
+    Array q0(1, 2), p0(1, 2);
+    q0 << 1. - e, 0.;
+    p0 << 0., std::sqrt((1. + e) / (1. - e));
+    std::cout << "Kepler problem, e = " << e << ", error after one period\n";
+    for (const auto &[method, name] : methods) {
+      symplecticint<2, decltype(kepler)> S(kepler, Eigen::ArrayXd::Ones(1));
+      S.options.method = method;
+      std::cout << "  " << std::left << std::setw(16) << name << std::right;
+      double err_old = 0.;
+      for (unsigned int N = 200; N <= 3200; N *= 2) {
+        Array q = q0, p = p0;
+        S.solve(q, p, 2. * M_PI, N);
+        const double err = std::sqrt((q - q0).square().sum() +
+                                     (p - p0).square().sum());
+        std::cout << " " << err;
+        if (N > 200) {
+          std::cout << std::setprecision(1) << std::fixed << " ("
+                    << std::log2(err_old / err) << ")" << std::setprecision(3)
+                    << std::scientific;
+        }
+        err_old = err;
+      }
+      std::cout << "\n";
+    }
+    // Long time behaviour: 1000 periods, energy error bounded, no drift
+    std::cout << "1000 periods, 100 steps per period\n";
+    for (const auto &[method, name] : methods) {
+      symplecticint<2, decltype(kepler)> S(kepler, Eigen::ArrayXd::Ones(1));
+      S.options.method = method;
+      Array q = q0, p = p0;
+      S.solve(q, p, 2000. * M_PI, 100000);
+      std::cout << "  " << std::left << std::setw(16) << name << std::right;
+      S.print();
+    }
+  }
+
+  // 2. n particles in the quartic potential V(q) = sum_i |q_i|^4, cf.
+  // ODE/SymplecticTimestepping, with the forces evaluated in parallel.
+  // Same number of force evaluations for all methods.
+  {
+    const Eigen::Index n = argc > 1 ? std::atol(argv[1]) : 1000000;
+    using Array = Eigen::Array<double, Eigen::Dynamic, 3>;
+    const auto quartic = [](const Array &q, Array &f) {
+      std::vector<double> partial(numThreadsFor(q.rows(), 0), 0.);
+      parallelFor(q.rows(), [&](std::size_t b, std::size_t e,
+                                unsigned int t) {
+        const auto qb = q.middleRows(b, e - b);
+        const Eigen::ArrayXd r2 = qb.square().rowwise().sum();
+        f.middleRows(b, e - b) = -4. * (qb.colwise() * r2);
+        partial[t] = r2.square().sum();
+      });
+      double V = 0.;
+      for (double x : partial) V += x;
+      return V;
+    };
+    const Array q0 = Array::Random(n, 3), p0 = Array::Random(n, 3);
+    const Eigen::ArrayXd minv = 1. + 0.5 * Eigen::ArrayXd::Random(n);
+    const unsigned int forces = 84;
+    std::cout << "\n" << n << " particles in a quartic potential, T = 1, "
+              << forces << " force evaluations, " << numThreadsFor(n, 0)
+              << " threads\n";
+    for (const auto &[method, name] : methods) {
+      symplecticint<3, decltype(quartic)> S(quartic, minv);
+      S.options.method = method;
+      const unsigned int N =
+          forces / splittingCoefficients(method).a.size();
+      Array q = q0, p = p0;
+      const double t = timeit([&] { S.solve(q, p, 1., N); });
+      std::cout << "  " << std::left << std::setw(16) << name << std::right
+                << t << " s, " << t / N << " s/step, ";
+      S.print();
+    }
+  }
+  return 0;
+}
@@ -0,0 +1,227 @@
+#pragma once
+
+#include <Eigen/Dense>
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+#include <limits>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "phiv.hpp"
+
+/* Exponential integrators; all actions of phi-functions are computed by
+ * phiv(), so the Jacobian or linear part is only needed through products
+ * with vectors: a dense or sparse Eigen matrix or a functor v -> A v.
+ * - expEulerStep(): exponential Euler (exponential Rosenbrock-Euler)
+ *     y1 = y0 + h phi_1(h J) f(y0),  J = Df(y0),
+ *   for y' = f(y), order 2, the same method as exponentialEulerStep() in
+ *   ODE/ExponentialIntegrator.
+ * - etdrk4Step(): ETDRK4 of Cox and Matthews [J. Comput. Phys. 176 (2002)]
+ *   for semilinear problems y' = L y + N(y), order 4 (for non-stiff N).
+ * - expRosenbrockStep(): exponential Rosenbrock methods of the EPIRK class
+ *   [Hochbruck, Ostermann, Schweitzer, SINUM 47 (2009); Tokman, JCP 230
+ *   (2011)] for y' = f(y) with J = Df(y0) and the remainder
+ *   g(y) = f(y) - f(y0) - J (y - y0):
+ *     exprb32 (order 3, embedded exponential Euler of order 2),
+ *     exprb43 (order 4, embedded order 3),
+ *   stiffly accurate for any size of ||h J||; with error estimates for
+ *   ExpRosenbrock, which chooses the step size adaptively.
+ * The linear combinations of phi_k(h J) v_k of one stage are evaluated by
+ * a single call of phiv(), and stages that only differ in the time
+ * (phi_1(h J / 2) f and phi_1(h J) f) share one Krylov space. */
+
+// One step of the exponential Euler method; df(y) returns J = Df(y)
+/* SAM_LISTING_BEGIN_0 */
+template <class Function, class Jacobian>
+Eigen::VectorXd expEulerStep(const Eigen::VectorXd &y0, Function &&f,
+                             Jacobian &&df, double h,
+                             const PhivOptions &opt = {},
+                             PhivStatistics *stats = nullptr) {
+  const Eigen::Index n = y0.size();
+  Eigen::MatrixXd U = Eigen::MatrixXd::Zero(n, 2);
+  U.col(1) = f(y0);
+  const auto J = df(y0);
+  return y0 + phiv(J, h, U, opt, stats);
+}
+/* SAM_LISTING_END_0 */
+
+// One step of ETDRK4 for y' = L y + N(y):
+//   a = e^{hL/2} y + h/2 phi_1(hL/2) N(y)
+//   b = a + h/2 phi_1(hL/2) (N(a) - N(y))
+//   c = e^{hL/2} a + h/2 phi_1(hL/2) (2 N(b) - N(y))
+//   y1 = e^{hL} y + h phi_1(hL) N(y) + h phi_2(hL) (-3 N(y) + 2 N(a)
+//        + 2 N(b) - N(c)) + h phi_3(hL) (4 N(y) - 4 N(a) - 4 N(b) + 4 N(c))
+/* SAM_LISTING_BEGIN_1 */
+template <class LinearOp, class Nonlinearity>
+Eigen::VectorXd etdrk4Step(const LinearOp &L, Nonlinearity &&N,
+                           const Eigen::VectorXd &y, double h,
+                           const PhivOptions &opt = {},
+                           PhivStatistics *stats = nullptr) {
+  const Eigen::Index n = y.size();
+  Eigen::MatrixXd U(n, 2);
+  const Eigen::VectorXd Ny = N(y);
+  U << y, Ny;
+  // e^{hL/2} y + h/2 phi_1(hL/2) N(y) and e^{hL} y + h phi_1(hL) N(y)
+  const Eigen::MatrixXd ay = phiv(L, {h / 2, h}, U, opt, stats);
+  const Eigen::VectorXd a = ay.col(0);
+  const Eigen::VectorXd Na = N(a);
+  U << Eigen::VectorXd::Zero(n), Na - Ny;
+  const Eigen::VectorXd b = a + phiv(L, h / 2, U, opt, stats);
+  const Eigen::VectorXd Nb = N(b);
+  U << a, 2 * Nb - Ny;
+  const Eigen::VectorXd c = phiv(L, h / 2, U, opt, stats);
+  const Eigen::VectorXd Nc = N(c);
+  Eigen::MatrixXd V = Eigen::MatrixXd::Zero(n, 4);
+  V.col(2) = (-3 * Ny + 2 * Na + 2 * Nb - Nc) / h;
+  V.col(3) = 4 * (Ny - Na - Nb + Nc) / (h * h);
+  return ay.col(1) + phiv(L, h, V, opt, stats);
+}
+/* SAM_LISTING_END_1 */
+
+enum class ExpMethod { Exprb32, Exprb43 };
+
+// One step of exprb32 or exprb43 from y with f(y) = fy and J = Df(y);
+// returns y1 and the difference to the embedded method
+/* SAM_LISTING_BEGIN_2 */
+template <class Function, class JacobianOp>
+std::pair<Eigen::VectorXd, Eigen::VectorXd> expRosenbrockStep(
+    ExpMethod method, Function &&f, const JacobianOp &J,
+    const Eigen::VectorXd &y, const Eigen::VectorXd &fy, double h,
+    const PhivOptions &opt = {}, PhivStatistics *stats = nullptr) {
+  const Eigen::Index n = y.size();
+  // g(y + d) = f(y + d) - f(y) - J d
+  const auto g = [&](const Eigen::VectorXd &d) -> Eigen::VectorXd {
+    return f(Eigen::VectorXd(y + d)) - fy - arnoldi_detail::apply(J, d);
+  };
+  Eigen::MatrixXd U = Eigen::MatrixXd::Zero(n, 2);
+  U.col(1) = fy;
+  if (method == ExpMethod::Exprb32) {
+    // U2 = y + h phi_1(hJ) f(y), y1 = U2 + 2 h phi_3(hJ) g(U2)
+    const Eigen::VectorXd d2 = phiv(J, h, U, opt, stats);
+    Eigen::MatrixXd V = Eigen::MatrixXd::Zero(n, 4);
+    V.col(3) = 2. * g(d2) / (h * h);
+    const Eigen::VectorXd e = phiv(J, h, V, opt, stats);
+    return {y + d2 + e, e};
+  }
+  // U2 = y + h/2 phi_1(hJ/2) f(y), U3 = y + h phi_1(hJ) (f(y) + D2),
+  // y1 = y + h phi_1(hJ) f(y) + h (16 phi_3 - 48 phi_4)(hJ) D2
+  //      + h (-2 phi_3 + 12 phi_4)(hJ) D3,  Di = g(Ui)
+  const Eigen::MatrixXd d = phiv(J, {h / 2, h}, U, opt, stats);
+  const Eigen::VectorXd D2 = g(d.col(0));
+  U.col(1) = D2;
+  const Eigen::VectorXd D3 = g(d.col(1) + phiv(J, h, U, opt, stats));
+  Eigen::MatrixXd V = Eigen::MatrixXd::Zero(n, 5);
+  V.col(3) = (16 * D2 - 2 * D3) / (h * h);
+  const Eigen::VectorXd y3 = y + d.col(1) + phiv(J, h, V, opt, stats);
+  V.col(3).setZero();
+  V.col(4) = (-48 * D2 + 12 * D3) / (h * h * h);
+  const Eigen::VectorXd e = phiv(J, h, V, opt, stats);
+  return {y3 + e, e};
+}
+/* SAM_LISTING_END_2 */
+
+// Adaptive integration of y' = f(y) with exprb32 or exprb43, cf. ode45:
+//   ExpRosenbrock<decltype(f), decltype(Jf)> E(f, Jf);
+//   auto sol = E.solve(y0, T);   // vector of pairs (y(t), t)
+// Jf(y) returns Df(y) as a dense or sparse matrix or as a functor
+// v -> Df(y) v; it is evaluated once per step. Like ode45, solve() throws
+// (std::runtime_error) if more than max_iterations steps in a row are
+// rejected instead of returning a partial trajectory.
+template <class RhsType, class JacType>
+class ExpRosenbrock {
+ public:
+  ExpRosenbrock(const RhsType &rhs, const JacType &jac) : f(rhs), Jf(jac) {}
+
+  struct Options {
+    ExpMethod method = ExpMethod::Exprb43;
+    double rtol = 1e-6;
+    double atol = 1e-8;
+    double initial_dt = -1.;  // -1: automatic
+    double max_dt = -1.;      // -1: T / 10
+    unsigned int max_iterations = 100;  // rejected steps in a row
+    PhivOptions krylov;
+  } options;
+
+  struct Statistics {
+    unsigned int steps = 0;
+    unsigned int rejected_steps = 0;
+    unsigned int funcalls = 0;
+    unsigned int jaccalls = 0;
+    PhivStatistics krylov;
+  } statistics;
+
+  std::vector<std::pair<Eigen::VectorXd, double>> solve(
+      const Eigen::VectorXd &y0, double T) {
+    const unsigned int q = options.method == ExpMethod::Exprb32 ? 2 : 3;
+    const auto rhs = [this](const Eigen::VectorXd &y) {
+      ++statistics.funcalls;
+      return f(y);
+    };
+    // Krylov errors well below the time discretization errors
+    PhivOptions kopt = options.krylov;
+    kopt.tol = std::min(kopt.tol, 1e-2 * options.rtol);
+    const double max_dt = options.max_dt > 0 ? options.max_dt : T / 10;
+    std::vector<std::pair<Eigen::VectorXd, double>> sol{{y0, 0.}};
+    Eigen::VectorXd y = y0, fy = rhs(y);
+    double t = 0., h = options.initial_dt;
+    if (h <= 0.) {
+      const Eigen::VectorXd sc =
+          (y.cwiseAbs() * options.rtol).array() + options.atol;
+      const double d = fy.cwiseQuotient(sc).cwiseAbs().maxCoeff();
+      h = d > 0 ? std::pow(1. / d, 1. / (q + 1)) * 1e-1 : max_dt;
+    }
+    unsigned int rejected = 0;
+    while (t < T) {
+      h = std::min({h, max_dt, T - t});
+      const auto J = Jf(y);
+      ++statistics.jaccalls;
+      while (true) {
+        auto [y1, e] = expRosenbrockStep(options.method, rhs, J, y, fy, h,
+                                         kopt, &statistics.krylov);
+        const Eigen::VectorXd sc =
+            (y.cwiseAbs().cwiseMax(y1.cwiseAbs()) * options.rtol)
+                .array() +
+            options.atol;
+        const double err =
+            std::sqrt(e.cwiseQuotient(sc).squaredNorm() / y.size());
+        const double fac =
+            err > 0 ? std::pow(1. / err, 1. / (q + 1)) * 0.9 : 5.;
+        if (err <= 1. && y1.allFinite()) {
+          t = (T - t - h <= 1e-14 * T) ? T : t + h;
+          y = std::move(y1);
+          fy = rhs(y);
+          sol.emplace_back(y, t);
+          ++statistics.steps;
+          h *= std::clamp(fac, 0.2, rejected > 0 ? 1. : 5.);
+          rejected = 0;
+          break;
+        }
+        ++statistics.rejected_steps;
+        if (++rejected > options.max_iterations) {
+          throw std::runtime_error(
+              "ExpRosenbrock: too many rejected steps at t = " +
+              std::to_string(t));
+        }
+        h *= std::isfinite(fac) ? std::clamp(fac, 0.2, 0.9) : 0.2;
+      }
+    }
+    return sol;
+  }
+
+  void print() const {
+    std::cout << "steps: " << statistics.steps
+              << ", rejected: " << statistics.rejected_steps
+              << ", f: " << statistics.funcalls
+              << ", Df: " << statistics.jaccalls
+              << ", Krylov: " << statistics.krylov.substeps
+              << " subspaces (largest " << statistics.krylov.max_dim
+              << "), " << statistics.krylov.matvecs << " products\n";
+  }
+
+ private:
+  RhsType f;
+  JacType Jf;
+};
@@ -0,0 +1,226 @@
+#include <Eigen/Dense>
+#include <Eigen/Sparse>
+#include <chrono>
+#include <cmath>
+#include <iomanip>
+#include <iostream>
+#include <vector>
+
+#include "expint.hpp"
+#include "fdjacobian.hpp"
+#include "phiv.hpp"
+#include "stiffode.hpp"
+
+template <class Action>
+double timeit(Action &&a) {
+  const auto start = std::chrono::high_resolution_clock::now();
+  a();
+  const auto end = std::chrono::high_resolution_clock::now();
+  return std::chrono::duration<double>(end - start).count();
+}
+
+// eps u'' on (0,1) with u(0) = u(1) = 0, n interior points
+Eigen::SparseMatrix<double> laplacian(Eigen::Index n, double eps) {
+  const double c = eps * (n + 1) * (n + 1);
+  Eigen::SparseMatrix<double> L(n, n);
+  L.reserve(Eigen::VectorXi::Constant(n, 3));
+  for (Eigen::Index i = 0; i < n; ++i) {
+    L.insert(i, i) = -2 * c;
+    if (i > 0) L.insert(i, i - 1) = c;
+    if (i + 1 < n) L.insert(i, i + 1) = c;
+  }
+  L.makeCompressed();
+  return L;
+}
+
+// Brusselator with diffusion as in StiffIntegration/fdjacobian
+Eigen::VectorXd brusselator(const Eigen::VectorXd &y) {
+  const Eigen::Index N = y.size() / 2;
+  const double alpha = 1. / 50, c = alpha * (N + 1) * (N + 1);
+  Eigen::VectorXd f(y.size());
+  for (Eigen::Index i = 0; i < N; ++i) {
+    const double u = y(2 * i), v = y(2 * i + 1);
+    const double ul = i > 0 ? y(2 * i - 2) : 1.;
+    const double ur = i < N - 1 ? y(2 * i + 2) : 1.;
+    const double vl = i > 0 ? y(2 * i - 1) : 3.;
+    const double vr = i < N - 1 ? y(2 * i + 3) : 3.;
+    f(2 * i) = 1 + u * u * v - 4 * u + c * (ul - 2 * u + ur);
+    f(2 * i + 1) = 3 * u - u * u * v + c * (vl - 2 * v + vr);
+  }
+  return f;
+}
+
+int main() {
+  std::cout << std::setprecision(3) << std::scientific;
+
+  // 1. phiv() against the dense phi-functions
+  {
+    const Eigen::Index n = 200;
+    const Eigen::MatrixXd A = Eigen::MatrixXd(laplacian(n, 1e-2)) +
+                              Eigen::MatrixXd::Random(n, n) * 10.;
+    const Eigen::MatrixXd U = Eigen::MatrixXd::Random(n, 4);
+    PhivStatistics st;
+    PhivOptions opt;
+    opt.tol = 1e-10;
+    const Eigen::MatrixXd w = phiv(A, {0.05, 0.1}, U, opt, &st);
+    std::cout << "sum_k t^k phi_k(tA) u_k, k = 0..3, ||A|| = "
+              << A.norm() << "\n";
+    for (int i = 0; i < 2; ++i) {
+      const double t = 0.05 * (i + 1);
+      const auto phi = phiDense(t * A, 3);
+      Eigen::VectorXd ref = Eigen::VectorXd::Zero(n);
+      for (int k = 0; k <= 3; ++k) ref += std::pow(t, k) * phi[k] * U.col(k);
+      std::cout << "  t = " << t
+                << ": relative error " << (w.col(i) - ref).norm() / ref.norm()
+                << "\n";
+    }
+    std::cout << "  " << st.substeps << " Krylov spaces, " << st.reductions
+              << " step size reductions, " << st.matvecs << " products\n";
+  }
+
+  // Allen-Cahn equation u_t = eps u_xx + u - u^3, L y + N(y)
+  const double eps = 1e-2;
+  const auto N = [](const Eigen::VectorXd &y) {
+    return Eigen::VectorXd(y - y.cwiseProduct(y).cwiseProduct(y));
+  };
+  const auto initial = [](Eigen::Index n) {
+    Eigen::VectorXd y0(n);
+    for (Eigen::Index i = 0; i < n; ++i) {
+      const double x = (i + 1.) / (n + 1);
+      y0(i) = 0.5 * std::sin(M_PI * x) + 0.3 * std::sin(7 * M_PI * x);
+    }
+    return y0;
+  };
+
+  // 2. One exponential Euler step: dense phi_1 against Krylov
+  std::cout << "\nExponential Euler step, Allen-Cahn equation\n";
+  for (Eigen::Index n : {125, 250, 500}) {
+    const Eigen::SparseMatrix<double> L = laplacian(n, eps);
+    const auto f = [&](const Eigen::VectorXd &y) {
+      return Eigen::VectorXd(L * y + N(y));
+    };
+    const auto df = [&](const Eigen::VectorXd &y) {
+      Eigen::SparseMatrix<double> J = L;
+      J.diagonal() += (1. - 3. * y.array().square()).matrix();
+      return J;
+    };
+    const Eigen::VectorXd y0 = initial(n);
+    const double h = 0.01;
+    Eigen::VectorXd yd, yk;
+    const double td = timeit([&] {
+      const Eigen::MatrixXd hJ = h * Eigen::MatrixXd(df(y0));
+      yd = y0 + h * phiDense(hJ, 1)[1] * f(y0);
+    });
+    PhivStatistics st;
+    const double tk =
+        timeit([&] { yk = expEulerStep(y0, f, df, h, {}, &st); });
+    std::cout << "  n = " << std::setw(4) << n << ": dense " << td
+              << " s, Krylov " << tk << " s (" << st.matvecs
+              << " products), difference " << (yd - yk).norm() / yd.norm()
+              << "\n";
+  }
+
+  // 3. Convergence with fixed step sizes
+  {
+    const Eigen::Index n = 1000;
+    const double T = 1.;
+    const Eigen::SparseMatrix<double> L = laplacian(n, eps);
+    const auto f = [&](const Eigen::VectorXd &y) {
+      return Eigen::VectorXd(L * y + N(y));
+    };
+    const auto df = [&](const Eigen::VectorXd &y) {
+      Eigen::SparseMatrix<double> J = L;
+      J.diagonal() += (1. - 3. * y.array().square()).matrix();
+      return J;
+    };
+    PhivOptions opt;
+    opt.tol = 1e-13;
+    const Eigen::VectorXd y0 = initial(n);
+    const auto run = [&](int method, int M) {
+      const double h = T / M;
+      Eigen::VectorXd y = y0;
+      for (int k = 0; k < M; ++k) {
+        switch (method) {
+          case 0:
+            y = expEulerStep(y, f, df, h, opt);
+            break;
+          case 1:
+            y = etdrk4Step(L, N, y, h, opt);
+            break;
+          default:
+            y = expRosenbrockStep(
+                    method == 2 ? ExpMethod::Exprb32 : ExpMethod::Exprb43, f,
+                    df(y), y, f(y), h, opt)
+                    .first;
+        }
+      }
+      return y;
+    };
+    const Eigen::VectorXd yref = run(1, 1024);
+    std::cout << "\nAllen-Cahn, n = " << n << ", ||h L|| = "
+              << 4 * eps * (n + 1) * (n + 1) * T / 8
+              << " for M = 8: errors at T = " << T << "\n"
+              << "    M   exp. Euler  ETDRK4     exprb32    exprb43\n";
+    for (int M = 8; M <= 128; M *= 2) {
+      std::cout << std::setw(5) << M;
+      for (int method = 0; method < 4; ++method) {
+        std::cout << "  " << (run(method, M) - yref).norm() / yref.norm();
+      }
+      std::cout << "\n";
+    }
+  }
+
+  // 4. Adaptive exprb32/exprb43 against NDF
+  {
+    const Eigen::Index Nb = 1000, n = 2 * Nb;
+    Eigen::VectorXd y0(n);
+    for (Eigen::Index i = 0; i < Nb; ++i) {
+      y0(2 * i) = 1 + std::sin(2 * M_PI * (i + 1.) / (Nb + 1));
+      y0(2 * i + 1) = 3;
+    }
+    std::vector<Eigen::Triplet<double>> trip;
+    for (Eigen::Index i = 0; i < n; ++i) {
+      for (Eigen::Index j = std::max<Eigen::Index>(0, i - 2);
+           j <= std::min(n - 1, i + 2); ++j) {
+        trip.emplace_back(i, j, 1.);
+      }
+    }
+    Eigen::SparseMatrix<double> P(n, n);
+    P.setFromTriplets(trip.begin(), trip.end());
+    SparseFDJacobian fd(P);
+    const auto Jf = [&](const Eigen::VectorXd &y) {
+      return Eigen::SparseMatrix<double>(fd(brusselator, y));
+    };
+    const double T = 1.;
+    std::cout << "\nBrusselator, n = " << n << ", T = " << T
+              << ", rtol = 1e-6\n";
+    stiffode<Eigen::VectorXd, decltype(&brusselator), decltype(Jf)> O(
+        &brusselator, Jf);
+    O.options.method = StiffMethod::NDF;
+    O.options.rtol = 1e-10;
+    O.options.atol = 1e-12;
+    const Eigen::VectorXd yref = O.solve(y0, T).back().first;
+    for (ExpMethod method : {ExpMethod::Exprb32, ExpMethod::Exprb43}) {
+      ExpRosenbrock<decltype(&brusselator), decltype(Jf)> E(&brusselator,
+                                                            Jf);
+      E.options.method = method;
+      Eigen::VectorXd y;
+      const double t = timeit([&] { y = E.solve(y0, T).back().first; });
+      std::cout << (method == ExpMethod::Exprb32 ? "  exprb32: "
+                                                 : "  exprb43: ")
+                << t << " s, error " << (y - yref).norm() / yref.norm()
+                << "\n    ";
+      E.print();
+    }
+    O.options.rtol = 1e-6;
+    O.options.atol = 1e-8;
+    O.options.do_statistics = true;
+    Eigen::VectorXd y;
+    const double t = timeit([&] { y = O.solve(y0, T).back().first; });
+    std::cout << "  NDF:     " << t << " s, error "
+              << (y - yref).norm() / yref.norm() << ", "
+              << O.statistics.steps << " steps, "
+              << O.statistics.decompositions << " LU\n";
+  }
+  return 0;
+}
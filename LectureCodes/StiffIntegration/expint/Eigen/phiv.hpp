@@ -0,0 +1,200 @@
+#pragma once
+
+#include <Eigen/Dense>
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <limits>
+#include <unsupported/Eigen/MatrixFunctions>
+#include <vector>
+
+#include "arnoldi.hpp"
+
+/* phi-functions phi_0(z) = e^z, phi_{k+1}(z) = (phi_k(z) - 1/k!) / z, of a
+ * matrix A acting on vectors, as needed by exponential integrators:
+ *   w(t) = sum_{k=0}^p t^k phi_k(t A) u_k ,                            (*)
+ * which is the solution of w' = A w + sum_{j<p} u_{j+1} t^j / j!,
+ * w(0) = u_0. Instead of the dense exponential of an augmented matrix,
+ * see phim() in ODE/ExponentialIntegrator (O(n^3)), (*) is computed in a
+ * Krylov space of the (n+p) x (n+p) matrix
+ *   A~ = [A  W; 0  J],  W = [u_p, ..., u_1],  J = [0 I_{p-1}; 0 0],
+ * for which [I 0] exp(t A~) [u_0; e_p] = w(t) [Al-Mohy, Higham, SISC 33
+ * (2011)]. Only products with A are required. The Krylov approximation
+ *   exp(tau A~) b ~ beta V_m exp(tau H_m) e_1,  beta = ||b||,
+ * is accurate if tau ||A|| is not too large compared to m; therefore the
+ * time interval is traversed in substeps tau, restarting the Arnoldi
+ * process from the current w with the forcing terms re-expanded about the
+ * current time, as in phipm [Niesen, Wright, ACM TOMS 38 (2012)]:
+ * - the Krylov dimension m is increased until the a posteriori estimate
+ *     err = beta h_{m+1,m} tau |e_m^T phi_1(tau H_m) e_1|
+ *   of the local error is below tol * beta * tau / t, so that the local
+ *   errors sum up to at most tol * beta;
+ * - if m reaches m_max first, tau is reduced using the same Krylov space,
+ *   which costs only exponentials of m x m matrices, and increased again
+ *   in the next substep;
+ * - values at several times t_1 < ... < t_q are taken from the Krylov
+ *   space of the substep containing them, so e.g. phi_1(h A / 2) u and
+ *   phi_1(h A) u of two stages of a Runge-Kutta type method come from a
+ *   single Arnoldi process.
+ * For symmetric A and p = 0 the Lanczos process is used. */
+
+struct PhivOptions {
+  double tol = 1e-8;         // relative tolerance of (*)
+  Eigen::Index m_min = 4;    // smallest Krylov dimension checked
+  Eigen::Index m_max = 40;   // largest Krylov dimension
+  bool symmetric = false;    // A = A^T: Lanczos if p = 0
+};
+
+// Accumulated costs of phiv() calls
+struct PhivStatistics {
+  unsigned int calls = 0;       // calls of phiv()
+  unsigned int substeps = 0;    // Arnoldi processes
+  unsigned int reductions = 0;  // reductions of tau with the same space
+  unsigned int matvecs = 0;     // products with A
+  Eigen::Index max_dim = 0;     // largest Krylov dimension used
+};
+
+// phi_0(Z), ..., phi_p(Z) of a small dense matrix Z from the exponential of
+// [Z I 0 ... 0; 0 0 I 0 ..; ...; 0 ... 0], the generalization of phim()
+/* SAM_LISTING_BEGIN_0 */
+inline std::vector<Eigen::MatrixXd> phiDense(const Eigen::MatrixXd &Z,
+                                             unsigned int p) {
+  const Eigen::Index n = Z.rows();
+  assert(n == Z.cols() && "Matrix must be square.");
+  Eigen::MatrixXd C = Eigen::MatrixXd::Zero(n * (p + 1), n * (p + 1));
+  C.topLeftCorner(n, n) = Z;
+  C.topRightCorner(n * p, n * p).setIdentity();
+  const Eigen::MatrixXd E = C.exp();
+  std::vector<Eigen::MatrixXd> phi(p + 1);
+  for (unsigned int k = 0; k <= p; ++k) phi[k] = E.block(0, k * n, n, n);
+  return phi;
+}
+/* SAM_LISTING_END_0 */
+
+namespace phiv_detail {
+// [phi_0(Z) e_1, phi_1(Z) e_1] from one exponential of an (m+1) x (m+1)
+// matrix [Z e_1; 0 0] [Sidje, ACM TOMS 24 (1998)]
+inline Eigen::MatrixXd phi01(const Eigen::MatrixXd &Z) {
+  const Eigen::Index m = Z.rows();
+  Eigen::MatrixXd C = Eigen::MatrixXd::Zero(m + 1, m + 1);
+  C.topLeftCorner(m, m) = Z;
+  C(0, m) = 1.;
+  const Eigen::MatrixXd E = C.exp();
+  Eigen::MatrixXd P(m, 2);
+  P << E.col(0).head(m), E.col(m).head(m);
+  return P;
+}
+}  // namespace phiv_detail
+
+// w(t_i) of (*) for 0 < t_1 < ... < t_q in the columns of the result;
+// U = [u_0, ..., u_p] in R^{n,p+1}, A a matrix or a functor v -> A v
+/* SAM_LISTING_BEGIN_1 */
+template <class Op>
+Eigen::MatrixXd phiv(const Op &A, const std::vector<double> &t,
+                     const Eigen::MatrixXd &U, const PhivOptions &opt = {},
+                     PhivStatistics *stats = nullptr) {
+  const Eigen::Index n = U.rows(), p = U.cols() - 1;
+  assert(p >= 0 && !t.empty() && t.front() > 0.);
+  assert(std::is_sorted(t.begin(), t.end()));
+  PhivStatistics dummy;
+  PhivStatistics &st = stats ? *stats : dummy;
+  ++st.calls;
+  Eigen::MatrixXd w(n, t.size());
+  // Forcing terms about the current time, [u~_p, ..., u~_1] / eta
+  Eigen::MatrixXd W(n, p);
+  // y = A~ x, x = [x_n; x_p]
+  const auto Aaug = [&](const Eigen::VectorXd &x) {
+    ++st.matvecs;
+    Eigen::VectorXd y(n + p);
+    y.head(n) = arnoldi_detail::apply(A, Eigen::VectorXd(x.head(n)));
+    if (p > 0) {
+      y.head(n) += W * x.tail(p);
+      y.tail(p) << x.tail(p - 1), 0.;
+    }
+    return y;
+  };
+  const Eigen::Index m_max = std::max<Eigen::Index>(opt.m_max, 1);
+  Arnoldi<decltype(Aaug)> arn(Aaug, n + p, m_max,
+                              opt.symmetric && p == 0);
+  const double T = t.back();
+  Eigen::VectorXd wk = U.col(0);  // w(tk)
+  double tk = 0., tau = T;
+  std::size_t out = 0;
+  while (out < t.size()) {
+    tau = std::min(tau, T - tk);
+    // u~_j = sum_{l=0}^{p-j} tk^l / l! u_{j+l}, scaled to unit size
+    double eta = 0.;
+    for (Eigen::Index j = 1; j <= p; ++j) {
+      Eigen::VectorXd uj = U.col(j);
+      double c = 1.;
+      for (Eigen::Index l = 1; j + l <= p; ++l) {
+        c *= tk / l;
+        uj += c * U.col(j + l);
+      }
+      W.col(p - j) = uj;
+      eta = std::max(eta, uj.norm());
+    }
+    if (eta == 0.) eta = 1.;
+    W /= eta;
+    Eigen::VectorXd b(n + p);
+    b.head(n) = wk;
+    if (p > 0) b.tail(p) = Eigen::VectorXd::Unit(p, p - 1) * eta;
+    ++st.substeps;
+    if (!arn.restart(b)) {
+      // w = 0 on the remaining interval
+      for (; out < t.size(); ++out) w.col(out).setZero();
+      break;
+    }
+    const double beta = arn.beta();
+    // Local error estimate for the step size s with the current space
+    Eigen::MatrixXd P;
+    const auto error = [&](double s) {
+      P = phiv_detail::phi01(s * arn.H());
+      return beta * arn.hNext() * s * std::abs(P(arn.dim() - 1, 1));
+    };
+    // The estimate costs O(m^3), so it is checked at m_min, then after
+    // m/4 more vectors each, and at m_max
+    double err = std::numeric_limits<double>::infinity();
+    Eigen::Index check = opt.m_min;
+    while (arn.step()) {
+      if (arn.dim() < check && arn.dim() < m_max) continue;
+      check = arn.dim() + std::max<Eigen::Index>(1, arn.dim() / 4);
+      if ((err = error(tau)) <= opt.tol * beta * tau / T) break;
+    }
+    const Eigen::Index m = arn.dim();
+    st.max_dim = std::max(st.max_dim, m);
+    if (arn.breakdown()) err = error(tau);
+    // m = m_max: shrink tau within the same Krylov space
+    while (err > opt.tol * beta * tau / T) {
+      tau *= std::max(0.1, 0.9 * std::pow(opt.tol * beta * tau / T / err,
+                                          1. / m));
+      err = error(tau);
+      ++st.reductions;
+    }
+    // Outputs in (tk, tk + tau], the last substep ends at t_q exactly
+    const double tnext = (T - tk - tau <= 1e-14 * T) ? T : tk + tau;
+    for (; out < t.size() && t[out] <= tnext; ++out) {
+      const double s = t[out] - tk;
+      const Eigen::MatrixXd E = (s * arn.H()).exp();
+      w.col(out) = beta * (arn.V() * E.col(0)).head(n);
+    }
+    if (out == t.size()) break;
+    wk = beta * (arn.V() * P.col(0)).head(n);
+    tk = tnext;
+    // Next step size: larger if the space was more than good enough
+    tau *= (err > 0.) ? std::min(2., 0.9 * std::pow(opt.tol * beta * tau / T /
+                                                        err,
+                                                    1. / m))
+                      : 2.;
+  }
+  return w;
+}
+/* SAM_LISTING_END_1 */
+
+// w(t) of (*) for a single time t
+template <class Op>
+Eigen::VectorXd phiv(const Op &A, double t, const Eigen::MatrixXd &U,
+                     const PhivOptions &opt = {},
+                     PhivStatistics *stats = nullptr) {
+  return phiv(A, std::vector<double>{t}, U, opt, stats).col(0);
+}
@@ -0,0 +1,136 @@
+#include <Eigen/Dense>
+#include <Eigen/Sparse>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <vector>
+
+#include "dampnewton.hpp"
+#include "fdjacobian.hpp"
+#include "stiffode.hpp"
+
+template <class Action>
+double timeit(Action &&a) {
+  const auto start = std::chrono::high_resolution_clock::now();
+  a();
+  const auto end = std::chrono::high_resolution_clock::now();
+  return std::chrono::duration<double>(end - start).count();
+}
+
+// Brusselator with diffusion on (0,1), N interior points, u and v
+// interleaved: y = (u_1, v_1, u_2, v_2, ...), Df has bandwidths 2
+Eigen::VectorXd brusselator(const Eigen::VectorXd &y) {
+  const Eigen::Index N = y.size() / 2;
+  const double alpha = 1. / 50, c = alpha * (N + 1) * (N + 1);
+  Eigen::VectorXd f(y.size());
+  for (Eigen::Index i = 0; i < N; ++i) {
+    const double u = y(2 * i), v = y(2 * i + 1);
+    // boundary values u = 1, v = 3
+    const double ul = i > 0 ? y(2 * i - 2) : 1.;
+    const double ur = i < N - 1 ? y(2 * i + 2) : 1.;
+    const double vl = i > 0 ? y(2 * i - 1) : 3.;
+    const double vr = i < N - 1 ? y(2 * i + 3) : 3.;
+    f(2 * i) = 1 + u * u * v - 4 * u + c * (ul - 2 * u + ur);
+    f(2 * i + 1) = 3 * u - u * u * v + c * (vl - 2 * v + vr);
+  }
+  return f;
+}
+
+int main(int argc, char **argv) {
+  std::cout << std::setprecision(3) << std::scientific;
+  const Eigen::Index N = argc > 1 ? std::atol(argv[1]) : 50000;
+  const Eigen::Index n = 2 * N;
+  Eigen::VectorXd y0(n);
+  for (Eigen::Index i = 0; i < N; ++i) {
+    y0(2 * i) = 1 + std::sin(2 * M_PI * (i + 1.) / (N + 1));
+    y0(2 * i + 1) = 3;
+  }
+  const double T = 1;
+  std::cout << "Brusselator, n = " << n << " unknowns, NDF up to T = " << T
+            << "\n";
+
+  // banded Jacobian: 5 colors
+  BandedFDJacobian bandfd(n, 2, 2);
+  auto Jband = [&](const Eigen::VectorXd &y) -> const BandedMatrix & {
+    return bandfd(brusselator, y);
+  };
+  // general sparse pattern: CPR coloring
+  std::vector<Eigen::Triplet<double>> trip;
+  for (Eigen::Index i = 0; i < n; ++i) {
+    for (Eigen::Index j = std::max<Eigen::Index>(0, i - 2);
+         j <= std::min(n - 1, i + 2); ++j) {
+      trip.emplace_back(i, j, 1.);
+    }
+  }
+  Eigen::SparseMatrix<double> P(n, n);
+  P.setFromTriplets(trip.begin(), trip.end());
+  SparseFDJacobian sparsefd(P);
+  auto Jsparse = [&](const Eigen::VectorXd &y)
+      -> const Eigen::SparseMatrix<double> & {
+    return sparsefd(brusselator, y);
+  };
+  std::cout << "  colors: banded " << bandfd.numColors() << ", CPR "
+            << sparsefd.numColors() << " (instead of " << n
+            << " evaluations of f)\n";
+
+  auto run = [&](const char *name, auto &Jf) {
+    using Jac = std::decay_t<decltype(Jf)>;
+    stiffode<Eigen::VectorXd, decltype(&brusselator), Jac> O(&brusselator,
+                                                             Jf);
+    O.options.method = StiffMethod::NDF;
+    O.options.rtol = 1e-5;
+    O.options.atol = 1e-7;
+    Eigen::VectorXd y;
+    const double t = timeit([&] { y = O.solve(y0, T).back().first; });
+    std::cout << "  " << name << t << " s, " << O.statistics.steps
+              << " steps, " << O.statistics.jaccalls << " Jacobians, "
+              << O.statistics.decompositions << " LU, u(1/2) = "
+              << y(2 * (N / 2)) << "\n";
+  };
+  run("banded + BandedLU:  ", Jband);
+  run("sparse + SparseLU:  ", Jsparse);
+
+  // 2-D: 5-point stencil on an m x m grid, steady state of
+  // -Laplace u + u^3 = 1 by the damped Newton method with a CPR Jacobian
+  const Eigen::Index m = 200, nn = m * m;
+  const double c2 = double(m + 1) * (m + 1);
+  auto F = [&](const Eigen::VectorXd &u) {
+    Eigen::VectorXd r(nn);
+    for (Eigen::Index i = 0; i < m; ++i) {
+      for (Eigen::Index j = 0; j < m; ++j) {
+        const Eigen::Index k = i * m + j;
+        double s = 4 * u(k);
+        if (i > 0) s -= u(k - m);
+        if (i < m - 1) s -= u(k + m);
+        if (j > 0) s -= u(k - 1);
+        if (j < m - 1) s -= u(k + 1);
+        r(k) = c2 * s + u(k) * u(k) * u(k) - 1;
+      }
+    }
+    return r;
+  };
+  trip.clear();
+  for (Eigen::Index k = 0; k < nn; ++k) {
+    const Eigen::Index i = k / m, j = k % m;
+    trip.emplace_back(k, k, 1.);
+    if (i > 0) trip.emplace_back(k, k - m, 1.);
+    if (i < m - 1) trip.emplace_back(k, k + m, 1.);
+    if (j > 0) trip.emplace_back(k, k - 1, 1.);
+    if (j < m - 1) trip.emplace_back(k, k + 1, 1.);
+  }
+  Eigen::SparseMatrix<double> P2(nn, nn);
+  P2.setFromTriplets(trip.begin(), trip.end());
+  SparseFDJacobian fd2(P2);
+  auto DF = [&](const Eigen::VectorXd &u)
+      -> const Eigen::SparseMatrix<double> & { return fd2(F, u); };
+  Eigen::VectorXd u = Eigen::VectorXd::Zero(nn);
+  const double t = timeit([&] { dampnewton(F, DF, u, 1e-10, 1e-12); });
+  std::cout << "\n-Laplace u + u^3 = 1, " << m << " x " << m
+            << " grid: 5-point stencil, " << fd2.numColors()
+            << " colors; damped Newton " << t << " s, |F(u)| = "
+            << F(u).norm() << ", u(center) = " << u((m / 2) * m + m / 2)
+            << "\n";
+  return 0;
+}
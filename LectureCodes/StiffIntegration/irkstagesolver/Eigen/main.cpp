@@ -0,0 +1,174 @@
+#include <Eigen/Dense>
+#include <Eigen/Sparse>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <string>
+
+#include "irkstagesolver.hpp"
+
+template <class Action>
+double timeit(Action &&a) {
+  const auto start = std::chrono::high_resolution_clock::now();
+  a();
+  const auto end = std::chrono::high_resolution_clock::now();
+  return std::chrono::duration<double>(end - start).count();
+}
+
+struct Butcher {
+  std::string name;
+  Eigen::MatrixXd A;
+  Eigen::VectorXd b;
+};
+
+// 2-stage Radau IIA, order 3 (the method of the ImplRK3Prey exercise)
+Butcher radau2() {
+  Eigen::MatrixXd A(2, 2);
+  A << 5. / 12., -1. / 12., 3. / 4., 1. / 4.;
+  return {"Radau IIA, s = 2", A, A.row(1).transpose()};
+}
+// 3-stage Radau IIA, order 5
+Butcher radau3() {
+  const double r = std::sqrt(6.);
+  Eigen::MatrixXd A(3, 3);
+  A << (88 - 7 * r) / 360, (296 - 169 * r) / 1800, (-2 + 3 * r) / 225,
+      (296 + 169 * r) / 1800, (88 + 7 * r) / 360, (-2 - 3 * r) / 225,
+      (16 - r) / 36, (16 + r) / 36, 1. / 9.;
+  return {"Radau IIA, s = 3", A, A.row(2).transpose()};
+}
+// 3-stage Lobatto IIIA, order 4: A is singular, no decoupling
+Butcher lobatto3() {
+  Eigen::MatrixXd A(3, 3);
+  A << 0., 0., 0., 5. / 24., 1. / 3., -1. / 24., 1. / 6., 2. / 3., 1. / 6.;
+  return {"Lobatto IIIA, s = 3", A, A.row(2).transpose()};
+}
+
+// N steps of size T/N with the stage solver, y(T) is returned
+template <class JacobianMatrix, class Function, class JacobianFunction>
+Eigen::VectorXd integrate(const Butcher &rk, Function &&f,
+                          JacobianFunction &&Jf, const Eigen::VectorXd &y0,
+                          double T, unsigned int N, bool &ok,
+                          typename IRKStageSolver<
+                              JacobianMatrix>::Statistics &stats) {
+  IRKStageSolver<JacobianMatrix> stages(rk.A, rk.b, T / N);
+  Eigen::VectorXd y = y0, y1;
+  ok = true;
+  for (unsigned int k = 0; k < N && ok; ++k) {
+    ok = stages.step(f, Jf, y, y1);
+    if (ok) y = y1;
+  }
+  stats = stages.statistics;
+  return y;
+}
+
+template <class Statistics>
+void printStatistics(const Statistics &s) {
+  std::cout << std::setw(6) << s.iterations << std::setw(5) << s.jacobians
+            << std::setw(5) << s.decompositions << std::setw(5) << s.retries
+            << std::setw(5) << s.failures;
+}
+
+int main() {
+  std::cout << std::setprecision(3) << std::scientific;
+
+  // 1. Predator-prey model of the ImplRK3Prey exercise, dense Jacobian
+  {
+    const double alpha1 = 3., alpha2 = 2., beta1 = 0.1, beta2 = 0.1;
+    auto f = [=](const Eigen::VectorXd &y) {
+      Eigen::VectorXd z = y;
+      z(0) *= alpha1 - beta1 * y(1);
+      z(1) *= -alpha2 + beta2 * y(0);
+      return z;
+    };
+    auto Jf = [=](const Eigen::VectorXd &y) {
+      Eigen::MatrixXd J(2, 2);
+      J << alpha1 - beta1 * y(1), -beta1 * y(0), beta2 * y(1),
+          -alpha2 + beta2 * y(0);
+      return J;
+    };
+    Eigen::VectorXd y0(2), yex(2);
+    y0 << 100, 5;
+    yex << 0.319465882659820, 9.730809352326228;
+    std::cout << "Predator-prey, T = 10, " << radau2().name << "\n"
+              << std::setw(8) << "N" << std::setw(11) << "error"
+              << "  iter  Df   LU  ret fail\n";
+    for (unsigned int N = 128; N <= 4096; N *= 2) {
+      bool ok;
+      IRKStageSolver<Eigen::MatrixXd>::Statistics st;
+      const Eigen::VectorXd y =
+          integrate<Eigen::MatrixXd>(radau2(), f, Jf, y0, 10., N, ok, st);
+      std::cout << std::setw(8) << N << std::setw(11) << (y - yex).norm();
+      printStatistics(st);
+      std::cout << (ok ? "" : "  failed") << "\n";
+    }
+  }
+
+  // 2. Stiff reaction-diffusion system y' = L y - y^3, n = 150, with a
+  // dense and a sparse Jacobian
+  {
+    const Eigen::Index n = 150;
+    const double c = double(n + 1) * (n + 1);
+    Eigen::SparseMatrix<double> L(n, n);
+    for (Eigen::Index i = 0; i < n; ++i) {
+      L.insert(i, i) = -2 * c;
+      if (i > 0) L.insert(i, i - 1) = c;
+      if (i + 1 < n) L.insert(i, i + 1) = c;
+    }
+    L.makeCompressed();
+    auto f = [&L](const Eigen::VectorXd &y) -> Eigen::VectorXd {
+      return L * y - y.array().cube().matrix();
+    };
+    auto Jsparse = [&L](const Eigen::VectorXd &y) {
+      Eigen::SparseMatrix<double> J = L;
+      J.diagonal() -= (3 * y.array().square()).matrix();
+      return J;
+    };
+    auto Jdense = [&Jsparse](const Eigen::VectorXd &y) {
+      return Eigen::MatrixXd(Jsparse(y));
+    };
+    const Eigen::VectorXd x = Eigen::VectorXd::LinSpaced(n + 2, 0, 1)
+                                  .segment(1, n);
+    const Eigen::VectorXd y0 = 10 * (M_PI * x).array().sin() +
+                               3 * (8 * M_PI * x).array().sin();
+    const double T = 0.1;
+    bool ok;
+    IRKStageSolver<Eigen::SparseMatrix<double>>::Statistics st;
+    const Eigen::VectorXd yref = integrate<Eigen::SparseMatrix<double>>(
+        radau3(), f, Jsparse, y0, T, 4000, ok, st);
+    std::cout << "\ny' = Ly - y^3, n = " << n << ", T = " << T
+              << ", error against Radau IIA with N = 4000\n"
+              << std::setw(20) << "method" << std::setw(8) << "N"
+              << std::setw(11) << "error" << std::setw(11) << "time"
+              << "  iter  Df   LU  ret fail\n";
+    for (const Butcher &rk : {radau2(), radau3(), lobatto3()}) {
+      for (unsigned int N : {10u, 20u, 40u, 200u}) {
+        for (bool sparse : {false, true}) {
+          Eigen::VectorXd y;
+          IRKStageSolver<Eigen::MatrixXd>::Statistics sd;
+          const double t = timeit([&] {
+            if (sparse) {
+              y = integrate<Eigen::SparseMatrix<double>>(rk, f, Jsparse, y0,
+                                                          T, N, ok, st);
+            } else {
+              y = integrate<Eigen::MatrixXd>(rk, f, Jdense, y0, T, N, ok,
+                                             sd);
+            }
+          });
+          std::cout << std::setw(20) << rk.name << std::setw(8) << N
+                    << std::setw(11) << (y - yref).norm() / yref.norm()
+                    << std::setw(11) << t;
+          if (sparse) {
+            printStatistics(st);
+          } else {
+            printStatistics(sd);
+          }
+          std::cout << (sparse ? " sparse" : " dense")
+                    << (ok ? "" : "  failed") << "\n";
+        }
+      }
+    }
+  }
+  return 0;
+}
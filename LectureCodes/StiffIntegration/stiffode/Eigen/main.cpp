@@ -0,0 +1,129 @@
+#include <Eigen/Dense>
+#include <chrono>
+#include <cmath>
+#include <iomanip>
+#include <iostream>
+#include <string>
+
+#include "ode45.hpp"
+#include "stiffode.hpp"
+
+template <class Action>
+double timeit(Action &&a) {
+  const auto start = std::chrono::high_resolution_clock::now();
+  a();
+  const auto end = std::chrono::high_resolution_clock::now();
+  return std::chrono::duration<double>(end - start).count();
+}
+
+// Solves y' = f(y) on [0, T] with ode45 and all methods of stiffode and
+// reports cost and the error at T w.r.t. a solution with tight tolerances
+template <class Vec, class Rhs, class Jac>
+void compare(const std::string &name, const Rhs &f, const Jac &Jf,
+             const Vec &y0, double T, double rtol, double atol) {
+  using Mat = typename stiffode<Vec>::JacobianType;
+  std::cout << name << ", rtol = " << rtol << ", atol = " << atol << "\n";
+  stiffode<Vec> ref(f, Jf);
+  ref.options.method = StiffMethod::NDF;
+  ref.options.rtol = 1e-12;
+  ref.options.atol = 1e-14;
+  const Vec yT = ref.solve(y0, T).back().first;
+  auto report = [&](const char *method, double t, const Vec &y,
+                    unsigned int steps, unsigned int rejected,
+                    unsigned int funcalls, unsigned int jaccalls,
+                    unsigned int lus) {
+    std::cout << "  " << std::left << std::setw(14) << method << std::right
+              << " steps " << std::setw(6) << steps << " rejected "
+              << std::setw(5) << rejected << " f " << std::setw(7) << funcalls
+              << " Df " << std::setw(5) << jaccalls << " LU " << std::setw(5)
+              << lus << "  error " << (y - yT).norm() / yT.norm() << ", " << t
+              << " s\n";
+  };
+  ode45<Vec> O(f);
+  O.options.rtol = rtol;
+  O.options.atol = atol;
+  O.options.do_statistics = true;
+  Vec y;
+  double t;
+  try {
+    t = timeit([&] { y = O.solve(y0, T).back().first; });
+    report("ode45", t, y, O.statistics.steps, O.statistics.rejected_steps,
+           O.statistics.funcalls, 0, 0);
+  } catch (const termination_error &) {
+    std::cout << "  ode45          failed after " << O.statistics.steps
+              << " steps\n";
+  }
+  const StiffMethod methods[] = {StiffMethod::Rosenbrock23,
+                                 StiffMethod::TRBDF2, StiffMethod::NDF,
+                                 StiffMethod::Auto};
+  const char *names[] = {"Rosenbrock23", "TR-BDF2", "NDF", "Auto"};
+  for (int i = 0; i < 4; ++i) {
+    stiffode<Vec> S(f, [&Jf](const Vec &x) -> Mat { return Jf(x); });
+    S.options.method = methods[i];
+    S.options.rtol = rtol;
+    S.options.atol = atol;
+    t = timeit([&] { y = S.solve(y0, T).back().first; });
+    report(names[i], t, y, S.statistics.steps, S.statistics.rejected_steps,
+           S.statistics.funcalls, S.statistics.jaccalls,
+           S.statistics.decompositions);
+    if (methods[i] == StiffMethod::Auto) {
+      std::cout << "  " << S.statistics.switches << " switches, "
+                << S.statistics.stiff_steps << " steps with NDF\n";
+    }
+  }
+}
+
+int main() {
+  std::cout << std::setprecision(3) << std::scientific;
+
+  // Chemical reaction kinetics, cf. chemstiff: reactions with rate
+  // constants k1, ..., k4 that differ by four orders of magnitude
+  const double k1 = 1e4, k2 = 1e3, k3 = 10, k4 = 1;
+  auto fchem = [=](const Eigen::Vector4d &y) {
+    const double r1 = k1 * y(0) * y(1), r2 = k2 * y(2);
+    const double r3 = k3 * y(1) * y(2), r4 = k4 * y(3);
+    return Eigen::Vector4d(-r1 + r2, -r1 + r2 - r3 + r4, r1 - r2 - r3 + r4,
+                           r3 - r4);
+  };
+  auto Jchem = [=](const Eigen::Vector4d &y) {
+    Eigen::Matrix4d J;
+    J << -k1 * y(1), -k1 * y(0), k2, 0,
+         -k1 * y(1), -k1 * y(0) - k3 * y(2), k2 - k3 * y(1), k4,
+         k1 * y(1), k1 * y(0) - k3 * y(2), -k2 - k3 * y(1), k4,
+         0, k3 * y(2), k3 * y(1), -k4;
+    return J;
+  };
+  compare("Chemical reaction", fchem, Jchem, Eigen::Vector4d(1, 1, 10, 0),
+          1.0, 1e-6, 1e-8);
+
+  // Robertson's reaction: eigenvalues down to -1e4 after the transient
+  auto frob = [](const Eigen::Vector3d &y) {
+    const double a = 0.04 * y(0), b = 1e4 * y(1) * y(2);
+    const double c = 3e7 * y(1) * y(1);
+    return Eigen::Vector3d(-a + b, a - b - c, c);
+  };
+  auto Jrob = [](const Eigen::Vector3d &y) {
+    Eigen::Matrix3d J;
+    J << -0.04, 1e4 * y(2), 1e4 * y(1),
+         0.04, -1e4 * y(2) - 6e7 * y(1), -1e4 * y(1),
+         0, 6e7 * y(1), 0;
+    return J;
+  };
+  compare("\nRobertson", frob, Jrob, Eigen::Vector3d(1, 0, 0), 40.0, 1e-6,
+          1e-10);
+
+  // Van der Pol oscillator, mu = 100: non-stiff fast transitions alternate
+  // with stiff slow phases, the case for automatic switching
+  const double mu = 100;
+  auto fvdp = [=](const Eigen::Vector2d &y) {
+    return Eigen::Vector2d(y(1), mu * (1 - y(0) * y(0)) * y(1) - y(0));
+  };
+  auto Jvdp = [=](const Eigen::Vector2d &y) {
+    Eigen::Matrix2d J;
+    J << 0, 1, -2 * mu * y(0) * y(1) - 1, mu * (1 - y(0) * y(0));
+    return J;
+  };
+  compare("\nVan der Pol, mu = 100", fvdp, Jvdp, Eigen::Vector2d(2, 0),
+          300.0, 1e-6, 1e-8);
+  return 0;
+}
@@ -2,9 +2,26 @@
 #define DAMPNEWTON_HPP
 
 #include <Eigen/Dense>
+#include <Eigen/Sparse>
+#include <Eigen/SparseLU>
 #include <iostream>
 #include <vector>
 
+namespace dampnewton_detail {
+// LU-decomposition of a dense Jacobian (or a BandedMatrix, fdjacobian.hpp)
+template <typename MatType>
+auto lu(const MatType &J) {
+  return J.lu();
+}
+// LU-decomposition of a sparse Jacobian, e.g. from SparseFDJacobian
+inline Eigen::SparseLU<Eigen::SparseMatrix<double>> lu(
+    const Eigen::SparseMatrix<double> &J) {
+  Eigen::SparseMatrix<double> M = J;
+  M.makeCompressed();
+  return Eigen::SparseLU<Eigen::SparseMatrix<double>>(M);
+}
+}  // namespace dampnewton_detail
+
 template <typename FuncType, typename JacType>
 void dampnewton(const FuncType &F, const JacType &DF, Eigen::VectorXd &x,
                 double rtol = 1e-4, double atol = 1e-6) {
@@ -16,7 +33,7 @@ void dampnewton(const FuncType &F, const JacType &DF, Eigen::VectorXd &x,
   double sn, stn;                // Norms of Newton corrections
 
   do {
-    auto jacfac = DF(x).lu();  // LU-factorize Jacobian
+    auto jacfac = dampnewton_detail::lu(DF(x));  // LU-factorize Jacobian
 
     s = jacfac.solve(F(x));  // Newton correction
     sn = s.norm();           // Norm of Newton correction
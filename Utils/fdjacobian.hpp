@@ -0,0 +1,348 @@
+#pragma once
+
+#include <Eigen/Dense>
+#include <Eigen/Sparse>
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <limits>
+#include <numeric>
+#include <utility>
+#include <vector>
+
+#include "parallel.hpp"
+
+//! \file fdjacobian.hpp Jacobians of large sparse r.h.s. f: R^n -> R^n by
+//! colored finite differences [Curtis, Powell, Reid, J. Inst. Math. Appl.
+//! 13 (1974)]. Columns of Df that have no nonzero row in common form a
+//! group ("color"); perturbing all columns of a group at once yields all of
+//! them from a single evaluation of f, so the cost is one evaluation of f
+//! per color instead of per column: 3 for a tridiagonal Jacobian, about 5-8
+//! for a 5-point stencil, independent of n. The colors are evaluated in
+//! parallel, f has to be thread-safe then.
+//! - SparseFDJacobian: general sparsity pattern, Eigen::SparseMatrix with a
+//!   fixed pattern, for Eigen::SparseLU (analyzePattern() once,
+//!   factorize() for every new Jacobian),
+//! - BandedFDJacobian: lower/upper bandwidths ml/mu, ml + mu + 1 colors,
+//!   BandedMatrix with the LU-decomposition BandedLU (O(n ml (ml + mu))).
+
+//! \brief Curtis-Powell-Reid coloring of the columns of a sparsity pattern
+//! P by the greedy algorithm, columns with many nonzeros first.
+//! \param P pattern, only the positions of the (structural) nonzeros count
+//! \return color of each column, numbered 0, 1, ...
+/* SAM_LISTING_BEGIN_0 */
+inline std::vector<int> cprColoring(const Eigen::SparseMatrix<double> &P) {
+  const Eigen::Index n = P.cols();
+  // rows -> columns
+  const Eigen::SparseMatrix<double, Eigen::RowMajor> Pr = P;
+  std::vector<Eigen::Index> order(n);
+  std::iota(order.begin(), order.end(), Eigen::Index(0));
+  std::stable_sort(order.begin(), order.end(),
+                   [&P](Eigen::Index a, Eigen::Index b) {
+                     return P.col(a).nonZeros() > P.col(b).nonZeros();
+                   });
+  std::vector<int> color(n, -1);
+  std::vector<Eigen::Index> forbidden;  // forbidden[c] == j: c used near j
+  for (const Eigen::Index j : order) {
+    // colors of all columns with a nonzero in a common row
+    for (Eigen::SparseMatrix<double>::InnerIterator it(P, j); it; ++it) {
+      for (Eigen::SparseMatrix<double, Eigen::RowMajor>::InnerIterator r(
+               Pr, it.row());
+           r; ++r) {
+        const int c = color[r.col()];
+        if (c >= 0) forbidden[c] = j;
+      }
+    }
+    int c = 0;
+    while (c < static_cast<int>(forbidden.size()) && forbidden[c] == j) ++c;
+    if (c == static_cast<int>(forbidden.size())) forbidden.push_back(-1);
+    color[j] = c;
+  }
+  return color;
+}
+/* SAM_LISTING_END_0 */
+
+namespace fdjacobian_detail {
+// Perturbations sqrt(eps) max(|y_j|, 1), rounded such that y_j + d_j - y_j
+// is exact
+inline Eigen::VectorXd increments(const Eigen::VectorXd &y) {
+  const double s = std::sqrt(std::numeric_limits<double>::epsilon());
+  Eigen::VectorXd d(y.size());
+  for (Eigen::Index j = 0; j < y.size(); ++j) {
+    const double yp = y(j) + s * std::max(std::abs(y(j)), 1.0);
+    d(j) = yp - y(j);
+  }
+  return d;
+}
+
+// Calls body(c, fc) with fc = f(y + sum of the increments of the columns of
+// color c) for all colors, in parallel
+template <class Function, class Body>
+void forAllColors(Function &&f, const Eigen::VectorXd &y,
+                  const Eigen::VectorXd &d,
+                  const std::vector<std::vector<Eigen::Index>> &groups,
+                  Body &&body, unsigned int num_threads) {
+  parallelFor(
+      groups.size(),
+      [&](std::size_t b, std::size_t e, unsigned int) {
+        Eigen::VectorXd yp = y;
+        for (std::size_t c = b; c < e; ++c) {
+          for (const Eigen::Index j : groups[c]) yp(j) += d(j);
+          const Eigen::VectorXd fc = f(yp);
+          body(c, fc);
+          for (const Eigen::Index j : groups[c]) yp(j) = y(j);
+        }
+      },
+      num_threads);
+}
+}  // namespace fdjacobian_detail
+
+//! \brief Jacobian with a given sparsity pattern by colored differences.
+/* SAM_LISTING_BEGIN_1 */
+class SparseFDJacobian {
+ public:
+  //! \param P sparsity pattern of Df (a superset is fine)
+  //! \param num_threads for the evaluations of f, 0 = hardware threads
+  explicit SparseFDJacobian(const Eigen::SparseMatrix<double> &P,
+                            unsigned int num_threads = 0)
+      : J(P), num_threads(num_threads) {
+    J.makeCompressed();
+    const std::vector<int> color = cprColoring(J);
+    const int k =
+        color.empty() ? 0 : *std::max_element(color.begin(), color.end()) + 1;
+    groups.resize(k);
+    for (Eigen::Index j = 0; j < J.cols(); ++j) groups[color[j]].push_back(j);
+  }
+
+  //! \brief Df(y), given fy = f(y). The pattern of the returned matrix is
+  //! always that of P (explicit zeros included).
+  template <class Function>
+  const Eigen::SparseMatrix<double> &operator()(Function &&f,
+                                                const Eigen::VectorXd &y,
+                                                const Eigen::VectorXd &fy) {
+    const Eigen::VectorXd d = fdjacobian_detail::increments(y);
+    using StorageIndex = Eigen::SparseMatrix<double>::StorageIndex;
+    const StorageIndex *outer = J.outerIndexPtr();
+    const StorageIndex *rows = J.innerIndexPtr();
+    double *values = J.valuePtr();
+    // the columns of one color have disjoint rows: every entry of fc - fy
+    // belongs to exactly one of them
+    fdjacobian_detail::forAllColors(
+        f, y, d, groups,
+        [&](std::size_t c, const Eigen::VectorXd &fc) {
+          for (const Eigen::Index j : groups[c]) {
+            for (StorageIndex p = outer[j]; p < outer[j + 1]; ++p) {
+              values[p] = (fc(rows[p]) - fy(rows[p])) / d(j);
+            }
+          }
+        },
+        num_threads);
+    return J;
+  }
+  template <class Function>
+  const Eigen::SparseMatrix<double> &operator()(Function &&f,
+                                                const Eigen::VectorXd &y) {
+    return (*this)(f, y, f(y));
+  }
+
+  //! \brief Number of colors = evaluations of f per Jacobian
+  std::size_t numColors() const { return groups.size(); }
+
+ private:
+  Eigen::SparseMatrix<double> J;
+  std::vector<std::vector<Eigen::Index>> groups;
+  unsigned int num_threads;
+};
+/* SAM_LISTING_END_1 */
+
+class BandedLU;
+
+//! \brief n x n matrix with ml subdiagonals and mu superdiagonals in
+//! LAPACK band storage: a_ij in row ml + mu + i - j of column j; the first
+//! ml rows are kept for the fill-in of the LU-decomposition.
+/* SAM_LISTING_BEGIN_2 */
+class BandedMatrix {
+ public:
+  BandedMatrix(Eigen::Index n = 0, Eigen::Index ml = 0, Eigen::Index mu = 0)
+      : ab(Eigen::MatrixXd::Zero(2 * ml + mu + 1, n)), kl(ml), ku(mu) {}
+
+  Eigen::Index rows() const { return ab.cols(); }
+  Eigen::Index cols() const { return ab.cols(); }
+  Eigen::Index lower() const { return kl; }
+  Eigen::Index upper() const { return ku; }
+  //! \brief Entry (i, j) with -ml <= j - i <= mu
+  double &operator()(Eigen::Index i, Eigen::Index j) {
+    assert(j - i <= ku && i - j <= kl);
+    return ab(kl + ku + i - j, j);
+  }
+  double operator()(Eigen::Index i, Eigen::Index j) const {
+    assert(j - i <= ku && i - j <= kl);
+    return ab(kl + ku + i - j, j);
+  }
+  //! \brief Row range of the band in column j
+  Eigen::Index firstRow(Eigen::Index j) const {
+    return std::max<Eigen::Index>(0, j - ku);
+  }
+  Eigen::Index endRow(Eigen::Index j) const {
+    return std::min<Eigen::Index>(rows(), j + kl + 1);
+  }
+
+  //! \brief I - c A, as needed by implicit time steppers
+  BandedMatrix shiftedIdentity(double c) const {
+    BandedMatrix M = *this;
+    M.ab *= -c;
+    M.ab.row(kl + ku).array() += 1.0;
+    return M;
+  }
+  Eigen::VectorXd operator*(const Eigen::VectorXd &x) const {
+    Eigen::VectorXd y = Eigen::VectorXd::Zero(rows());
+    for (Eigen::Index j = 0; j < cols(); ++j) {
+      for (Eigen::Index i = firstRow(j); i < endRow(j); ++i) {
+        y(i) += (*this)(i, j) * x(j);
+      }
+    }
+    return y;
+  }
+  //! \brief max_i sum_j |a_ij|
+  double normInf() const {
+    Eigen::VectorXd r = Eigen::VectorXd::Zero(rows());
+    for (Eigen::Index j = 0; j < cols(); ++j) {
+      for (Eigen::Index i = firstRow(j); i < endRow(j); ++i) {
+        r(i) += std::abs((*this)(i, j));
+      }
+    }
+    return r.size() > 0 ? r.maxCoeff() : 0.0;
+  }
+  Eigen::SparseMatrix<double> toSparse() const {
+    std::vector<Eigen::Triplet<double>> t;
+    t.reserve(cols() * (kl + ku + 1));
+    for (Eigen::Index j = 0; j < cols(); ++j) {
+      for (Eigen::Index i = firstRow(j); i < endRow(j); ++i) {
+        t.emplace_back(i, j, (*this)(i, j));
+      }
+    }
+    Eigen::SparseMatrix<double> S(rows(), cols());
+    S.setFromTriplets(t.begin(), t.end());
+    return S;
+  }
+  //! \brief LU-decomposition, as A.lu() for dense Eigen matrices
+  BandedLU lu() const;
+
+ private:
+  friend class BandedLU;
+  Eigen::MatrixXd ab;
+  Eigen::Index kl, ku;
+};
+
+//! \brief LU-decomposition with partial pivoting of a BandedMatrix (as
+//! LAPACK dgbtf2): U gets ml + mu superdiagonals, O(n ml (ml + mu)) work.
+class BandedLU {
+ public:
+  BandedLU() = default;
+  explicit BandedLU(const BandedMatrix &A) { compute(A); }
+
+  BandedLU &compute(const BandedMatrix &A) {
+    LU = A;
+    const Eigen::Index n = A.cols(), kl = A.kl, ku = A.ku, kv = kl + ku;
+    Eigen::MatrixXd &ab = LU.ab;
+    ab.topRows(kl).setZero();
+    piv.resize(n);
+    // last column touched by row exchanges so far
+    Eigen::Index ju = 0;
+    // ab(kv + i - j, j) = a_ij
+    for (Eigen::Index j = 0; j < n; ++j) {
+      const Eigen::Index km = std::min(kl, n - 1 - j);
+      // pivot in column j, rows j..j+km
+      Eigen::Index p;
+      ab.col(j).segment(kv, km + 1).cwiseAbs().maxCoeff(&p);
+      piv(j) = j + p;
+      const double pv = ab(kv + p, j);
+      if (pv == 0.0) continue;  // singular, solve() yields inf/nan
+      // columns j..ju take part in the row exchange and elimination
+      ju = std::max(ju, std::min(n - 1, j + ku + p));
+      if (p != 0) {
+        for (Eigen::Index c = j; c <= ju; ++c) {
+          std::swap(ab(kv + j - c, c), ab(kv + j + p - c, c));
+        }
+      }
+      ab.col(j).segment(kv + 1, km) /= ab(kv, j);
+      for (Eigen::Index c = j + 1; c <= ju; ++c) {
+        const double u = ab(kv + j - c, c);
+        if (u == 0.0) continue;
+        for (Eigen::Index i = 1; i <= km; ++i) {
+          ab(kv + j + i - c, c) -= ab(kv + i, j) * u;
+        }
+      }
+    }
+    return *this;
+  }
+
+  Eigen::VectorXd solve(const Eigen::VectorXd &b) const {
+    const Eigen::MatrixXd &ab = LU.ab;
+    const Eigen::Index n = ab.cols(), kl = LU.kl, kv = LU.kl + LU.ku;
+    Eigen::VectorXd x = b;
+    // L y = P b
+    for (Eigen::Index j = 0; j < n; ++j) {
+      std::swap(x(j), x(piv(j)));
+      const Eigen::Index km = std::min(kl, n - 1 - j);
+      x.segment(j + 1, km) -= x(j) * ab.col(j).segment(kv + 1, km);
+    }
+    // U x = y, U has kl + ku superdiagonals
+    for (Eigen::Index j = n - 1; j >= 0; --j) {
+      x(j) /= ab(kv, j);
+      const Eigen::Index i0 = std::max<Eigen::Index>(0, j - kv);
+      x.segment(i0, j - i0) -= x(j) * ab.col(j).segment(kv - (j - i0), j - i0);
+    }
+    return x;
+  }
+
+ private:
+  BandedMatrix LU;
+  Eigen::Matrix<Eigen::Index, Eigen::Dynamic, 1> piv;
+};
+
+inline BandedLU BandedMatrix::lu() const { return BandedLU(*this); }
+/* SAM_LISTING_END_2 */
+
+//! \brief Banded Jacobian by colored differences: column j gets color
+//! j mod (ml + mu + 1).
+/* SAM_LISTING_BEGIN_3 */
+class BandedFDJacobian {
+ public:
+  BandedFDJacobian(Eigen::Index n, Eigen::Index ml, Eigen::Index mu,
+                   unsigned int num_threads = 0)
+      : J(n, ml, mu), num_threads(num_threads) {
+    const Eigen::Index k = std::min(n, ml + mu + 1);
+    groups.resize(k);
+    for (Eigen::Index j = 0; j < n; ++j) groups[j % k].push_back(j);
+  }
+
+  template <class Function>
+  const BandedMatrix &operator()(Function &&f, const Eigen::VectorXd &y,
+                                 const Eigen::VectorXd &fy) {
+    const Eigen::VectorXd d = fdjacobian_detail::increments(y);
+    fdjacobian_detail::forAllColors(
+        f, y, d, groups,
+        [&](std::size_t c, const Eigen::VectorXd &fc) {
+          for (const Eigen::Index j : groups[c]) {
+            for (Eigen::Index i = J.firstRow(j); i < J.endRow(j); ++i) {
+              J(i, j) = (fc(i) - fy(i)) / d(j);
+            }
+          }
+        },
+        num_threads);
+    return J;
+  }
+  template <class Function>
+  const BandedMatrix &operator()(Function &&f, const Eigen::VectorXd &y) {
+    return (*this)(f, y, f(y));
+  }
+
+  std::size_t numColors() const { return groups.size(); }
+
+ private:
+  BandedMatrix J;
+  std::vector<std::vector<Eigen::Index>> groups;
+  unsigned int num_threads;
+};
+/* SAM_LISTING_END_3 */
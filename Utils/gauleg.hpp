@@ -4,6 +4,8 @@
 #include <Eigen/Eigenvalues>
 #include <cmath>
 
+#include "gaussrules.hpp"
+
 //! Structure containing a Quadrature rule on [-1,1], comprised of weights and
 //! nodes
 struct QuadRule {
@@ -22,19 +24,10 @@ inline QuadRule gauleg(unsigned int n) {
     qr.nodes(0) = 0;
     qr.weights(0) = 2;
   } else {
-    Eigen::VectorXd b(n - 1);
-    Eigen::MatrixXd J = Eigen::MatrixXd::Zero(n, n);
-
-    for (unsigned int i = 1; i < n; ++i) {
-      double d = (i) / sqrt(4. * i * i - 1.);
-      J(i, i - 1) = d;
-      J(i - 1, i) = d;
-    }
-    Eigen::EigenSolver<Eigen::MatrixXd> eig(J);
-
-    qr.nodes = eig.eigenvalues().real();
-    qr.weights = 2 * eig.eigenvectors().real().topRows<1>().cwiseProduct(
-                         eig.eigenvectors().real().topRows<1>());
+    // Cached rule, computed without forming the dense Jacobi matrix
+    const auto rule = gaussRule(GaussFamily::Legendre, n);
+    qr.nodes = rule->nodes;
+    qr.weights = rule->weights;
   }
   return qr;
 }
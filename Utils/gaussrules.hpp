@@ -0,0 +1 @@
+#include "../LectureCodes/NumQuad/gaussrules/Eigen/gaussrules.hpp"
\ No newline at end of file
@@ -2,6 +2,8 @@
 
 #include <Eigen/Dense>
 
+#include "gaussrules.hpp"
+
 //! @brief Golub-Welsh implementation 5.3.35
 //! @param[in] n number of Gauss nodes
 //! @param[out] w weights
@@ -14,19 +16,9 @@ inline void golubwelsh(const int n, vector& w, vector& x) {
         x(0) = 0;
         w(0) = 2;
     } else {
-        vector b(n-1);
-        Eigen::MatrixXd J = Eigen::MatrixXd::Zero(n,n);
-
-        for(int i = 1; i < n; ++i) {
-            double d = (i) / sqrt(4. * i * i - 1.);
-            J(i,i-1) = d;
-            J(i-1,i) = d;
-        }
-
-        Eigen::EigenSolver<Eigen::MatrixXd> eig(J);
-
-        x = eig.eigenvalues().real();
-        vector tmp = eig.eigenvectors().real().topRows<1>();
-        w = 2 * tmp.cwiseProduct(tmp);
+        // Cached rule, computed without forming the dense Jacobi matrix
+        const auto rule = gaussRule(GaussFamily::Legendre, n);
+        x = rule->nodes;
+        w = rule->weights;
     }
 }
@@ -0,0 +1,378 @@
+#pragma once
+
+#include <Eigen/Dense>
+#include <Eigen/Eigenvalues>
+#include <Eigen/Sparse>
+#include <Eigen/SparseLU>
+#include <algorithm>
+#include <cmath>
+#include <complex>
+#include <limits>
+#include <type_traits>
+#include <vector>
+#include <unsupported/Eigen/KroneckerProduct>
+
+/**
+ * \file irkstagesolver.hpp Solves the stage equations of an implicit
+ * Runge-Kutta method with Butcher matrix A,
+ *   g_i = h sum_j a_ij f(y0 + g_j),  i = 1, ..., s,
+ * by a simplified Newton iteration [Hairer, Wanner, Solving ODEs II,
+ * Sect. IV.8]: the Jacobian Df is frozen and reused across steps as long as
+ * the iteration contracts fast, so that the LU-decompositions are only
+ * recomputed when Df is evaluated again.
+ * If A is invertible and diagonalizable, A^{-1} = T diag(lambda) T^{-1},
+ * the transformation W = (T^{-1} x I) G decouples the sn x sn system
+ * (I - h A x J) into the s systems (lambda_i / h I - J) of size n: one real
+ * system per real eigenvalue and one complex system per pair of complex
+ * conjugate eigenvalues (for the 3-stage Radau IIA method one real and one
+ * complex system instead of a 3n x 3n one). Otherwise the full system is
+ * decomposed.
+ * For a sparse Jacobian (Eigen::SparseMatrix) the sparsity pattern is
+ * analyzed once and only the numerical factorization is repeated.
+ */
+
+namespace irkstagesolver_detail {
+//! LU-decomposition of a dense or sparse matrix; for sparse matrices the
+//! symbolic analysis is kept as long as the number of nonzeros does not
+//! change (Df is expected to have a fixed sparsity pattern)
+template <class Scalar, bool Sparse>
+struct LU;
+
+template <class Scalar>
+struct LU<Scalar, false> {
+  using Matrix = Eigen::Matrix<Scalar, Eigen::Dynamic, Eigen::Dynamic>;
+  Eigen::PartialPivLU<Matrix> lu;
+  void compute(const Matrix &M) { lu.compute(M); }
+  template <class Rhs>
+  Eigen::Matrix<Scalar, Eigen::Dynamic, 1> solve(const Rhs &r) const {
+    return lu.solve(r);
+  }
+};
+
+template <class Scalar>
+struct LU<Scalar, true> {
+  using Matrix = Eigen::SparseMatrix<Scalar>;
+  Eigen::SparseLU<Matrix> lu;
+  Eigen::Index nnz = -1;
+  void compute(Matrix M) {
+    M.makeCompressed();
+    if (M.nonZeros() != nnz) {
+      lu.analyzePattern(M);
+      nnz = M.nonZeros();
+    }
+    lu.factorize(M);
+  }
+  template <class Rhs>
+  Eigen::Matrix<Scalar, Eigen::Dynamic, 1> solve(const Rhs &r) {
+    return lu.solve(Eigen::Matrix<Scalar, Eigen::Dynamic, 1>(r));
+  }
+};
+
+//! shift I - J for a dense or sparse J
+template <class Scalar>
+Eigen::Matrix<Scalar, Eigen::Dynamic, Eigen::Dynamic> shifted(
+    Scalar shift, const Eigen::MatrixXd &J) {
+  Eigen::Matrix<Scalar, Eigen::Dynamic, Eigen::Dynamic> M =
+      -J.cast<Scalar>();
+  M.diagonal().array() += shift;
+  return M;
+}
+template <class Scalar>
+Eigen::SparseMatrix<Scalar> shifted(Scalar shift,
+                                    const Eigen::SparseMatrix<double> &J) {
+  Eigen::SparseMatrix<Scalar> I(J.rows(), J.cols());
+  I.setIdentity();
+  return shift * I - J.cast<Scalar>();
+}
+}  // namespace irkstagesolver_detail
+
+/**
+ * \brief Stage solver for implicit RK methods with fixed step size h.
+ * \tparam JacobianMatrix type returned by Df: a dense Eigen matrix or
+ * Eigen::SparseMatrix<double>.
+ */
+/* SAM_LISTING_BEGIN_0 */
+template <class JacobianMatrix = Eigen::MatrixXd>
+class IRKStageSolver {
+ public:
+  static constexpr bool sparse =
+      std::is_base_of<Eigen::SparseMatrixBase<JacobianMatrix>,
+                      JacobianMatrix>::value;
+  using Jacobian =
+      typename std::conditional<sparse, Eigen::SparseMatrix<double>,
+                                Eigen::MatrixXd>::type;
+
+  /**
+   * \brief Precomputes the transformation of the Butcher matrix.
+   * \param A Butcher matrix, \param b weights, \param h step size
+   * \param rtol, atol tolerance for the stage increments per unit time: a
+   * step of size h is accepted at h (atol + rtol |y0|), so that the errors
+   * of all steps up to time T add up to about T (atol + rtol |y|), well
+   * below the discretization error for all sensible step sizes
+   */
+  IRKStageSolver(const Eigen::MatrixXd &A, const Eigen::VectorXd &b, double h,
+                 double rtol = 1e-10, double atol = 1e-12)
+      : A(A),
+        b(b),
+        h(h),
+        rtol(rtol),
+        atol(atol),
+        s(b.size()),
+        real_lu(s),
+        complex_lu(s) {
+    diagonalize();
+  }
+
+  /**
+   * \brief One step y0 -> y1 of the implicit RK method.
+   * If the simplified Newton iteration fails even with a freshly evaluated
+   * Jacobian, the step is retried once as two steps of size h/2.
+   * \return false if that fails, too; the caller should fall back to a
+   * full (damped) Newton method then.
+   */
+  template <class Function, class JacobianFunction>
+  bool step(Function &&f, JacobianFunction &&Jf, const Eigen::VectorXd &y0,
+            Eigen::VectorXd &y1);
+
+  //! \brief Usage statistics
+  struct Statistics {
+    unsigned int steps = 0;           //!< calls of step()
+    unsigned int iterations = 0;      //!< simplified Newton iterations
+    unsigned int jacobians = 0;       //!< evaluations of Df
+    unsigned int decompositions = 0;  //!< (sets of) LU-decompositions
+    unsigned int retries = 0;         //!< steps retried with h/2
+    unsigned int failures = 0;        //!< steps returning false
+  } statistics;
+
+ private:
+  using Real = irkstagesolver_detail::LU<double, sparse>;
+  using Complex = irkstagesolver_detail::LU<std::complex<double>, sparse>;
+
+  void diagonalize();
+  void decompose(double hs);
+  // stage equations and y1 for the step size hs, false on failure
+  template <class Function, class JacobianFunction>
+  bool solveStages(Function &&f, JacobianFunction &&Jf,
+                   const Eigen::VectorXd &y0, Eigen::VectorXd &y1, double hs);
+  // one simplified Newton iteration, returns the correction of G (n x s)
+  Eigen::MatrixXd correction(const Eigen::MatrixXd &R);
+
+  const Eigen::MatrixXd A;
+  const Eigen::VectorXd b;
+  const double h, rtol, atol;
+  const unsigned int s;
+  static constexpr unsigned int max_iterations = 20;
+  // A^{-1} = T diag(lambda) T^{-1}; block k of the transformed system uses
+  // eigenvalue lambda(k), its conjugate partner (-1 for real eigenvalues)
+  // is obtained by conjugation
+  bool diagonal = false;
+  Eigen::MatrixXd Ainv;
+  Eigen::VectorXcd lambda;
+  Eigen::MatrixXcd T, Tinv;
+  std::vector<int> partner;
+  // y1 = y0 + G d with d = A^{-T} b if A is invertible
+  Eigen::VectorXd d;
+  // stage increments of the last step, initial guess for the next one
+  Eigen::MatrixXd G_last;
+  // frozen Jacobian and its decompositions (SparseLU is not copyable, the
+  // vectors are never resized)
+  Jacobian J;
+  bool have_jacobian = false, refresh = false;
+  double h_lu = 0.;  // step size of the decompositions
+  std::vector<Real> real_lu;
+  std::vector<Complex> complex_lu;
+  Real full_lu;
+};
+
+template <class JacobianMatrix>
+void IRKStageSolver<JacobianMatrix>::diagonalize() {
+  const Eigen::FullPivLU<Eigen::MatrixXd> luA(A);
+  if (!luA.isInvertible()) return;
+  Ainv = luA.inverse();
+  d = luA.transpose().solve(b);
+  const Eigen::EigenSolver<Eigen::MatrixXd> es(Ainv);
+  if (es.info() != Eigen::Success) return;
+  lambda = es.eigenvalues();
+  T = es.eigenvectors();
+  partner.assign(s, -1);
+  const double small = 1e-12 * lambda.cwiseAbs().maxCoeff();
+  for (unsigned int i = 0; i < s; ++i) {
+    if (std::abs(lambda(i).imag()) <= small) {
+      lambda(i) = lambda(i).real();
+      T.col(i) = T.col(i).real().cast<std::complex<double>>();
+    } else if (lambda(i).imag() > 0 && partner[i] < 0) {
+      // the eigenvector of the conjugate eigenvalue is the conjugate one
+      for (unsigned int j = 0; j < s; ++j) {
+        if (j != i && partner[j] < 0 &&
+            std::abs(lambda(j) - std::conj(lambda(i))) <= small) {
+          partner[i] = j;
+          partner[j] = i;
+          T.col(j) = T.col(i).conjugate();
+          break;
+        }
+      }
+    }
+  }
+  // non-diagonalizable or badly conditioned: full system
+  const Eigen::JacobiSVD<Eigen::MatrixXcd> svd(T);
+  const Eigen::VectorXd sv = svd.singularValues();
+  if (sv(s - 1) <= 1e-8 * sv(0)) return;
+  Tinv = T.inverse();
+  diagonal = true;
+}
+
+// LU-decompositions of lambda_i / h I - J for one eigenvalue of each
+// conjugate pair, or of I - h A x J
+template <class JacobianMatrix>
+void IRKStageSolver<JacobianMatrix>::decompose(double hs) {
+  using irkstagesolver_detail::shifted;
+  ++statistics.decompositions;
+  h_lu = hs;
+  if (!diagonal) {
+    if constexpr (sparse) {
+      Jacobian I(s * J.rows(), s * J.cols());
+      I.setIdentity();
+      const Jacobian As = A.sparseView();
+      full_lu.compute(I - hs * Jacobian(Eigen::kroneckerProduct(As, J)));
+    } else {
+      full_lu.compute(Eigen::MatrixXd::Identity(s * J.rows(), s * J.cols()) -
+                      hs * Eigen::kroneckerProduct(A, J));
+    }
+    return;
+  }
+  for (unsigned int i = 0; i < s; ++i) {
+    if (partner[i] < 0) {
+      real_lu[i].compute(shifted(lambda(i).real() / hs, J));
+    } else if (lambda(i).imag() > 0) {
+      complex_lu[i].compute(shifted(lambda(i) / hs, J));
+    }
+  }
+}
+
+// Correction for the residual R = F(G) - G A^{-T} / h (diagonal case) or
+// R = h F(G) A^T - G (full system), stages in the columns
+template <class JacobianMatrix>
+Eigen::MatrixXd IRKStageSolver<JacobianMatrix>::correction(
+    const Eigen::MatrixXd &R) {
+  const Eigen::Index n = R.rows();
+  if (!diagonal) {
+    const Eigen::VectorXd dg =
+        full_lu.solve(Eigen::Map<const Eigen::VectorXd>(R.data(), n * s));
+    return Eigen::Map<const Eigen::MatrixXd>(dg.data(), n, s);
+  }
+  // transform, solve the decoupled systems, transform back
+  const Eigen::MatrixXcd Rt = R * Tinv.transpose();
+  Eigen::MatrixXcd W(n, s);
+  for (unsigned int i = 0; i < s; ++i) {
+    if (partner[i] < 0) {
+      W.col(i) = real_lu[i].solve(Rt.col(i).real())
+                     .template cast<std::complex<double>>();
+    } else if (lambda(i).imag() > 0) {
+      W.col(i) = complex_lu[i].solve(Rt.col(i));
+      W.col(partner[i]) = W.col(i).conjugate();
+    }
+  }
+  return (W * T.transpose()).real();
+}
+
+template <class JacobianMatrix>
+template <class Function, class JacobianFunction>
+bool IRKStageSolver<JacobianMatrix>::step(Function &&f,
+                                          JacobianFunction &&Jf,
+                                          const Eigen::VectorXd &y0,
+                                          Eigen::VectorXd &y1) {
+  ++statistics.steps;
+  if (solveStages(f, Jf, y0, y1, h)) return true;
+  // retry once with two steps of size h/2
+  ++statistics.retries;
+  Eigen::VectorXd ym;
+  const bool ok =
+      solveStages(f, Jf, y0, ym, h / 2) && solveStages(f, Jf, ym, y1, h / 2);
+  // the decompositions and stages belong to h/2
+  refresh = true;
+  G_last.resize(0, 0);
+  if (!ok) ++statistics.failures;
+  return ok;
+}
+
+template <class JacobianMatrix>
+template <class Function, class JacobianFunction>
+bool IRKStageSolver<JacobianMatrix>::solveStages(Function &&f,
+                                                 JacobianFunction &&Jf,
+                                                 const Eigen::VectorXd &y0,
+                                                 Eigen::VectorXd &y1,
+                                                 double hs) {
+  const Eigen::Index n = y0.size();
+  const double tol = hs * (atol + rtol * y0.norm());
+  Eigen::MatrixXd G(n, s), FG(n, s);
+  const bool guess = G_last.rows() == n && hs == h_lu;
+  // at most two attempts: with the frozen Jacobian, with a fresh one
+  for (int attempt = 0; attempt < 2; ++attempt) {
+    const bool fresh =
+        !have_jacobian || refresh || hs != h_lu || attempt > 0;
+    if (fresh) {
+      J = Jf(y0);
+      have_jacobian = true;
+      refresh = false;
+      ++statistics.jacobians;
+      decompose(hs);
+    }
+    // the stages change by O(h^2) from step to step
+    if (guess && attempt == 0) {
+      G = G_last;
+    } else {
+      G.setZero();
+    }
+    double prev = 0., theta_max = 0.;
+    bool converged = false;
+    for (unsigned int k = 0; k < max_iterations && !converged; ++k) {
+      ++statistics.iterations;
+      for (unsigned int j = 0; j < s; ++j) FG.col(j) = f(y0 + G.col(j));
+      Eigen::MatrixXd R;
+      if (diagonal) {
+        R = FG - G * Ainv.transpose() / hs;
+      } else {
+        R = hs * FG * A.transpose() - G;
+      }
+      const Eigen::MatrixXd dG = correction(R);
+      G += dG;
+      const double nd = dG.norm();
+      if (!std::isfinite(nd)) break;
+      if (nd <= 8 * std::numeric_limits<double>::epsilon() * G.norm()) {
+        converged = true;  // roundoff level
+      } else if (k == 0) {
+        converged = nd <= 1e-3 * tol;
+      } else {
+        const double theta = nd / prev;
+        theta_max = std::max(theta_max, theta);
+        if (theta >= 1.) break;  // diverging
+        converged = theta / (1. - theta) * nd <= tol;
+        // slow contraction, hopeless within max_iterations: give up early,
+        // but only after the contraction rate has been observed twice
+        if (!converged && k >= 2 && theta > 0.5 &&
+            std::pow(theta, max_iterations - 1 - k) / (1. - theta) * nd > tol) {
+          break;
+        }
+      }
+      prev = nd;
+    }
+    if (converged) {
+      // slow contraction: evaluate Df again before the next step
+      refresh = theta_max > 0.3;
+      G_last = G;
+      if (diagonal) {
+        y1 = y0 + G * d;
+      } else {
+        for (unsigned int j = 0; j < s; ++j) FG.col(j) = f(y0 + G.col(j));
+        y1 = y0 + hs * FG * b;
+      }
+      return true;
+    }
+    // with a Jacobian evaluated at y0 a second attempt cannot do better
+    if (fresh) break;
+  }
+  refresh = true;
+  G_last.resize(0, 0);
+  return false;
+}
+/* SAM_LISTING_END_0 */
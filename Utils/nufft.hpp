@@ -0,0 +1 @@
+#include "../LectureCodes/FuncApproximation/nufft/Eigen/nufft.hpp"
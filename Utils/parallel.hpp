@@ -0,0 +1,60 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <exception>
+#include <thread>
+#include <vector>
+
+//! @brief Default number of worker threads: the number of hardware threads
+inline unsigned int defaultNumThreads() {
+  const unsigned int n = std::thread::hardware_concurrency();
+  return n > 0 ? n : 1;
+}
+
+//! @brief Number of threads actually used for n work items
+//! @param[in] n number of work items
+//! @param[in] num_threads requested number of threads, 0 = default
+inline unsigned int numThreadsFor(std::size_t n, unsigned int num_threads) {
+  if (num_threads == 0) num_threads = defaultNumThreads();
+  return static_cast<unsigned int>(
+      std::max<std::size_t>(1, std::min<std::size_t>(n, num_threads)));
+}
+
+//! @brief Split the index range [0,n) into contiguous chunks, one per thread,
+//! and call body(begin, end, thread_id) for each chunk concurrently.
+//! Exceptions thrown in a worker are rethrown in the calling thread.
+//! @param[in] n length of the index range
+//! @param[in] body callable with signature (size_t, size_t, unsigned int)
+//! @param[in] num_threads number of threads, 0 = defaultNumThreads()
+template <class Body>
+void parallelFor(std::size_t n, Body&& body, unsigned int num_threads = 0) {
+  const unsigned int p = numThreadsFor(n, num_threads);
+  if (p == 1) {
+    if (n > 0) body(std::size_t(0), n, 0u);
+    return;
+  }
+  std::vector<std::thread> threads;
+  std::vector<std::exception_ptr> errors(p);
+  threads.reserve(p - 1);
+  const auto chunk = [n, p](unsigned int t) { return n * t / p; };
+  for (unsigned int t = 1; t < p; ++t) {
+    threads.emplace_back([&, t] {
+      try {
+        body(chunk(t), chunk(t + 1), t);
+      } catch (...) {
+        errors[t] = std::current_exception();
+      }
+    });
+  }
+  // the calling thread processes the first chunk
+  try {
+    body(chunk(0), chunk(1), 0u);
+  } catch (...) {
+    errors[0] = std::current_exception();
+  }
+  for (auto& th : threads) th.join();
+  for (auto& e : errors) {
+    if (e) std::rethrow_exception(e);
+  }
+}
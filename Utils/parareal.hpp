@@ -0,0 +1,126 @@
+#pragma once
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <vector>
+
+#include "parallel.hpp"
+
+//! \file parareal.hpp Parallel-in-time integration of autonomous ODEs with
+//! the parareal algorithm [Lions, Maday, Turinici, C. R. Acad. Sci. 332
+//! (2001)].
+//!
+//! [0,T] is split into N time slices of length dt = T/N with boundary
+//! values U_n ~ y(n dt). Given a cheap coarse propagator G (e.g. a few steps
+//! of an explicit Runge-Kutta method) and an accurate fine propagator F
+//! (e.g. ode45 with tight tolerances), iteration k computes
+//!   U_{n+1}^{k+1} = G(U_n^{k+1}) + F(U_n^k) - G(U_n^k),
+//! where the expensive values F(U_n^k) of all slices are independent and
+//! are computed concurrently, while only the cheap coarse sweep is serial.
+//! After k iterations U_0, ..., U_k coincide with the serial fine solution,
+//! hence at most N iterations are needed; with K << N iterations and p
+//! threads the speedup over the serial fine solution is at best about
+//!   min(p, N) / K,
+//! reduced by the serial coarse sweeps.
+
+//! \brief Configuration of parareal()
+struct PararealOptions {
+  //! Tolerance for the relative change of the slice boundary values
+  double tol = 1e-10;
+  //! Maximal number of iterations (0 = number of slices)
+  unsigned int max_iterations = 0;
+  //! Threads for the fine propagations (0 = defaultNumThreads())
+  unsigned int num_threads = 0;
+};
+
+//! \brief Usage statistics and convergence history of parareal()
+struct PararealStatistics {
+  //! Number of parareal iterations
+  unsigned int iterations = 0;
+  //! max_n ||U_n^k - U_n^{k-1}|| / max(||U_n^k||, 1) in iteration k
+  std::vector<double> defects;
+  //! Calls of the fine and of the coarse propagator
+  unsigned int fine_calls = 0;
+  unsigned int coarse_calls = 0;
+  //! Wall clock time [s] spent in fine propagation and in coarse sweeps
+  double fine_time = 0.;
+  double coarse_time = 0.;
+};
+
+//! \brief Parareal iteration for y' = f(y), y(0) = y0 on [0, T].
+//! \tparam State Eigen vector type of the state
+//! \tparam Coarse, Fine propagators State(const State &y, double dt)
+//! approximating y(dt) for the initial value y; Fine must be safe to call
+//! from several threads at once, e.g. a lambda creating its own ode45.
+//! \param[in] G coarse propagator
+//! \param[in] F fine propagator
+//! \param[in] y0 initial value
+//! \param[in] T final time
+//! \param[in] N number of time slices
+//! \param[in] options see PararealOptions
+//! \param[out] stats optional statistics
+//! \return the N+1 slice boundary values U_0 = y0, ..., U_N ~ y(T)
+template <class State, class Coarse, class Fine>
+std::vector<State> parareal(const Coarse &G, const Fine &F, const State &y0,
+                            double T, unsigned int N,
+                            const PararealOptions &options = {},
+                            PararealStatistics *stats = nullptr) {
+  PararealStatistics dummy;
+  PararealStatistics &st = stats ? *stats : dummy;
+  using clock = std::chrono::high_resolution_clock;
+  const auto seconds = [](clock::time_point start) {
+    return std::chrono::duration<double>(clock::now() - start).count();
+  };
+  const double dt = T / N;
+  const unsigned int max_it =
+      options.max_iterations > 0 ? std::min(options.max_iterations, N) : N;
+
+  // Initial guess U^0 by a serial coarse sweep; Gu[n] = G(U_n^k)
+  std::vector<State> U, Gu(N), Fu(N);
+  U.reserve(N + 1);
+  U.push_back(y0);
+  auto start = clock::now();
+  for (unsigned int n = 0; n < N; ++n) {
+    Gu[n] = G(U[n], dt);
+    U.push_back(Gu[n]);
+  }
+  st.coarse_calls += N;
+  st.coarse_time += seconds(start);
+
+  for (unsigned int k = 0; k < max_it; ++k) {
+    // Fine propagation of the slices not yet converged, concurrently
+    start = clock::now();
+    parallelFor(
+        N - k,
+        [&](std::size_t begin, std::size_t end, unsigned int) {
+          for (std::size_t n = k + begin; n < k + end; ++n) {
+            Fu[n] = F(U[n], dt);
+          }
+        },
+        options.num_threads);
+    st.fine_calls += N - k;
+    st.fine_time += seconds(start);
+    // Serial coarse sweep with correction; U_k is unchanged, so that
+    // U_{k+1} becomes the fine solution
+    start = clock::now();
+    double defect = 0.;
+    for (unsigned int n = k; n < N; ++n) {
+      State u = Fu[n];
+      if (n > k) {
+        State g = G(U[n], dt);
+        u += g - Gu[n];
+        Gu[n] = std::move(g);
+        ++st.coarse_calls;
+      }
+      defect = std::max(defect, (u - U[n + 1]).norm() /
+                                    std::max(u.norm(), 1.));
+      U[n + 1] = std::move(u);
+    }
+    st.coarse_time += seconds(start);
+    ++st.iterations;
+    st.defects.push_back(defect);
+    if (defect <= options.tol) break;
+  }
+  return U;
+}
@@ -0,0 +1,710 @@
+#pragma once
+
+#include <Eigen/Dense>
+#include <Eigen/Sparse>
+#include <Eigen/SparseLU>
+#include <algorithm>
+#include <cmath>
+#include <functional>
+#include <iostream>
+#include <limits>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "fdjacobian.hpp"
+#include "ode45.hpp"
+
+//! \file stiffode.hpp Contains a header only class for adaptive integration
+//! of stiff ODEs, with the same interface as ode45.
+
+//! \brief Integrators of stiffode
+enum class StiffMethod {
+  //! Rosenbrock-W method of order 2 with embedded error estimate of order 3
+  //! (MATLAB's ode23s). Order 2 for any approximation of the Jacobian, so
+  //! the Jacobian is kept as long as steps are accepted.
+  Rosenbrock23,
+  //! TR-BDF2, an L-stable ESDIRK method of order 2 with embedded error
+  //! estimate of order 3 (MATLAB's ode23tb); one LU-decomposition per step
+  //! size serves both implicit stages.
+  TRBDF2,
+  //! Variable order (1-5) numerical differentiation formulas in backward
+  //! difference form (MATLAB's ode15s); plain BDF with options.ndf = false.
+  NDF,
+  //! Explicit Dormand-Prince 5(4) as long as the problem is not stiff,
+  //! switching to NDF when stiffness is detected and back when the
+  //! explicit method would be stable with the current step size (LSODA).
+  Auto
+};
+
+namespace stiffode_detail {
+// LU-decomposition of I - c J for a dense Jacobian ...
+template <class Matrix>
+struct Decomposition {
+  Eigen::PartialPivLU<Matrix> lu;
+  void compute(double c, const Matrix &J) {
+    lu.compute(Matrix::Identity(J.rows(), J.cols()) - c * J);
+  }
+  template <class Vector>
+  auto solve(const Eigen::MatrixBase<Vector> &b) const {
+    return lu.solve(b).eval();
+  }
+  static double normInf(const Matrix &J) {
+    return J.cwiseAbs().rowwise().sum().maxCoeff();
+  }
+};
+
+// ... a sparse one with fixed pattern, e.g. from SparseFDJacobian: the
+// pattern is analyzed once ...
+template <>
+struct Decomposition<Eigen::SparseMatrix<double>> {
+  using Matrix = Eigen::SparseMatrix<double>;
+  Eigen::SparseLU<Matrix> lu;
+  bool analyzed = false;
+  void compute(double c, const Matrix &J) {
+    Matrix I(J.rows(), J.cols());
+    I.setIdentity();
+    Matrix M = I - c * J;
+    M.makeCompressed();
+    if (!analyzed) lu.analyzePattern(M);
+    analyzed = true;
+    lu.factorize(M);
+  }
+  Eigen::VectorXd solve(const Eigen::VectorXd &b) { return lu.solve(b); }
+  static double normInf(const Matrix &J) {
+    Eigen::VectorXd r = Eigen::VectorXd::Zero(J.rows());
+    for (Eigen::Index j = 0; j < J.outerSize(); ++j) {
+      for (Matrix::InnerIterator it(J, j); it; ++it) {
+        r(it.row()) += std::abs(it.value());
+      }
+    }
+    return r.maxCoeff();
+  }
+};
+
+// ... or a banded one, e.g. from BandedFDJacobian
+template <>
+struct Decomposition<BandedMatrix> {
+  BandedLU lu;
+  void compute(double c, const BandedMatrix &J) {
+    lu.compute(J.shiftedIdentity(c));
+  }
+  Eigen::VectorXd solve(const Eigen::VectorXd &b) const {
+    return lu.solve(b);
+  }
+  static double normInf(const BandedMatrix &J) { return J.normInf(); }
+};
+}  // namespace stiffode_detail
+
+//! \brief Class for adaptive integration of stiff ODEs \f$ y' = f(y) \f$.
+//! Works like ode45, but needs the Jacobian \f$ Df \f$:
+//!
+//! 1. Construct with right-hand side and Jacobian:
+//!     stiffode<Eigen::VectorXd> O(f, Jf);
+//!
+//! 2. (optional) Set options, e.g. the method:
+//!     O.options.method = StiffMethod::NDF;
+//!
+//! 3. Solve:
+//!     auto sol = O.solve(y0, T);
+//!
+//! 4. (optional) Get statistics or print them:
+//!     O.statistics.<stat_you_want_to_get>
+//!     O.print();
+//!
+//! All methods solve their linear systems with LU-decompositions of
+//! \f$ I - ch Df \f$; the Jacobian is only evaluated again if a Newton
+//! iteration fails or a step is rejected with an old Jacobian, and a
+//! decomposition is reused as long as \f$ ch \f$ does not change.
+//! For large sparse problems \f$ Df \f$ may return an
+//! Eigen::SparseMatrix<double> with a fixed sparsity pattern (decomposed by
+//! Eigen::SparseLU) or a BandedMatrix (decomposed by BandedLU), e.g. the
+//! colored finite difference approximations of fdjacobian.hpp:
+//!     SparseFDJacobian fd(pattern);
+//!     auto Jf = [&](const Eigen::VectorXd &y) { return fd(f, y); };
+//!     stiffode<Eigen::VectorXd, decltype(f), decltype(Jf)> O(f, Jf);
+//! \tparam StateType Eigen vector type of \f$ y \f$.
+//! \tparam RhsType type of \f$ f \f$, StateType operator()(const StateType &)
+//! \tparam JacType type of \f$ Df \f$, returns a square dense Eigen matrix,
+//! an Eigen::SparseMatrix<double> or a BandedMatrix.
+template <class StateType,
+          class RhsType = std::function<StateType(const StateType &)>,
+          class JacType = std::function<Eigen::Matrix<
+              typename StateType::Scalar, StateType::RowsAtCompileTime,
+              StateType::RowsAtCompileTime>(const StateType &)>>
+class stiffode {
+ public:
+  using JacobianType =
+      std::decay_t<std::invoke_result_t<JacType &, const StateType &>>;
+
+  //! \brief Stores copies of the r.h.s. and of its Jacobian.
+  stiffode(const RhsType &rhs, const JacType &jac) : f(rhs), Jf(jac) {}
+
+  //! \brief Solves the IVP up to time T, cf. ode45::solve().
+  //! \return vector of pairs \f$ (y(t), t) \f$ for all accepted steps.
+  template <class NormFunc = decltype(_norm<StateType>)>
+  std::vector<std::pair<StateType, double>> solve(
+      const StateType &y0, double T, const NormFunc &norm = _norm<StateType>);
+
+  //! \brief Print statistics and options of this class instance.
+  void print();
+
+  //! \brief Configuration parameters, cf. ode45::Options.
+  struct Options {
+    //!< Integrator
+    StiffMethod method = StiffMethod::Auto;
+    //!< Set true if you want to save the initial data
+    bool save_init = true;
+    //!< Set the maximum number of rejected steps in a row
+    unsigned int max_iterations = 5000;
+    //!< Set the minimum step size (-1 for none)
+    double min_dt = -1.;
+    //!< Set the maximum step size (-1 for (T - start_time) / 10)
+    double max_dt = -1.;
+    //!< Set an initial step size (-1 for automatic)
+    double initial_dt = -1.;
+    //!< Set a starting time
+    double start_time = 0;
+    //!< Relative tolerance for the error.
+    double rtol = 1e-6;
+    //!< Absolute tolerance for the error.
+    double atol = 1e-8;
+    //!< Maximal order of the NDF/BDF method (1 to 5)
+    unsigned int max_order = 5;
+    //!< NDF instead of BDF formulas
+    bool ndf = true;
+    //!< Auto: consecutive stiff steps of the explicit method before
+    //!< switching to NDF
+    unsigned int stiff_steps = 15;
+    //!< Rosenbrock23: maximal number of steps with the same Jacobian
+    unsigned int jacobian_age = 20;
+    //!< Set to true before solving to save statistics
+    bool do_statistics = false;
+  } options;
+
+  //! \brief Usage statistics, cf. ode45::Statistics.
+  struct Statistics {
+    //!< Number of loops (sum of all accepted and rejected steps)
+    unsigned int cycles = 0;
+    //!< Number of actual time steps performed (accepted step)
+    unsigned int steps = 0;
+    //!< Number of rejected steps
+    unsigned int rejected_steps = 0;
+    //!< Function calls
+    unsigned int funcalls = 0;
+    //!< Jacobian evaluations
+    unsigned int jaccalls = 0;
+    //!< LU-decompositions
+    unsigned int decompositions = 0;
+    //!< Accepted steps of the implicit method (Auto)
+    unsigned int stiff_steps = 0;
+    //!< Switches between explicit and implicit method (Auto)
+    unsigned int switches = 0;
+  } statistics;
+
+ private:
+  // A copy of rhs and of its Jacobian stored during initialization
+  RhsType f;
+  JacType Jf;
+  // Current time and step size
+  double t, h;
+  // Jacobian, LU-decomposition of I - c J, and c (-1: not decomposed)
+  JacobianType J;
+  stiffode_detail::Decomposition<JacobianType> lu;
+  double ch = -1.;
+  bool have_jacobian = false, jacobian_current = false;
+  unsigned int jacobian_steps = 0;
+  // NDF: order, backward differences \nabla^j y in column j-1, number of
+  // steps with the current order and step size, failures of this step
+  unsigned int k = 1, k_steps = 0, k_fails = 0;
+  Eigen::MatrixXd dif;
+  // Auto: explicit (non-stiff) mode, counters of the stiffness detection
+  bool explicit_mode = true;
+  unsigned int stiff_count = 0, nonstiff_count = 0;
+
+  StateType rhs(const StateType &y) {
+    ++statistics.funcalls;
+    return f(y);
+  }
+  void jacobian(const StateType &y) {
+    J = Jf(y);
+    ++statistics.jaccalls;
+    have_jacobian = jacobian_current = true;
+    jacobian_steps = 0;
+    ch = -1.;
+  }
+  void decompose(double c) {
+    if (c == ch) return;
+    lu.compute(c, J);
+    ++statistics.decompositions;
+    ch = c;
+  }
+  // Rejected steps in a row
+  unsigned int iterations = 0;
+  // Step size factor from the error estimate for a method of order p, no
+  // increase right after a rejection
+  double factor(double err, double tol, unsigned int p) const {
+    const double fmax = iterations > 0 ? 1. : 5.;
+    if (err <= std::numeric_limits<double>::epsilon() * tol) return fmax;
+    return std::min(fmax, std::max(0.2, 0.9 * std::pow(tol / err, 1. / p)));
+  }
+
+  template <class NormFunc>
+  bool newton(StateType &z, const StateType &base, double c, double tol,
+              const NormFunc &norm);
+  template <class NormFunc>
+  bool rosenbrockStep(StateType &y, StateType &fy, double tol,
+                      const NormFunc &norm);
+  template <class NormFunc>
+  bool trbdf2Step(StateType &y, StateType &fy, double tol,
+                  const NormFunc &norm);
+  template <class NormFunc>
+  bool ndfStep(StateType &y, double tol, const NormFunc &norm);
+  template <class NormFunc>
+  bool dopriStep(StateType &y, StateType &fy, double tol,
+                 const NormFunc &norm);
+  void ndfStart(const StateType &fy);
+  void ndfRescale(double rho);
+};
+
+/* SAM_LISTING_BEGIN_0 */
+// Simplified Newton iteration for z = base + c f(z) with the decomposition
+// of I - c J; false if it does not converge within 5 steps
+template <class StateType, class RhsType, class JacType>
+template <class NormFunc>
+bool stiffode<StateType, RhsType, JacType>::newton(StateType &z,
+                                                   const StateType &base,
+                                                   double c, double tol,
+                                                   const NormFunc &norm) {
+  double prev = 0.;
+  for (unsigned int i = 0; i < 5; ++i) {
+    const StateType dz = lu.solve(base + c * rhs(z) - z);
+    z += dz;
+    const double nd = norm(dz);
+    if (nd <= 1e-3 * tol) return true;
+    if (i > 0) {
+      const double rate = nd / prev;
+      if (rate >= 0.9) return false;
+      if (rate / (1. - rate) * nd <= 0.05 * tol) return true;
+    }
+    prev = nd;
+  }
+  return false;
+}
+
+// Rosenbrock-W step of ode23s: W = I - d h J,
+//   W k1 = f(y),  W k2 = f(y + h/2 k1) - d h J k1,  y1 = y + h k2,
+// error estimate h/6 (k1 - 2 k2 + k3) with a third stage at y1. The order
+// does not depend on J, but the stability does: J is renewed when the step
+// size has to shrink or after options.jacobian_age steps.
+template <class StateType, class RhsType, class JacType>
+template <class NormFunc>
+bool stiffode<StateType, RhsType, JacType>::rosenbrockStep(
+    StateType &y, StateType &fy, double tol, const NormFunc &norm) {
+  const double d = 1. / (2. + std::sqrt(2.)), e32 = 6. + std::sqrt(2.);
+  if (!have_jacobian) jacobian(y);
+  decompose(d * h);
+  const StateType k1 = lu.solve(fy);
+  const StateType f1 = rhs(y + 0.5 * h * k1);
+  const StateType k2 = StateType(lu.solve(f1 - k1)) + k1;
+  const StateType y1 = y + h * k2;
+  const StateType f2 = rhs(y1);
+  const StateType k3 =
+      lu.solve(f2 - e32 * (k2 - f1) - 2. * (k1 - fy));
+  const double err = h / 6. * norm(k1 - 2. * k2 + k3);
+  const double fac = factor(err, tol, 3);
+  if (err > tol) {
+    // an old Jacobian may be the reason
+    if (!jacobian_current) jacobian(y);
+    h *= fac;
+    return false;
+  }
+  t += h;
+  y = y1;
+  fy = f2;
+  jacobian_current = false;
+  if (fac < 1. || ++jacobian_steps >= options.jacobian_age) jacobian(y);
+  h *= fac;
+  return true;
+}
+
+// TR-BDF2 as an ESDIRK method with gamma = 2 - sqrt(2), d = gamma/2,
+// w = sqrt(2)/4: trapezoidal rule to t + gamma h, BDF2 to t + h,
+//   z2 = y + d h (f(y) + f(z2)),  y1 = y + h (w f(y) + w f(z2) + d f(y1)),
+// embedded third order weights ((1-w)/3, (3w+1)/3, d/3)
+template <class StateType, class RhsType, class JacType>
+template <class NormFunc>
+bool stiffode<StateType, RhsType, JacType>::trbdf2Step(
+    StateType &y, StateType &fy, double tol, const NormFunc &norm) {
+  const double gamma = 2. - std::sqrt(2.), d = gamma / 2.;
+  const double w = std::sqrt(2.) / 4.;
+  if (!have_jacobian) jacobian(y);
+  decompose(d * h);
+  StateType z2 = y + gamma * h * fy;
+  bool ok = newton(z2, y + d * h * fy, d * h, tol, norm);
+  StateType k2, y1;
+  if (ok) {
+    // f(z2) from the stage equation, saves an evaluation
+    k2 = (z2 - y - d * h * fy) / (d * h);
+    y1 = z2 + (1. - gamma) * h * k2;
+    ok = newton(y1, y + w * h * (fy + k2), d * h, tol, norm);
+  }
+  if (!ok) {
+    if (jacobian_current) {
+      h *= 0.25;
+    } else {
+      jacobian(y);
+    }
+    return false;
+  }
+  const StateType k3 = (y1 - y - w * h * (fy + k2)) / (d * h);
+  const double err =
+      h * norm((w - (1. - w) / 3.) * fy + (w - (3. * w + 1.) / 3.) * k2 +
+               (2. * d / 3.) * k3);
+  const double fac = factor(err, tol, 3);
+  if (err > tol) {
+    if (!jacobian_current) jacobian(y);
+    h *= fac;
+    return false;
+  }
+  t += h;
+  y = y1;
+  fy = rhs(y);
+  jacobian_current = false;
+  h *= fac;
+  return true;
+}
+/* SAM_LISTING_END_0 */
+
+/* SAM_LISTING_BEGIN_1 */
+// NDF/BDF of order k in backward difference form [Shampine, Reichelt, SIAM
+// J. Sci. Comput. 18 (1997)]: predictor y^(0) = y_n + sum_{j<=k} nabla^j y_n,
+// corrector
+//   (1 - kappa) gamma_k (y_{n+1} - y^(0)) + sum_{j<=k} gamma_j nabla^j y_n
+//     = h f(y_{n+1}),   gamma_j = 1 + 1/2 + ... + 1/j,
+// error estimate (kappa gamma_k + 1/(k+1)) ||y_{n+1} - y^(0)||
+namespace stiffode_detail {
+// NDF coefficients kappa_k, k = 1, ..., 5
+constexpr double kappa[5] = {-0.1850, -1. / 9., -0.0823, -0.0415, 0.};
+inline double gamma(unsigned int k) {
+  double g = 0.;
+  for (unsigned int j = 1; j <= k; ++j) g += 1. / j;
+  return g;
+}
+// R(rho)_{jm} = prod_{i=1}^j (i - 1 - m rho) / i, j, m = 1, ..., k
+inline Eigen::MatrixXd differenceR(unsigned int k, double rho) {
+  Eigen::MatrixXd R(k, k);
+  for (unsigned int m = 1; m <= k; ++m) {
+    double p = 1.;
+    for (unsigned int j = 1; j <= k; ++j) {
+      p *= (j - 1. - m * rho) / j;
+      R(j - 1, m - 1) = p;
+    }
+  }
+  return R;
+}
+}  // namespace stiffode_detail
+
+template <class StateType, class RhsType, class JacType>
+void stiffode<StateType, RhsType, JacType>::ndfStart(const StateType &fy) {
+  k = 1;
+  k_steps = k_fails = 0;
+  dif = Eigen::MatrixXd::Zero(fy.size(), options.max_order + 2);
+  dif.col(0) = h * fy;
+}
+
+// New step size rho h: the differences are those of the interpolating
+// polynomial at the new spacing, nabla_new = nabla R(rho) U, U = R(1)
+template <class StateType, class RhsType, class JacType>
+void stiffode<StateType, RhsType, JacType>::ndfRescale(double rho) {
+  if (rho == 1.) return;
+  using stiffode_detail::differenceR;
+  dif.leftCols(k) =
+      (dif.leftCols(k) * (differenceR(k, rho) * differenceR(k, 1.))).eval();
+  h *= rho;
+  k_steps = 0;
+}
+
+template <class StateType, class RhsType, class JacType>
+template <class NormFunc>
+bool stiffode<StateType, RhsType, JacType>::ndfStep(StateType &y, double tol,
+                                                    const NormFunc &norm) {
+  using stiffode_detail::gamma;
+  const double kap = options.ndf ? stiffode_detail::kappa[k - 1] : 0.;
+  const double alpha = (1. - kap) * gamma(k);
+  Eigen::VectorXd g(k);
+  for (unsigned int j = 1; j <= k; ++j) g(j - 1) = gamma(j) / alpha;
+  const StateType y0 = y + dif.leftCols(k).rowwise().sum();
+  const StateType psi = dif.leftCols(k) * g;
+  if (!have_jacobian) jacobian(y);
+  decompose(h / alpha);
+  // Newton iteration for the correction d = y_{n+1} - y^(0)
+  StateType d = StateType::Zero(y.size()), y1 = y0;
+  bool ok = false;
+  double prev = 0.;
+  for (unsigned int i = 0; i < 4 && !ok; ++i) {
+    const StateType del = lu.solve(h / alpha * rhs(y1) - psi - d);
+    d += del;
+    y1 = y0 + d;
+    const double nd = norm(del);
+    const double rate = i > 0 ? nd / prev : 0.;
+    if (rate >= 0.9) break;
+    ok = nd <= 1e-3 * tol || (i > 0 && rate / (1. - rate) * nd <= 0.05 * tol);
+    prev = nd;
+  }
+  if (!ok) {
+    if (jacobian_current) {
+      ndfRescale(0.3);
+    } else {
+      jacobian(y);
+    }
+    return false;
+  }
+  const double err = (kap * gamma(k) + 1. / (k + 1)) * norm(d);
+  if (err > tol) {
+    // smaller steps, lower order after repeated failures
+    ++k_fails;
+    if (!jacobian_current) jacobian(y);
+    if (k_fails > 2 && k > 1) --k;
+    ndfRescale(k_fails == 1
+                   ? std::max(0.1, 0.833 * std::pow(tol / err, 1. / (k + 1)))
+                   : 0.5);
+    return false;
+  }
+  // accepted: update the differences
+  t += h;
+  y = y1;
+  jacobian_current = false;
+  k_fails = 0;
+  ++k_steps;
+  dif.col(k + 1) = d - dif.col(k);
+  dif.col(k) = d;
+  for (unsigned int j = k; j >= 1; --j) dif.col(j - 1) += dif.col(j);
+  // new order and step size, after k + 1 steps with the current ones
+  if (k_steps < k + 1) return true;
+  auto errConst = [&](unsigned int q) {
+    return (options.ndf ? stiffode_detail::kappa[q - 1] * gamma(q) : 0.) +
+           1. / (q + 1);
+  };
+  unsigned int knew = k;
+  double rho = std::pow(tol / std::max(err, 1e-300), 1. / (k + 1)) / 1.2;
+  if (k > 1) {
+    // dif.col(k - 1) = nabla^k y_{n+1} estimates the error of order k - 1
+    const double e = errConst(k - 1) * norm(StateType(dif.col(k - 1)));
+    const double r = std::pow(tol / std::max(e, 1e-300), 1. / k) / 1.3;
+    if (r > rho) {
+      rho = r;
+      knew = k - 1;
+    }
+  }
+  if (k < options.max_order) {
+    const double e = errConst(k + 1) * norm(StateType(dif.col(k + 1)));
+    const double r = std::pow(tol / std::max(e, 1e-300), 1. / (k + 2)) / 1.4;
+    if (r > rho) {
+      rho = r;
+      knew = k + 1;
+    }
+  }
+  // change only for a substantial gain, it costs a decomposition
+  if (rho > 1.2) {
+    k = knew;
+    ndfRescale(std::min(rho, 10.));
+  }
+  return true;
+}
+/* SAM_LISTING_END_1 */
+
+/* SAM_LISTING_BEGIN_2 */
+// Dormand-Prince 5(4) step with Hairer's stiffness detection: for the last
+// two stages, which both belong to t + h, h ||f(Y7) - f(Y6)|| / ||Y7 - Y6||
+// estimates h |lambda| for the dominant eigenvalue of the Jacobian; if it
+// exceeds the stability boundary 3.25 for options.stiff_steps accepted steps
+// the problem is considered stiff.
+template <class StateType, class RhsType, class JacType>
+template <class NormFunc>
+bool stiffode<StateType, RhsType, JacType>::dopriStep(StateType &y,
+                                                      StateType &fy,
+                                                      double tol,
+                                                      const NormFunc &norm) {
+  static const double a[7][6] = {
+      {0, 0, 0, 0, 0, 0},
+      {1. / 5, 0, 0, 0, 0, 0},
+      {3. / 40, 9. / 40, 0, 0, 0, 0},
+      {44. / 45, -56. / 15, 32. / 9, 0, 0, 0},
+      {19372. / 6561, -25360. / 2187, 64448. / 6561, -212. / 729, 0, 0},
+      {9017. / 3168, -355. / 33, 46732. / 5247, 49. / 176, -5103. / 18656,
+       0},
+      {35. / 384, 0, 500. / 1113, 125. / 192, -2187. / 6784, 11. / 84}};
+  // differences of the 5th and 4th order weights
+  static const double e[7] = {71. / 57600,  0,         -71. / 16695,
+                              71. / 1920,   -17253. / 339200,
+                              22. / 525,    -1. / 40};
+  std::vector<StateType> K(7, fy);
+  StateType Y = y, Y6 = y;
+  for (int i = 1; i < 7; ++i) {
+    Y = y;
+    for (int j = 0; j < i; ++j) Y += (h * a[i][j]) * K[j];
+    K[i] = rhs(Y);
+    if (i == 5) Y6 = Y;
+  }
+  StateType E = e[0] * K[0];
+  for (int i = 1; i < 7; ++i) E += e[i] * K[i];
+  const double err = h * norm(E);
+  const double fac = factor(err, tol, 5);
+  if (err > tol) {
+    h *= fac;
+    return false;
+  }
+  const double dy = norm(Y - Y6);
+  if (dy > 0. && h * norm(K[6] - K[5]) / dy > 3.25) {
+    ++stiff_count;
+    nonstiff_count = 0;
+  } else if (++nonstiff_count >= 6) {
+    stiff_count = 0;
+  }
+  t += h;
+  y = Y;
+  fy = K[6];
+  h *= fac;
+  return true;
+}
+/* SAM_LISTING_END_2 */
+
+template <class StateType, class RhsType, class JacType>
+template <class NormFunc>
+std::vector<std::pair<StateType, double>>
+stiffode<StateType, RhsType, JacType>::solve(const StateType &y0, double T,
+                                             const NormFunc &norm) {
+  t = options.start_time;
+  const double max_dt = options.max_dt > 0 ? options.max_dt : (T - t) / 10;
+  const double min_dt =
+      options.min_dt > 0 ? options.min_dt
+                         : 16 * std::numeric_limits<double>::epsilon() *
+                               std::max(std::abs(t), std::abs(T));
+  std::vector<std::pair<StateType, double>> snapshots;
+  if (options.save_init) snapshots.push_back(std::make_pair(y0, t));
+  StateType y = y0, fy = rhs(y0);
+  h = options.initial_dt;
+  if (h <= 0) {
+    // |h f(y0)| about 1% of |y0|
+    const double nf = norm(fy);
+    h = nf > 0 ? 0.01 * std::max(norm(y0), options.atol / options.rtol) / nf
+               : max_dt;
+  }
+  h = std::max(std::min(h, max_dt), min_dt);
+  have_jacobian = jacobian_current = false;
+  ch = -1.;
+  explicit_mode = options.method == StiffMethod::Auto;
+  stiff_count = nonstiff_count = 0;
+  if (options.method == StiffMethod::NDF) ndfStart(fy);
+  iterations = 0;
+  while (t < T) {
+    const bool ndf = options.method == StiffMethod::NDF ||
+                     (options.method == StiffMethod::Auto && !explicit_mode);
+    // Checked before the step is cut to the end of the time slot, as in
+    // ode45: a short last step is no failure
+    if (h < min_dt) {
+      std::cerr << "Fatal error: stiffode exited at time t = " << t
+                << " before the endpoint at tend = " << T
+                << " was reached, the step size became smaller than "
+                << "\"min_dt\"." << std::endl;
+      throw termination_error();
+    }
+    // Force hitting the endpoint of the time slot exactly
+    const double hmax = std::min(max_dt, T - t);
+    if (h > hmax) {
+      if (ndf) {
+        ndfRescale(hmax / h);
+      } else {
+        h = hmax;
+      }
+    }
+    const double tol = std::max(options.rtol * norm(y), options.atol);
+    bool accepted;
+    if (ndf) {
+      accepted = ndfStep(y, tol, norm);
+    } else if (options.method == StiffMethod::Auto) {
+      accepted = dopriStep(y, fy, tol, norm);
+    } else if (options.method == StiffMethod::Rosenbrock23) {
+      accepted = rosenbrockStep(y, fy, tol, norm);
+    } else {
+      accepted = trbdf2Step(y, fy, tol, norm);
+    }
+    ++statistics.cycles;
+    if (!accepted) {
+      ++statistics.rejected_steps;
+      if (++iterations >= options.max_iterations) {
+        std::cerr << "Fatal error: stiffode exited at time t = " << t
+                  << " after " << iterations << " rejected steps."
+                  << std::endl;
+        throw termination_error();
+      }
+      continue;
+    }
+    iterations = 0;
+    ++statistics.steps;
+    // h * (hmax / h) may miss hmax by a few ulps: T is reached
+    if (T - t <= min_dt) t = T;
+    snapshots.push_back(std::make_pair(y, t));
+    if (options.method != StiffMethod::Auto) continue;
+    // switching between the explicit and the implicit method
+    if (explicit_mode && stiff_count >= options.stiff_steps) {
+      explicit_mode = false;
+      ++statistics.switches;
+      jacobian(y);
+      ndfStart(fy);
+    } else if (!explicit_mode) {
+      ++statistics.stiff_steps;
+      // ||J||_inf >= |lambda|: explicit method stable with step size h
+      if (++nonstiff_count % 10 == 0) {
+        if (!jacobian_current) jacobian(y);
+        if (h * lu.normInf(J) <= 3.25 / 2) {
+          explicit_mode = true;
+          ++statistics.switches;
+          stiff_count = nonstiff_count = 0;
+          fy = rhs(y);
+        }
+      }
+    }
+  }
+  return snapshots;
+}
+
+template <class StateType, class RhsType, class JacType>
+void stiffode<StateType, RhsType, JacType>::print() {
+  static const char *names[] = {"Rosenbrock23", "TR-BDF2", "NDF",
+                                "Auto (DOPRI5/NDF)"};
+  std::cout << "----------------------------------" << std::endl;
+  std::cout << "--- Report of ODE solve stiffode. ---" << std::endl;
+  std::cout << "----------------------------------" << std::endl;
+  std::cout << " + Data:" << std::endl;
+  std::cout << "    - current time of simulation:         " << t << std::endl;
+  std::cout << " + Options:" << std::endl;
+  std::cout << "    - method:                             "
+            << names[static_cast<int>(options.method)] << std::endl;
+  std::cout << "    - relative tolerance:                 " << options.rtol
+            << std::endl;
+  std::cout << "    - absolute tolerance:                 " << options.atol
+            << std::endl;
+  std::cout << "    - maximal NDF order:                  "
+            << options.max_order << std::endl;
+  if (!options.do_statistics) return;
+  std::cout << " + Statistics:" << std::endl;
+  std::cout << "    - number of steps:                    " << statistics.steps
+            << std::endl;
+  std::cout << "    - number of rejected steps:           "
+            << statistics.rejected_steps << std::endl;
+  std::cout << "    - function calls:                     "
+            << statistics.funcalls << std::endl;
+  std::cout << "    - Jacobian evaluations:               "
+            << statistics.jaccalls << std::endl;
+  std::cout << "    - LU-decompositions:                  "
+            << statistics.decompositions << std::endl;
+  if (options.method == StiffMethod::Auto) {
+    std::cout << "    - steps of the implicit method:       "
+              << statistics.stiff_steps << std::endl;
+    std::cout << "    - method switches:                    "
+              << statistics.switches << std::endl;
+  }
+  std::cout << "----------------------------------" << std::endl;
+}
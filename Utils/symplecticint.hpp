@@ -0,0 +1,239 @@
+#pragma once
+
+#include <Eigen/Dense>
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <iostream>
+#include <stdexcept>
+#include <vector>
+
+#include "parallel.hpp"
+
+//! \file symplecticint.hpp Contains a header only class for symplectic
+//! splitting methods for separable Hamiltonian systems of many particles
+//!   H(p, q) = sum_i |p_i|^2 / (2 m_i) + V(q),
+//!   q' = M^{-1} p,  p' = -grad V(q) = f(q).
+//!
+//! A splitting method alternates exact flows of the two parts, "kicks"
+//! p += b_i tau f(q) and "drifts" q += a_i tau M^{-1} p:
+//!   kick(b_0) drift(a_0) kick(b_1) ... drift(a_{s-1}) kick(b_s).
+//! Each sub-step is a symplectic map, hence so is the method; the energy
+//! error does not drift but stays bounded over exponentially long times.
+//! The force after the last drift is reused by the first kick of the next
+//! step, so s force evaluations are needed per step.
+//!
+//! Particles are stored as structure of arrays: an n x D array, column
+//! major, holds one contiguous array per coordinate, so that kicks and
+//! drifts are unit-stride loops that the compiler vectorizes with the
+//! instruction set enabled (e.g. -march=native for AVX). For large n
+//! they are split among threads with parallelFor().
+
+//! \brief Splitting methods provided by symplecticint
+enum class SymplecticMethod {
+  //! Stoermer-Verlet (velocity Verlet, leapfrog), order 2, 1 force/step
+  StormerVerlet,
+  //! McLachlan's 2-stage method of order 2 with minimal error constant,
+  //! kick(l) drift(1/2) kick(1-2l) drift(1/2) kick(l), l = 0.1932
+  //! [McLachlan, SIAM J. Sci. Comput. 16 (1995)], 2 forces/step
+  McLachlan2,
+  //! Forest-Ruth/Yoshida triple jump of Stoermer-Verlet, order 4,
+  //! 3 forces/step
+  ForestRuth4,
+  //! Yoshida's 7-fold composition of Stoermer-Verlet ("solution A"),
+  //! order 6, 7 forces/step
+  Yoshida6
+};
+
+//! \brief Coefficients a_0..a_{s-1} (drifts) and b_0..b_s (kicks)
+struct SplittingCoefficients {
+  std::vector<double> a, b;
+  unsigned int order;
+};
+
+//! \brief Symmetric composition of Stoermer-Verlet steps with weights w:
+//! neighbouring half kicks are merged
+inline SplittingCoefficients verletComposition(const std::vector<double> &w,
+                                               unsigned int order) {
+  SplittingCoefficients c{w, std::vector<double>(w.size() + 1, 0.), order};
+  for (std::size_t i = 0; i < w.size(); ++i) {
+    c.b[i] += 0.5 * w[i];
+    c.b[i + 1] += 0.5 * w[i];
+  }
+  return c;
+}
+
+//! \brief Coefficients of a method from SymplecticMethod
+inline SplittingCoefficients splittingCoefficients(SymplecticMethod method) {
+  switch (method) {
+    case SymplecticMethod::StormerVerlet:
+      return verletComposition({1.}, 2);
+    case SymplecticMethod::McLachlan2: {
+      const double l = 0.1931833275037836;
+      return {{0.5, 0.5}, {l, 1. - 2. * l, l}, 2};
+    }
+    case SymplecticMethod::ForestRuth4: {
+      const double w1 = 1. / (2. - std::cbrt(2.)), w0 = 1. - 2. * w1;
+      return verletComposition({w1, w0, w1}, 4);
+    }
+    case SymplecticMethod::Yoshida6: {
+      const double w1 = -1.17767998417887, w2 = 0.235573213359357,
+                   w3 = 0.784513610477560, w0 = 1. - 2. * (w1 + w2 + w3);
+      return verletComposition({w3, w2, w1, w0, w1, w2, w3}, 6);
+    }
+  }
+  throw std::invalid_argument("Unknown symplectic method");
+}
+
+//! \brief Online monitoring of the energy error E(t)/E(0) - 1: its maximum
+//! and the slope of its least squares line, i.e. the energy drift per unit
+//! time; O(1) storage, nothing of the trajectory is kept.
+struct EnergyDiagnostics {
+  double e0 = 0.;             //!< Initial energy
+  double energy = 0.;         //!< Latest energy
+  double max_rel_error = 0.;  //!< max |E(t) / E(0) - 1|
+  unsigned int samples = 0;   //!< Number of recorded energies
+
+  //! \brief Record the energy e at time t
+  void add(double t, double e) {
+    if (samples == 0) e0 = e;
+    energy = e;
+    const double d = e / e0 - 1.;
+    max_rel_error = std::max(max_rel_error, std::abs(d));
+    ++samples;
+    s_t += t;
+    s_tt += t * t;
+    s_d += d;
+    s_td += t * d;
+  }
+  //! \brief Slope of the least squares line through (t, E(t)/E(0) - 1)
+  double drift() const {
+    const double den = samples * s_tt - s_t * s_t;
+    return den > 0. ? (samples * s_td - s_t * s_d) / den : 0.;
+  }
+
+ private:
+  double s_t = 0., s_tt = 0., s_d = 0., s_td = 0.;  // running sums
+};
+
+//! \brief Class for symplectic splitting methods on particle arrays.
+//! \tparam D spatial dimension
+//! \tparam ForceType functor double(const Array &q, Array &f) that stores
+//! the forces -grad V(q) in f (n x D) and returns V(q); it may itself
+//! evaluate the forces in parallel, e.g. with parallelFor().
+//!
+//! Usage:
+//!     symplecticint<3, decltype(force)> S(force, minv);
+//!     S.options.method = SymplecticMethod::ForestRuth4;
+//!     S.solve(q, p, T, N);
+//!     S.print();
+template <int D, class ForceType>
+class symplecticint {
+ public:
+  using Array = Eigen::Array<double, Eigen::Dynamic, D>;
+
+  //! \param[in] force force functor, see above
+  //! \param[in] minv inverse masses 1/m_i of the n particles
+  symplecticint(const ForceType &force, const Eigen::ArrayXd &minv)
+      : force(force), minv(minv) {}
+
+  //! \brief Configuration of solve()
+  struct Options {
+    SymplecticMethod method = SymplecticMethod::StormerVerlet;
+    //! Threads for kicks, drifts and kinetic energies (0 = default);
+    //! fewer than min_chunk particles per thread are not worth it
+    unsigned int num_threads = 0;
+    std::size_t min_chunk = 1 << 15;
+    //! Record the energy every diagnostics_every steps (0 = never)
+    unsigned int diagnostics_every = 1;
+  } options;
+
+  //! \brief Usage statistics of the last call of solve()
+  struct Statistics {
+    unsigned int steps = 0;
+    unsigned int force_calls = 0;
+  } statistics;
+
+  //! \brief Energy diagnostics of the last call of solve()
+  EnergyDiagnostics diagnostics;
+
+  //! \brief N equidistant steps from time 0 to T for the particles
+  //! (q, p), which are overwritten with the values at T.
+  void solve(Array &q, Array &p, double T, unsigned int N) {
+    const SplittingCoefficients c = splittingCoefficients(options.method);
+    const double tau = T / N;
+    statistics = Statistics();
+    diagnostics = EnergyDiagnostics();
+    Array f(q.rows(), D);
+    double V = force(q, f);
+    ++statistics.force_calls;
+    if (options.diagnostics_every > 0) diagnostics.add(0., V + kinetic(p));
+    for (unsigned int k = 1; k <= N; ++k) {
+      for (std::size_t i = 0; i < c.a.size(); ++i) {
+        kick(p, f, c.b[i] * tau);
+        drift(q, p, c.a[i] * tau);
+        V = force(q, f);
+        ++statistics.force_calls;
+      }
+      kick(p, f, c.b.back() * tau);
+      ++statistics.steps;
+      if (options.diagnostics_every > 0 &&
+          (k % options.diagnostics_every == 0 || k == N)) {
+        diagnostics.add(k * tau, V + kinetic(p));
+      }
+    }
+  }
+
+  //! \brief Kinetic energy sum_i |p_i|^2 / (2 m_i)
+  double kinetic(const Array &p) const {
+    std::vector<double> partial(threads(p.rows()), 0.);
+    parallelFor(
+        p.rows(),
+        [&](std::size_t b, std::size_t e, unsigned int t) {
+          partial[t] = 0.5 * (p.middleRows(b, e - b).square().rowwise().sum() *
+                              minv.segment(b, e - b))
+                                 .sum();
+        },
+        threads(p.rows()));
+    double s = 0.;
+    for (double x : partial) s += x;
+    return s;
+  }
+
+  //! \brief Print statistics and energy diagnostics
+  void print() const {
+    std::cout << "steps " << statistics.steps << ", force evaluations "
+              << statistics.force_calls << ", energy " << diagnostics.energy
+              << ", max |E/E0 - 1| " << diagnostics.max_rel_error
+              << ", drift " << diagnostics.drift() << " per unit time\n";
+  }
+
+ private:
+  // p += c f
+  void kick(Array &p, const Array &f, double c) const {
+    parallelFor(
+        p.rows(),
+        [&](std::size_t b, std::size_t e, unsigned int) {
+          p.middleRows(b, e - b) += c * f.middleRows(b, e - b);
+        },
+        threads(p.rows()));
+  }
+  // q += c M^{-1} p
+  void drift(Array &q, const Array &p, double c) const {
+    parallelFor(
+        q.rows(),
+        [&](std::size_t b, std::size_t e, unsigned int) {
+          q.middleRows(b, e - b) +=
+              c * (p.middleRows(b, e - b).colwise() * minv.segment(b, e - b));
+        },
+        threads(q.rows()));
+  }
+  unsigned int threads(std::size_t n) const {
+    const std::size_t max_threads = std::max<std::size_t>(
+        1, n / std::max<std::size_t>(options.min_chunk, 1));
+    return numThreadsFor(max_threads, options.num_threads);
+  }
+
+  ForceType force;
+  Eigen::ArrayXd minv;
+};